@@ -35,6 +35,8 @@
 #include "SDL_endian.h"
 #include "SDL_error.h"
 #include "SDL_events.h"
+#include "SDL_hints.h"
+#include "SDL_jobs.h"
 #include "SDL_loadso.h"
 #include "SDL_mutex.h"
 #include "SDL_rwops.h"
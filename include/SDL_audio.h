@@ -55,6 +55,17 @@ extern "C" {
  *     and left channels in LR ordering.
  *     Note that the number of samples is directly related to time by the
  *     following formula:  ms = (samples*1000)/freq
+ * - 'desired->channels' is the number of channels, from 1 to 8.  The
+ *     samples of each frame are stored in this order:
+ *       1: mono
+ *       2: front left, front right
+ *       3: front left, front right, LFE
+ *       4: front left, front right, back left, back right
+ *       5: as 4 channels, with LFE after the front right
+ *       6: front left, front right, center, LFE, back left, back right
+ *       7: front left, front right, center, LFE, back center,
+ *          side left, side right
+ *       8: as 6 channels, followed by side left, side right (7.1)
  * - 'desired->size' is the size in bytes of the audio buffer, and is
  *     calculated by SDL_OpenAudio().
  * - 'desired->silence' is the value used to set the buffer to silence,
@@ -74,7 +85,7 @@ extern "C" {
 typedef struct SDL_AudioSpec {
 	int freq;		/**< DSP frequency -- samples per second */
 	Uint16 format;		/**< Audio data format */
-	Uint8  channels;	/**< Number of channels: 1 mono, 2 stereo */
+	Uint8  channels;	/**< Number of channels: 1 mono, 2 stereo, up to 8 */
 	Uint8  silence;		/**< Audio buffer silence value (calculated) */
 	Uint16 samples;		/**< Audio buffer size in samples (power of 2) */
 	Uint16 padding;		/**< Necessary for some compile environments */
@@ -124,7 +135,7 @@ typedef struct SDL_AudioSpec {
 
 /** A structure to hold a set of audio conversion filters and buffers */
 typedef struct SDL_AudioCVT {
-	int needed;			/**< Set to 1 if conversion possible */
+	int needed;			/**< Set to nonzero if conversion possible */
 	Uint16 src_format;		/**< Source audio format */
 	Uint16 dst_format;		/**< Target audio format */
 	double rate_incr;		/**< Rate conversion increment */
@@ -195,6 +206,12 @@ extern DECLSPEC SDL_audiostatus SDLCALL SDL_GetAudioStatus(void);
  */
 extern DECLSPEC void SDLCALL SDL_PauseAudio(int pause_on);
 
+/**
+ * Get the time in microseconds between the audio callback filling a buffer
+ * and the buffer being heard, or -1 if the audio driver can't tell.
+ */
+extern DECLSPEC int SDLCALL SDL_GetAudioLatency(void);
+
 /**
  * This function loads a WAVE from the data source, automatically freeing
  * that source if 'freesrc' is non-zero.  For example, to load a WAVE file,
@@ -223,6 +240,55 @@ extern DECLSPEC SDL_AudioSpec * SDLCALL SDL_LoadWAV_RW(SDL_RWops *src, int frees
  */
 extern DECLSPEC void SDLCALL SDL_FreeWAV(Uint8 *audio_buf);
 
+/** @name WAVE Streaming
+ *  Read a WAVE file a piece at a time instead of loading it all at once
+ */
+/*@{*/
+struct SDL_WAVStream;
+typedef struct SDL_WAVStream SDL_WAVStream;
+
+/**
+ * This function opens a WAVE data source for streaming, automatically
+ * freeing that source when the stream is closed if 'freesrc' is non-zero.
+ * The source must stay valid, and seekable, until then.
+ *
+ * If this function succeeds, it fills 'spec' with the audio data format
+ * of the samples that SDL_ReadWAVStream() returns.  Raw, MS-ADPCM and
+ * IMA-ADPCM data is decoded one block at a time, so the memory used does
+ * not depend on the length of the file.
+ *
+ * This function returns NULL and sets the SDL error message if the
+ * wave file cannot be opened, uses an unknown data format, or is corrupt.
+ */
+extern DECLSPEC SDL_WAVStream * SDLCALL SDL_OpenWAVStream_RW(SDL_RWops *src, int freesrc, SDL_AudioSpec *spec);
+
+/** Convenience function -- opens a WAV file for streaming */
+#define SDL_OpenWAVStream(file, spec) \
+	SDL_OpenWAVStream_RW(SDL_RWFromFile(file, "rb"),1, spec)
+
+/**
+ * Read up to 'frames' sample frames into 'buf', which must hold
+ * frames * channels * bytes per sample.  Returns the number of frames
+ * read, 0 at the end of the data, or -1 on error.
+ */
+extern DECLSPEC int SDLCALL SDL_ReadWAVStream(SDL_WAVStream *stream, void *buf, int frames);
+
+/**
+ * Move the read position to sample frame 'frame'.
+ * Returns 0, or -1 if the frame is past the end or the source can't seek.
+ */
+extern DECLSPEC int SDLCALL SDL_SeekWAVStream(SDL_WAVStream *stream, Uint32 frame);
+
+/** Returns the sample frame that the next read will start at */
+extern DECLSPEC Uint32 SDLCALL SDL_TellWAVStream(SDL_WAVStream *stream);
+
+/** Returns the number of sample frames in the stream */
+extern DECLSPEC Uint32 SDLCALL SDL_GetWAVStreamLength(SDL_WAVStream *stream);
+
+/** Close a stream, and its data source if it was opened with 'freesrc' */
+extern DECLSPEC void SDLCALL SDL_CloseWAVStream(SDL_WAVStream *stream);
+/*@}*/
+
 /**
  * This function takes a source format and rate and a destination format
  * and rate, and initializes the 'cvt' structure with information needed
@@ -235,6 +301,33 @@ extern DECLSPEC int SDLCALL SDL_BuildAudioCVT(SDL_AudioCVT *cvt,
 		Uint16 src_format, Uint8 src_channels, int src_rate,
 		Uint16 dst_format, Uint8 dst_channels, int dst_rate);
 
+/**
+ * Set the gains SDL_BuildAudioCVT() uses to convert between two channel
+ * counts, from 1 to 8.  'matrix' has dst_channels rows of src_channels
+ * gains each, so output channel j is the sum of input channel i times
+ * matrix[j*src_channels+i].  Pass NULL to go back to the standard matrix.
+ * Conversions built afterwards use it; ones built before keep the gains
+ * they were built with.  It can be called from any thread.  Matrices
+ * set are forgotten when the audio subsystem is quit, and conversions
+ * built before then use the standard matrix or one set since.
+ *
+ * @return This function returns 0, or -1 if the channel counts aren't
+ *         supported or there isn't enough memory.
+ */
+extern DECLSPEC int SDLCALL SDL_SetAudioChannelMatrix(int src_channels, int dst_channels, const float *matrix);
+
+/**
+ * Get the gains used to convert between two channel counts, laid out as
+ * for SDL_SetAudioChannelMatrix().  Unless one has been set this is the
+ * standard downmix or upmix for the channel layouts, but note that when
+ * converting between 1, 2, 4 and 6 channels SDL keeps using its older
+ * fixed conversions unless a matrix has been set.
+ *
+ * @return This function returns 0, or -1 if the channel counts aren't
+ *         supported.
+ */
+extern DECLSPEC int SDLCALL SDL_GetAudioChannelMatrix(int src_channels, int dst_channels, float *matrix);
+
 /**
  * Once you have initialized the 'cvt' structure using SDL_BuildAudioCVT(),
  * created an audio buffer cvt->buf, and filled it with cvt->len bytes of
@@ -257,6 +350,154 @@ extern DECLSPEC int SDLCALL SDL_ConvertAudio(SDL_AudioCVT *cvt);
  */
 extern DECLSPEC void SDLCALL SDL_MixAudio(Uint8 *dst, const Uint8 *src, Uint32 len, int volume);
 
+/**
+ * This works like SDL_MixAudio(), but for audio in the given format, as
+ * needed by the callbacks of devices opened with SDL_OpenAudioDevice().
+ */
+extern DECLSPEC void SDLCALL SDL_MixAudioFormat(Uint8 *dst, const Uint8 *src, Uint16 format, Uint32 len, int volume);
+
+/** @name Voice Mixing
+ *  Play many sounds at once, each with its own gain, pan and pitch
+ */
+/*@{*/
+struct SDL_AudioMixer;
+typedef struct SDL_AudioMixer SDL_AudioMixer;
+struct SDL_MixerSound;
+typedef struct SDL_MixerSound SDL_MixerSound;
+
+/**
+ * Create a mixer with 'voices' voices, from 1 to 256, that mixes audio in
+ * the format 'spec' describes.  Only the format, channels and freq fields
+ * are used.  Set SDL_AudioMixerCallback() as the audio callback with the
+ * mixer as its userdata, or call it from your own callback.
+ *
+ * @return The new mixer, or NULL if the format isn't supported.
+ */
+extern DECLSPEC SDL_AudioMixer * SDLCALL SDL_CreateAudioMixer(const SDL_AudioSpec *spec, int voices);
+
+/**
+ * Free a mixer, and release the sounds it was playing.  The audio device
+ * must be closed, or no longer calling the mixer, first.
+ */
+extern DECLSPEC void SDLCALL SDL_FreeAudioMixer(SDL_AudioMixer *mixer);
+
+/** Mix 'len' bytes of the mixer's playing voices into 'stream' */
+extern DECLSPEC void SDLCALL SDL_AudioMixerCallback(void *userdata, Uint8 *stream, int len);
+
+/**
+ * Make a sound from 'len' bytes of audio in the format of 'spec'.  The
+ * data is copied and converted to 16-bit mono or stereo, once, so it can
+ * be played by any mixer without converting it again.
+ */
+extern DECLSPEC SDL_MixerSound * SDLCALL SDL_CreateMixerSound(const SDL_AudioSpec *spec, const Uint8 *data, Uint32 len);
+
+/**
+ * Free a sound.  Voices that are playing it keep it until they finish, so
+ * it's safe to free a sound as soon as you're done starting voices.
+ */
+extern DECLSPEC void SDLCALL SDL_FreeMixerSound(SDL_MixerSound *sound);
+
+/**
+ * Start a voice playing 'sound', 'loops' more times after the first, or
+ * forever if 'loops' is -1.  'gain' is 1.0 for the sound's own volume,
+ * 'pan' goes from -1.0 (left) to 1.0 (right), and 'pitch' is 1.0 to play
+ * at the sound's own rate.  If every voice is busy, the oldest voice that
+ * isn't looping is stopped and used.
+ *
+ * These functions can be called from any thread, without locking the
+ * audio.  They queue their changes, which the mixer picks up the next
+ * time it runs.
+ *
+ * @return A handle for the voice, or -1 if no voice could be started.
+ */
+extern DECLSPEC int SDLCALL SDL_PlayMixerSound(SDL_AudioMixer *mixer, SDL_MixerSound *sound, int loops, float gain, float pan, float pitch);
+
+/** Change the gain, pan and pitch of a voice that's playing */
+extern DECLSPEC int SDLCALL SDL_SetMixerVoice(SDL_AudioMixer *mixer, int voice, float gain, float pan, float pitch);
+
+/** Stop a voice */
+extern DECLSPEC int SDLCALL SDL_StopMixerVoice(SDL_AudioMixer *mixer, int voice);
+
+/** Stop every voice */
+extern DECLSPEC int SDLCALL SDL_StopAllMixerVoices(SDL_AudioMixer *mixer);
+
+/** Set the gain for the whole mix, 1.0 by default */
+extern DECLSPEC int SDLCALL SDL_SetMixerGain(SDL_AudioMixer *mixer, float gain);
+
+/**
+ * Returns non-zero if a voice is still playing, or is about to start.
+ * Voice handles aren't reused until the voice's slot has been reused
+ * 8 million times.
+ */
+extern DECLSPEC int SDLCALL SDL_MixerVoicePlaying(SDL_AudioMixer *mixer, int voice);
+/*@}*/
+
+/** @name Audio Cache
+ *  Keep sounds converted to the device format, so they're only converted
+ *  once however often they're loaded
+ */
+/*@{*/
+struct SDL_AudioCache;
+typedef struct SDL_AudioCache SDL_AudioCache;
+
+typedef struct SDL_AudioCacheStats {
+	Uint32 hits;		/**< Sounds that were already in the cache */
+	Uint32 misses;		/**< Sounds converted and added to the cache */
+	Uint32 evictions;	/**< Sounds freed to stay within the budget */
+	Uint32 entries;		/**< Sounds in the cache */
+	Uint32 memory;		/**< Bytes of converted audio in the cache */
+	Uint32 budget;		/**< Bytes the cache tries to stay within */
+} SDL_AudioCacheStats;
+
+/**
+ * Create a cache that converts sounds to the format, channels and freq
+ * of 'spec', usually the format the audio device was opened with.  Once
+ * the cache holds more than 'budget' bytes, the sounds that were used
+ * least recently and aren't in use are freed.
+ *
+ * @return The new cache, or NULL if the format isn't supported.
+ */
+extern DECLSPEC SDL_AudioCache * SDLCALL SDL_CreateAudioCache(const SDL_AudioSpec *spec, Uint32 budget);
+
+/**
+ * Free a cache and every sound in it.  Buffers that haven't been released
+ * are freed as well.
+ */
+extern DECLSPEC void SDLCALL SDL_FreeAudioCache(SDL_AudioCache *cache);
+
+/**
+ * Get 'len' bytes of audio in the format of 'spec', converted to the
+ * cache's format.  Sounds are matched by their format and a hash of their
+ * samples, so the same sound is only converted and stored once.  The
+ * length of the converted audio goes in 'audio_len'.
+ *
+ * The buffer stays valid until it's passed to SDL_ReleaseCachedAudio(),
+ * which must be done once for every call that returned it.
+ *
+ * @return The converted audio, or NULL if it couldn't be converted.
+ */
+extern DECLSPEC const Uint8 * SDLCALL SDL_CacheAudio(SDL_AudioCache *cache, const SDL_AudioSpec *spec, const Uint8 *data, Uint32 len, Uint32 *audio_len);
+
+/**
+ * Load a WAVE file with SDL_LoadWAV_RW() and get it through the cache as
+ * SDL_CacheAudio() does.
+ */
+extern DECLSPEC const Uint8 * SDLCALL SDL_LoadCachedWAV_RW(SDL_AudioCache *cache, SDL_RWops *src, int freesrc, Uint32 *audio_len);
+
+/** Convenience function -- loads a WAV from a file through the cache */
+#define SDL_LoadCachedWAV(cache, file, audio_len) \
+	SDL_LoadCachedWAV_RW(cache, SDL_RWFromFile(file, "rb"),1, audio_len)
+
+/** Let the cache free a buffer once it's over budget */
+extern DECLSPEC void SDLCALL SDL_ReleaseCachedAudio(SDL_AudioCache *cache, const Uint8 *buf);
+
+/** Change the budget, freeing unused sounds if the cache is over it */
+extern DECLSPEC void SDLCALL SDL_SetAudioCacheBudget(SDL_AudioCache *cache, Uint32 budget);
+
+/** Get the cache's counters and how much memory it's using */
+extern DECLSPEC void SDLCALL SDL_GetAudioCacheStats(SDL_AudioCache *cache, SDL_AudioCacheStats *stats);
+/*@}*/
+
 /**
  * @name Audio Locks
  * The lock manipulated by these functions protects the callback function.
@@ -274,6 +515,88 @@ extern DECLSPEC void SDLCALL SDL_UnlockAudio(void);
  */
 extern DECLSPEC void SDLCALL SDL_CloseAudio(void);
 
+/**
+ * @name Audio Devices
+ * These functions play to several audio devices at once, each with its
+ * own callback, thread and format conversion.  The device opened by
+ * SDL_OpenAudio() is device 1, so these functions work on it too.
+ */
+/*@{*/
+typedef Uint32 SDL_AudioDeviceID;
+
+/**
+ * This function opens another audio device, and returns its ID, or 0 if
+ * it failed.  'driver' names the audio driver to use, as in
+ * SDL_AUDIODRIVER, or is NULL for the driver SDL_Init() chose.  'device'
+ * names the device for the driver, such as an ALSA PCM, an OSS device path
+ * or the "disk" driver's output file, or is NULL for the default device.
+ * 'desired' and 'obtained' work as they do for SDL_OpenAudio().
+ *
+ * The device starts out paused, like the one opened by SDL_OpenAudio().
+ */
+extern DECLSPEC SDL_AudioDeviceID SDLCALL SDL_OpenAudioDevice(const char *driver, const char *device, SDL_AudioSpec *desired, SDL_AudioSpec *obtained);
+
+extern DECLSPEC SDL_audiostatus SDLCALL SDL_GetAudioDeviceStatus(SDL_AudioDeviceID dev);
+extern DECLSPEC void SDLCALL SDL_PauseAudioDevice(SDL_AudioDeviceID dev, int pause_on);
+extern DECLSPEC int SDLCALL SDL_GetAudioDeviceLatency(SDL_AudioDeviceID dev);
+extern DECLSPEC void SDLCALL SDL_LockAudioDevice(SDL_AudioDeviceID dev);
+extern DECLSPEC void SDLCALL SDL_UnlockAudioDevice(SDL_AudioDeviceID dev);
+
+/**
+ * This function closes an audio device.  Closing device 1 is the same as
+ * calling SDL_CloseAudio(), which closes all audio devices.
+ */
+extern DECLSPEC void SDLCALL SDL_CloseAudioDevice(SDL_AudioDeviceID dev);
+/*@}*/
+
+/**
+ * @name Audio Capture
+ * These functions record from the capture device of the current audio
+ * driver, the default microphone or line input.
+ */
+/*@{*/
+/**
+ * This function opens the audio capture device with the desired
+ * parameters, and returns 0 if successful, placing the actual hardware
+ * parameters in the structure pointed to by 'obtained'.  If 'obtained' is
+ * NULL, the recorded data will be converted to the requested format.
+ *
+ * If 'desired->callback' is set, it is called from a separate thread with
+ * each buffer of recorded data, and SDL_LockAudio() does not protect it.
+ * If it is NULL, the data is queued for SDL_ReadAudioCapture() instead.
+ *
+ * The capture device starts out paused, and should be enabled by calling
+ * SDL_PauseAudioCapture(0).  SDL_CloseAudio() closes it along with the
+ * playback device.
+ */
+extern DECLSPEC int SDLCALL SDL_OpenAudioCapture(SDL_AudioSpec *desired, SDL_AudioSpec *obtained);
+
+/**
+ * This function pauses and unpauses recording.  Audio recorded while
+ * paused is thrown away.
+ */
+extern DECLSPEC void SDLCALL SDL_PauseAudioCapture(int pause_on);
+
+/**
+ * Get the number of bytes of recorded audio waiting to be read.
+ * This is always 0 if the capture device was opened with a callback.
+ */
+extern DECLSPEC Uint32 SDLCALL SDL_GetAudioCaptureSize(void);
+
+/**
+ * This function copies up to 'len' bytes of recorded audio to 'data',
+ * and returns the number of bytes copied.  It never blocks, and only
+ * copies whole sample frames.  If the application doesn't read often
+ * enough, newer audio is dropped until there is room for it.
+ */
+extern DECLSPEC Uint32 SDLCALL SDL_ReadAudioCapture(void *data, Uint32 len);
+
+/**
+ * This function stops recording and closes the audio capture device.
+ */
+extern DECLSPEC void SDLCALL SDL_CloseAudioCapture(void);
+/*@}*/
+
 
 /* Ends C function definitions when using C++ */
 #ifdef __cplusplus
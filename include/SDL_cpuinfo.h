@@ -57,9 +57,63 @@ extern DECLSPEC SDL_bool SDLCALL SDL_HasSSE(void);
 /** This function returns true if the CPU has SSE2 features */
 extern DECLSPEC SDL_bool SDLCALL SDL_HasSSE2(void);
 
+/** This function returns true if the CPU has SSE3 features */
+extern DECLSPEC SDL_bool SDLCALL SDL_HasSSE3(void);
+
+/** This function returns true if the CPU has SSSE3 features */
+extern DECLSPEC SDL_bool SDLCALL SDL_HasSSSE3(void);
+
+/** This function returns true if the CPU has SSE4.1 features */
+extern DECLSPEC SDL_bool SDLCALL SDL_HasSSE41(void);
+
+/** This function returns true if the CPU has SSE4.2 features */
+extern DECLSPEC SDL_bool SDLCALL SDL_HasSSE42(void);
+
+/**
+ *  This function returns true if the CPU has AVX features and the
+ *  operating system saves the AVX registers
+ */
+extern DECLSPEC SDL_bool SDLCALL SDL_HasAVX(void);
+
+/**
+ *  This function returns true if the CPU has AVX2 features and the
+ *  operating system saves the AVX registers
+ */
+extern DECLSPEC SDL_bool SDLCALL SDL_HasAVX2(void);
+
+/**
+ *  This function returns true if the CPU has AVX-512 Foundation features
+ *  and the operating system saves the AVX-512 registers
+ */
+extern DECLSPEC SDL_bool SDLCALL SDL_HasAVX512F(void);
+
 /** This function returns true if the CPU has AltiVec features */
 extern DECLSPEC SDL_bool SDLCALL SDL_HasAltiVec(void);
 
+/**
+ *  This function returns the number of CPUs available, counting each
+ *  hardware thread of a core with simultaneous multithreading
+ */
+extern DECLSPEC int SDLCALL SDL_GetCPUCount(void);
+
+/**
+ *  This function returns the number of physical CPU cores, or the same
+ *  as SDL_GetCPUCount() if that can't be found out
+ */
+extern DECLSPEC int SDLCALL SDL_GetCPUCoreCount(void);
+
+/**
+ *  This function returns the size in bytes of the level 1, 2 or 3 data
+ *  cache, or 0 if there isn't one or it can't be found out
+ */
+extern DECLSPEC int SDLCALL SDL_GetCPUCacheSize(int level);
+
+/**
+ *  This function returns the size in bytes of a level 1 data cache line,
+ *  or a guess of 64 if it can't be found out
+ */
+extern DECLSPEC int SDLCALL SDL_GetCPUCacheLineSize(void);
+
 /* Ends C function definitions when using C++ */
 #ifdef __cplusplus
 }
@@ -0,0 +1,143 @@
+/*
+    SDL - Simple DirectMedia Layer
+    Copyright (C) 1997-2012 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+
+/**
+ *  @file SDL_hints.h
+ *  Settings that change how SDL behaves
+ *
+ *  A hint is a named setting, usually one of the environment variables
+ *  SDL has always read.  The environment is read the first time a hint
+ *  is looked up, and again whenever a subsystem is initialized, so it's
+ *  not searched every time SDL needs a setting.  Hints can also be set
+ *  from the program, and functions can be called when a hint changes.
+ */
+
+#ifndef _SDL_hints_h
+#define _SDL_hints_h
+
+#include "SDL_stdinc.h"
+
+#include "begin_code.h"
+/* Set up for C function definitions, even when using C++ */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @name Hint Names
+ *  Some of the hints SDL reads, named after their environment variables
+ */
+/*@{*/
+#define SDL_HINT_VIDEODRIVER		"SDL_VIDEODRIVER"
+#define SDL_HINT_AUDIODRIVER		"SDL_AUDIODRIVER"
+#define SDL_HINT_AUDIO_FREQUENCY	"SDL_AUDIO_FREQUENCY"
+#define SDL_HINT_AUDIO_FORMAT		"SDL_AUDIO_FORMAT"
+#define SDL_HINT_AUDIO_CHANNELS		"SDL_AUDIO_CHANNELS"
+#define SDL_HINT_AUDIO_SAMPLES		"SDL_AUDIO_SAMPLES"
+#define SDL_HINT_AUDIO_ALSA_MMAP	"SDL_AUDIO_ALSA_MMAP"
+#define SDL_HINT_AUDIO_CAPTURE_DEVICE	"SDL_AUDIO_CAPTURE_DEVICE"
+#define SDL_HINT_AUDIO_PULSE_LATENCY	"SDL_AUDIO_PULSE_LATENCY"
+#define SDL_HINT_DISKAUDIOFILE		"SDL_DISKAUDIOFILE"
+#define SDL_HINT_DISKAUDIOINFILE	"SDL_DISKAUDIOINFILE"
+#define SDL_HINT_DISKAUDIODELAY		"SDL_DISKAUDIODELAY"
+#define SDL_HINT_WAVE_DECODE_THREADS	"SDL_WAVE_DECODE_THREADS"
+#define SDL_HINT_FBDEV			"SDL_FBDEV"
+#define SDL_HINT_FBACCEL		"SDL_FBACCEL"
+#define SDL_HINT_FBCON_ROTATION		"SDL_VIDEO_FBCON_ROTATION"
+#define SDL_HINT_FBCON_FILE_MODE	"SDL_FBCON_FILE_MODE"
+#define SDL_HINT_FBCON_SKIP_UNCHANGED	"SDL_FBCON_SKIP_UNCHANGED"
+#define SDL_HINT_FBCON_TRIPLEBUF_MODE	"SDL_FBCON_TRIPLEBUF_MODE"
+#define SDL_HINT_FBCON_UPDATE_THREADS	"SDL_FBCON_UPDATE_THREADS"
+#define SDL_HINT_VIDEO_PRESENT_THREAD	"SDL_VIDEO_PRESENT_THREAD"
+#define SDL_HINT_VIDEO_PRESENT_BUFFERS	"SDL_VIDEO_PRESENT_BUFFERS"
+#define SDL_HINT_JOB_THREADS		"SDL_JOB_THREADS"
+#define SDL_HINT_SIMD_LEVEL		"SDL_SIMD_LEVEL"
+/*@}*/
+
+/**
+ *  How strongly a hint is set.  A hint can't be set at a lower priority
+ *  than it already has.  The environment wins over hints set at
+ *  SDL_HINT_DEFAULT or SDL_HINT_NORMAL, but not at SDL_HINT_OVERRIDE.
+ */
+typedef enum {
+	SDL_HINT_DEFAULT,
+	SDL_HINT_NORMAL,
+	SDL_HINT_OVERRIDE
+} SDL_HintPriority;
+
+/**
+ *  Set a hint at the given priority, or unset it if 'value' is NULL.
+ *
+ *  @return SDL_TRUE if the hint was set, or SDL_FALSE if it already had
+ *          a higher priority.
+ */
+extern DECLSPEC SDL_bool SDLCALL SDL_SetHintWithPriority(const char *name, const char *value, SDL_HintPriority priority);
+
+/** Set a hint at SDL_HINT_NORMAL priority */
+extern DECLSPEC SDL_bool SDLCALL SDL_SetHint(const char *name, const char *value);
+
+/**
+ *  Get the value of a hint, or NULL if it's not set.  The string belongs
+ *  to SDL.  It stays valid until the program sets the hint again, or
+ *  until SDL_ClearHints() or SDL_Quit(); SDL reading the environment again
+ *  doesn't free it.  Use the typed functions below from threads that
+ *  might race with one setting it.
+ */
+extern DECLSPEC const char * SDLCALL SDL_GetHint(const char *name);
+
+/**
+ *  Get a hint as a boolean: "0", "false", "no" and "off" are false, and
+ *  anything else is true.  Returns 'default_value' if it's not set.
+ */
+extern DECLSPEC SDL_bool SDLCALL SDL_GetHintBoolean(const char *name, SDL_bool default_value);
+
+/** Get a hint as a number, or 'default_value' if it's not set */
+extern DECLSPEC int SDLCALL SDL_GetHintInt(const char *name, int default_value);
+
+/**
+ *  A function called when a hint changes, with its old and new values,
+ *  either of which may be NULL.  It's called from the thread that
+ *  changed the hint, after SDL has released its lock on the hints.
+ */
+typedef void (SDLCALL *SDL_HintCallback)(void *userdata, const char *name, const char *oldValue, const char *newValue);
+
+/**
+ *  Call 'callback' whenever a hint changes.  It's also called straight
+ *  away with the current value.
+ */
+extern DECLSPEC void SDLCALL SDL_AddHintCallback(const char *name, SDL_HintCallback callback, void *userdata);
+
+/** Stop calling a function added with SDL_AddHintCallback() */
+extern DECLSPEC void SDLCALL SDL_DelHintCallback(const char *name, SDL_HintCallback callback, void *userdata);
+
+/**
+ *  Forget every hint set by the program, every callback, and what was
+ *  read from the environment.  SDL_Quit() does this.
+ */
+extern DECLSPEC void SDLCALL SDL_ClearHints(void);
+
+/* Ends C function definitions when using C++ */
+#ifdef __cplusplus
+}
+#endif
+#include "close_code.h"
+
+#endif /* _SDL_hints_h */
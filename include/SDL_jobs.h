@@ -0,0 +1,111 @@
+/*
+    SDL - Simple DirectMedia Layer
+    Copyright (C) 1997-2012 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+
+/**
+ *  @file SDL_jobs.h
+ *  Run short pieces of work on a pool of threads shared by all of SDL
+ *
+ *  The pool is started the first time it's used, with one thread for
+ *  each CPU but one, or as many as the SDL_JOB_THREADS environment
+ *  variable says.  Each thread keeps its own queue of jobs and takes
+ *  jobs from the others when it runs out.  A thread waiting for a job
+ *  runs other jobs in the meantime, so jobs can start and wait for jobs
+ *  of their own.
+ */
+
+#ifndef _SDL_jobs_h
+#define _SDL_jobs_h
+
+#include "SDL_stdinc.h"
+#include "SDL_error.h"
+
+#include "begin_code.h"
+/* Set up for C function definitions, even when using C++ */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** A job that has been created, defined in SDL_jobs.c */
+struct SDL_Job;
+typedef struct SDL_Job SDL_Job;
+
+/** The function a job runs */
+typedef void (SDLCALL *SDL_JobFunction)(void *data);
+
+/** The function SDL_ParallelFor() runs, for indices first to last-1 */
+typedef void (SDLCALL *SDL_ParallelForFunction)(void *data, int first, int last);
+
+/**
+ *  Create a job that will call 'func' with 'data'.  It doesn't run until
+ *  it's started with SDL_StartJob().
+ *
+ *  @return the job, or NULL if there wasn't memory for it
+ */
+extern DECLSPEC SDL_Job * SDLCALL SDL_CreateJob(SDL_JobFunction func, void *data);
+
+/**
+ *  Make 'job' wait until 'dependency' has finished before it runs.
+ *  This has to be done before 'job' is started.
+ *
+ *  @return 0, or -1 if 'job' has already been started
+ */
+extern DECLSPEC int SDLCALL SDL_JobDependsOn(SDL_Job *job, SDL_Job *dependency);
+
+/**
+ *  Queue a job to run as soon as the jobs it depends on have finished.
+ *  If there are no job threads, it runs on this thread before this
+ *  returns.
+ */
+extern DECLSPEC void SDLCALL SDL_StartJob(SDL_Job *job);
+
+/** Returns SDL_TRUE once a job has finished running */
+extern DECLSPEC SDL_bool SDLCALL SDL_JobDone(SDL_Job *job);
+
+/**
+ *  Wait for a job to finish, running other jobs until it has, then free
+ *  it.  The job is started if it hasn't been.
+ */
+extern DECLSPEC void SDLCALL SDL_WaitJob(SDL_Job *job);
+
+/**
+ *  Free a job without waiting for it.  It's started if it hasn't been,
+ *  and is freed once it has run.
+ */
+extern DECLSPEC void SDLCALL SDL_DetachJob(SDL_Job *job);
+
+/**
+ *  Call 'func' for every index from 'first' to 'last'-1, splitting the
+ *  range into pieces of at least 'grain' indices that run at the same
+ *  time on the job threads and this one.  Returns once they're all done.
+ */
+extern DECLSPEC void SDLCALL SDL_ParallelFor(int first, int last, int grain, SDL_ParallelForFunction func, void *data);
+
+/** Returns how many threads run jobs, besides the threads waiting for them */
+extern DECLSPEC int SDLCALL SDL_GetJobThreads(void);
+
+/* Ends C function definitions when using C++ */
+#ifdef __cplusplus
+}
+#endif
+#include "close_code.h"
+
+#endif /* _SDL_jobs_h */
@@ -76,6 +76,11 @@ extern DECLSPEC int SDLCALL SDL_mutexV(SDL_mutex *mutex);
 /** Destroy a mutex */
 extern DECLSPEC void SDLCALL SDL_DestroyMutex(SDL_mutex *mutex);
 
+/** Returns how many times locking the mutex found another thread
+ *  holding it, or 0 on platforms where SDL doesn't count this.
+ */
+extern DECLSPEC Uint32 SDLCALL SDL_GetMutexContention(SDL_mutex *mutex);
+
 /*@}*/
 
 /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
@@ -122,6 +127,11 @@ extern DECLSPEC int SDLCALL SDL_SemPost(SDL_sem *sem);
 /** Returns the current count of the semaphore */
 extern DECLSPEC Uint32 SDLCALL SDL_SemValue(SDL_sem *sem);
 
+/** Returns how many times waiting on the semaphore found its count at 0,
+ *  or 0 on platforms where SDL doesn't count this.
+ */
+extern DECLSPEC Uint32 SDLCALL SDL_GetSemContention(SDL_sem *sem);
+
 /*@}*/
 
 /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
@@ -167,6 +177,52 @@ extern DECLSPEC int SDLCALL SDL_CondWaitTimeout(SDL_cond *cond, SDL_mutex *mutex
 
 /*@}*/
 
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+/** @name Reader-writer lock functions                           */ /*@{*/
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/** A lock that many threads can hold at once for reading, or one thread
+ *  for writing.  Unlike SDL_mutex it isn't recursive: a thread holding it
+ *  must not lock it again.
+ */
+struct SDL_rwlock;
+typedef struct SDL_rwlock SDL_rwlock;
+
+/** Create a reader-writer lock, initialized unlocked */
+extern DECLSPEC SDL_rwlock * SDLCALL SDL_CreateRWLock(void);
+
+/** Lock for reading, waiting while a thread holds it for writing
+ *  @return 0, or -1 on error
+ */
+extern DECLSPEC int SDLCALL SDL_LockRWLockForReading(SDL_rwlock *rwlock);
+
+/** Lock for writing, waiting while any thread holds it
+ *  @return 0, or -1 on error
+ */
+extern DECLSPEC int SDLCALL SDL_LockRWLockForWriting(SDL_rwlock *rwlock);
+
+/** Non-blocking variant of SDL_LockRWLockForReading().
+ *  @return 0 if the lock was taken, SDL_MUTEX_TIMEDOUT if it would
+ *  have had to wait, and -1 on error.
+ */
+extern DECLSPEC int SDLCALL SDL_TryLockRWLockForReading(SDL_rwlock *rwlock);
+
+/** Non-blocking variant of SDL_LockRWLockForWriting().
+ *  @return 0 if the lock was taken, SDL_MUTEX_TIMEDOUT if it would
+ *  have had to wait, and -1 on error.
+ */
+extern DECLSPEC int SDLCALL SDL_TryLockRWLockForWriting(SDL_rwlock *rwlock);
+
+/** Unlock, whether it was locked for reading or writing
+ *  @return 0, or -1 on error
+ */
+extern DECLSPEC int SDLCALL SDL_UnlockRWLock(SDL_rwlock *rwlock);
+
+/** Destroy a reader-writer lock */
+extern DECLSPEC void SDLCALL SDL_DestroyRWLock(SDL_rwlock *rwlock);
+
+/*@}*/
+
 /* Ends C function definitions when using C++ */
 #ifdef __cplusplus
 }
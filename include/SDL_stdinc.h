@@ -224,12 +224,21 @@ extern DECLSPEC char * SDLCALL SDL_getenv(const char *name);
 extern DECLSPEC int SDLCALL SDL_putenv(const char *variable);
 #endif
 
-#ifdef HAVE_QSORT
-#define SDL_qsort	qsort
-#else
+/** An introsort that never takes time of order n^2, used even when the
+ *  C library has a qsort()
+ */
 extern DECLSPEC void SDLCALL SDL_qsort(void *base, size_t nmemb, size_t size,
            int (*compare)(const void *, const void *));
-#endif
+
+/**
+ *  Sort 'nmemb' elements of 'size' bytes, smallest first, by the Uint32
+ *  found 'offset' bytes into each one, such as the depth of a sprite.
+ *  It's a radix sort, so it's quicker than SDL_qsort() on big arrays and
+ *  keeps elements with equal keys in the order they were in.
+ *
+ *  @return 0, or -1 if there wasn't memory for a copy of the array
+ */
+extern DECLSPEC int SDLCALL SDL_RadixSort32(void *base, size_t nmemb, size_t size, size_t offset);
 
 #ifdef HAVE_ABS
 #define SDL_abs		abs
@@ -414,6 +414,58 @@ extern DECLSPEC void SDLCALL SDL_UpdateRect
  */
 extern DECLSPEC int SDLCALL SDL_Flip(SDL_Surface *screen);
 
+/** @name Frame statistics
+ *  Timing of the frames shown with SDL_Flip() and SDL_UpdateRects() on
+ *  the display surface; updates of other surfaces aren't counted.
+ *  Timestamps are in microseconds from an arbitrary starting point and
+ *  wrap around after a little over an hour, so only their differences
+ *  are meaningful.
+ */
+/*@{*/
+#define SDL_FRAMESTATS_HISTORY	128	/**< Frames kept for the histograms */
+#define SDL_FRAMESTATS_BUCKETS	16	/**< Histogram buckets */
+
+typedef struct SDL_FrameTiming {
+	Uint32 begin;	/**< SDL_Flip() or SDL_UpdateRects() was called */
+	Uint32 blit;	/**< The frame was converted into the video surface */
+	Uint32 upload;	/**< The video driver finished its update */
+	Uint32 vblank;	/**< The frame was put on the screen, 0 if unknown */
+} SDL_FrameTiming;
+
+/**
+ * The histograms cover the last 'count' frames.  Bucket 0 counts times
+ * under 64 microseconds, bucket n counts times from 32<<n up to 64<<n
+ * microseconds, and the last bucket counts everything longer.
+ */
+typedef struct SDL_FrameStats {
+	Uint32 frames;		/**< Frames handed to the video driver */
+	Uint32 dropped;		/**< Frames replaced before they were shown */
+	Uint32 count;		/**< Frames in the histograms */
+	SDL_FrameTiming last;	/**< The most recent frame */
+	Uint32 blit_time[SDL_FRAMESTATS_BUCKETS];	/**< begin to blit */
+	Uint32 upload_time[SDL_FRAMESTATS_BUCKETS];	/**< blit to upload */
+	Uint32 interval[SDL_FRAMESTATS_BUCKETS];	/**< begin to next begin */
+} SDL_FrameStats;
+
+/**
+ * Fill 'stats' with the frame statistics of the current video mode.
+ * This function returns 0 if successful, or -1 if there was an error.
+ */
+extern DECLSPEC int SDLCALL SDL_GetFrameStats(SDL_FrameStats *stats);
+
+/**
+ * Copy the timing of up to 'maxtimings' recent frames into 'timings',
+ * oldest first.  This function returns the number of frames copied, or
+ * -1 if there was an error.
+ */
+extern DECLSPEC int SDLCALL SDL_GetFrameTimings(SDL_FrameTiming *timings, int maxtimings);
+
+/**
+ * Clear the frame statistics.  They are also cleared by SDL_SetVideoMode().
+ */
+extern DECLSPEC void SDLCALL SDL_ResetFrameStats(void);
+/*@}*/
+
 /**
  * Set the gamma correction for each of the color channels.
  * The gamma values range (approximately) between 0.1 and 10.0
@@ -25,6 +25,10 @@
 
 #include "SDL.h"
 #include "SDL_fatal.h"
+#include "SDL_hints_c.h"
+#include "audio/SDL_audio_c.h"
+#include "cpuinfo/SDL_cpuinfo_c.h"
+#include "thread/SDL_jobs_c.h"
 #if !SDL_VIDEO_DISABLED
 #include "video/SDL_leaks.h"
 #endif
@@ -64,6 +68,12 @@ int surfaces_allocated = 0;
 
 int SDL_InitSubSystem(Uint32 flags)
 {
+	/* Pick up environment variables set since the hints were read */
+	SDL_RefreshHintEnvironment();
+
+	/* Choose the SIMD routines, allowing for SDL_SIMD_LEVEL */
+	SDL_InitSIMD();
+
 #if !SDL_TIMERS_DISABLED
 	/* Initialize the timer subsystem */
 	if ( ! ticks_started ) {
@@ -86,7 +96,7 @@ int SDL_InitSubSystem(Uint32 flags)
 #if !SDL_VIDEO_DISABLED
 	/* Initialize the video/event subsystem */
 	if ( (flags & SDL_INIT_VIDEO) && !(SDL_initialized & SDL_INIT_VIDEO) ) {
-		if ( SDL_VideoInit(SDL_getenv("SDL_VIDEODRIVER"),
+		if ( SDL_VideoInit(SDL_GetHint(SDL_HINT_VIDEODRIVER),
 		                   (flags&SDL_INIT_EVENTTHREAD)) < 0 ) {
 			return(-1);
 		}
@@ -102,7 +112,7 @@ int SDL_InitSubSystem(Uint32 flags)
 #if !SDL_AUDIO_DISABLED
 	/* Initialize the audio subsystem */
 	if ( (flags & SDL_INIT_AUDIO) && !(SDL_initialized & SDL_INIT_AUDIO) ) {
-		if ( SDL_AudioInit(SDL_getenv("SDL_AUDIODRIVER")) < 0 ) {
+		if ( SDL_AudioInit(SDL_GetHint(SDL_HINT_AUDIODRIVER)) < 0 ) {
 			return(-1);
 		}
 		SDL_initialized |= SDL_INIT_AUDIO;
@@ -190,6 +200,10 @@ void SDL_QuitSubSystem(Uint32 flags)
 		SDL_AudioQuit();
 		SDL_initialized &= ~SDL_INIT_AUDIO;
 	}
+	if ( (flags & SDL_INIT_AUDIO) ) {
+		/* Conversions can use these without the audio started */
+		SDL_FreeChannelMatrices();
+	}
 #endif
 #if !SDL_VIDEO_DISABLED
 	if ( (flags & SDL_initialized & SDL_INIT_VIDEO) ) {
@@ -221,6 +235,9 @@ void SDL_Quit(void)
 #endif
 	SDL_QuitSubSystem(SDL_INIT_EVERYTHING);
 
+	/* Stop the job threads, once they've run what they were given */
+	SDL_QuitJobs();
+
 #ifdef CHECK_LEAKS
 #ifdef DEBUG_BUILD
   printf("[SDL_Quit] : CHECK_LEAKS\n"); fflush(stdout);
@@ -239,6 +256,9 @@ void SDL_Quit(void)
 	/* Uninstall any parachute signal handlers */
 	SDL_UninstallParachute();
 
+	/* Forget the hints, so they're read again if SDL is restarted */
+	SDL_ClearHints();
+
 #if !SDL_THREADS_DISABLED && SDL_THREAD_PTH
 	pth_kill();
 #endif
@@ -0,0 +1,478 @@
+/*
+    SDL - Simple DirectMedia Layer
+    Copyright (C) 1997-2012 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+#include "SDL_config.h"
+
+/* The hint registry: settings looked up by name, from the environment or
+   set by the program, with functions called when they change.
+
+   Every hint that's been looked up or set has an entry in a small hash
+   table, keeping its environment variable as it was last read, so asking
+   for a hint doesn't search the environment.  One reader-writer lock
+   covers the table, so threads looking up hints don't hold each other up,
+   and callbacks are run after it's released, on copies of the values, so
+   they can look up or set hints themselves.
+
+   SDL looks at the environment again whenever a subsystem is initialized,
+   which the program doesn't see coming, so environment values it replaces
+   are kept until SDL_ClearHints() in case SDL_GetHint() returned them.
+ */
+
+#include "SDL_hints.h"
+#include "SDL_mutex.h"
+#include "SDL_hints_c.h"
+#include "thread/SDL_atomic_c.h"
+
+#define HINT_BUCKETS	64
+
+typedef struct SDL_HintWatch {
+	SDL_HintCallback callback;
+	void *userdata;
+	struct SDL_HintWatch *next;
+} SDL_HintWatch;
+
+typedef struct SDL_Hint {
+	char *name;
+	char *value;		/* Set by the program, or NULL */
+	char *env;		/* The environment variable, or NULL */
+	SDL_HintPriority priority;
+	SDL_HintWatch *watches;
+	struct SDL_Hint *next;
+} SDL_Hint;
+
+/* An environment value that's been replaced, but may still be in use */
+typedef struct SDL_RetiredHint {
+	char *env;
+	struct SDL_RetiredHint *next;
+} SDL_RetiredHint;
+
+static SDL_Hint *SDL_hints[HINT_BUCKETS];
+static SDL_RetiredHint *SDL_retired_hints = NULL;
+static SDL_rwlock * volatile SDL_hints_lock = NULL;
+
+/* Lock the table, for writing if 'write' is set */
+static void SDL_LockHints(SDL_bool write)
+{
+	SDL_rwlock *lock = (SDL_rwlock *)SDL_AtomicGetPtr((void * volatile *)&SDL_hints_lock);
+
+	if ( lock == NULL ) {
+		lock = SDL_CreateRWLock();
+		if ( lock == NULL ) {
+			return;
+		}
+		if ( !SDL_AtomicCASPtr((void * volatile *)&SDL_hints_lock, NULL, lock) ) {
+			/* Another thread got there first */
+			SDL_DestroyRWLock(lock);
+			lock = (SDL_rwlock *)SDL_AtomicGetPtr((void * volatile *)&SDL_hints_lock);
+		}
+	}
+	if ( write ) {
+		SDL_LockRWLockForWriting(lock);
+	} else {
+		SDL_LockRWLockForReading(lock);
+	}
+}
+
+static void SDL_UnlockHints(void)
+{
+	SDL_rwlock *lock = (SDL_rwlock *)SDL_AtomicGetPtr((void * volatile *)&SDL_hints_lock);
+
+	if ( lock != NULL ) {
+		SDL_UnlockRWLock(lock);
+	}
+}
+
+static Uint32 SDL_HashHintName(const char *name)
+{
+	Uint32 hash = 2166136261u;
+
+	while ( *name ) {
+		hash ^= (Uint8)*name++;
+		hash *= 16777619u;
+	}
+	return(hash);
+}
+
+static char *SDL_CopyHintString(const char *string)
+{
+	return(string ? SDL_strdup(string) : NULL);
+}
+
+static SDL_bool SDL_HintStringsEqual(const char *a, const char *b)
+{
+	if ( a == NULL || b == NULL ) {
+		return((a == b) ? SDL_TRUE : SDL_FALSE);
+	}
+	return((SDL_strcmp(a, b) == 0) ? SDL_TRUE : SDL_FALSE);
+}
+
+/* The value a hint has, taking the environment into account */
+static const char *SDL_HintValue(const SDL_Hint *hint)
+{
+	if ( hint->value && (hint->priority == SDL_HINT_OVERRIDE || !hint->env) ) {
+		return(hint->value);
+	}
+	return(hint->env);
+}
+
+/* Find a hint with the lock held, adding it if 'create' is set */
+static SDL_Hint *SDL_FindHint(const char *name, SDL_bool create)
+{
+	Uint32 bucket = SDL_HashHintName(name) % HINT_BUCKETS;
+	SDL_Hint *hint;
+
+	for ( hint = SDL_hints[bucket]; hint; hint = hint->next ) {
+		if ( SDL_strcmp(hint->name, name) == 0 ) {
+			return(hint);
+		}
+	}
+	if ( !create ) {
+		return(NULL);
+	}
+
+	hint = (SDL_Hint *)SDL_malloc(sizeof(*hint));
+	if ( hint == NULL ) {
+		SDL_OutOfMemory();
+		return(NULL);
+	}
+	SDL_memset(hint, 0, sizeof(*hint));
+	hint->name = SDL_strdup(name);
+	if ( hint->name == NULL ) {
+		SDL_OutOfMemory();
+		SDL_free(hint);
+		return(NULL);
+	}
+	hint->env = SDL_CopyHintString(SDL_getenv(name));
+	hint->priority = SDL_HINT_DEFAULT;
+	hint->next = SDL_hints[bucket];
+	SDL_hints[bucket] = hint;
+	return(hint);
+}
+
+/* Look up the value of a hint, leaving the table locked.  Hints that have
+   been looked up before only need it locked for reading.
+ */
+static const char *SDL_LockHintValue(const char *name)
+{
+	SDL_Hint *hint;
+
+	SDL_LockHints(SDL_FALSE);
+	hint = SDL_FindHint(name, SDL_FALSE);
+	if ( hint == NULL ) {
+		SDL_UnlockHints();
+		SDL_LockHints(SDL_TRUE);
+		hint = SDL_FindHint(name, SDL_TRUE);
+	}
+	return(hint ? SDL_HintValue(hint) : NULL);
+}
+
+/* A change to pass to the callbacks once the lock is released */
+typedef struct SDL_HintChange {
+	char *name;
+	char *oldValue;
+	char *newValue;
+	int numwatches;
+	SDL_HintWatch *watches;
+	struct SDL_HintChange *next;
+} SDL_HintChange;
+
+/* Note a change with the lock held, if anything is watching the hint */
+static void SDL_QueueHintChange(SDL_HintChange **queue, SDL_Hint *hint,
+                                const char *oldValue, const char *newValue)
+{
+	SDL_HintChange *change;
+	SDL_HintWatch *watch;
+	int i;
+
+	if ( hint->watches == NULL ||
+	     SDL_HintStringsEqual(oldValue, newValue) ) {
+		return;
+	}
+	change = (SDL_HintChange *)SDL_malloc(sizeof(*change));
+	if ( change == NULL ) {
+		return;
+	}
+	SDL_memset(change, 0, sizeof(*change));
+	for ( watch = hint->watches; watch; watch = watch->next ) {
+		++change->numwatches;
+	}
+	change->name = SDL_strdup(hint->name);
+	change->oldValue = SDL_CopyHintString(oldValue);
+	change->newValue = SDL_CopyHintString(newValue);
+	change->watches = (SDL_HintWatch *)SDL_malloc(change->numwatches * sizeof(SDL_HintWatch));
+	if ( change->name == NULL || change->watches == NULL ||
+	     (oldValue && !change->oldValue) || (newValue && !change->newValue) ) {
+		SDL_free(change->name);
+		SDL_free(change->oldValue);
+		SDL_free(change->newValue);
+		SDL_free(change->watches);
+		SDL_free(change);
+		return;
+	}
+	for ( i = 0, watch = hint->watches; watch; ++i, watch = watch->next ) {
+		change->watches[i] = *watch;
+	}
+	change->next = *queue;
+	*queue = change;
+}
+
+/* Call the callbacks for changes queued while the lock was held */
+static void SDL_RunHintChanges(SDL_HintChange *queue)
+{
+	SDL_HintChange *change;
+	int i;
+
+	while ( queue ) {
+		change = queue;
+		queue = change->next;
+		for ( i = 0; i < change->numwatches; ++i ) {
+			change->watches[i].callback(change->watches[i].userdata,
+			             change->name, change->oldValue, change->newValue);
+		}
+		SDL_free(change->name);
+		SDL_free(change->oldValue);
+		SDL_free(change->newValue);
+		SDL_free(change->watches);
+		SDL_free(change);
+	}
+}
+
+SDL_bool SDL_SetHintWithPriority(const char *name, const char *value,
+                                 SDL_HintPriority priority)
+{
+	SDL_HintChange *changes = NULL;
+	SDL_Hint *hint;
+	char *before, *oldValue, *newValue;
+
+	if ( name == NULL ) {
+		return(SDL_FALSE);
+	}
+	newValue = SDL_CopyHintString(value);
+	if ( value && !newValue ) {
+		SDL_OutOfMemory();
+		return(SDL_FALSE);
+	}
+
+	SDL_LockHints(SDL_TRUE);
+	hint = SDL_FindHint(name, SDL_TRUE);
+	if ( hint == NULL || (hint->value && priority < hint->priority) ) {
+		SDL_UnlockHints();
+		SDL_free(newValue);
+		return(SDL_FALSE);
+	}
+	/* The old value has to outlive the change if anything is watching */
+	before = hint->watches ? SDL_CopyHintString(SDL_HintValue(hint)) : NULL;
+	oldValue = hint->value;
+	hint->value = newValue;
+	hint->priority = newValue ? priority : SDL_HINT_DEFAULT;
+	SDL_QueueHintChange(&changes, hint, before, SDL_HintValue(hint));
+	SDL_UnlockHints();
+
+	SDL_free(oldValue);
+	SDL_free(before);
+	SDL_RunHintChanges(changes);
+	return(SDL_TRUE);
+}
+
+SDL_bool SDL_SetHint(const char *name, const char *value)
+{
+	return(SDL_SetHintWithPriority(name, value, SDL_HINT_NORMAL));
+}
+
+const char *SDL_GetHint(const char *name)
+{
+	const char *value;
+
+	if ( name == NULL ) {
+		return(NULL);
+	}
+	value = SDL_LockHintValue(name);
+	SDL_UnlockHints();
+	return(value);
+}
+
+SDL_bool SDL_GetHintBoolean(const char *name, SDL_bool default_value)
+{
+	const char *value;
+	SDL_bool result = default_value;
+
+	if ( name == NULL ) {
+		return(default_value);
+	}
+	value = SDL_LockHintValue(name);
+	if ( value != NULL ) {
+		if ( SDL_strcmp(value, "0") == 0 ||
+		     SDL_strcasecmp(value, "false") == 0 ||
+		     SDL_strcasecmp(value, "no") == 0 ||
+		     SDL_strcasecmp(value, "off") == 0 ) {
+			result = SDL_FALSE;
+		} else {
+			result = SDL_TRUE;
+		}
+	}
+	SDL_UnlockHints();
+	return(result);
+}
+
+int SDL_GetHintInt(const char *name, int default_value)
+{
+	const char *value;
+	int result = default_value;
+
+	if ( name == NULL ) {
+		return(default_value);
+	}
+	value = SDL_LockHintValue(name);
+	if ( value != NULL ) {
+		result = SDL_atoi(value);
+	}
+	SDL_UnlockHints();
+	return(result);
+}
+
+void SDL_AddHintCallback(const char *name, SDL_HintCallback callback, void *userdata)
+{
+	SDL_Hint *hint;
+	SDL_HintWatch *watch;
+	char *value;
+
+	if ( name == NULL || callback == NULL ) {
+		return;
+	}
+	watch = (SDL_HintWatch *)SDL_malloc(sizeof(*watch));
+	if ( watch == NULL ) {
+		SDL_OutOfMemory();
+		return;
+	}
+	watch->callback = callback;
+	watch->userdata = userdata;
+
+	SDL_LockHints(SDL_TRUE);
+	hint = SDL_FindHint(name, SDL_TRUE);
+	if ( hint == NULL ) {
+		SDL_UnlockHints();
+		SDL_free(watch);
+		return;
+	}
+	watch->next = hint->watches;
+	hint->watches = watch;
+	value = SDL_CopyHintString(SDL_HintValue(hint));
+	SDL_UnlockHints();
+
+	callback(userdata, name, value, value);
+	SDL_free(value);
+}
+
+void SDL_DelHintCallback(const char *name, SDL_HintCallback callback, void *userdata)
+{
+	SDL_Hint *hint;
+	SDL_HintWatch *watch, **prev;
+
+	if ( name == NULL ) {
+		return;
+	}
+	SDL_LockHints(SDL_TRUE);
+	hint = SDL_FindHint(name, SDL_FALSE);
+	if ( hint ) {
+		for ( prev = &hint->watches; (watch = *prev) != NULL;
+		      prev = &watch->next ) {
+			if ( watch->callback == callback &&
+			     watch->userdata == userdata ) {
+				*prev = watch->next;
+				SDL_free(watch);
+				break;
+			}
+		}
+	}
+	SDL_UnlockHints();
+}
+
+void SDL_RefreshHintEnvironment(void)
+{
+	SDL_HintChange *changes = NULL;
+	SDL_RetiredHint *retired;
+	SDL_Hint *hint;
+	char *before, *env;
+	int i;
+
+	SDL_LockHints(SDL_TRUE);
+	for ( i = 0; i < HINT_BUCKETS; ++i ) {
+		for ( hint = SDL_hints[i]; hint; hint = hint->next ) {
+			env = SDL_getenv(hint->name);
+			if ( SDL_HintStringsEqual(env, hint->env) ) {
+				continue;
+			}
+			if ( env && !(env = SDL_strdup(env)) ) {
+				continue;
+			}
+			retired = NULL;
+			if ( hint->env ) {
+				retired = (SDL_RetiredHint *)SDL_malloc(sizeof(*retired));
+				if ( retired == NULL ) {
+					SDL_free(env);
+					continue;
+				}
+				retired->env = hint->env;
+				retired->next = SDL_retired_hints;
+				SDL_retired_hints = retired;
+			}
+			before = hint->watches ? SDL_CopyHintString(SDL_HintValue(hint)) : NULL;
+			hint->env = env;
+			SDL_QueueHintChange(&changes, hint, before, SDL_HintValue(hint));
+			SDL_free(before);
+		}
+	}
+	SDL_UnlockHints();
+
+	SDL_RunHintChanges(changes);
+}
+
+void SDL_ClearHints(void)
+{
+	SDL_Hint *hint, *next;
+	SDL_HintWatch *watch;
+	SDL_RetiredHint *retired;
+	int i;
+
+	SDL_LockHints(SDL_TRUE);
+	for ( i = 0; i < HINT_BUCKETS; ++i ) {
+		for ( hint = SDL_hints[i]; hint; hint = next ) {
+			next = hint->next;
+			while ( hint->watches ) {
+				watch = hint->watches;
+				hint->watches = watch->next;
+				SDL_free(watch);
+			}
+			SDL_free(hint->name);
+			SDL_free(hint->value);
+			SDL_free(hint->env);
+			SDL_free(hint);
+		}
+		SDL_hints[i] = NULL;
+	}
+	while ( SDL_retired_hints ) {
+		retired = SDL_retired_hints;
+		SDL_retired_hints = retired->next;
+		SDL_free(retired->env);
+		SDL_free(retired);
+	}
+	SDL_UnlockHints();
+}
@@ -0,0 +1,37 @@
+/*
+    SDL - Simple DirectMedia Layer
+    Copyright (C) 1997-2012 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+#include "SDL_config.h"
+
+/* Functions used inside SDL to manage the hint registry */
+
+#ifndef _SDL_hints_c_h
+#define _SDL_hints_c_h
+
+#include "SDL_hints.h"
+
+/* Read the environment variables for the hints again, calling callbacks
+   for any that changed.  SDL_InitSubSystem() calls this, so programs can
+   still set environment variables before starting a subsystem.
+ */
+extern void SDL_RefreshHintEnvironment(void);
+
+#endif /* _SDL_hints_c_h */
@@ -27,6 +27,7 @@
 #include "SDL_audio_c.h"
 #include "SDL_audiomem.h"
 #include "SDL_sysaudio.h"
+#include "../thread/SDL_atomic_c.h"
 
 /* Available audio drivers */
 static AudioBootStrap *bootstrap[] = {
@@ -116,6 +117,17 @@ static AudioBootStrap *bootstrap[] = {
 	NULL
 };
 SDL_AudioDevice *current_audio = NULL;
+static SDL_AudioDevice *capture_audio = NULL;
+
+/* Devices opened by SDL_OpenAudioDevice(), from ID 2 up */
+#define SDL_MAX_AUDIO_DEVICES	16
+static SDL_AudioDevice *open_devices[SDL_MAX_AUDIO_DEVICES];
+
+/* The driver SDL_OpenAudioDevice() asked for, while it checks for it */
+static const char *requested_driver = NULL;
+
+/* How many device buffers of recorded audio SDL_ReadAudioCapture() can lag */
+#define SDL_AUDIO_CAPTURE_BUFFERS	8
 
 /* Various local functions */
 int SDL_AudioInit(const char *driver_name);
@@ -210,6 +222,87 @@ int SDLCALL SDL_RunAudio(void *audiop)
 	return(0);
 }
 
+/* Hand recorded audio to SDL_ReadAudioCapture(), dropping it if the
+   application doesn't keep up.  Only whole buffers are queued, so the
+   ring always holds complete sample frames.
+ */
+static void SDL_QueueCapturedAudio(SDL_AudioDevice *audio, const Uint8 *data, Uint32 len)
+{
+	Uint32 head = (Uint32)audio->capture_head;
+	Uint32 tail = (Uint32)SDL_AtomicGet(&audio->capture_tail);
+	Uint32 offset, chunk;
+
+	if ( len > audio->capture_size - (head - tail) ) {
+#ifdef DEBUG_AUDIO
+		fprintf(stderr, "Audio capture overflow, dropping %u bytes\n", len);
+#endif
+		return;
+	}
+	offset = head & (audio->capture_size - 1);
+	chunk = audio->capture_size - offset;
+	if ( chunk > len ) {
+		chunk = len;
+	}
+	SDL_memcpy(audio->capture_ring + offset, data, chunk);
+	SDL_memcpy(audio->capture_ring, data + chunk, len - chunk);
+
+	/* Publish the data to the reader */
+	SDL_AtomicAdd(&audio->capture_head, (int)len);
+}
+
+/* The recording thread function */
+static int SDLCALL SDL_RunAudioCapture(void *audiop)
+{
+	SDL_AudioDevice *audio = (SDL_AudioDevice *)audiop;
+	Uint8 *stream;
+	Uint32 stream_len;
+	void  *udata;
+	void (SDLCALL *fill)(void *userdata,Uint8 *stream, int len);
+
+	/* Perform any thread setup */
+	if ( audio->ThreadInit ) {
+		audio->ThreadInit(audio);
+	}
+	audio->threadid = SDL_ThreadID();
+
+	fill  = audio->spec.callback;
+	udata = audio->spec.userdata;
+
+	/* Record straight into the conversion buffer if there is one */
+	if ( audio->convert.needed ) {
+		stream = audio->convert.buf;
+	} else {
+		stream = audio->fake_stream;
+	}
+
+	/* Loop, emptying the audio buffers */
+	while ( audio->enabled ) {
+		if ( audio->CaptureAudio(audio, stream, audio->spec.size) < 0 ) {
+			audio->enabled = 0;
+			break;
+		}
+
+		/* Keep reading while paused, so the device doesn't overrun */
+		if ( audio->paused ) {
+			continue;
+		}
+
+		stream_len = audio->spec.size;
+		if ( audio->convert.needed ) {
+			audio->convert.len = audio->spec.size;
+			SDL_ConvertAudio(&audio->convert);
+			stream_len = audio->convert.len_cvt;
+		}
+
+		if ( fill ) {
+			(*fill)(udata, stream, stream_len);
+		} else {
+			SDL_QueueCapturedAudio(audio, stream, stream_len);
+		}
+	}
+	return(0);
+}
+
 static void SDL_LockAudio_Default(SDL_AudioDevice *audio)
 {
 	if ( audio->thread && (SDL_ThreadID() == audio->threadid) ) {
@@ -376,38 +469,20 @@ char *SDL_AudioDriverName(char *namebuf, int maxlen)
 	return(NULL);
 }
 
-int SDL_OpenAudio(SDL_AudioSpec *desired, SDL_AudioSpec *obtained)
+/* Fill in the defaults for a spec passed to SDL_OpenAudio() */
+static int SDL_PrepareAudioSpec(SDL_AudioSpec *desired)
 {
-	SDL_AudioDevice *audio;
 	const char *env;
 
-	/* Start up the audio driver, if necessary */
-	if ( ! current_audio ) {
-		if ( (SDL_InitSubSystem(SDL_INIT_AUDIO) < 0) ||
-		     (current_audio == NULL) ) {
-			return(-1);
-		}
-	}
-	audio = current_audio;
-
-	if (audio->opened) {
-		SDL_SetError("Audio device is already opened");
-		return(-1);
-	}
-
-	/* Verify some parameters */
 	if ( desired->freq == 0 ) {
-		env = SDL_getenv("SDL_AUDIO_FREQUENCY");
-		if ( env ) {
-			desired->freq = SDL_atoi(env);
-		}
+		desired->freq = SDL_GetHintInt(SDL_HINT_AUDIO_FREQUENCY, 0);
 	}
 	if ( desired->freq == 0 ) {
 		/* Pick some default audio frequency */
 		desired->freq = 22050;
 	}
 	if ( desired->format == 0 ) {
-		env = SDL_getenv("SDL_AUDIO_FORMAT");
+		env = SDL_GetHint(SDL_HINT_AUDIO_FORMAT);
 		if ( env ) {
 			desired->format = SDL_ParseAudioFormat(env);
 		}
@@ -417,30 +492,18 @@ int SDL_OpenAudio(SDL_AudioSpec *desired, SDL_AudioSpec *obtained)
 		desired->format = AUDIO_S16;
 	}
 	if ( desired->channels == 0 ) {
-		env = SDL_getenv("SDL_AUDIO_CHANNELS");
-		if ( env ) {
-			desired->channels = (Uint8)SDL_atoi(env);
-		}
+		desired->channels = (Uint8)SDL_GetHintInt(SDL_HINT_AUDIO_CHANNELS, 0);
 	}
 	if ( desired->channels == 0 ) {
 		/* Pick a default number of channels */
 		desired->channels = 2;
 	}
-	switch ( desired->channels ) {
-	    case 1:	/* Mono */
-	    case 2:	/* Stereo */
-	    case 4:	/* surround */
-	    case 6:	/* surround with center and lfe */
-		break;
-	    default:
-		SDL_SetError("1 (mono) and 2 (stereo) channels supported");
+	if ( desired->channels > 8 ) {
+		SDL_SetError("Only 1 (mono) to 8 (7.1) channels supported");
 		return(-1);
 	}
 	if ( desired->samples == 0 ) {
-		env = SDL_getenv("SDL_AUDIO_SAMPLES");
-		if ( env ) {
-			desired->samples = (Uint16)SDL_atoi(env);
-		}
+		desired->samples = (Uint16)SDL_GetHintInt(SDL_HINT_AUDIO_SAMPLES, 0);
 	}
 	if ( desired->samples == 0 ) {
 		/* Pick a default of ~46 ms at desired frequency */
@@ -451,6 +514,16 @@ int SDL_OpenAudio(SDL_AudioSpec *desired, SDL_AudioSpec *obtained)
 		}
 		desired->samples = power2;
 	}
+	return(0);
+}
+
+/* Open a device and start its thread, the caller cleans up on failure */
+static int SDL_StartAudio(SDL_AudioDevice *audio, SDL_AudioSpec *desired, SDL_AudioSpec *obtained)
+{
+	/* Verify some parameters */
+	if ( SDL_PrepareAudioSpec(desired) < 0 ) {
+		return(-1);
+	}
 	if ( desired->callback == NULL ) {
 		SDL_SetError("SDL_OpenAudio() passed a NULL callback");
 		return(-1);
@@ -463,7 +536,6 @@ int SDL_OpenAudio(SDL_AudioSpec *desired, SDL_AudioSpec *obtained)
 	audio->mixer_lock = SDL_CreateMutex();
 	if ( audio->mixer_lock == NULL ) {
 		SDL_SetError("Couldn't create mixer lock");
-		SDL_CloseAudio();
 		return(-1);
 	}
 #endif /* SDL_THREADS_DISABLED */
@@ -480,7 +552,6 @@ int SDL_OpenAudio(SDL_AudioSpec *desired, SDL_AudioSpec *obtained)
 	audio->opened = audio->OpenAudio(audio, &audio->spec)+1;
 
 	if ( ! audio->opened ) {
-		SDL_CloseAudio();
 		return(-1);
 	}
 
@@ -493,7 +564,6 @@ int SDL_OpenAudio(SDL_AudioSpec *desired, SDL_AudioSpec *obtained)
 	/* Allocate a fake audio memory buffer */
 	audio->fake_stream = SDL_AllocAudioMem(audio->spec.size);
 	if ( audio->fake_stream == NULL ) {
-		SDL_CloseAudio();
 		SDL_OutOfMemory();
 		return(-1);
 	}
@@ -510,7 +580,6 @@ int SDL_OpenAudio(SDL_AudioSpec *desired, SDL_AudioSpec *obtained)
 					desired->freq,
 			audio->spec.format, audio->spec.channels,
 					audio->spec.freq) < 0 ) {
-			SDL_CloseAudio();
 			return(-1);
 		}
 		if ( audio->convert.needed ) {
@@ -519,7 +588,6 @@ int SDL_OpenAudio(SDL_AudioSpec *desired, SDL_AudioSpec *obtained)
 			audio->convert.buf =(Uint8 *)SDL_AllocAudioMem(
 			   audio->convert.len*audio->convert.len_mult);
 			if ( audio->convert.buf == NULL ) {
-				SDL_CloseAudio();
 				SDL_OutOfMemory();
 				return(-1);
 			}
@@ -537,7 +605,6 @@ int SDL_OpenAudio(SDL_AudioSpec *desired, SDL_AudioSpec *obtained)
 			audio->thread = SDL_CreateThread(SDL_RunAudio, audio);
 #endif
 			if ( audio->thread == NULL ) {
-				SDL_CloseAudio();
 				SDL_SetError("Couldn't create audio thread");
 				return(-1);
 			}
@@ -551,9 +618,153 @@ int SDL_OpenAudio(SDL_AudioSpec *desired, SDL_AudioSpec *obtained)
 	return(0);
 }
 
-SDL_audiostatus SDL_GetAudioStatus(void)
+int SDL_OpenAudio(SDL_AudioSpec *desired, SDL_AudioSpec *obtained)
 {
-	SDL_AudioDevice *audio = current_audio;
+	SDL_AudioDevice *audio;
+
+	/* Start up the audio driver, if necessary */
+	if ( ! current_audio ) {
+		if ( (SDL_InitSubSystem(SDL_INIT_AUDIO) < 0) ||
+		     (current_audio == NULL) ) {
+			return(-1);
+		}
+	}
+	audio = current_audio;
+
+	if (audio->opened) {
+		SDL_SetError("Audio device is already opened");
+		return(-1);
+	}
+
+	if ( SDL_StartAudio(audio, desired, obtained) < 0 ) {
+		SDL_CloseAudio();
+		return(-1);
+	}
+	return(0);
+}
+
+/* Device 1 is the one opened by SDL_OpenAudio() */
+static SDL_AudioDevice *SDL_GetAudioDevice(SDL_AudioDeviceID devid)
+{
+	if ( devid == 1 ) {
+		return(current_audio);
+	}
+	if ( (devid >= 2) && (devid - 2 < SDL_MAX_AUDIO_DEVICES) ) {
+		return(open_devices[devid - 2]);
+	}
+	return(NULL);
+}
+
+int SDL_AudioDriverRequested(const char *name)
+{
+	const char *envr = SDL_GetHint(SDL_HINT_AUDIODRIVER);
+
+	if ( requested_driver && (SDL_strcasecmp(requested_driver, name) == 0) ) {
+		return(1);
+	}
+	return(envr && (SDL_strcmp(envr, name) == 0));
+}
+
+/* Create another device from the named driver */
+static SDL_AudioDevice *SDL_CreateAudioDevice(const char *driver_name)
+{
+	SDL_AudioDevice *audio;
+	int i;
+
+	for ( i=0; bootstrap[i]; ++i ) {
+		if ( SDL_strcasecmp(bootstrap[i]->name, driver_name) == 0 ) {
+			break;
+		}
+	}
+	requested_driver = driver_name;
+	if ( ! bootstrap[i] || ! bootstrap[i]->available() ) {
+		requested_driver = NULL;
+		SDL_SetError("Audio driver '%s' not available", driver_name);
+		return(NULL);
+	}
+	requested_driver = NULL;
+	audio = bootstrap[i]->create(0);
+	if ( audio != NULL ) {
+		audio->name = bootstrap[i]->name;
+		if ( !audio->LockAudio && !audio->UnlockAudio ) {
+			audio->LockAudio = SDL_LockAudio_Default;
+			audio->UnlockAudio = SDL_UnlockAudio_Default;
+		}
+	}
+	return(audio);
+}
+
+static void SDL_ShutdownAudioDevice(SDL_AudioDevice *audio)
+{
+	audio->enabled = 0;
+	if ( audio->thread != NULL ) {
+		SDL_WaitThread(audio->thread, NULL);
+	}
+	if ( audio->mixer_lock != NULL ) {
+		SDL_DestroyMutex(audio->mixer_lock);
+	}
+	if ( audio->fake_stream != NULL ) {
+		SDL_FreeAudioMem(audio->fake_stream);
+	}
+	if ( audio->convert.needed ) {
+		SDL_FreeAudioMem(audio->convert.buf);
+
+	}
+	if ( audio->capture_ring != NULL ) {
+		SDL_free(audio->capture_ring);
+	}
+	if ( audio->opened ) {
+		audio->CloseAudio(audio);
+		audio->opened = 0;
+	}
+	if ( audio->devname != NULL ) {
+		SDL_free(audio->devname);
+	}
+	/* Free the driver data */
+	audio->free(audio);
+}
+
+SDL_AudioDeviceID SDL_OpenAudioDevice(const char *driver, const char *device,
+                                      SDL_AudioSpec *desired, SDL_AudioSpec *obtained)
+{
+	SDL_AudioDevice *audio;
+	int i;
+
+	/* Start up the audio driver, if necessary */
+	if ( ! current_audio ) {
+		if ( (SDL_InitSubSystem(SDL_INIT_AUDIO) < 0) ||
+		     (current_audio == NULL) ) {
+			return(0);
+		}
+	}
+
+	for ( i=0; (i < SDL_MAX_AUDIO_DEVICES) && open_devices[i]; ++i ) {
+		continue;
+	}
+	if ( i == SDL_MAX_AUDIO_DEVICES ) {
+		SDL_SetError("Too many audio devices opened");
+		return(0);
+	}
+
+	audio = SDL_CreateAudioDevice(driver ? driver : current_audio->name);
+	if ( audio == NULL ) {
+		return(0);
+	}
+	if ( device != NULL ) {
+		audio->devname = SDL_strdup(device);
+	}
+	open_devices[i] = audio;
+
+	if ( SDL_StartAudio(audio, desired, obtained) < 0 ) {
+		SDL_CloseAudioDevice(i + 2);
+		return(0);
+	}
+	return(i + 2);
+}
+
+SDL_audiostatus SDL_GetAudioDeviceStatus(SDL_AudioDeviceID devid)
+{
+	SDL_AudioDevice *audio = SDL_GetAudioDevice(devid);
 	SDL_audiostatus status;
 
 	status = SDL_AUDIO_STOPPED;
@@ -567,18 +778,43 @@ SDL_audiostatus SDL_GetAudioStatus(void)
 	return(status);
 }
 
-void SDL_PauseAudio (int pause_on)
+SDL_audiostatus SDL_GetAudioStatus(void)
 {
-	SDL_AudioDevice *audio = current_audio;
+	return(SDL_GetAudioDeviceStatus(1));
+}
+
+void SDL_PauseAudioDevice(SDL_AudioDeviceID devid, int pause_on)
+{
+	SDL_AudioDevice *audio = SDL_GetAudioDevice(devid);
 
 	if ( audio ) {
 		audio->paused = pause_on;
 	}
 }
 
-void SDL_LockAudio (void)
+void SDL_PauseAudio (int pause_on)
+{
+	SDL_PauseAudioDevice(1, pause_on);
+}
+
+int SDL_GetAudioDeviceLatency(SDL_AudioDeviceID devid)
+{
+	SDL_AudioDevice *audio = SDL_GetAudioDevice(devid);
+
+	if ( audio && audio->opened && audio->GetLatency ) {
+		return(audio->GetLatency(audio));
+	}
+	return(-1);
+}
+
+int SDL_GetAudioLatency(void)
 {
-	SDL_AudioDevice *audio = current_audio;
+	return(SDL_GetAudioDeviceLatency(1));
+}
+
+void SDL_LockAudioDevice(SDL_AudioDeviceID devid)
+{
+	SDL_AudioDevice *audio = SDL_GetAudioDevice(devid);
 
 	/* Obtain a lock on the mixing buffers */
 	if ( audio && audio->LockAudio ) {
@@ -586,9 +822,14 @@ void SDL_LockAudio (void)
 	}
 }
 
-void SDL_UnlockAudio (void)
+void SDL_LockAudio (void)
+{
+	SDL_LockAudioDevice(1);
+}
+
+void SDL_UnlockAudioDevice(SDL_AudioDeviceID devid)
 {
-	SDL_AudioDevice *audio = current_audio;
+	SDL_AudioDevice *audio = SDL_GetAudioDevice(devid);
 
 	/* Release lock on the mixing buffers */
 	if ( audio && audio->UnlockAudio ) {
@@ -596,6 +837,26 @@ void SDL_UnlockAudio (void)
 	}
 }
 
+void SDL_UnlockAudio (void)
+{
+	SDL_UnlockAudioDevice(1);
+}
+
+void SDL_CloseAudioDevice(SDL_AudioDeviceID devid)
+{
+	SDL_AudioDevice *audio;
+
+	if ( devid == 1 ) {
+		SDL_CloseAudio();
+		return;
+	}
+	audio = SDL_GetAudioDevice(devid);
+	if ( audio ) {
+		open_devices[devid - 2] = NULL;
+		SDL_ShutdownAudioDevice(audio);
+	}
+}
+
 void SDL_CloseAudio (void)
 {
 	SDL_QuitSubSystem(SDL_INIT_AUDIO);
@@ -603,30 +864,207 @@ void SDL_CloseAudio (void)
 
 void SDL_AudioQuit(void)
 {
-	SDL_AudioDevice *audio = current_audio;
+	int i;
 
-	if ( audio ) {
-		audio->enabled = 0;
-		if ( audio->thread != NULL ) {
-			SDL_WaitThread(audio->thread, NULL);
-		}
-		if ( audio->mixer_lock != NULL ) {
-			SDL_DestroyMutex(audio->mixer_lock);
+	SDL_CloseAudioCapture();
+	for ( i=0; i < SDL_MAX_AUDIO_DEVICES; ++i ) {
+		SDL_CloseAudioDevice(i + 2);
+	}
+	if ( current_audio ) {
+		SDL_ShutdownAudioDevice(current_audio);
+		current_audio = NULL;
+	}
+}
+
+int SDL_OpenAudioCapture(SDL_AudioSpec *desired, SDL_AudioSpec *obtained)
+{
+	SDL_AudioDevice *audio;
+	SDL_AudioSpec *output;
+	Uint32 chunk;
+
+	/* Start up the audio driver, if necessary */
+	if ( ! current_audio ) {
+		if ( (SDL_InitSubSystem(SDL_INIT_AUDIO) < 0) ||
+		     (current_audio == NULL) ) {
+			return(-1);
 		}
-		if ( audio->fake_stream != NULL ) {
-			SDL_FreeAudioMem(audio->fake_stream);
+	}
+
+	if ( capture_audio ) {
+		SDL_SetError("Audio capture device is already opened");
+		return(-1);
+	}
+
+	/* Verify some parameters */
+	if ( SDL_PrepareAudioSpec(desired) < 0 ) {
+		return(-1);
+	}
+
+#if SDL_THREADS_DISABLED
+	SDL_SetError("Audio capture needs thread support");
+	return(-1);
+#else
+	/* Create a second device from the driver in use */
+	audio = SDL_CreateAudioDevice(current_audio->name);
+	if ( audio == NULL ) {
+		return(-1);
+	}
+	if ( audio->CaptureAudio == NULL ) {
+		SDL_SetError("The %s audio driver can't record", audio->name);
+		audio->free(audio);
+		return(-1);
+	}
+	audio->iscapture = 1;
+	capture_audio = audio;
+
+	/* Calculate the silence and size of the audio specification */
+	SDL_CalculateAudioSpec(desired);
+
+	/* Open the audio subsystem */
+	SDL_memcpy(&audio->spec, desired, sizeof(audio->spec));
+	audio->convert.needed = 0;
+	audio->enabled = 1;
+	audio->paused  = 1;
+
+	audio->opened = audio->OpenAudio(audio, &audio->spec)+1;
+
+	if ( ! audio->opened ) {
+		SDL_CloseAudioCapture();
+		return(-1);
+	}
+
+	/* If the audio driver changes the buffer size, accept it */
+	if ( audio->spec.samples != desired->samples ) {
+		desired->samples = audio->spec.samples;
+		SDL_CalculateAudioSpec(desired);
+	}
+
+	/* Allocate the buffer the device is read into */
+	audio->fake_stream = SDL_AllocAudioMem(audio->spec.size);
+	if ( audio->fake_stream == NULL ) {
+		SDL_CloseAudioCapture();
+		SDL_OutOfMemory();
+		return(-1);
+	}
+
+	/* See if we need to do any conversion */
+	output = &audio->spec;
+	chunk = audio->spec.size;
+	if ( obtained != NULL ) {
+		SDL_memcpy(obtained, &audio->spec, sizeof(audio->spec));
+	} else if ( desired->freq != audio->spec.freq ||
+		    desired->format != audio->spec.format ||
+		    desired->channels != audio->spec.channels ) {
+		/* Build an audio conversion block, from the hardware this time */
+		if ( SDL_BuildAudioCVT(&audio->convert,
+			audio->spec.format, audio->spec.channels,
+					audio->spec.freq,
+			desired->format, desired->channels,
+					desired->freq) < 0 ) {
+			SDL_CloseAudioCapture();
+			return(-1);
 		}
 		if ( audio->convert.needed ) {
-			SDL_FreeAudioMem(audio->convert.buf);
+			audio->convert.len = audio->spec.size;
+			audio->convert.buf =(Uint8 *)SDL_AllocAudioMem(
+			   audio->convert.len*audio->convert.len_mult);
+			if ( audio->convert.buf == NULL ) {
+				SDL_CloseAudioCapture();
+				SDL_OutOfMemory();
+				return(-1);
+			}
+			chunk = audio->convert.len*audio->convert.len_mult;
+		}
+		output = desired;
+	}
 
+	/* Without a callback the data is queued for SDL_ReadAudioCapture() */
+	if ( desired->callback == NULL ) {
+		audio->capture_frame = ((output->format & 0xFF) / 8) *
+		                       output->channels;
+		audio->capture_size = 1;
+		while ( audio->capture_size < chunk * SDL_AUDIO_CAPTURE_BUFFERS ) {
+			audio->capture_size *= 2;
 		}
-		if ( audio->opened ) {
-			audio->CloseAudio(audio);
-			audio->opened = 0;
+		audio->capture_ring = (Uint8 *)SDL_malloc(audio->capture_size);
+		if ( audio->capture_ring == NULL ) {
+			SDL_CloseAudioCapture();
+			SDL_OutOfMemory();
+			return(-1);
 		}
-		/* Free the driver data */
-		audio->free(audio);
-		current_audio = NULL;
+		audio->capture_head = 0;
+		audio->capture_tail = 0;
+	}
+
+	/* Start the recording thread */
+#if (defined(__WIN32__) && !defined(_WIN32_WCE)) && !defined(HAVE_LIBC) && !defined(__SYMBIAN32__)
+	audio->thread = SDL_CreateThread(SDL_RunAudioCapture, audio, NULL, NULL);
+#else
+	audio->thread = SDL_CreateThread(SDL_RunAudioCapture, audio);
+#endif
+	if ( audio->thread == NULL ) {
+		SDL_CloseAudioCapture();
+		SDL_SetError("Couldn't create audio capture thread");
+		return(-1);
+	}
+	return(0);
+#endif /* SDL_THREADS_DISABLED */
+}
+
+void SDL_PauseAudioCapture(int pause_on)
+{
+	SDL_AudioDevice *audio = capture_audio;
+
+	if ( audio ) {
+		audio->paused = pause_on;
+	}
+}
+
+Uint32 SDL_GetAudioCaptureSize(void)
+{
+	SDL_AudioDevice *audio = capture_audio;
+
+	if ( ! audio || ! audio->capture_ring ) {
+		return(0);
+	}
+	return((Uint32)SDL_AtomicGet(&audio->capture_head) -
+	       (Uint32)SDL_AtomicGet(&audio->capture_tail));
+}
+
+Uint32 SDL_ReadAudioCapture(void *data, Uint32 len)
+{
+	SDL_AudioDevice *audio = capture_audio;
+	Uint32 head, tail, offset, chunk;
+
+	if ( ! audio || ! audio->capture_ring ) {
+		return(0);
+	}
+
+	head = (Uint32)SDL_AtomicGet(&audio->capture_head);
+	tail = (Uint32)audio->capture_tail;
+	if ( len > head - tail ) {
+		len = head - tail;
+	}
+	len -= len % audio->capture_frame;
+
+	offset = tail & (audio->capture_size - 1);
+	chunk = audio->capture_size - offset;
+	if ( chunk > len ) {
+		chunk = len;
+	}
+	SDL_memcpy(data, audio->capture_ring + offset, chunk);
+	SDL_memcpy((Uint8 *)data + chunk, audio->capture_ring, len - chunk);
+
+	/* Give the space back to the capture thread */
+	SDL_AtomicAdd(&audio->capture_tail, (int)len);
+	return(len);
+}
+
+void SDL_CloseAudioCapture(void)
+{
+	if ( capture_audio ) {
+		SDL_ShutdownAudioDevice(capture_audio);
+		capture_audio = NULL;
 	}
 }
 
@@ -30,6 +30,12 @@ extern Uint16 SDL_NextAudioFormat(void);
 /* Function to calculate the size and silence for a SDL_AudioSpec */
 extern void SDL_CalculateAudioSpec(SDL_AudioSpec *spec);
 
+/* For drivers only used on request: is 'name' the driver asked for? */
+extern int SDL_AudioDriverRequested(const char *name);
+
 /* The actual mixing thread function */
 extern int SDLCALL SDL_RunAudio(void *audiop);
 
+/* Free the channel matrices made for audio conversions */
+extern void SDL_FreeChannelMatrices(void);
+
@@ -0,0 +1,427 @@
+/*
+    SDL - Simple DirectMedia Layer
+    Copyright (C) 1997-2012 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+#include "SDL_config.h"
+
+/* A cache of audio converted to one format, so that sounds which are
+   loaded again and again are only converted once.
+
+   Entries are found by the source format and a 64-bit hash of the source
+   samples, so the same sound loaded from two places is only kept once.
+   Entries that nobody is using are kept in least recently used order, and
+   the oldest are freed when the cache holds more than its budget.  The
+   converted samples follow the entry in the same allocation, so releasing
+   a buffer finds its entry without a search.
+*/
+
+#include "SDL_audio.h"
+#include "SDL_mutex.h"
+
+#define CACHE_MAGIC		0x41434845	/* "ACHE" */
+#define CACHE_MIN_BUCKETS	64
+
+typedef struct CacheEntry {
+	Uint32 magic;
+	Uint32 hash[2];
+	Uint16 format;
+	Uint8 channels;
+	int freq;
+	Uint32 src_len;
+
+	Uint8 *buf;
+	Uint32 len;
+	int refcount;
+
+	struct CacheEntry *next_hash;
+	struct CacheEntry *lru_prev;	/* Towards more recently used */
+	struct CacheEntry *lru_next;	/* Towards less recently used */
+} CacheEntry;
+
+/* The samples start this far into an entry's allocation */
+#define ENTRY_SIZE	((sizeof(CacheEntry) + 15) & ~15)
+
+struct SDL_AudioCache {
+	SDL_mutex *lock;
+	SDL_AudioSpec spec;
+
+	CacheEntry **buckets;
+	int bucket_mask;
+	CacheEntry *lru_head;
+	CacheEntry *lru_tail;
+
+	SDL_AudioCacheStats stats;
+};
+
+
+#define ROTL32(x, r)	(((x) << (r)) | ((x) >> (32 - (r))))
+
+static Uint32 MixHash(Uint32 h, Uint32 k, int r)
+{
+	k *= 0xCC9E2D51;
+	k = ROTL32(k, 15);
+	k *= 0x1B873593;
+	h ^= k;
+	h = ROTL32(h, r);
+	return h * 5 + 0xE6546B64;
+}
+
+static Uint32 FinishHash(Uint32 h)
+{
+	h ^= h >> 16;
+	h *= 0x85EBCA6B;
+	h ^= h >> 13;
+	h *= 0xC2B2AE35;
+	h ^= h >> 16;
+	return h;
+}
+
+/* Two 32-bit lanes, eight bytes at a time */
+static void HashSamples(const Uint8 *data, Uint32 len, Uint32 hash[2])
+{
+	Uint32 h1 = 0x9E3779B9 ^ len;
+	Uint32 h2 = 0x7F4A7C15 ^ len;
+	Uint32 k[2];
+	Uint32 i;
+
+	for ( i = 0; i + 8 <= len; i += 8 ) {
+		SDL_memcpy(k, data + i, 8);
+		h1 = MixHash(h1, k[0], 13);
+		h2 = MixHash(h2, k[1], 17);
+	}
+	k[0] = k[1] = 0;
+	SDL_memcpy(k, data + i, len - i);
+	h1 = MixHash(h1, k[0], 13);
+	h2 = MixHash(h2, k[1], 17);
+
+	h1 += h2;
+	h2 += h1;
+	hash[0] = FinishHash(h1);
+	hash[1] = FinishHash(h2);
+}
+
+SDL_AudioCache *SDL_CreateAudioCache(const SDL_AudioSpec *spec, Uint32 budget)
+{
+	SDL_AudioCache *cache;
+	SDL_AudioCVT cvt;
+
+	if ( !spec ) {
+		SDL_SetError("Passed a NULL audio spec");
+		return(NULL);
+	}
+	/* Make sure we'll be able to convert to it */
+	if ( SDL_BuildAudioCVT(&cvt, spec->format, spec->channels, spec->freq,
+	         spec->format, spec->channels, spec->freq) < 0 ) {
+		return(NULL);
+	}
+
+	cache = (SDL_AudioCache *)SDL_malloc(sizeof(*cache));
+	if ( cache == NULL ) {
+		SDL_OutOfMemory();
+		return(NULL);
+	}
+	SDL_memset(cache, 0, sizeof(*cache));
+	cache->spec = *spec;
+	cache->stats.budget = budget;
+	cache->bucket_mask = CACHE_MIN_BUCKETS - 1;
+	cache->buckets = (CacheEntry **)SDL_malloc(CACHE_MIN_BUCKETS *
+	                                           sizeof(CacheEntry *));
+	cache->lock = SDL_CreateMutex();
+	if ( !cache->buckets || !cache->lock ) {
+		SDL_FreeAudioCache(cache);
+		SDL_OutOfMemory();
+		return(NULL);
+	}
+	SDL_memset(cache->buckets, 0, CACHE_MIN_BUCKETS * sizeof(CacheEntry *));
+	return(cache);
+}
+
+static void UnlinkLRU(SDL_AudioCache *cache, CacheEntry *entry)
+{
+	if ( entry->lru_prev ) {
+		entry->lru_prev->lru_next = entry->lru_next;
+	} else {
+		cache->lru_head = entry->lru_next;
+	}
+	if ( entry->lru_next ) {
+		entry->lru_next->lru_prev = entry->lru_prev;
+	} else {
+		cache->lru_tail = entry->lru_prev;
+	}
+	entry->lru_prev = entry->lru_next = NULL;
+}
+
+static void LinkLRU(SDL_AudioCache *cache, CacheEntry *entry)
+{
+	entry->lru_prev = NULL;
+	entry->lru_next = cache->lru_head;
+	if ( cache->lru_head ) {
+		cache->lru_head->lru_prev = entry;
+	} else {
+		cache->lru_tail = entry;
+	}
+	cache->lru_head = entry;
+}
+
+static void RemoveEntry(SDL_AudioCache *cache, CacheEntry *entry)
+{
+	CacheEntry **prev;
+
+	prev = &cache->buckets[entry->hash[0] & cache->bucket_mask];
+	while ( *prev != entry ) {
+		prev = &(*prev)->next_hash;
+	}
+	*prev = entry->next_hash;
+	UnlinkLRU(cache, entry);
+
+	cache->stats.entries -= 1;
+	cache->stats.memory -= entry->len;
+	entry->magic = 0;
+	SDL_free(entry);
+}
+
+/* Free unused entries, oldest first, until the cache is within budget */
+static void Evict(SDL_AudioCache *cache)
+{
+	CacheEntry *entry, *prev;
+
+	entry = cache->lru_tail;
+	while ( entry && cache->stats.memory > cache->stats.budget ) {
+		prev = entry->lru_prev;
+		if ( entry->refcount == 0 ) {
+			RemoveEntry(cache, entry);
+			cache->stats.evictions += 1;
+		}
+		entry = prev;
+	}
+}
+
+static void GrowBuckets(SDL_AudioCache *cache)
+{
+	CacheEntry **buckets, *entry, *next;
+	int i, size, mask;
+
+	size = (cache->bucket_mask + 1) * 2;
+	buckets = (CacheEntry **)SDL_malloc(size * sizeof(CacheEntry *));
+	if ( buckets == NULL ) {
+		return;		/* Chains just get longer */
+	}
+	SDL_memset(buckets, 0, size * sizeof(CacheEntry *));
+	mask = size - 1;
+	for ( i = 0; i <= cache->bucket_mask; ++i ) {
+		for ( entry = cache->buckets[i]; entry; entry = next ) {
+			next = entry->next_hash;
+			entry->next_hash = buckets[entry->hash[0] & mask];
+			buckets[entry->hash[0] & mask] = entry;
+		}
+	}
+	SDL_free(cache->buckets);
+	cache->buckets = buckets;
+	cache->bucket_mask = mask;
+}
+
+static CacheEntry *FindEntry(SDL_AudioCache *cache, const SDL_AudioSpec *spec,
+				Uint32 len, const Uint32 hash[2])
+{
+	CacheEntry *entry;
+
+	entry = cache->buckets[hash[0] & cache->bucket_mask];
+	for ( ; entry; entry = entry->next_hash ) {
+		if ( entry->hash[0] == hash[0] && entry->hash[1] == hash[1] &&
+		     entry->src_len == len && entry->format == spec->format &&
+		     entry->channels == spec->channels &&
+		     entry->freq == spec->freq ) {
+			return(entry);
+		}
+	}
+	return(NULL);
+}
+
+static CacheEntry *ConvertEntry(SDL_AudioCache *cache,
+		const SDL_AudioSpec *spec, const Uint8 *data, Uint32 len)
+{
+	SDL_AudioCVT cvt;
+	CacheEntry *entry, *shrunk;
+
+	if ( SDL_BuildAudioCVT(&cvt, spec->format, spec->channels, spec->freq,
+	         cache->spec.format, cache->spec.channels, cache->spec.freq) < 0 ) {
+		return(NULL);
+	}
+	entry = (CacheEntry *)SDL_malloc(ENTRY_SIZE + len * cvt.len_mult);
+	if ( entry == NULL ) {
+		SDL_OutOfMemory();
+		return(NULL);
+	}
+	cvt.buf = (Uint8 *)entry + ENTRY_SIZE;
+	cvt.len = len;
+	SDL_memcpy(cvt.buf, data, len);
+	if ( SDL_ConvertAudio(&cvt) < 0 ) {
+		SDL_free(entry);
+		return(NULL);
+	}
+	if ( (Uint32)cvt.len_cvt < len * cvt.len_mult ) {
+		shrunk = (CacheEntry *)SDL_realloc(entry, ENTRY_SIZE + cvt.len_cvt);
+		if ( shrunk ) {
+			entry = shrunk;
+		}
+	}
+	entry->buf = (Uint8 *)entry + ENTRY_SIZE;
+	entry->len = cvt.len_cvt;
+	return(entry);
+}
+
+const Uint8 *SDL_CacheAudio(SDL_AudioCache *cache, const SDL_AudioSpec *spec,
+				const Uint8 *data, Uint32 len, Uint32 *audio_len)
+{
+	CacheEntry *entry;
+	Uint32 hash[2];
+
+	if ( !cache || !spec || !data ) {
+		SDL_SetError("Passed a NULL cache, spec or data");
+		return(NULL);
+	}
+	HashSamples(data, len, hash);
+
+	SDL_mutexP(cache->lock);
+	entry = FindEntry(cache, spec, len, hash);
+	if ( entry ) {
+		cache->stats.hits += 1;
+		UnlinkLRU(cache, entry);
+	} else {
+		/* Convert without the lock, another thread may add it too */
+		SDL_mutexV(cache->lock);
+		entry = ConvertEntry(cache, spec, data, len);
+		if ( entry == NULL ) {
+			return(NULL);
+		}
+		SDL_mutexP(cache->lock);
+		if ( FindEntry(cache, spec, len, hash) ) {
+			/* The other thread's copy is the one that's cached */
+			SDL_free(entry);
+			entry = FindEntry(cache, spec, len, hash);
+			cache->stats.hits += 1;
+			UnlinkLRU(cache, entry);
+		} else {
+			cache->stats.misses += 1;
+			entry->magic = CACHE_MAGIC;
+			entry->hash[0] = hash[0];
+			entry->hash[1] = hash[1];
+			entry->format = spec->format;
+			entry->channels = spec->channels;
+			entry->freq = spec->freq;
+			entry->src_len = len;
+			entry->refcount = 0;
+			entry->lru_prev = entry->lru_next = NULL;
+			entry->next_hash = cache->buckets[hash[0] & cache->bucket_mask];
+			cache->buckets[hash[0] & cache->bucket_mask] = entry;
+			cache->stats.entries += 1;
+			cache->stats.memory += entry->len;
+			if ( cache->stats.entries > (Uint32)cache->bucket_mask ) {
+				GrowBuckets(cache);
+			}
+		}
+	}
+	entry->refcount += 1;
+	LinkLRU(cache, entry);
+	Evict(cache);
+	SDL_mutexV(cache->lock);
+
+	if ( audio_len ) {
+		*audio_len = entry->len;
+	}
+	return(entry->buf);
+}
+
+const Uint8 *SDL_LoadCachedWAV_RW(SDL_AudioCache *cache, SDL_RWops *src,
+					int freesrc, Uint32 *audio_len)
+{
+	SDL_AudioSpec spec;
+	const Uint8 *buf;
+	Uint8 *data;
+	Uint32 len;
+
+	if ( !cache ) {
+		SDL_SetError("Passed a NULL cache");
+		if ( src && freesrc ) {
+			SDL_RWclose(src);
+		}
+		return(NULL);
+	}
+	if ( SDL_LoadWAV_RW(src, freesrc, &spec, &data, &len) == NULL ) {
+		return(NULL);
+	}
+	buf = SDL_CacheAudio(cache, &spec, data, len, audio_len);
+	SDL_FreeWAV(data);
+	return(buf);
+}
+
+void SDL_ReleaseCachedAudio(SDL_AudioCache *cache, const Uint8 *buf)
+{
+	CacheEntry *entry;
+
+	if ( !cache || !buf ) {
+		return;
+	}
+	entry = (CacheEntry *)(buf - ENTRY_SIZE);
+	SDL_mutexP(cache->lock);
+	if ( entry->magic == CACHE_MAGIC && entry->refcount > 0 ) {
+		entry->refcount -= 1;
+		Evict(cache);
+	}
+	SDL_mutexV(cache->lock);
+}
+
+void SDL_SetAudioCacheBudget(SDL_AudioCache *cache, Uint32 budget)
+{
+	if ( cache ) {
+		SDL_mutexP(cache->lock);
+		cache->stats.budget = budget;
+		Evict(cache);
+		SDL_mutexV(cache->lock);
+	}
+}
+
+void SDL_GetAudioCacheStats(SDL_AudioCache *cache, SDL_AudioCacheStats *stats)
+{
+	if ( cache && stats ) {
+		SDL_mutexP(cache->lock);
+		*stats = cache->stats;
+		SDL_mutexV(cache->lock);
+	}
+}
+
+void SDL_FreeAudioCache(SDL_AudioCache *cache)
+{
+	CacheEntry *entry, *next;
+
+	if ( !cache ) {
+		return;
+	}
+	for ( entry = cache->lru_head; entry; entry = next ) {
+		next = entry->lru_next;
+		entry->magic = 0;
+		SDL_free(entry);
+	}
+	if ( cache->lock ) {
+		SDL_DestroyMutex(cache->lock);
+	}
+	SDL_free(cache->buckets);
+	SDL_free(cache);
+}
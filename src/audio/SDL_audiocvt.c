@@ -24,6 +24,10 @@
 /* Functions for audio drivers to perform runtime conversion of audio format */
 
 #include "SDL_audio.h"
+#include "SDL_mutex.h"
+#include "SDL_audio_c.h"
+#include "../cpuinfo/SDL_cpuinfo_c.h"
+#include "../thread/SDL_atomic_c.h"
 
 
 /* Effectively mix right and left channels into a single channel */
@@ -1225,6 +1229,67 @@ void SDLCALL SDL_RateDIV2_c6(SDL_AudioCVT *cvt, Uint16 format)
 	}
 }
 
+/* Convert rate by 2 for the channel counts without their own filters,
+   copying or dropping whole frames */
+static void SDL_RateMUL2_cN(SDL_AudioCVT *cvt, Uint16 format, int channels)
+{
+	int i, size;
+	Uint8 *src, *dst;
+
+#ifdef DEBUG_CONVERT
+	fprintf(stderr, "Converting audio rate * 2\n");
+#endif
+	size = ((format & 0xFF) / 8) * channels;
+	src = cvt->buf+(cvt->len_cvt/size)*size;
+	dst = cvt->buf+(cvt->len_cvt/size)*size*2;
+	for ( i=cvt->len_cvt/size; i; --i ) {
+		src -= size;
+		dst -= size*2;
+		SDL_memmove(dst+size, src, size);
+		SDL_memmove(dst, src, size);
+	}
+	cvt->len_cvt *= 2;
+	if ( cvt->filters[++cvt->filter_index] ) {
+		cvt->filters[cvt->filter_index](cvt, format);
+	}
+}
+static void SDL_RateDIV2_cN(SDL_AudioCVT *cvt, Uint16 format, int channels)
+{
+	int i, size;
+	Uint8 *src, *dst;
+
+#ifdef DEBUG_CONVERT
+	fprintf(stderr, "Converting audio rate / 2\n");
+#endif
+	size = ((format & 0xFF) / 8) * channels;
+	src = cvt->buf;
+	dst = cvt->buf;
+	for ( i=cvt->len_cvt/(size*2); i; --i ) {
+		SDL_memmove(dst, src, size);
+		src += size*2;
+		dst += size;
+	}
+	cvt->len_cvt /= 2;
+	if ( cvt->filters[++cvt->filter_index] ) {
+		cvt->filters[cvt->filter_index](cvt, format);
+	}
+}
+
+#define RATE_FILTERS(n) \
+static void SDLCALL SDL_RateMUL2_c##n(SDL_AudioCVT *cvt, Uint16 format) \
+{ \
+	SDL_RateMUL2_cN(cvt, format, n); \
+} \
+static void SDLCALL SDL_RateDIV2_c##n(SDL_AudioCVT *cvt, Uint16 format) \
+{ \
+	SDL_RateDIV2_cN(cvt, format, n); \
+}
+RATE_FILTERS(3)
+RATE_FILTERS(5)
+RATE_FILTERS(7)
+RATE_FILTERS(8)
+#undef RATE_FILTERS
+
 /* Very slow rate conversion routine */
 void SDLCALL SDL_RateSLOW(SDL_AudioCVT *cvt, Uint16 format)
 {
@@ -1300,6 +1365,931 @@ void SDLCALL SDL_RateSLOW(SDL_AudioCVT *cvt, Uint16 format)
 	}
 }
 
+/* The fused converter does the work of the endian, sign, width and channel
+   filters in a single pass.  Each source sample is read once and turned
+   into the value the format filters would have left in the buffer, the
+   channel filters' arithmetic is applied to those values, and the result
+   is stored in the destination format.  There is a converter for each
+   pair of sample layouts, and the common 16-bit cases are done with SSE2
+   where available.  The results are the same as running the separate
+   filters.
+*/
+#if SDL_ASSEMBLY_ROUTINES && defined(__GNUC__) && defined(__SSE2__)
+#define SSE2_FUSED_CVT 1
+#include <emmintrin.h>
+#endif
+
+typedef struct SDL_FusedCVT {
+	int src_channels, dst_channels;
+	int src_size, dst_size;		/* Bytes per sample */
+	int src_msb, dst_msb;
+	int src_signed, dst_signed;
+	int shift;			/* Width change */
+	int xor_mask, sub_mask;		/* Sign change and sign extension */
+} SDL_FusedCVT;
+
+static void InitFusedCVT(SDL_FusedCVT *f, SDL_AudioCVT *cvt,
+					int src_channels, int dst_channels)
+{
+	Uint16 src_format = cvt->src_format;
+	Uint16 dst_format = cvt->dst_format;
+	int sign_bit;
+
+	f->src_channels = src_channels;
+	f->dst_channels = dst_channels;
+	f->src_size = (src_format & 0xFF) / 8;
+	f->dst_size = (dst_format & 0xFF) / 8;
+	f->src_msb = ((src_format & 0x1000) == 0x1000);
+	f->dst_msb = ((dst_format & 0x1000) == 0x1000);
+	f->src_signed = ((src_format & 0x8000) == 0x8000);
+	f->dst_signed = ((dst_format & 0x8000) == 0x8000);
+	f->shift = (f->src_size != f->dst_size) ? 8 : 0;
+	sign_bit = (f->dst_size == 2) ? 0x8000 : 0x80;
+	f->xor_mask = 0;
+	f->sub_mask = 0;
+	if ( f->src_signed != f->dst_signed ) {
+		f->xor_mask ^= sign_bit;
+	}
+	if ( f->dst_signed ) {
+		f->xor_mask ^= sign_bit;
+		f->sub_mask = sign_bit;
+	}
+}
+
+#define FUSED_SWAP16(x)	((Uint16)(((x) << 8) | ((x) >> 8)))
+
+/* Read a sample as a value in the range of the destination format */
+#define FUSED_SRC16(i)		(((const Uint16 *)src)[i])
+#define FUSED_READ_8(i)		((((int)src[i] << shift) ^ xv) - sv)
+#define FUSED_READ_16(i)	((((int)FUSED_SRC16(i) >> shift) ^ xv) - sv)
+#define FUSED_READ_16SWAP(i) \
+	((((int)FUSED_SWAP16(FUSED_SRC16(i)) >> shift) ^ xv) - sv)
+
+/* Store a value in the destination format */
+#define FUSED_WRITE_8(i, v)	dst[i] = (Uint8)(v)
+#define FUSED_WRITE_16(i, v)	((Uint16 *)dst)[i] = (Uint16)(v)
+#define FUSED_WRITE_16SWAP(i, v) \
+{ \
+	Uint16 w = (Uint16)(v); \
+	((Uint16 *)dst)[i] = FUSED_SWAP16(w); \
+}
+
+/* The conversion is done in place, so frames that grow are done from the
+   end of the buffer backwards and frames that shrink from the start.
+   The 16-bit surround filters store the rear channels swapped, and that's
+   kept here so the output doesn't change.
+ */
+#define FUSED_CONVERTER(name, READ, WRITE) \
+static void name(const SDL_FusedCVT *f, const Uint8 *src, Uint8 *dst, \
+								int frames) \
+{ \
+	const int shift = f->shift; \
+	const int xv = f->xor_mask; \
+	const int sv = f->sub_mask; \
+	const int sc = f->src_channels; \
+	const int dc = f->dst_channels; \
+	const int wide = (f->dst_size == 2); \
+	int i, lf, rf, ce; \
+ \
+	switch ((sc << 4) | dc) { \
+		case 0x11: \
+			if ( f->dst_size > f->src_size ) { \
+				for ( i = frames; i--; ) { \
+					WRITE(i, READ(i)); \
+				} \
+			} else { \
+				for ( i = 0; i < frames; ++i ) { \
+					WRITE(i, READ(i)); \
+				} \
+			} \
+			break; \
+		case 0x12: \
+			for ( i = frames; i--; ) { \
+				lf = READ(i); \
+				WRITE(i*2, lf); \
+				WRITE(i*2+1, lf); \
+			} \
+			break; \
+		case 0x14: \
+		case 0x16: \
+		case 0x24: \
+		case 0x26: \
+			for ( i = frames; i--; ) { \
+				lf = READ(i*sc); \
+				rf = READ(i*sc+sc-1); \
+				ce = (lf/2) + (rf/2); \
+				WRITE(i*dc, lf); \
+				WRITE(i*dc+1, rf); \
+				if ( wide ) { \
+					WRITE(i*dc+2, rf - ce); \
+					WRITE(i*dc+3, lf - ce); \
+				} else { \
+					WRITE(i*dc+2, lf - ce); \
+					WRITE(i*dc+3, rf - ce); \
+				} \
+				if ( dc == 6 ) { \
+					WRITE(i*dc+4, ce); \
+					WRITE(i*dc+5, ce); \
+				} \
+			} \
+			break; \
+		case 0x21: \
+		case 0x61: \
+			for ( i = 0; i < frames; ++i ) { \
+				lf = READ(i*sc); \
+				rf = READ(i*sc+1); \
+				WRITE(i, (lf + rf) / 2); \
+			} \
+			break; \
+		case 0x41: \
+			for ( i = 0; i < frames; ++i ) { \
+				lf = (READ(i*4) + READ(i*4+1)) / 2; \
+				rf = (READ(i*4+2) + READ(i*4+3)) / 2; \
+				WRITE(i, (lf + rf) / 2); \
+			} \
+			break; \
+		case 0x42: \
+			for ( i = 0; i < frames; ++i ) { \
+				lf = (READ(i*4) + READ(i*4+1)) / 2; \
+				rf = (READ(i*4+2) + READ(i*4+3)) / 2; \
+				WRITE(i*2, lf); \
+				WRITE(i*2+1, rf); \
+			} \
+			break; \
+		case 0x62: \
+			for ( i = 0; i < frames; ++i ) { \
+				lf = READ(i*6); \
+				rf = READ(i*6+1); \
+				WRITE(i*2, lf); \
+				WRITE(i*2+1, rf); \
+			} \
+			break; \
+	} \
+}
+FUSED_CONVERTER(FusedConvert_8_8, FUSED_READ_8, FUSED_WRITE_8)
+FUSED_CONVERTER(FusedConvert_8_16, FUSED_READ_8, FUSED_WRITE_16)
+FUSED_CONVERTER(FusedConvert_8_16S, FUSED_READ_8, FUSED_WRITE_16SWAP)
+FUSED_CONVERTER(FusedConvert_16_8, FUSED_READ_16, FUSED_WRITE_8)
+FUSED_CONVERTER(FusedConvert_16_16, FUSED_READ_16, FUSED_WRITE_16)
+FUSED_CONVERTER(FusedConvert_16_16S, FUSED_READ_16, FUSED_WRITE_16SWAP)
+FUSED_CONVERTER(FusedConvert_16S_8, FUSED_READ_16SWAP, FUSED_WRITE_8)
+FUSED_CONVERTER(FusedConvert_16S_16, FUSED_READ_16SWAP, FUSED_WRITE_16)
+FUSED_CONVERTER(FusedConvert_16S_16S, FUSED_READ_16SWAP, FUSED_WRITE_16SWAP)
+#undef FUSED_CONVERTER
+
+/* Indexed by sample layout: 8-bit, native 16-bit, byte swapped 16-bit */
+static void (*fused_converters[3][3])(const SDL_FusedCVT *f,
+			const Uint8 *src, Uint8 *dst, int frames) = {
+	{ FusedConvert_8_8, FusedConvert_8_16, FusedConvert_8_16S },
+	{ FusedConvert_16_8, FusedConvert_16_16, FusedConvert_16_16S },
+	{ FusedConvert_16S_8, FusedConvert_16S_16, FusedConvert_16S_16S },
+};
+
+static int FusedLayout(int size, int msb)
+{
+	if ( size == 1 ) {
+		return 0;
+	}
+	return (msb == (SDL_BYTEORDER == SDL_BIG_ENDIAN)) ? 1 : 2;
+}
+
+static void FusedConvertFrames(const SDL_FusedCVT *f,
+				const Uint8 *src, Uint8 *dst, int frames)
+{
+	fused_converters[FusedLayout(f->src_size, f->src_msb)]
+			[FusedLayout(f->dst_size, f->dst_msb)](f, src, dst, frames);
+}
+
+#if SSE2_FUSED_CVT
+/* Signed 16-bit values from eight raw samples */
+static __inline__ __m128i FusedLoad16(const SDL_FusedCVT *f, const Uint8 *src)
+{
+	__m128i x = _mm_loadu_si128((const __m128i *)src);
+
+	if ( f->src_msb ) {
+		x = _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+	}
+	if ( !f->src_signed ) {
+		x = _mm_xor_si128(x, _mm_set1_epi16((short)0x8000));
+	}
+	return x;
+}
+
+/* Store eight signed 16-bit values as raw samples */
+static __inline__ void FusedStore16(const SDL_FusedCVT *f, Uint8 *dst, __m128i x)
+{
+	if ( !f->dst_signed ) {
+		x = _mm_xor_si128(x, _mm_set1_epi16((short)0x8000));
+	}
+	if ( f->dst_msb ) {
+		x = _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+	}
+	_mm_storeu_si128((__m128i *)dst, x);
+}
+
+/* Handle 16-bit format changes, mono to stereo and stereo to mono.
+   Returns the number of frames done, the rest are left to the converters.
+ */
+static int FusedConvert16_SSE2(const SDL_FusedCVT *f, Uint8 *buf, int frames)
+{
+	int i, n;
+
+	if ( f->src_size != 2 || f->dst_size != 2 ) {
+		return 0;
+	}
+	if ( f->src_channels == 1 && f->dst_channels == 1 ) {
+		n = frames / 8;
+		for ( i = 0; i < n; ++i ) {
+			FusedStore16(f, buf + i*16, FusedLoad16(f, buf + i*16));
+		}
+		return n * 8;
+	}
+	if ( f->src_channels == 2 && f->dst_channels == 1 ) {
+		const __m128i one = _mm_set1_epi16(1);
+		__m128i a, b;
+
+		n = frames / 8;
+		for ( i = 0; i < n; ++i ) {
+			/* Sums of each left and right pair, halved the way
+			   SDL_ConvertMono does in the destination format */
+			a = _mm_madd_epi16(FusedLoad16(f, buf + i*32), one);
+			b = _mm_madd_epi16(FusedLoad16(f, buf + i*32 + 16), one);
+			if ( f->dst_signed ) {
+				a = _mm_add_epi32(a, _mm_srli_epi32(a, 31));
+				b = _mm_add_epi32(b, _mm_srli_epi32(b, 31));
+			}
+			a = _mm_srai_epi32(a, 1);
+			b = _mm_srai_epi32(b, 1);
+			FusedStore16(f, buf + i*16, _mm_packs_epi32(a, b));
+		}
+		return n * 8;
+	}
+	if ( f->src_channels == 1 && f->dst_channels == 2 ) {
+		__m128i x;
+
+		n = frames / 8;
+		/* The vector part is at the start of the buffer, so do the
+		   tail here first; it expands past everything before it. */
+		FusedConvertFrames(f, buf + n*16, buf + n*32, frames - n*8);
+		for ( i = n; i--; ) {
+			x = FusedLoad16(f, buf + i*16);
+			FusedStore16(f, buf + i*32 + 16, _mm_unpackhi_epi16(x, x));
+			FusedStore16(f, buf + i*32, _mm_unpacklo_epi16(x, x));
+		}
+		return frames;
+	}
+	return 0;
+}
+#endif /* SSE2_FUSED_CVT */
+
+static void SDL_ConvertFused(SDL_AudioCVT *cvt, Uint16 format,
+					int src_channels, int dst_channels)
+{
+	SDL_FusedCVT f;
+	int frames, done;
+
+#ifdef DEBUG_CONVERT
+	fprintf(stderr, "Converting format and channels in one pass\n");
+#endif
+	InitFusedCVT(&f, cvt, src_channels, dst_channels);
+	frames = cvt->len_cvt / (f.src_size * src_channels);
+	done = 0;
+#if SSE2_FUSED_CVT
+	if ( SDL_UseSIMD(CPU_HAS_SSE2) ) {
+		done = FusedConvert16_SSE2(&f, cvt->buf, frames);
+	}
+#endif
+	FusedConvertFrames(&f, cvt->buf + done * f.src_size * src_channels,
+				cvt->buf + done * f.dst_size * dst_channels,
+				frames - done);
+	cvt->len_cvt = frames * f.dst_size * dst_channels;
+	format = cvt->dst_format;
+	if ( cvt->filters[++cvt->filter_index] ) {
+		cvt->filters[cvt->filter_index](cvt, format);
+	}
+}
+
+#define FUSED_FILTER(s, d) \
+static void SDLCALL SDL_ConvertFused_##s##_##d(SDL_AudioCVT *cvt, Uint16 format) \
+{ \
+	SDL_ConvertFused(cvt, format, s, d); \
+}
+FUSED_FILTER(1, 1)
+FUSED_FILTER(1, 2)
+FUSED_FILTER(1, 4)
+FUSED_FILTER(1, 6)
+FUSED_FILTER(2, 1)
+FUSED_FILTER(2, 4)
+FUSED_FILTER(2, 6)
+FUSED_FILTER(4, 1)
+FUSED_FILTER(4, 2)
+FUSED_FILTER(6, 1)
+FUSED_FILTER(6, 2)
+#undef FUSED_FILTER
+
+/* The channel conversions the fused filter knows; the same channel count
+   on both sides is a plain format change and uses the 1 to 1 filter.
+ */
+static const struct {
+	Uint8 src_channels;
+	Uint8 dst_channels;
+	void (SDLCALL *filter)(SDL_AudioCVT *cvt, Uint16 format);
+} fused_filters[] = {
+	{ 1, 2, SDL_ConvertFused_1_2 },
+	{ 1, 4, SDL_ConvertFused_1_4 },
+	{ 1, 6, SDL_ConvertFused_1_6 },
+	{ 2, 1, SDL_ConvertFused_2_1 },
+	{ 2, 4, SDL_ConvertFused_2_4 },
+	{ 2, 6, SDL_ConvertFused_2_6 },
+	{ 4, 1, SDL_ConvertFused_4_1 },
+	{ 4, 2, SDL_ConvertFused_4_2 },
+	{ 6, 1, SDL_ConvertFused_6_1 },
+	{ 6, 2, SDL_ConvertFused_6_2 },
+};
+
+/* Channel conversions other than the fixed ones above go through a matrix
+   of gains, from each input channel to each output channel.  There is a
+   standard matrix for each pair of channel counts, made from the speaker
+   layouts below, and the application can set its own.  The mixing is done
+   on a block of frames at a time, with SSE where available, in the same
+   pass as the format conversion.
+*/
+#if SDL_ASSEMBLY_ROUTINES && defined(__GNUC__) && defined(__SSE__)
+#define SSE_CHANNEL_MATRIX 1
+#include <xmmintrin.h>
+#endif
+
+#define MATRIX_BLOCK_FRAMES	64
+#define MINUS_3DB		0.70710678f
+
+enum {
+	SPEAKER_FL, SPEAKER_FR, SPEAKER_FC, SPEAKER_LFE,
+	SPEAKER_BL, SPEAKER_BR, SPEAKER_BC, SPEAKER_SL, SPEAKER_SR
+};
+
+/* The speakers for each channel count, in the order they're stored */
+static const Uint8 channel_layouts[8][8] = {
+	{ SPEAKER_FC },
+	{ SPEAKER_FL, SPEAKER_FR },
+	{ SPEAKER_FL, SPEAKER_FR, SPEAKER_LFE },
+	{ SPEAKER_FL, SPEAKER_FR, SPEAKER_BL, SPEAKER_BR },
+	{ SPEAKER_FL, SPEAKER_FR, SPEAKER_LFE, SPEAKER_BL, SPEAKER_BR },
+	{ SPEAKER_FL, SPEAKER_FR, SPEAKER_FC, SPEAKER_LFE,
+	  SPEAKER_BL, SPEAKER_BR },
+	{ SPEAKER_FL, SPEAKER_FR, SPEAKER_FC, SPEAKER_LFE,
+	  SPEAKER_BC, SPEAKER_SL, SPEAKER_SR },
+	{ SPEAKER_FL, SPEAKER_FR, SPEAKER_FC, SPEAKER_LFE,
+	  SPEAKER_BL, SPEAKER_BR, SPEAKER_SL, SPEAKER_SR },
+};
+
+/* A set of gains, dst_channels rows of src_channels each.  Once made
+   it doesn't change until SDL_FreeChannelMatrices(), since conversions
+   built with it keep using it after another is set.
+ */
+typedef struct SDL_ChannelMatrix {
+	int src_channels;
+	int dst_channels;
+	float gains[64];
+} SDL_ChannelMatrix;
+
+/* Every matrix made, so setting the same gains again doesn't make
+   another.  A matrix is known by its number, which is its index in the
+   table plus one, so that 0 is none.  channel_matrix[][] has the numbers
+   of the ones in use, indexed by channel counts less one, made when
+   first needed.  The lock covers all of them.
+ */
+static SDL_ChannelMatrix **channel_matrices = NULL;
+static int num_channel_matrices = 0;
+static int max_channel_matrices = 0;
+static int channel_matrix[8][8];
+static Uint8 channel_matrix_set[8][8];
+static SDL_mutex * volatile channel_matrix_lock = NULL;
+
+static void LockChannelMatrices(void)
+{
+	SDL_mutex *lock = (SDL_mutex *)SDL_AtomicGetPtr((void * volatile *)&channel_matrix_lock);
+
+	if ( lock == NULL ) {
+		lock = SDL_CreateMutex();
+		if ( lock == NULL ) {
+			return;
+		}
+		if ( !SDL_AtomicCASPtr((void * volatile *)&channel_matrix_lock, NULL, lock) ) {
+			/* Another thread got there first */
+			SDL_DestroyMutex(lock);
+			lock = (SDL_mutex *)SDL_AtomicGetPtr((void * volatile *)&channel_matrix_lock);
+		}
+	}
+	SDL_mutexP(lock);
+}
+
+static void UnlockChannelMatrices(void)
+{
+	SDL_mutex *lock = (SDL_mutex *)SDL_AtomicGetPtr((void * volatile *)&channel_matrix_lock);
+
+	if ( lock != NULL ) {
+		SDL_mutexV(lock);
+	}
+}
+
+static int LayoutChannel(int channels, int speaker)
+{
+	int i;
+
+	for ( i = 0; i < channels; ++i ) {
+		if ( channel_layouts[channels-1][i] == speaker ) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+/* Add a speaker's signal to the output gains, moving it to the nearest
+   speakers the output has if it doesn't have that one.
+ */
+static void AddSpeaker(float *gains, int channels, int speaker, float gain)
+{
+	int channel = LayoutChannel(channels, speaker);
+
+	if ( channel >= 0 ) {
+		gains[channel] += gain;
+		return;
+	}
+	switch (speaker) {
+		case SPEAKER_FL:
+		case SPEAKER_FR:
+			AddSpeaker(gains, channels, SPEAKER_FC, gain);
+			break;
+		case SPEAKER_FC:
+			AddSpeaker(gains, channels, SPEAKER_FL, gain*MINUS_3DB);
+			AddSpeaker(gains, channels, SPEAKER_FR, gain*MINUS_3DB);
+			break;
+		case SPEAKER_LFE:
+			/* Dropped, as the standard downmixes do */
+			break;
+		case SPEAKER_BL:
+		case SPEAKER_SL:
+			if ( LayoutChannel(channels, SPEAKER_SL) >= 0 ) {
+				AddSpeaker(gains, channels, SPEAKER_SL, gain);
+			} else if ( LayoutChannel(channels, SPEAKER_BL) >= 0 ) {
+				AddSpeaker(gains, channels, SPEAKER_BL, gain);
+			} else {
+				AddSpeaker(gains, channels, SPEAKER_FL, gain*MINUS_3DB);
+			}
+			break;
+		case SPEAKER_BR:
+		case SPEAKER_SR:
+			if ( LayoutChannel(channels, SPEAKER_SR) >= 0 ) {
+				AddSpeaker(gains, channels, SPEAKER_SR, gain);
+			} else if ( LayoutChannel(channels, SPEAKER_BR) >= 0 ) {
+				AddSpeaker(gains, channels, SPEAKER_BR, gain);
+			} else {
+				AddSpeaker(gains, channels, SPEAKER_FR, gain*MINUS_3DB);
+			}
+			break;
+		case SPEAKER_BC:
+			AddSpeaker(gains, channels, SPEAKER_BL, gain*MINUS_3DB);
+			AddSpeaker(gains, channels, SPEAKER_BR, gain*MINUS_3DB);
+			break;
+	}
+}
+
+static void StandardChannelMatrix(int src_channels, int dst_channels,
+								float *matrix)
+{
+	float gains[8], sum;
+	int i, j;
+
+	for ( i = 0; i < src_channels; ++i ) {
+		SDL_memset(gains, 0, sizeof(gains));
+		if ( src_channels == 1 && dst_channels > 1 ) {
+			/* Mono goes to the front left and right at full level */
+			AddSpeaker(gains, dst_channels, SPEAKER_FL, 1.0f);
+			AddSpeaker(gains, dst_channels, SPEAKER_FR, 1.0f);
+		} else {
+			AddSpeaker(gains, dst_channels,
+			           channel_layouts[src_channels-1][i], 1.0f);
+		}
+		for ( j = 0; j < dst_channels; ++j ) {
+			matrix[j*src_channels + i] = gains[j];
+		}
+	}
+
+	/* Scale down the outputs that could otherwise clip */
+	for ( j = 0; j < dst_channels; ++j ) {
+		sum = 0.0f;
+		for ( i = 0; i < src_channels; ++i ) {
+			sum += matrix[j*src_channels + i];
+		}
+		if ( sum > 1.0f ) {
+			for ( i = 0; i < src_channels; ++i ) {
+				matrix[j*src_channels + i] /= sum;
+			}
+		}
+	}
+}
+
+/* The matrix with this number, or NULL.  The table must be locked. */
+static SDL_ChannelMatrix *ChannelMatrix(int number)
+{
+	if ( number < 1 || number > num_channel_matrices ) {
+		return NULL;
+	}
+	return channel_matrices[number-1];
+}
+
+/* Find or make the matrix with these gains, or the standard ones if
+   'gains' is NULL, and return its number, or 0 if there isn't enough
+   memory.  The table must be locked.
+ */
+static int MakeChannelMatrix(int src_channels, int dst_channels,
+						const float *gains)
+{
+	SDL_ChannelMatrix *matrix;
+	float standard[64];
+	size_t size = src_channels * dst_channels * sizeof(float);
+	int i;
+
+	if ( gains == NULL ) {
+		StandardChannelMatrix(src_channels, dst_channels, standard);
+		gains = standard;
+	}
+	for ( i = 0; i < num_channel_matrices; ++i ) {
+		matrix = channel_matrices[i];
+		if ( matrix->src_channels == src_channels &&
+		     matrix->dst_channels == dst_channels &&
+		     SDL_memcmp(matrix->gains, gains, size) == 0 ) {
+			return(i+1);
+		}
+	}
+	if ( num_channel_matrices == max_channel_matrices ) {
+		SDL_ChannelMatrix **table;
+
+		table = (SDL_ChannelMatrix **)SDL_realloc(channel_matrices,
+			(max_channel_matrices + 16) * sizeof(*table));
+		if ( table == NULL ) {
+			SDL_OutOfMemory();
+			return(0);
+		}
+		channel_matrices = table;
+		max_channel_matrices += 16;
+	}
+	matrix = (SDL_ChannelMatrix *)SDL_malloc(sizeof(*matrix));
+	if ( matrix == NULL ) {
+		SDL_OutOfMemory();
+		return(0);
+	}
+	matrix->src_channels = src_channels;
+	matrix->dst_channels = dst_channels;
+	SDL_memcpy(matrix->gains, gains, size);
+	channel_matrices[num_channel_matrices++] = matrix;
+	return(num_channel_matrices);
+}
+
+/* The number of the matrix in use between two channel counts, or 0 if
+   there isn't enough memory.  The table must be locked.
+ */
+static int GetChannelMatrix(int src_channels, int dst_channels)
+{
+	int *number = &channel_matrix[src_channels-1][dst_channels-1];
+
+	if ( *number == 0 ) {
+		*number = MakeChannelMatrix(src_channels, dst_channels, NULL);
+	}
+	return *number;
+}
+
+void SDL_FreeChannelMatrices(void)
+{
+	SDL_mutex *lock;
+	int i;
+
+	LockChannelMatrices();
+	for ( i = 0; i < num_channel_matrices; ++i ) {
+		SDL_free(channel_matrices[i]);
+	}
+	SDL_free(channel_matrices);
+	channel_matrices = NULL;
+	num_channel_matrices = 0;
+	max_channel_matrices = 0;
+	SDL_memset(channel_matrix, 0, sizeof(channel_matrix));
+	SDL_memset(channel_matrix_set, 0, sizeof(channel_matrix_set));
+	UnlockChannelMatrices();
+
+	lock = (SDL_mutex *)SDL_AtomicGetPtr((void * volatile *)&channel_matrix_lock);
+	if ( lock && SDL_AtomicCASPtr((void * volatile *)&channel_matrix_lock, lock, NULL) ) {
+		SDL_DestroyMutex(lock);
+	}
+}
+
+/* SDL_AudioCVT has no room for the gains, so a matrix conversion keeps
+   the number of the matrix it was built with in 'needed', above the
+   bit that says a conversion is needed.
+ */
+#define CVT_MATRIX_NUMBER(cvt)	((cvt)->needed >> 1)
+
+/* Whether a conversion between these channel counts uses the matrix */
+static int UseChannelMatrix(int src_channels, int dst_channels)
+{
+	int i;
+
+	if ( src_channels < 1 || src_channels > 8 ||
+	     dst_channels < 1 || dst_channels > 8 ) {
+		return 0;
+	}
+	LockChannelMatrices();
+	i = channel_matrix_set[src_channels-1][dst_channels-1];
+	UnlockChannelMatrices();
+	if ( i ) {
+		return 1;
+	}
+	if ( src_channels == dst_channels ) {
+		return 0;
+	}
+	for ( i = 0; i < SDL_arraysize(fused_filters); ++i ) {
+		if ( fused_filters[i].src_channels == src_channels &&
+		     fused_filters[i].dst_channels == dst_channels ) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+int SDL_SetAudioChannelMatrix(int src_channels, int dst_channels,
+						const float *matrix)
+{
+	int made;
+
+	if ( src_channels < 1 || src_channels > 8 ||
+	     dst_channels < 1 || dst_channels > 8 ) {
+		SDL_SetError("Channel matrices go from 1 to 8 channels");
+		return(-1);
+	}
+	LockChannelMatrices();
+	made = MakeChannelMatrix(src_channels, dst_channels, matrix);
+	if ( made ) {
+		channel_matrix[src_channels-1][dst_channels-1] = made;
+		channel_matrix_set[src_channels-1][dst_channels-1] = (matrix != NULL);
+	}
+	UnlockChannelMatrices();
+	return(made ? 0 : -1);
+}
+
+int SDL_GetAudioChannelMatrix(int src_channels, int dst_channels,
+							float *matrix)
+{
+	SDL_ChannelMatrix *used;
+
+	if ( src_channels < 1 || src_channels > 8 ||
+	     dst_channels < 1 || dst_channels > 8 ) {
+		SDL_SetError("Channel matrices go from 1 to 8 channels");
+		return(-1);
+	}
+	LockChannelMatrices();
+	used = ChannelMatrix(GetChannelMatrix(src_channels, dst_channels));
+	if ( used ) {
+		SDL_memcpy(matrix, used->gains,
+		           src_channels*dst_channels*sizeof(float));
+	}
+	UnlockChannelMatrices();
+	return(used ? 0 : -1);
+}
+
+/* Read frames as signed values in the range of the destination format,
+   eight to a frame whatever the channel count */
+#define MATRIX_DECODE(READ) \
+	for ( i = 0; i < frames; ++i ) { \
+		for ( c = 0; c < sc; ++c ) { \
+			out[i*8+c] = (float)(READ(i*sc+c) - center); \
+		} \
+	}
+
+static void MatrixDecode(const SDL_FusedCVT *f, const Uint8 *src,
+						float *out, int frames)
+{
+	const int shift = f->shift;
+	const int xv = f->xor_mask;
+	const int sv = f->sub_mask;
+	const int sc = f->src_channels;
+	const int limit = (f->dst_size == 2) ? 0x8000 : 0x80;
+	const int center = f->dst_signed ? 0 : limit;
+	int i, c;
+
+	switch (FusedLayout(f->src_size, f->src_msb)) {
+		case 0:
+			MATRIX_DECODE(FUSED_READ_8);
+			break;
+		case 1:
+			MATRIX_DECODE(FUSED_READ_16);
+			break;
+		case 2:
+			MATRIX_DECODE(FUSED_READ_16SWAP);
+			break;
+	}
+}
+#undef MATRIX_DECODE
+
+/* Round, clip and store mixed frames in the destination format */
+#define MATRIX_ENCODE(WRITE) \
+	for ( i = 0; i < frames; ++i ) { \
+		for ( c = 0; c < dc; ++c ) { \
+			x = in[i*8+c]; \
+			if ( x > hi ) { \
+				x = hi; \
+			} else if ( x < lo ) { \
+				x = lo; \
+			} \
+			v = (int)(x < 0.0f ? x - 0.5f : x + 0.5f) + center; \
+			WRITE(i*dc+c, v); \
+		} \
+	}
+
+static void MatrixEncode(const SDL_FusedCVT *f, const float *in,
+						Uint8 *dst, int frames)
+{
+	const int dc = f->dst_channels;
+	const int limit = (f->dst_size == 2) ? 0x8000 : 0x80;
+	const int center = f->dst_signed ? 0 : limit;
+	const float hi = (float)(limit - 1);
+	const float lo = (float)(-limit);
+	float x;
+	int i, c, v;
+
+	switch (FusedLayout(f->dst_size, f->dst_msb)) {
+		case 0:
+			MATRIX_ENCODE(FUSED_WRITE_8);
+			break;
+		case 1:
+			MATRIX_ENCODE(FUSED_WRITE_16);
+			break;
+		case 2:
+			MATRIX_ENCODE(FUSED_WRITE_16SWAP);
+			break;
+	}
+}
+#undef MATRIX_ENCODE
+
+/* Mix frames with the gains from each input channel, eight to a column */
+typedef void (*MatrixMixFunc)(const float *columns, int src_channels,
+				const float *in, float *out, int frames);
+
+#if SSE_CHANNEL_MATRIX
+static void MatrixMixSSE(const float *columns, int src_channels,
+				const float *in, float *out, int frames)
+{
+	__m128 lo, hi, x;
+	int i, c;
+
+	for ( i = 0; i < frames; ++i, in += 8, out += 8 ) {
+		lo = _mm_setzero_ps();
+		hi = _mm_setzero_ps();
+		for ( c = 0; c < src_channels; ++c ) {
+			x = _mm_set1_ps(in[c]);
+			lo = _mm_add_ps(lo, _mm_mul_ps(x,
+			                _mm_loadu_ps(columns + c*8)));
+			hi = _mm_add_ps(hi, _mm_mul_ps(x,
+			                _mm_loadu_ps(columns + c*8 + 4)));
+		}
+		_mm_storeu_ps(out, lo);
+		_mm_storeu_ps(out + 4, hi);
+	}
+}
+#endif
+
+static void MatrixMix(const float *columns, int src_channels,
+				const float *in, float *out, int frames)
+{
+	int i, j, c;
+	float sum;
+
+	for ( i = 0; i < frames; ++i, in += 8, out += 8 ) {
+		for ( j = 0; j < 8; ++j ) {
+			sum = 0.0f;
+			for ( c = 0; c < src_channels; ++c ) {
+				sum += in[c] * columns[c*8 + j];
+			}
+			out[j] = sum;
+		}
+	}
+}
+
+static const SDL_SIMDKernel matrix_mix_kernels[] = {
+#if SSE_CHANNEL_MATRIX
+	{ CPU_HAS_SSE, (SDL_SIMDFunction)MatrixMixSSE },
+#endif
+	{ 0, (SDL_SIMDFunction)MatrixMix }
+};
+
+/* Convert frames in place, in blocks, working backwards if they grow */
+static void MatrixConvertFrames(const SDL_FusedCVT *f, const float *matrix,
+						Uint8 *buf, int frames)
+{
+	float columns[8*8];
+	float in[MATRIX_BLOCK_FRAMES*8];
+	float out[MATRIX_BLOCK_FRAMES*8];
+	const int sc = f->src_channels;
+	const int dc = f->dst_channels;
+	const int src_frame = f->src_size * sc;
+	const int dst_frame = f->dst_size * dc;
+	MatrixMixFunc mix;
+	int i, j, first, count;
+
+	SDL_memset(columns, 0, sizeof(columns));
+	for ( i = 0; i < sc; ++i ) {
+		for ( j = 0; j < dc; ++j ) {
+			columns[i*8 + j] = matrix[j*sc + i];
+		}
+	}
+	mix = (MatrixMixFunc)SDL_SelectSIMDKernel(matrix_mix_kernels);
+	first = 0;
+	while ( frames > 0 ) {
+		count = frames;
+		if ( count > MATRIX_BLOCK_FRAMES ) {
+			count = MATRIX_BLOCK_FRAMES;
+		}
+		if ( dst_frame > src_frame ) {
+			first = frames - count;
+		}
+		MatrixDecode(f, buf + first * src_frame, in, count);
+		mix(columns, sc, in, out, count);
+		MatrixEncode(f, out, buf + first * dst_frame, count);
+		if ( dst_frame <= src_frame ) {
+			first += count;
+		}
+		frames -= count;
+	}
+}
+
+static void SDL_ConvertMatrix(SDL_AudioCVT *cvt, Uint16 format,
+					int src_channels, int dst_channels)
+{
+	const SDL_ChannelMatrix *matrix;
+	float standard[64];
+	const float *gains;
+	SDL_FusedCVT f;
+	int frames;
+
+#ifdef DEBUG_CONVERT
+	fprintf(stderr, "Converting %d to %d channels with a matrix\n",
+					src_channels, dst_channels);
+#endif
+	/* The matrix doesn't change or go away once made, so it can be
+	   used unlocked.  A conversion built before SDL_Quit() freed the
+	   matrices uses the ones in use now instead. */
+	LockChannelMatrices();
+	matrix = ChannelMatrix(CVT_MATRIX_NUMBER(cvt));
+	if ( matrix == NULL || matrix->src_channels != src_channels ||
+	     matrix->dst_channels != dst_channels ) {
+		matrix = ChannelMatrix(GetChannelMatrix(src_channels, dst_channels));
+	}
+	UnlockChannelMatrices();
+	if ( matrix ) {
+		gains = matrix->gains;
+	} else {
+		StandardChannelMatrix(src_channels, dst_channels, standard);
+		gains = standard;
+	}
+	InitFusedCVT(&f, cvt, src_channels, dst_channels);
+	frames = cvt->len_cvt / (f.src_size * src_channels);
+	MatrixConvertFrames(&f, gains, cvt->buf, frames);
+	cvt->len_cvt = frames * f.dst_size * dst_channels;
+	format = cvt->dst_format;
+	if ( cvt->filters[++cvt->filter_index] ) {
+		cvt->filters[cvt->filter_index](cvt, format);
+	}
+}
+
+#define MATRIX_FILTER(s, d) \
+static void SDLCALL SDL_ConvertMatrix_##s##_##d(SDL_AudioCVT *cvt, Uint16 format) \
+{ \
+	SDL_ConvertMatrix(cvt, format, s, d); \
+}
+#define MATRIX_FILTERS(s) \
+	MATRIX_FILTER(s, 1) MATRIX_FILTER(s, 2) MATRIX_FILTER(s, 3) \
+	MATRIX_FILTER(s, 4) MATRIX_FILTER(s, 5) MATRIX_FILTER(s, 6) \
+	MATRIX_FILTER(s, 7) MATRIX_FILTER(s, 8)
+MATRIX_FILTERS(1)
+MATRIX_FILTERS(2)
+MATRIX_FILTERS(3)
+MATRIX_FILTERS(4)
+MATRIX_FILTERS(5)
+MATRIX_FILTERS(6)
+MATRIX_FILTERS(7)
+MATRIX_FILTERS(8)
+#undef MATRIX_FILTERS
+#undef MATRIX_FILTER
+
+#define MATRIX_ROW(s) { \
+	SDL_ConvertMatrix_##s##_1, SDL_ConvertMatrix_##s##_2, \
+	SDL_ConvertMatrix_##s##_3, SDL_ConvertMatrix_##s##_4, \
+	SDL_ConvertMatrix_##s##_5, SDL_ConvertMatrix_##s##_6, \
+	SDL_ConvertMatrix_##s##_7, SDL_ConvertMatrix_##s##_8 }
+static void (SDLCALL *matrix_filters[8][8])(SDL_AudioCVT *cvt, Uint16 format) = {
+	MATRIX_ROW(1), MATRIX_ROW(2), MATRIX_ROW(3), MATRIX_ROW(4),
+	MATRIX_ROW(5), MATRIX_ROW(6), MATRIX_ROW(7), MATRIX_ROW(8)
+};
+#undef MATRIX_ROW
+
 int SDL_ConvertAudio(SDL_AudioCVT *cvt)
 {
 	/* Make sure there's data to convert */
@@ -1330,6 +2320,10 @@ int SDL_BuildAudioCVT(SDL_AudioCVT *cvt,
 {
 /*printf("Build format %04x->%04x, channels %u->%u, rate %d->%d\n",
 		src_format, dst_format, src_channels, dst_channels, src_rate, dst_rate);*/
+	Uint8 orig_channels = src_channels;
+	int use_matrix;
+	int matrix = 0;
+
 	/* Start off with no conversion necessary */
 	cvt->needed = 0;
 	cvt->filter_index = 0;
@@ -1372,7 +2366,8 @@ int SDL_BuildAudioCVT(SDL_AudioCVT *cvt,
 	}
 
 	/* Last filter:  Mono/Stereo conversion */
-	if ( src_channels != dst_channels ) {
+	use_matrix = UseChannelMatrix(src_channels, dst_channels);
+	if ( src_channels != dst_channels && !use_matrix ) {
 		if ( (src_channels == 1) && (dst_channels > 1) ) {
 			cvt->filters[cvt->filter_index++] = 
 						SDL_ConvertStereo;
@@ -1433,6 +2428,44 @@ int SDL_BuildAudioCVT(SDL_AudioCVT *cvt,
 		}
 	}
 
+	/* Channel conversions without a fixed filter, or with a matrix set
+	   by the application, are mixed in the same pass as the format
+	   conversion, and otherwise the format and channel filters are
+	   replaced with a single pass where possible. */
+	if ( use_matrix ) {
+		int src_frame = ((src_format & 0xFF) / 8) * src_channels;
+		int dst_frame = ((dst_format & 0xFF) / 8) * dst_channels;
+
+		LockChannelMatrices();
+		matrix = GetChannelMatrix(src_channels, dst_channels);
+		UnlockChannelMatrices();
+		if ( matrix == 0 ) {
+			return(-1);
+		}
+		cvt->filters[0] = matrix_filters[src_channels-1][dst_channels-1];
+		cvt->filter_index = 1;
+		cvt->len_mult = (dst_frame + src_frame - 1) / src_frame;
+		cvt->len_ratio = (double)dst_frame / src_frame;
+		src_channels = dst_channels;
+	} else if ( cvt->filter_index > 0 ) {
+		void (SDLCALL *fused)(SDL_AudioCVT *cvt, Uint16 format) = NULL;
+		int i;
+
+		if ( src_channels == orig_channels ) {
+			fused = SDL_ConvertFused_1_1;
+		}
+		for ( i = 0; i < SDL_arraysize(fused_filters); ++i ) {
+			if ( fused_filters[i].src_channels == orig_channels &&
+			     fused_filters[i].dst_channels == src_channels ) {
+				fused = fused_filters[i].filter;
+			}
+		}
+		if ( fused ) {
+			cvt->filters[0] = fused;
+			cvt->filter_index = 1;
+		}
+	}
+
 	/* Do rate conversion */
 	cvt->rate_incr = 0.0;
 	if ( (src_rate/100) != (dst_rate/100) ) {
@@ -1447,8 +2480,12 @@ int SDL_BuildAudioCVT(SDL_AudioCVT *cvt,
 			switch (src_channels) {
 				case 1: rate_cvt = SDL_RateDIV2; break;
 				case 2: rate_cvt = SDL_RateDIV2_c2; break;
+				case 3: rate_cvt = SDL_RateDIV2_c3; break;
 				case 4: rate_cvt = SDL_RateDIV2_c4; break;
+				case 5: rate_cvt = SDL_RateDIV2_c5; break;
 				case 6: rate_cvt = SDL_RateDIV2_c6; break;
+				case 7: rate_cvt = SDL_RateDIV2_c7; break;
+				case 8: rate_cvt = SDL_RateDIV2_c8; break;
 				default: return -1;
 			}
 			len_mult = 1;
@@ -1459,8 +2496,12 @@ int SDL_BuildAudioCVT(SDL_AudioCVT *cvt,
 			switch (src_channels) {
 				case 1: rate_cvt = SDL_RateMUL2; break;
 				case 2: rate_cvt = SDL_RateMUL2_c2; break;
+				case 3: rate_cvt = SDL_RateMUL2_c3; break;
 				case 4: rate_cvt = SDL_RateMUL2_c4; break;
+				case 5: rate_cvt = SDL_RateMUL2_c5; break;
 				case 6: rate_cvt = SDL_RateMUL2_c6; break;
+				case 7: rate_cvt = SDL_RateMUL2_c7; break;
+				case 8: rate_cvt = SDL_RateMUL2_c8; break;
 				default: return -1;
 			}
 			len_mult = 2;
@@ -1499,12 +2540,12 @@ int SDL_BuildAudioCVT(SDL_AudioCVT *cvt,
 
 	/* Set up the filter information */
 	if ( cvt->filter_index != 0 ) {
-		cvt->needed = 1;
+		cvt->needed = 1 | (matrix << 1);
 		cvt->src_format = src_format;
 		cvt->dst_format = dst_format;
 		cvt->len = 0;
 		cvt->buf = NULL;
 		cvt->filters[cvt->filter_index] = NULL;
 	}
-	return(cvt->needed);
+	return(cvt->needed ? 1 : 0);
 }
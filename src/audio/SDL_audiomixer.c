@@ -0,0 +1,804 @@
+/*
+    SDL - Simple DirectMedia Layer
+    Copyright (C) 1997-2012 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+#include "SDL_config.h"
+
+/* A mixer for many voices at once, run from the audio callback.
+
+   Sounds are converted to 16-bit mono or stereo once, when they're
+   created, and any number of voices can play them.  Each callback mixes
+   every playing voice into a float buffer, resampling for the voice's
+   pitch, and then clips and stores the result in the output format.
+
+   The application's threads never touch the voices the mixer is playing.
+   They reserve a voice slot, which gives the handle its generation, and
+   queue commands that the callback picks up before it mixes.  The queue
+   is a fixed ring of commands with a sequence number in each, so any
+   number of threads can add to it without a lock.
+*/
+
+#include "SDL_audio.h"
+#include "SDL_endian.h"
+#include "../thread/SDL_atomic_c.h"
+#include "../cpuinfo/SDL_cpuinfo_c.h"
+
+#if SDL_ASSEMBLY_ROUTINES && defined(__GNUC__) && defined(__SSE2__)
+#define SSE2_AUDIO_MIXER 1
+#include <emmintrin.h>
+#endif
+
+#define MIXER_CHUNK_FRAMES	256
+#define MIXER_MAX_VOICES	256
+#define MIXER_MIN_COMMANDS	64
+
+/* The state word of a voice slot has the state in the low two bits, and
+   the slot's generation above them.  The handle is the generation and the
+   slot number, so handles of voices that have finished go stale.
+ */
+#define VOICE_FREE		0
+#define VOICE_RESERVED		1
+#define VOICE_PLAYING		2
+#define VOICE_GEN_MASK		0x7FFFFF
+#define VOICE_STATE(gen, state)	(((gen) << 2) | (state))
+#define VOICE_HANDLE(slot, gen)	(((gen) << 8) | (slot))
+
+enum {
+	MIXER_PLAY,
+	MIXER_SET,
+	MIXER_STOP,
+	MIXER_STOP_ALL,
+	MIXER_GAIN
+};
+
+typedef struct MixerCommand {
+	volatile int sequence;
+	int type;
+	int slot;
+	int gen;
+	SDL_MixerSound *sound;
+	int loops;
+	float gain, pan, pitch;
+} MixerCommand;
+
+struct SDL_MixerSound {
+	volatile int refcount;
+	Sint16 *samples;
+	Uint32 frames;
+	int channels;
+	int freq;
+};
+
+typedef struct MixerVoice {
+	/* Set by the thread that starts the voice */
+	volatile int state;
+	volatile int loops;
+	volatile int started;
+
+	/* Only used by the mixing callback */
+	SDL_MixerSound *sound;
+	int gen;
+	int loops_left;
+	Uint32 position;
+	Uint32 fraction;
+	Uint32 step;		/* Source frames per output frame, 16.16 */
+	float left, right;
+} MixerVoice;
+
+struct SDL_AudioMixer {
+	SDL_AudioSpec spec;
+	int mix_channels;	/* 1 for mono output, 2 otherwise */
+	float gain;
+	float *mix;
+
+	int num_voices;
+	MixerVoice *voices;
+	volatile int started;
+
+	MixerCommand *commands;
+	int command_mask;
+	volatile int enqueue_pos;
+	int dequeue_pos;
+};
+
+
+static void ReleaseSound(SDL_MixerSound *sound)
+{
+	if ( SDL_AtomicAdd(&sound->refcount, -1) == 1 ) {
+		SDL_free(sound->samples);
+		SDL_free(sound);
+	}
+}
+
+SDL_MixerSound *SDL_CreateMixerSound(const SDL_AudioSpec *spec,
+					const Uint8 *data, Uint32 len)
+{
+	SDL_MixerSound *sound;
+	SDL_AudioCVT cvt;
+	int channels;
+
+	if ( !spec || !data || spec->channels == 0 || spec->freq <= 0 ) {
+		SDL_SetError("Invalid sound format");
+		return(NULL);
+	}
+	channels = (spec->channels == 1) ? 1 : 2;
+	if ( SDL_BuildAudioCVT(&cvt, spec->format, spec->channels, spec->freq,
+			AUDIO_S16SYS, channels, spec->freq) < 0 ) {
+		return(NULL);
+	}
+	sound = (SDL_MixerSound *)SDL_malloc(sizeof(*sound));
+	if ( sound == NULL ) {
+		SDL_OutOfMemory();
+		return(NULL);
+	}
+	cvt.len = len;
+	cvt.buf = (Uint8 *)SDL_malloc(len * cvt.len_mult + 1);
+	if ( cvt.buf == NULL ) {
+		SDL_free(sound);
+		SDL_OutOfMemory();
+		return(NULL);
+	}
+	SDL_memcpy(cvt.buf, data, len);
+	SDL_ConvertAudio(&cvt);
+
+	sound->refcount = 1;
+	sound->samples = (Sint16 *)cvt.buf;
+	sound->channels = channels;
+	sound->frames = cvt.len_cvt / (2 * channels);
+	sound->freq = spec->freq;
+	return(sound);
+}
+
+void SDL_FreeMixerSound(SDL_MixerSound *sound)
+{
+	if ( sound ) {
+		ReleaseSound(sound);
+	}
+}
+
+SDL_AudioMixer *SDL_CreateAudioMixer(const SDL_AudioSpec *spec, int voices)
+{
+	SDL_AudioMixer *mixer;
+	int i, commands;
+
+	if ( !spec || spec->freq <= 0 ||
+	     spec->channels < 1 || spec->channels > 8 ) {
+		SDL_SetError("Invalid mixer format");
+		return(NULL);
+	}
+	switch (spec->format) {
+		case AUDIO_U8:
+		case AUDIO_S8:
+		case AUDIO_U16LSB:
+		case AUDIO_S16LSB:
+		case AUDIO_U16MSB:
+		case AUDIO_S16MSB:
+			break;
+		default:
+			SDL_SetError("Unsupported mixer format");
+			return(NULL);
+	}
+	if ( voices < 1 || voices > MIXER_MAX_VOICES ) {
+		SDL_SetError("A mixer has 1 to %d voices", MIXER_MAX_VOICES);
+		return(NULL);
+	}
+
+	mixer = (SDL_AudioMixer *)SDL_malloc(sizeof(*mixer));
+	if ( mixer == NULL ) {
+		SDL_OutOfMemory();
+		return(NULL);
+	}
+	SDL_memset(mixer, 0, sizeof(*mixer));
+	mixer->spec = *spec;
+	mixer->mix_channels = (spec->channels == 1) ? 1 : 2;
+	mixer->gain = 1.0f;
+	mixer->num_voices = voices;
+
+	commands = MIXER_MIN_COMMANDS;
+	while ( commands < voices * 4 ) {
+		commands *= 2;
+	}
+	mixer->command_mask = commands - 1;
+
+	mixer->mix = (float *)SDL_malloc(MIXER_CHUNK_FRAMES * 2 * sizeof(float));
+	mixer->voices = (MixerVoice *)SDL_malloc(voices * sizeof(MixerVoice));
+	mixer->commands = (MixerCommand *)SDL_malloc(commands * sizeof(MixerCommand));
+	if ( !mixer->mix || !mixer->voices || !mixer->commands ) {
+		SDL_free(mixer->commands);
+		SDL_free(mixer->voices);
+		SDL_free(mixer->mix);
+		SDL_free(mixer);
+		SDL_OutOfMemory();
+		return(NULL);
+	}
+	SDL_memset(mixer->voices, 0, voices * sizeof(MixerVoice));
+	for ( i = 0; i < commands; ++i ) {
+		mixer->commands[i].sequence = i;
+	}
+	return(mixer);
+}
+
+/* Add a command to the queue, from any thread */
+static int PushCommand(SDL_AudioMixer *mixer, const MixerCommand *command)
+{
+	MixerCommand *cell;
+	int pos, diff;
+
+	for ( ; ; ) {
+		pos = SDL_AtomicGet(&mixer->enqueue_pos);
+		cell = &mixer->commands[pos & mixer->command_mask];
+		diff = (int)((Uint32)SDL_AtomicGet(&cell->sequence) - (Uint32)pos);
+		if ( diff == 0 ) {
+			if ( SDL_AtomicCAS(&mixer->enqueue_pos, pos, pos + 1) ) {
+				break;
+			}
+		} else if ( diff < 0 ) {
+			SDL_SetError("The mixer's command queue is full");
+			return(-1);
+		}
+	}
+	cell->type = command->type;
+	cell->slot = command->slot;
+	cell->gen = command->gen;
+	cell->sound = command->sound;
+	cell->loops = command->loops;
+	cell->gain = command->gain;
+	cell->pan = command->pan;
+	cell->pitch = command->pitch;
+	SDL_AtomicSet(&cell->sequence, pos + 1);
+	return(0);
+}
+
+/* Take the next command off the queue, in the mixing callback */
+static SDL_bool PopCommand(SDL_AudioMixer *mixer, MixerCommand *command)
+{
+	MixerCommand *cell;
+	int pos = mixer->dequeue_pos;
+
+	cell = &mixer->commands[pos & mixer->command_mask];
+	if ( SDL_AtomicGet(&cell->sequence) != (int)((Uint32)pos + 1) ) {
+		return(SDL_FALSE);
+	}
+	command->type = cell->type;
+	command->slot = cell->slot;
+	command->gen = cell->gen;
+	command->sound = cell->sound;
+	command->loops = cell->loops;
+	command->gain = cell->gain;
+	command->pan = cell->pan;
+	command->pitch = cell->pitch;
+	SDL_AtomicSet(&cell->sequence,
+	              (int)((Uint32)pos + mixer->command_mask + 1));
+	mixer->dequeue_pos = (int)((Uint32)pos + 1);
+	return(SDL_TRUE);
+}
+
+/* Reserve a voice slot, taking the oldest voice that isn't looping if
+   they're all busy.  Returns the slot, with its new generation in 'gen'.
+ */
+static int ReserveVoice(SDL_AudioMixer *mixer, int loops, int *gen)
+{
+	MixerVoice *voice;
+	int i, state, victim, victim_state, started, oldest;
+
+	for ( ; ; ) {
+		victim = -1;
+		victim_state = 0;
+		oldest = 0;
+		for ( i = 0; i < mixer->num_voices; ++i ) {
+			voice = &mixer->voices[i];
+			state = SDL_AtomicGet(&voice->state);
+			if ( (state & 3) == VOICE_FREE ) {
+				*gen = ((state >> 2) + 1) & VOICE_GEN_MASK;
+				if ( SDL_AtomicCAS(&voice->state, state,
+				         VOICE_STATE(*gen, VOICE_RESERVED)) ) {
+					break;
+				}
+			} else if ( SDL_AtomicGet(&voice->loops) == 0 ) {
+				started = SDL_AtomicGet(&voice->started);
+				if ( victim < 0 ||
+				     (int)((Uint32)started - (Uint32)oldest) < 0 ) {
+					victim = i;
+					victim_state = state;
+					oldest = started;
+				}
+			}
+		}
+		if ( i < mixer->num_voices ) {
+			break;
+		}
+		if ( victim < 0 ) {
+			SDL_SetError("All the mixer's voices are looping");
+			return(-1);
+		}
+		*gen = ((victim_state >> 2) + 1) & VOICE_GEN_MASK;
+		if ( SDL_AtomicCAS(&mixer->voices[victim].state, victim_state,
+		                   VOICE_STATE(*gen, VOICE_RESERVED)) ) {
+			i = victim;
+			break;
+		}
+	}
+	voice = &mixer->voices[i];
+	SDL_AtomicSet(&voice->loops, loops);
+	SDL_AtomicSet(&voice->started, SDL_AtomicAdd(&mixer->started, 1));
+	return(i);
+}
+
+int SDL_PlayMixerSound(SDL_AudioMixer *mixer, SDL_MixerSound *sound,
+			int loops, float gain, float pan, float pitch)
+{
+	MixerCommand command;
+	int slot, gen;
+
+	if ( !mixer || !sound ) {
+		SDL_SetError("Passed a NULL mixer or sound");
+		return(-1);
+	}
+	if ( pitch <= 0.0f ) {
+		SDL_SetError("Pitch must be above zero");
+		return(-1);
+	}
+	slot = ReserveVoice(mixer, loops, &gen);
+	if ( slot < 0 ) {
+		return(-1);
+	}
+	SDL_AtomicAdd(&sound->refcount, 1);
+
+	command.type = MIXER_PLAY;
+	command.slot = slot;
+	command.gen = gen;
+	command.sound = sound;
+	command.loops = loops;
+	command.gain = gain;
+	command.pan = pan;
+	command.pitch = pitch;
+	if ( PushCommand(mixer, &command) < 0 ) {
+		SDL_AtomicCAS(&mixer->voices[slot].state,
+		              VOICE_STATE(gen, VOICE_RESERVED),
+		              VOICE_STATE(gen, VOICE_FREE));
+		ReleaseSound(sound);
+		return(-1);
+	}
+	return VOICE_HANDLE(slot, gen);
+}
+
+static int PushVoiceCommand(SDL_AudioMixer *mixer, int type, int voice,
+				float gain, float pan, float pitch)
+{
+	MixerCommand command;
+
+	if ( !mixer ) {
+		SDL_SetError("Passed a NULL mixer");
+		return(-1);
+	}
+	if ( voice < 0 || (voice & 0xFF) >= mixer->num_voices ) {
+		SDL_SetError("Invalid voice");
+		return(-1);
+	}
+	command.type = type;
+	command.slot = (voice & 0xFF);
+	command.gen = (voice >> 8);
+	command.sound = NULL;
+	command.loops = 0;
+	command.gain = gain;
+	command.pan = pan;
+	command.pitch = pitch;
+	return PushCommand(mixer, &command);
+}
+
+int SDL_SetMixerVoice(SDL_AudioMixer *mixer, int voice,
+				float gain, float pan, float pitch)
+{
+	if ( pitch <= 0.0f ) {
+		SDL_SetError("Pitch must be above zero");
+		return(-1);
+	}
+	return PushVoiceCommand(mixer, MIXER_SET, voice, gain, pan, pitch);
+}
+
+int SDL_StopMixerVoice(SDL_AudioMixer *mixer, int voice)
+{
+	return PushVoiceCommand(mixer, MIXER_STOP, voice, 0.0f, 0.0f, 0.0f);
+}
+
+int SDL_StopAllMixerVoices(SDL_AudioMixer *mixer)
+{
+	return PushVoiceCommand(mixer, MIXER_STOP_ALL, 0, 0.0f, 0.0f, 0.0f);
+}
+
+int SDL_SetMixerGain(SDL_AudioMixer *mixer, float gain)
+{
+	return PushVoiceCommand(mixer, MIXER_GAIN, 0, gain, 0.0f, 0.0f);
+}
+
+int SDL_MixerVoicePlaying(SDL_AudioMixer *mixer, int voice)
+{
+	int state;
+
+	if ( !mixer || voice < 0 || (voice & 0xFF) >= mixer->num_voices ) {
+		return(0);
+	}
+	state = SDL_AtomicGet(&mixer->voices[voice & 0xFF].state);
+	return ((state >> 2) == (voice >> 8) && (state & 3) != VOICE_FREE);
+}
+
+/* Work out the channel gains and resampling step for a voice */
+static void SetVoice(SDL_AudioMixer *mixer, MixerVoice *voice,
+				float gain, float pan, float pitch)
+{
+	double step;
+
+	if ( pan < -1.0f ) {
+		pan = -1.0f;
+	} else if ( pan > 1.0f ) {
+		pan = 1.0f;
+	}
+	voice->left = (pan > 0.0f) ? gain * (1.0f - pan) : gain;
+	voice->right = (pan < 0.0f) ? gain * (1.0f + pan) : gain;
+	if ( mixer->mix_channels == 1 ) {
+		voice->left = voice->right = gain;
+		if ( voice->sound->channels == 2 ) {
+			voice->left = voice->right = gain * 0.5f;
+		}
+	}
+	step = (double)voice->sound->freq / mixer->spec.freq * pitch;
+	voice->step = (Uint32)(step * 65536.0 + 0.5);
+	if ( voice->step == 0 ) {
+		voice->step = 1;
+	}
+}
+
+static void EndVoice(MixerVoice *voice)
+{
+	ReleaseSound(voice->sound);
+	voice->sound = NULL;
+	SDL_AtomicCAS(&voice->state, VOICE_STATE(voice->gen, VOICE_PLAYING),
+	              VOICE_STATE(voice->gen, VOICE_FREE));
+}
+
+static void RunCommands(SDL_AudioMixer *mixer)
+{
+	MixerCommand command;
+	MixerVoice *voice;
+	int i, state;
+
+	while ( PopCommand(mixer, &command) ) {
+		voice = &mixer->voices[command.slot];
+		switch (command.type) {
+		    case MIXER_PLAY:
+			state = SDL_AtomicGet(&voice->state);
+			if ( state != VOICE_STATE(command.gen, VOICE_RESERVED) ) {
+				/* Taken again before it started */
+				ReleaseSound(command.sound);
+				break;
+			}
+			if ( voice->sound ) {
+				ReleaseSound(voice->sound);
+			}
+			voice->sound = command.sound;
+			voice->gen = command.gen;
+			voice->loops_left = command.loops;
+			voice->position = 0;
+			voice->fraction = 0;
+			SetVoice(mixer, voice, command.gain, command.pan,
+			         command.pitch);
+			SDL_AtomicCAS(&voice->state, state,
+			              VOICE_STATE(command.gen, VOICE_PLAYING));
+			break;
+		    case MIXER_SET:
+			if ( voice->sound && voice->gen == command.gen ) {
+				SetVoice(mixer, voice, command.gain,
+				         command.pan, command.pitch);
+			}
+			break;
+		    case MIXER_STOP:
+			if ( voice->sound && voice->gen == command.gen ) {
+				EndVoice(voice);
+			}
+			break;
+		    case MIXER_STOP_ALL:
+			for ( i = 0; i < mixer->num_voices; ++i ) {
+				if ( mixer->voices[i].sound ) {
+					EndVoice(&mixer->voices[i]);
+				}
+			}
+			break;
+		    case MIXER_GAIN:
+			mixer->gain = command.gain;
+			break;
+		}
+	}
+}
+
+/* Add frames that play at their own rate to the mix */
+static void MixFrames(const MixerVoice *voice, const Sint16 *src,
+			int channels, float *mix, int mix_channels, int frames)
+{
+	const float left = voice->left;
+	const float right = voice->right;
+#if SSE2_AUDIO_MIXER
+	const int sse2 = SDL_UseSIMD(CPU_HAS_SSE2);
+#endif
+	int i = 0;
+
+	if ( mix_channels == 2 && channels == 1 ) {
+#if SSE2_AUDIO_MIXER
+		const __m128 l = _mm_set1_ps(left);
+		const __m128 r = _mm_set1_ps(right);
+		__m128i x;
+		__m128 s;
+
+		for ( ; sse2 && i + 4 <= frames; i += 4 ) {
+			x = _mm_loadl_epi64((const __m128i *)(src + i));
+			x = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+			s = _mm_cvtepi32_ps(x);
+			_mm_storeu_ps(mix + i*2, _mm_add_ps(
+			    _mm_loadu_ps(mix + i*2),
+			    _mm_unpacklo_ps(_mm_mul_ps(s, l), _mm_mul_ps(s, r))));
+			_mm_storeu_ps(mix + i*2 + 4, _mm_add_ps(
+			    _mm_loadu_ps(mix + i*2 + 4),
+			    _mm_unpackhi_ps(_mm_mul_ps(s, l), _mm_mul_ps(s, r))));
+		}
+#endif
+		for ( ; i < frames; ++i ) {
+			mix[i*2] += src[i] * left;
+			mix[i*2+1] += src[i] * right;
+		}
+	} else if ( mix_channels == 2 ) {
+#if SSE2_AUDIO_MIXER
+		const __m128 lr = _mm_setr_ps(left, right, left, right);
+		__m128i x;
+
+		for ( ; sse2 && i + 4 <= frames; i += 4 ) {
+			x = _mm_loadu_si128((const __m128i *)(src + i*2));
+			_mm_storeu_ps(mix + i*2, _mm_add_ps(
+			    _mm_loadu_ps(mix + i*2), _mm_mul_ps(lr,
+			    _mm_cvtepi32_ps(_mm_srai_epi32(
+			        _mm_unpacklo_epi16(x, x), 16)))));
+			_mm_storeu_ps(mix + i*2 + 4, _mm_add_ps(
+			    _mm_loadu_ps(mix + i*2 + 4), _mm_mul_ps(lr,
+			    _mm_cvtepi32_ps(_mm_srai_epi32(
+			        _mm_unpackhi_epi16(x, x), 16)))));
+		}
+#endif
+		for ( ; i < frames; ++i ) {
+			mix[i*2] += src[i*2] * left;
+			mix[i*2+1] += src[i*2+1] * right;
+		}
+	} else if ( channels == 1 ) {
+		for ( ; i < frames; ++i ) {
+			mix[i] += src[i] * left;
+		}
+	} else {
+		for ( ; i < frames; ++i ) {
+			mix[i] += src[i*2] * left + src[i*2+1] * right;
+		}
+	}
+}
+
+/* Add a voice to the mix, returning 0 once it has finished */
+static int MixVoice(SDL_AudioMixer *mixer, MixerVoice *voice,
+					float *mix, int frames)
+{
+	const SDL_MixerSound *sound = voice->sound;
+	const Sint16 *samples = sound->samples;
+	const int channels = sound->channels;
+	const int mix_channels = mixer->mix_channels;
+	const Uint32 length = sound->frames;
+	Uint32 next;
+	float frac, s0, s1;
+	int i, count;
+
+	while ( frames > 0 ) {
+		if ( voice->position >= length ) {
+			if ( voice->loops_left == 0 || length == 0 ) {
+				return(0);
+			}
+			if ( voice->loops_left > 0 ) {
+				--voice->loops_left;
+			}
+			voice->position %= length;
+		}
+
+		if ( voice->step == 0x10000 && voice->fraction == 0 ) {
+			count = frames;
+			if ( (Uint32)count > length - voice->position ) {
+				count = (int)(length - voice->position);
+			}
+			MixFrames(voice, samples + voice->position * channels,
+			          channels, mix, mix_channels, count);
+			voice->position += count;
+			mix += count * mix_channels;
+			frames -= count;
+			continue;
+		}
+
+		/* Linear interpolation, up to the end of the sound */
+		while ( frames > 0 && voice->position < length ) {
+			next = voice->position + 1;
+			if ( next == length ) {
+				next = (voice->loops_left != 0) ? 0 : voice->position;
+			}
+			frac = voice->fraction * (1.0f / 65536.0f);
+			for ( i = 0; i < channels; ++i ) {
+				s0 = samples[voice->position * channels + i];
+				s1 = samples[next * channels + i];
+				s0 += (s1 - s0) * frac;
+				if ( mix_channels == 1 ) {
+					mix[0] += s0 * voice->left;
+				} else if ( channels == 1 ) {
+					mix[0] += s0 * voice->left;
+					mix[1] += s0 * voice->right;
+				} else {
+					mix[i] += s0 * (i ? voice->right : voice->left);
+				}
+			}
+			voice->fraction += voice->step;
+			voice->position += voice->fraction >> 16;
+			voice->fraction &= 0xFFFF;
+			mix += mix_channels;
+			--frames;
+		}
+	}
+	return(1);
+}
+
+/* Clip the mix and store it in the output format */
+static void StoreMix(SDL_AudioMixer *mixer, const float *mix,
+					Uint8 *stream, int frames)
+{
+	const int channels = mixer->spec.channels;
+	const int mix_channels = mixer->mix_channels;
+	const Uint16 format = mixer->spec.format;
+	const int wide = ((format & 0xFF) == 16);
+	const int limit = wide ? 0x8000 : 0x80;
+	const int center = (format & 0x8000) ? 0 : limit;
+	const int swap = wide &&
+	          (((format & 0x1000) != 0) != (SDL_BYTEORDER == SDL_BIG_ENDIAN));
+	const float scale = mixer->gain * (wide ? 1.0f : (1.0f / 256.0f));
+	const float hi = (float)(limit - 1);
+	const float lo = (float)(-limit);
+	float x;
+	int i, c, v;
+
+#if SSE2_AUDIO_MIXER
+	if ( format == AUDIO_S16SYS && channels == mix_channels &&
+	     SDL_UseSIMD(CPU_HAS_SSE2) ) {
+		const __m128 g = _mm_set1_ps(scale);
+		const __m128 hi4 = _mm_set1_ps(hi);
+		const __m128 lo4 = _mm_set1_ps(lo);
+		const __m128 half = _mm_set1_ps(0.5f);
+		const __m128 sign = _mm_set1_ps(-0.0f);
+		__m128 y;
+		__m128i a, b;
+
+		/* Clamped and rounded half away from zero, like the loop below */
+		for ( i = 0; i + 8 <= frames * channels; i += 8 ) {
+			y = _mm_mul_ps(_mm_loadu_ps(mix + i), g);
+			y = _mm_min_ps(_mm_max_ps(y, lo4), hi4);
+			y = _mm_add_ps(y, _mm_or_ps(_mm_and_ps(y, sign), half));
+			a = _mm_cvttps_epi32(y);
+			y = _mm_mul_ps(_mm_loadu_ps(mix + i + 4), g);
+			y = _mm_min_ps(_mm_max_ps(y, lo4), hi4);
+			y = _mm_add_ps(y, _mm_or_ps(_mm_and_ps(y, sign), half));
+			b = _mm_cvttps_epi32(y);
+			_mm_storeu_si128((__m128i *)(stream + i*2),
+			                 _mm_packs_epi32(a, b));
+		}
+		/* The loop below finishes any frame left half done */
+		i -= i % channels;
+		mix += i;
+		stream += i*2;
+		frames -= i / channels;
+	}
+#endif
+	for ( i = 0; i < frames; ++i ) {
+		for ( c = 0; c < channels; ++c ) {
+			if ( c < mix_channels ) {
+				x = mix[c] * scale;
+				if ( x > hi ) {
+					x = hi;
+				} else if ( x < lo ) {
+					x = lo;
+				}
+				v = (int)(x < 0.0f ? x - 0.5f : x + 0.5f);
+			} else {
+				v = 0;
+			}
+			v += center;
+			if ( !wide ) {
+				*stream++ = (Uint8)v;
+			} else {
+				if ( swap ) {
+					v = SDL_Swap16((Uint16)v);
+				}
+				*(Uint16 *)stream = (Uint16)v;
+				stream += 2;
+			}
+		}
+		mix += mix_channels;
+	}
+}
+
+void SDLCALL SDL_AudioMixerCallback(void *userdata, Uint8 *stream, int len)
+{
+	SDL_AudioMixer *mixer = (SDL_AudioMixer *)userdata;
+	MixerVoice *voice;
+	int i, frames, count, frame_size;
+
+	RunCommands(mixer);
+
+	frame_size = ((mixer->spec.format & 0xFF) / 8) * mixer->spec.channels;
+	frames = len / frame_size;
+	while ( frames > 0 ) {
+		count = frames;
+		if ( count > MIXER_CHUNK_FRAMES ) {
+			count = MIXER_CHUNK_FRAMES;
+		}
+		SDL_memset(mixer->mix, 0,
+		           count * mixer->mix_channels * sizeof(float));
+		for ( i = 0; i < mixer->num_voices; ++i ) {
+			voice = &mixer->voices[i];
+			if ( !voice->sound ) {
+				continue;
+			}
+			if ( (SDL_AtomicGet(&voice->state) >> 2) != voice->gen ) {
+				/* The slot was taken for another voice */
+				ReleaseSound(voice->sound);
+				voice->sound = NULL;
+				continue;
+			}
+			if ( !MixVoice(mixer, voice, mixer->mix, count) ) {
+				EndVoice(voice);
+			}
+		}
+		StoreMix(mixer, mixer->mix, stream, count);
+		stream += count * frame_size;
+		frames -= count;
+	}
+}
+
+void SDL_FreeAudioMixer(SDL_AudioMixer *mixer)
+{
+	MixerCommand command;
+	int i;
+
+	if ( !mixer ) {
+		return;
+	}
+	if ( mixer->commands ) {
+		while ( PopCommand(mixer, &command) ) {
+			if ( command.type == MIXER_PLAY ) {
+				ReleaseSound(command.sound);
+			}
+		}
+	}
+	if ( mixer->voices ) {
+		for ( i = 0; i < mixer->num_voices; ++i ) {
+			if ( mixer->voices[i].sound ) {
+				ReleaseSound(mixer->voices[i].sound);
+			}
+		}
+	}
+	SDL_free(mixer->commands);
+	SDL_free(mixer->voices);
+	SDL_free(mixer->mix);
+	SDL_free(mixer);
+}
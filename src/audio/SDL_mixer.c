@@ -23,7 +23,7 @@
 
 /* This provides the default mixing callback for the SDL audio routines */
 
-#include "SDL_cpuinfo.h"
+#include "../cpuinfo/SDL_cpuinfo_c.h"
 #include "SDL_timer.h"
 #include "SDL_audio.h"
 #include "SDL_sysaudio.h"
@@ -94,9 +94,6 @@ void SDL_MixAudio (Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
 {
 	Uint16 format;
 
-	if ( volume == 0 ) {
-		return;
-	}
 	/* Mix the user-level audio format */
 	if ( current_audio ) {
 		if ( current_audio->convert.needed ) {
@@ -108,6 +105,14 @@ void SDL_MixAudio (Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
   		/* HACK HACK HACK */
 		format = AUDIO_S16;
 	}
+	SDL_MixAudioFormat(dst, src, format, len, volume);
+}
+
+void SDL_MixAudioFormat (Uint8 *dst, const Uint8 *src, Uint16 format, Uint32 len, int volume)
+{
+	if ( volume == 0 ) {
+		return;
+	}
 	switch (format) {
 
 		case AUDIO_U8: {
@@ -130,13 +135,13 @@ void SDL_MixAudio (Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
 		case AUDIO_S8: {
 #if defined(SDL_BUGGY_MMX_MIXERS) /* buggy, so we're disabling them. --ryan. */
 #if defined(__GNUC__) && defined(__i386__) && defined(SDL_ASSEMBLY_ROUTINES)
-			if (SDL_HasMMX())
+			if (SDL_UseSIMD(CPU_HAS_MMX))
 			{
 				SDL_MixAudio_MMX_S8((char*)dst,(char*)src,(unsigned int)len,(int)volume);
 			}
 			else
 #elif ((defined(_MSC_VER) && defined(_M_IX86)) || defined(__WATCOMC__)) && defined(SDL_ASSEMBLY_ROUTINES)
-			if (SDL_HasMMX())
+			if (SDL_UseSIMD(CPU_HAS_MMX))
 			{
 				SDL_MixAudio_MMX_S8_VC((char*)dst,(char*)src,(unsigned int)len,(int)volume);
 			}
@@ -179,13 +184,13 @@ void SDL_MixAudio (Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
 		case AUDIO_S16LSB: {
 #if defined(SDL_BUGGY_MMX_MIXERS) /* buggy, so we're disabling them. --ryan. */
 #if defined(__GNUC__) && defined(__i386__) && defined(SDL_ASSEMBLY_ROUTINES)
-			if (SDL_HasMMX())
+			if (SDL_UseSIMD(CPU_HAS_MMX))
 			{
 				SDL_MixAudio_MMX_S16((char*)dst,(char*)src,(unsigned int)len,(int)volume);
 			}
                         else
 #elif ((defined(_MSC_VER) && defined(_M_IX86)) || defined(__WATCOMC__)) && defined(SDL_ASSEMBLY_ROUTINES)
-			if (SDL_HasMMX())
+			if (SDL_UseSIMD(CPU_HAS_MMX))
 			{
 				SDL_MixAudio_MMX_S16_VC((char*)dst,(char*)src,(unsigned int)len,(int)volume);
 			}
@@ -54,6 +54,11 @@ struct SDL_AudioDevice {
 	void (*WaitDone)(_THIS);
 	void (*CloseAudio)(_THIS);
 
+	/* Fill 'buffer' from a capture device, returns -1 on error.
+	   Drivers that can record check 'iscapture' in OpenAudio().
+	 */
+	int  (*CaptureAudio)(_THIS, Uint8 *buffer, int buflen);
+
 	/* * * */
 	/* Lock / Unlock functions added for the Mac port */
 	void (*LockAudio)(_THIS);
@@ -61,6 +66,9 @@ struct SDL_AudioDevice {
 
 	void (*SetCaption)(_THIS, const char *caption);
 
+	/* Microseconds until audio played now is heard, or -1 if unknown */
+	int  (*GetLatency)(_THIS);
+
 	/* * * */
 	/* Data common to all devices */
 
@@ -85,6 +93,21 @@ struct SDL_AudioDevice {
 	SDL_Thread *thread;
 	Uint32 threadid;
 
+	/* Device name passed to SDL_OpenAudioDevice(), NULL for the default */
+	char *devname;
+
+	/* Set for the device opened by SDL_OpenAudioCapture() */
+	int iscapture;
+
+	/* Recorded audio waiting for SDL_ReadAudioCapture(), a single
+	   producer single consumer ring indexed by free running counters.
+	 */
+	Uint8 *capture_ring;
+	Uint32 capture_size;		/* Power of two */
+	int capture_frame;		/* Bytes per sample frame */
+	volatile int capture_head;	/* Written by the capture thread */
+	volatile int capture_tail;	/* Written by the reader */
+
 	/* * * */
 	/* Data private to this driver */
 	struct SDL_PrivateAudioData *hidden;
@@ -24,7 +24,10 @@
 /* Microsoft WAVE file loading routines */
 
 #include "SDL_audio.h"
+#include "SDL_hints.h"
+#include "SDL_jobs.h"
 #include "SDL_wave.h"
+#include "../thread/SDL_atomic_c.h"
 
 
 static int ReadChunk(SDL_RWops *src, Chunk *chunk);
@@ -35,28 +38,27 @@ struct MS_ADPCM_decodestate {
 	Sint16 iSamp1;
 	Sint16 iSamp2;
 };
-static struct MS_ADPCM_decoder {
+struct MS_ADPCM_decoder {
 	WaveFMT wavefmt;
 	Uint16 wSamplesPerBlock;
 	Uint16 wNumCoef;
 	Sint16 aCoeff[7][2];
-	/* * * */
-	struct MS_ADPCM_decodestate state[2];
-} MS_ADPCM_state;
+};
 
-static int InitMS_ADPCM(WaveFMT *format, int length)
+static int InitMS_ADPCM(struct MS_ADPCM_decoder *decoder,
+					WaveFMT *format, int length)
 {
 	Uint8 *rogue_feel, *rogue_feel_end;
-	int i;
+	int i, channels;
 
 	/* Set the rogue pointer to the MS_ADPCM specific data */
 	if (length < sizeof(*format)) goto too_short;
-	MS_ADPCM_state.wavefmt.encoding = SDL_SwapLE16(format->encoding);
-	MS_ADPCM_state.wavefmt.channels = SDL_SwapLE16(format->channels);
-	MS_ADPCM_state.wavefmt.frequency = SDL_SwapLE32(format->frequency);
-	MS_ADPCM_state.wavefmt.byterate = SDL_SwapLE32(format->byterate);
-	MS_ADPCM_state.wavefmt.blockalign = SDL_SwapLE16(format->blockalign);
-	MS_ADPCM_state.wavefmt.bitspersample =
+	decoder->wavefmt.encoding = SDL_SwapLE16(format->encoding);
+	decoder->wavefmt.channels = SDL_SwapLE16(format->channels);
+	decoder->wavefmt.frequency = SDL_SwapLE32(format->frequency);
+	decoder->wavefmt.byterate = SDL_SwapLE32(format->byterate);
+	decoder->wavefmt.blockalign = SDL_SwapLE16(format->blockalign);
+	decoder->wavefmt.bitspersample =
 					 SDL_SwapLE16(format->bitspersample);
 	rogue_feel = (Uint8 *)format+sizeof(*format);
 	rogue_feel_end = (Uint8 *)format + length;
@@ -64,175 +66,140 @@ static int InitMS_ADPCM(WaveFMT *format, int length)
 		rogue_feel += sizeof(Uint16);
 	}
 	if (rogue_feel + 4 > rogue_feel_end) goto too_short;
-	MS_ADPCM_state.wSamplesPerBlock = ((rogue_feel[1]<<8)|rogue_feel[0]);
+	decoder->wSamplesPerBlock = ((rogue_feel[1]<<8)|rogue_feel[0]);
 	rogue_feel += sizeof(Uint16);
-	MS_ADPCM_state.wNumCoef = ((rogue_feel[1]<<8)|rogue_feel[0]);
+	decoder->wNumCoef = ((rogue_feel[1]<<8)|rogue_feel[0]);
 	rogue_feel += sizeof(Uint16);
-	if ( MS_ADPCM_state.wNumCoef != 7 ) {
+	if ( decoder->wNumCoef != 7 ) {
 		SDL_SetError("Unknown set of MS_ADPCM coefficients");
 		return(-1);
 	}
-	for ( i=0; i<MS_ADPCM_state.wNumCoef; ++i ) {
+	for ( i=0; i<decoder->wNumCoef; ++i ) {
 		if (rogue_feel + 4 > rogue_feel_end) goto too_short;
-		MS_ADPCM_state.aCoeff[i][0] = ((rogue_feel[1]<<8)|rogue_feel[0]);
+		decoder->aCoeff[i][0] = ((rogue_feel[1]<<8)|rogue_feel[0]);
 		rogue_feel += sizeof(Uint16);
-		MS_ADPCM_state.aCoeff[i][1] = ((rogue_feel[1]<<8)|rogue_feel[0]);
+		decoder->aCoeff[i][1] = ((rogue_feel[1]<<8)|rogue_feel[0]);
 		rogue_feel += sizeof(Uint16);
 	}
+
+	/* Every block must hold its header and all of its nybbles */
+	channels = decoder->wavefmt.channels;
+	if ( (channels < 1) || (channels > 2) ) {
+		SDL_SetError("MS ADPCM decoder can only handle %d channels", 2);
+		return(-1);
+	}
+	if ( (decoder->wSamplesPerBlock < 2) ||
+	     (7*channels + ((decoder->wSamplesPerBlock-2)*channels+1)/2 >
+					decoder->wavefmt.blockalign) ) {
+		SDL_SetError("Unexpected block size for a MS ADPCM decoder");
+		return(-1);
+	}
 	return(0);
 too_short:
 	SDL_SetError("Unexpected length of a chunk with a MS ADPCM format");
 	return(-1);
 }
 
-static Sint32 MS_ADPCM_nibble(struct MS_ADPCM_decodestate *state,
-					Uint8 nybble, Sint16 *coeff)
+static const Sint32 MS_ADPCM_adaptive[16] = {
+	230, 230, 230, 230, 307, 409, 512, 614,
+	768, 614, 512, 409, 307, 230, 230, 230
+};
+
+static __inline__ Sint16 MS_ADPCM_nibble(struct MS_ADPCM_decodestate *state,
+					Uint8 nybble, const Sint16 *coeff)
 {
-	const Sint32 max_audioval = ((1<<(16-1))-1);
-	const Sint32 min_audioval = -(1<<(16-1));
-	const Sint32 adaptive[] = {
-		230, 230, 230, 230, 307, 409, 512, 614,
-		768, 614, 512, 409, 307, 230, 230, 230
-	};
 	Sint32 new_sample, delta;
 
 	new_sample = ((state->iSamp1 * coeff[0]) +
 		      (state->iSamp2 * coeff[1]))/256;
-	if ( nybble & 0x08 ) {
-		new_sample += state->iDelta * (nybble-0x10);
-	} else {
-		new_sample += state->iDelta * nybble;
-	}
-	if ( new_sample < min_audioval ) {
-		new_sample = min_audioval;
+	new_sample += (Sint32)state->iDelta * (((nybble ^ 0x08) - 0x08));
+	if ( new_sample < -32768 ) {
+		new_sample = -32768;
 	} else
-	if ( new_sample > max_audioval ) {
-		new_sample = max_audioval;
+	if ( new_sample > 32767 ) {
+		new_sample = 32767;
 	}
-	delta = ((Sint32)state->iDelta * adaptive[nybble])/256;
+	delta = ((Sint32)state->iDelta * MS_ADPCM_adaptive[nybble])/256;
 	if ( delta < 16 ) {
 		delta = 16;
 	}
 	state->iDelta = (Uint16)delta;
 	state->iSamp2 = state->iSamp1;
 	state->iSamp1 = (Sint16)new_sample;
-	return(new_sample);
+	return (Sint16)SDL_SwapLE16((Uint16)new_sample);
 }
 
-static int MS_ADPCM_decode(Uint8 **audio_buf, Uint32 *audio_len)
+/* Decode one block of wavefmt.blockalign bytes into wSamplesPerBlock frames */
+static int MS_ADPCM_decode_block(struct MS_ADPCM_decoder *decoder,
+				const Uint8 *encoded, Uint8 *decoded)
 {
-	struct MS_ADPCM_decodestate *state[2];
-	Uint8 *freeable, *encoded, *encoded_end, *decoded, *decoded_end;
-	Sint32 encoded_len, samplesleft;
-	Sint8 nybble, stereo;
-	Sint16 *coeff[2];
-	Sint32 new_sample;
-
-	/* Allocate the proper sized output buffer */
-	encoded_len = *audio_len;
-	encoded = *audio_buf;
-	encoded_end = encoded + encoded_len;
-	freeable = *audio_buf;
-	*audio_len = (encoded_len/MS_ADPCM_state.wavefmt.blockalign) * 
-				MS_ADPCM_state.wSamplesPerBlock*
-				MS_ADPCM_state.wavefmt.channels*sizeof(Sint16);
-	*audio_buf = (Uint8 *)SDL_malloc(*audio_len);
-	if ( *audio_buf == NULL ) {
-		SDL_Error(SDL_ENOMEM);
-		return(-1);
-	}
-	decoded = *audio_buf;
-	decoded_end = decoded + *audio_len;
-
-	/* Get ready... Go! */
-	stereo = (MS_ADPCM_state.wavefmt.channels == 2);
-	state[0] = &MS_ADPCM_state.state[0];
-	state[1] = &MS_ADPCM_state.state[stereo];
-	while ( encoded_len >= MS_ADPCM_state.wavefmt.blockalign ) {
+	struct MS_ADPCM_decodestate left, right;
+	const Sint16 *coeff[2];
+	Sint16 *out = (Sint16 *)decoded;
+	Sint32 samplesleft;
+	Uint8 byte;
+
+	samplesleft = (decoder->wSamplesPerBlock-2)*decoder->wavefmt.channels;
+	if ( decoder->wavefmt.channels == 2 ) {
 		/* Grab the initial information for this block */
-		if (encoded + 7 + (stereo ? 7 : 0) > encoded_end) goto invalid_size;
-		state[0]->hPredictor = *encoded++;
-		if ( stereo ) {
-			state[1]->hPredictor = *encoded++;
-		}
-		if (state[0]->hPredictor >= 7 || state[1]->hPredictor >= 7) {
+		left.hPredictor = encoded[0];
+		right.hPredictor = encoded[1];
+		if ( left.hPredictor >= 7 || right.hPredictor >= 7 ) {
 			goto invalid_predictor;
 		}
-		state[0]->iDelta = ((encoded[1]<<8)|encoded[0]);
-		encoded += sizeof(Sint16);
-		if ( stereo ) {
-			state[1]->iDelta = ((encoded[1]<<8)|encoded[0]);
-			encoded += sizeof(Sint16);
-		}
-		state[0]->iSamp1 = ((encoded[1]<<8)|encoded[0]);
-		encoded += sizeof(Sint16);
-		if ( stereo ) {
-			state[1]->iSamp1 = ((encoded[1]<<8)|encoded[0]);
-			encoded += sizeof(Sint16);
-		}
-		state[0]->iSamp2 = ((encoded[1]<<8)|encoded[0]);
-		encoded += sizeof(Sint16);
-		if ( stereo ) {
-			state[1]->iSamp2 = ((encoded[1]<<8)|encoded[0]);
-			encoded += sizeof(Sint16);
-		}
-		coeff[0] = MS_ADPCM_state.aCoeff[state[0]->hPredictor];
-		coeff[1] = MS_ADPCM_state.aCoeff[state[1]->hPredictor];
+		left.iDelta = ((encoded[3]<<8)|encoded[2]);
+		right.iDelta = ((encoded[5]<<8)|encoded[4]);
+		left.iSamp1 = (Sint16)((encoded[7]<<8)|encoded[6]);
+		right.iSamp1 = (Sint16)((encoded[9]<<8)|encoded[8]);
+		left.iSamp2 = (Sint16)((encoded[11]<<8)|encoded[10]);
+		right.iSamp2 = (Sint16)((encoded[13]<<8)|encoded[12]);
+		encoded += 14;
+		coeff[0] = decoder->aCoeff[left.hPredictor];
+		coeff[1] = decoder->aCoeff[right.hPredictor];
 
 		/* Store the two initial samples we start with */
-		if (decoded + 4 + (stereo ? 4 : 0) > decoded_end) goto invalid_size;
-		decoded[0] = state[0]->iSamp2&0xFF;
-		decoded[1] = state[0]->iSamp2>>8;
-		decoded += 2;
-		if ( stereo ) {
-			decoded[0] = state[1]->iSamp2&0xFF;
-			decoded[1] = state[1]->iSamp2>>8;
-			decoded += 2;
+		out[0] = (Sint16)SDL_SwapLE16((Uint16)left.iSamp2);
+		out[1] = (Sint16)SDL_SwapLE16((Uint16)right.iSamp2);
+		out[2] = (Sint16)SDL_SwapLE16((Uint16)left.iSamp1);
+		out[3] = (Sint16)SDL_SwapLE16((Uint16)right.iSamp1);
+		out += 4;
+
+		/* Each byte holds one sample for each channel */
+		for ( ; samplesleft > 0; samplesleft -= 2 ) {
+			byte = *encoded++;
+			out[0] = MS_ADPCM_nibble(&left, byte>>4, coeff[0]);
+			out[1] = MS_ADPCM_nibble(&right, byte&0x0F, coeff[1]);
+			out += 2;
 		}
-		decoded[0] = state[0]->iSamp1&0xFF;
-		decoded[1] = state[0]->iSamp1>>8;
-		decoded += 2;
-		if ( stereo ) {
-			decoded[0] = state[1]->iSamp1&0xFF;
-			decoded[1] = state[1]->iSamp1>>8;
-			decoded += 2;
+	} else {
+		left.hPredictor = encoded[0];
+		if ( left.hPredictor >= 7 ) {
+			goto invalid_predictor;
 		}
-
-		/* Decode and store the other samples in this block */
-		samplesleft = (MS_ADPCM_state.wSamplesPerBlock-2)*
-					MS_ADPCM_state.wavefmt.channels;
-		while ( samplesleft > 0 ) {
-			if (encoded + 1 > encoded_end) goto invalid_size;
-			if (decoded + 4 > decoded_end) goto invalid_size;
-
-			nybble = (*encoded)>>4;
-			new_sample = MS_ADPCM_nibble(state[0],nybble,coeff[0]);
-			decoded[0] = new_sample&0xFF;
-			new_sample >>= 8;
-			decoded[1] = new_sample&0xFF;
-			decoded += 2;
-
-			nybble = (*encoded)&0x0F;
-			new_sample = MS_ADPCM_nibble(state[1],nybble,coeff[1]);
-			decoded[0] = new_sample&0xFF;
-			new_sample >>= 8;
-			decoded[1] = new_sample&0xFF;
-			decoded += 2;
-
-			++encoded;
-			samplesleft -= 2;
+		left.iDelta = ((encoded[2]<<8)|encoded[1]);
+		left.iSamp1 = (Sint16)((encoded[4]<<8)|encoded[3]);
+		left.iSamp2 = (Sint16)((encoded[6]<<8)|encoded[5]);
+		encoded += 7;
+		coeff[0] = decoder->aCoeff[left.hPredictor];
+
+		out[0] = (Sint16)SDL_SwapLE16((Uint16)left.iSamp2);
+		out[1] = (Sint16)SDL_SwapLE16((Uint16)left.iSamp1);
+		out += 2;
+
+		for ( ; samplesleft > 1; samplesleft -= 2 ) {
+			byte = *encoded++;
+			out[0] = MS_ADPCM_nibble(&left, byte>>4, coeff[0]);
+			out[1] = MS_ADPCM_nibble(&left, byte&0x0F, coeff[0]);
+			out += 2;
+		}
+		if ( samplesleft ) {
+			out[0] = MS_ADPCM_nibble(&left, (*encoded)>>4, coeff[0]);
 		}
-		encoded_len -= MS_ADPCM_state.wavefmt.blockalign;
 	}
-	SDL_free(freeable);
 	return(0);
-invalid_size:
-	SDL_SetError("Unexpected chunk length for a MS ADPCM decoder");
-	SDL_free(freeable);
-	return(-1);
+
 invalid_predictor:
 	SDL_SetError("Invalid predictor value for a MS ADPCM decoder");
-	SDL_free(freeable);
 	return(-1);
 }
 
@@ -240,43 +207,20 @@ struct IMA_ADPCM_decodestate {
 	Sint32 sample;
 	Sint8 index;
 };
-static struct IMA_ADPCM_decoder {
+struct IMA_ADPCM_decoder {
 	WaveFMT wavefmt;
 	Uint16 wSamplesPerBlock;
-	/* * * */
-	struct IMA_ADPCM_decodestate state[2];
-} IMA_ADPCM_state;
-
-static int InitIMA_ADPCM(WaveFMT *format, int length)
-{
-	Uint8 *rogue_feel, *rogue_feel_end;
+};
 
-	/* Set the rogue pointer to the IMA_ADPCM specific data */
-	if (length < sizeof(*format)) goto too_short;
-	IMA_ADPCM_state.wavefmt.encoding = SDL_SwapLE16(format->encoding);
-	IMA_ADPCM_state.wavefmt.channels = SDL_SwapLE16(format->channels);
-	IMA_ADPCM_state.wavefmt.frequency = SDL_SwapLE32(format->frequency);
-	IMA_ADPCM_state.wavefmt.byterate = SDL_SwapLE32(format->byterate);
-	IMA_ADPCM_state.wavefmt.blockalign = SDL_SwapLE16(format->blockalign);
-	IMA_ADPCM_state.wavefmt.bitspersample =
-					 SDL_SwapLE16(format->bitspersample);
-	rogue_feel = (Uint8 *)format+sizeof(*format);
-	rogue_feel_end = (Uint8 *)format + length;
-	if ( sizeof(*format) == 16 ) {
-		rogue_feel += sizeof(Uint16);
-	}
-	if (rogue_feel + 2 > rogue_feel_end) goto too_short;
-	IMA_ADPCM_state.wSamplesPerBlock = ((rogue_feel[1]<<8)|rogue_feel[0]);
-	return(0);
-too_short:
-	SDL_SetError("Unexpected length of a chunk with an IMA ADPCM format");
-	return(-1);
-}
+/* The sample change and the next step index for every step index and
+   nybble, so decoding a sample takes two lookups instead of a run of tests.
+ */
+static Sint32 IMA_ADPCM_delta[89][16];
+static Uint8 IMA_ADPCM_next[89][16];
+static volatile int IMA_ADPCM_tables_ready = 0;
 
-static Sint32 IMA_ADPCM_nibble(struct IMA_ADPCM_decodestate *state,Uint8 nybble)
+static void InitIMA_ADPCM_tables(void)
 {
-	const Sint32 max_audioval = ((1<<(16-1))-1);
-	const Sint32 min_audioval = -(1<<(16-1));
 	const int index_table[16] = {
 		-1, -1, -1, -1,
 		 2,  4,  6,  8,
@@ -294,143 +238,341 @@ static Sint32 IMA_ADPCM_nibble(struct IMA_ADPCM_decodestate *state,Uint8 nybble)
 		22385, 24623, 27086, 29794, 32767
 	};
 	Sint32 delta, step;
+	int index, nybble, next;
 
-	/* Clamp index value. The inital value can be invalid. */
-	if ( state->index > 88 ) {
-		state->index = 88;
-	} else
-	if ( state->index < 0 ) {
-		state->index = 0;
+	if ( IMA_ADPCM_tables_ready ) {
+		return;
+	}
+	for ( index=0; index<89; ++index ) {
+		step = step_table[index];
+		for ( nybble=0; nybble<16; ++nybble ) {
+			delta = step >> 3;
+			if ( nybble & 0x04 ) delta += step;
+			if ( nybble & 0x02 ) delta += (step >> 1);
+			if ( nybble & 0x01 ) delta += (step >> 2);
+			if ( nybble & 0x08 ) delta = -delta;
+			IMA_ADPCM_delta[index][nybble] = delta;
+
+			next = index + index_table[nybble];
+			if ( next > 88 ) {
+				next = 88;
+			} else
+			if ( next < 0 ) {
+				next = 0;
+			}
+			IMA_ADPCM_next[index][nybble] = (Uint8)next;
+		}
 	}
+	IMA_ADPCM_tables_ready = 1;
+}
 
-	/* Compute difference and new sample value */
-	step = step_table[state->index];
-	delta = step >> 3;
-	if ( nybble & 0x04 ) delta += step;
-	if ( nybble & 0x02 ) delta += (step >> 1);
-	if ( nybble & 0x01 ) delta += (step >> 2);
-	if ( nybble & 0x08 ) delta = -delta;
-	state->sample += delta;
+static int InitIMA_ADPCM(struct IMA_ADPCM_decoder *decoder,
+					WaveFMT *format, int length)
+{
+	Uint8 *rogue_feel, *rogue_feel_end;
+	int channels;
 
-	/* Update index value */
-	state->index += index_table[nybble];
+	/* Set the rogue pointer to the IMA_ADPCM specific data */
+	if (length < sizeof(*format)) goto too_short;
+	decoder->wavefmt.encoding = SDL_SwapLE16(format->encoding);
+	decoder->wavefmt.channels = SDL_SwapLE16(format->channels);
+	decoder->wavefmt.frequency = SDL_SwapLE32(format->frequency);
+	decoder->wavefmt.byterate = SDL_SwapLE32(format->byterate);
+	decoder->wavefmt.blockalign = SDL_SwapLE16(format->blockalign);
+	decoder->wavefmt.bitspersample =
+					 SDL_SwapLE16(format->bitspersample);
+	rogue_feel = (Uint8 *)format+sizeof(*format);
+	rogue_feel_end = (Uint8 *)format + length;
+	if ( sizeof(*format) == 16 ) {
+		rogue_feel += sizeof(Uint16);
+	}
+	if (rogue_feel + 2 > rogue_feel_end) goto too_short;
+	decoder->wSamplesPerBlock = ((rogue_feel[1]<<8)|rogue_feel[0]);
+
+	/* Samples come in groups of 8 per channel after the block header */
+	channels = decoder->wavefmt.channels;
+	if ( (channels < 1) || (channels > 2) ) {
+		SDL_SetError("IMA ADPCM decoder can only handle %d channels", 2);
+		return(-1);
+	}
+	if ( (decoder->wSamplesPerBlock < 1) ||
+	     ((decoder->wSamplesPerBlock-1) % 8) != 0 ||
+	     (4*channels + (decoder->wSamplesPerBlock-1)/2*channels >
+					decoder->wavefmt.blockalign) ) {
+		SDL_SetError("Unexpected block size for an IMA ADPCM decoder");
+		return(-1);
+	}
+	InitIMA_ADPCM_tables();
+	return(0);
+too_short:
+	SDL_SetError("Unexpected length of a chunk with an IMA ADPCM format");
+	return(-1);
+}
+
+static __inline__ Sint16 IMA_ADPCM_nibble(struct IMA_ADPCM_decodestate *state,
+							Uint8 nybble)
+{
+	Sint32 sample;
+
+	sample = state->sample + IMA_ADPCM_delta[state->index][nybble];
+	state->index = IMA_ADPCM_next[state->index][nybble];
 
 	/* Clamp output sample */
-	if ( state->sample > max_audioval ) {
-		state->sample = max_audioval;
+	if ( sample > 32767 ) {
+		sample = 32767;
 	} else
-	if ( state->sample < min_audioval ) {
-		state->sample = min_audioval;
+	if ( sample < -32768 ) {
+		sample = -32768;
 	}
-	return(state->sample);
+	state->sample = sample;
+	return (Sint16)SDL_SwapLE16((Uint16)sample);
 }
 
-/* Fill the decode buffer with a channel block of data (8 samples) */
-static void Fill_IMA_ADPCM_block(Uint8 *decoded, Uint8 *encoded,
-	int channel, int numchannels, struct IMA_ADPCM_decodestate *state)
+/* Decode one block of wavefmt.blockalign bytes into wSamplesPerBlock frames */
+static int IMA_ADPCM_decode_block(struct IMA_ADPCM_decoder *decoder,
+				const Uint8 *encoded, Uint8 *decoded)
 {
+	struct IMA_ADPCM_decodestate state[2];
+	Sint16 *out = (Sint16 *)decoded;
+	Sint32 groups;
+	unsigned int c, channels;
+	Sint8 index;
 	int i;
-	Sint8 nybble;
-	Sint32 new_sample;
-
-	decoded += (channel * 2);
-	for ( i=0; i<4; ++i ) {
-		nybble = (*encoded)&0x0F;
-		new_sample = IMA_ADPCM_nibble(state, nybble);
-		decoded[0] = new_sample&0xFF;
-		new_sample >>= 8;
-		decoded[1] = new_sample&0xFF;
-		decoded += 2 * numchannels;
-
-		nybble = (*encoded)>>4;
-		new_sample = IMA_ADPCM_nibble(state, nybble);
-		decoded[0] = new_sample&0xFF;
-		new_sample >>= 8;
-		decoded[1] = new_sample&0xFF;
-		decoded += 2 * numchannels;
-
-		++encoded;
+
+	channels = decoder->wavefmt.channels;
+
+	/* Grab the initial information for this block */
+	for ( c=0; c<channels; ++c ) {
+		/* Fill the state information for this block */
+		state[c].sample = (Sint16)((encoded[1]<<8)|encoded[0]);
+		/* The inital index can be invalid, clamp it */
+		index = (Sint8)encoded[2];
+		if ( index > 88 ) {
+			index = 88;
+		} else
+		if ( index < 0 ) {
+			index = 0;
+		}
+		state[c].index = index;
+		/* encoded[3] is reserved and should be 0 */
+		encoded += 4;
+
+		/* Store the initial sample we start with */
+		*out++ = (Sint16)SDL_SwapLE16((Uint16)state[c].sample);
+	}
+
+	/* The rest comes in groups of 4 bytes (8 samples) per channel */
+	groups = (decoder->wSamplesPerBlock-1)/8;
+	if ( channels == 2 ) {
+		for ( ; groups > 0; --groups ) {
+			for ( i=0; i<4; ++i ) {
+				out[0] = IMA_ADPCM_nibble(&state[0], encoded[i]&0x0F);
+				out[1] = IMA_ADPCM_nibble(&state[1], encoded[4+i]&0x0F);
+				out[2] = IMA_ADPCM_nibble(&state[0], encoded[i]>>4);
+				out[3] = IMA_ADPCM_nibble(&state[1], encoded[4+i]>>4);
+				out += 4;
+			}
+			encoded += 8;
+		}
+	} else {
+		for ( groups *= 4; groups > 0; --groups ) {
+			out[0] = IMA_ADPCM_nibble(&state[0], (*encoded)&0x0F);
+			out[1] = IMA_ADPCM_nibble(&state[0], (*encoded)>>4);
+			out += 2;
+			++encoded;
+		}
 	}
+	return(0);
 }
 
-static int IMA_ADPCM_decode(Uint8 **audio_buf, Uint32 *audio_len)
+/* The format of a WAVE data chunk, and the decoder state to read it with */
+typedef struct WaveDecoder {
+	Uint16 encoding;
+	Uint16 blockalign;	/* Bytes per encoded block */
+	Uint16 blockframes;	/* Sample frames per block */
+	Uint16 framesize;	/* Bytes per decoded sample frame */
+	struct MS_ADPCM_decoder ms;
+	struct IMA_ADPCM_decoder ima;
+} WaveDecoder;
+
+static int InitWaveDecoder(WaveDecoder *decoder, WaveFMT *format, int length,
+							SDL_AudioSpec *spec)
 {
-	struct IMA_ADPCM_decodestate *state;
-	Uint8 *freeable, *encoded, *encoded_end, *decoded, *decoded_end;
-	Sint32 encoded_len, samplesleft;
-	unsigned int c, channels;
+	int was_error = 0;
 
-	/* Check to make sure we have enough variables in the state array */
-	channels = IMA_ADPCM_state.wavefmt.channels;
-	if ( channels > SDL_arraysize(IMA_ADPCM_state.state) ) {
-		SDL_SetError("IMA ADPCM decoder can only handle %d channels",
-					SDL_arraysize(IMA_ADPCM_state.state));
+	SDL_memset(decoder, 0, (sizeof *decoder));
+	decoder->encoding = SDL_SwapLE16(format->encoding);
+	switch (decoder->encoding) {
+		case PCM_CODE:
+			/* We can understand this */
+			break;
+		case MS_ADPCM_CODE:
+			/* Try to understand this */
+			if ( InitMS_ADPCM(&decoder->ms, format, length) < 0 ) {
+				return(-1);
+			}
+			decoder->blockalign = decoder->ms.wavefmt.blockalign;
+			decoder->blockframes = decoder->ms.wSamplesPerBlock;
+			break;
+		case IMA_ADPCM_CODE:
+			/* Try to understand this */
+			if ( InitIMA_ADPCM(&decoder->ima, format, length) < 0 ) {
+				return(-1);
+			}
+			decoder->blockalign = decoder->ima.wavefmt.blockalign;
+			decoder->blockframes = decoder->ima.wSamplesPerBlock;
+			break;
+		case MP3_CODE:
+			SDL_SetError("MPEG Layer 3 data not supported",
+					SDL_SwapLE16(format->encoding));
+			return(-1);
+		default:
+			SDL_SetError("Unknown WAVE data format: 0x%.4x",
+					SDL_SwapLE16(format->encoding));
+			return(-1);
+	}
+	SDL_memset(spec, 0, (sizeof *spec));
+	spec->freq = SDL_SwapLE32(format->frequency);
+	switch (SDL_SwapLE16(format->bitspersample)) {
+		case 8:
+			spec->format = AUDIO_U8;
+			break;
+		case 16:
+			spec->format = AUDIO_S16;
+			break;
+		default:
+			was_error = 1;
+			break;
+	}
+	if ( decoder->encoding != PCM_CODE ) {
+		/* The ADPCM decoders write 16-bit samples, whatever the header
+		   says the encoded sample size is.
+		 */
+		spec->format = AUDIO_S16;
+		was_error = 0;
+	}
+	if ( was_error ) {
+		SDL_SetError("Unknown %d-bit PCM data format",
+			SDL_SwapLE16(format->bitspersample));
 		return(-1);
 	}
-	state = IMA_ADPCM_state.state;
+	spec->channels = (Uint8)SDL_SwapLE16(format->channels);
+	spec->samples = 4096;		/* Good default buffer size */
+
+	decoder->framesize = ((spec->format & 0xFF)/8)*spec->channels;
+	if ( decoder->encoding == PCM_CODE ) {
+		decoder->blockalign = decoder->framesize;
+		decoder->blockframes = 1;
+	}
+	return(0);
+}
+
+static int WaveDecodeBlock(WaveDecoder *decoder,
+				const Uint8 *encoded, Uint8 *decoded)
+{
+	switch (decoder->encoding) {
+		case MS_ADPCM_CODE:
+			return MS_ADPCM_decode_block(&decoder->ms, encoded, decoded);
+		case IMA_ADPCM_CODE:
+			return IMA_ADPCM_decode_block(&decoder->ima, encoded, decoded);
+		default:
+			SDL_memcpy(decoded, encoded, decoder->blockalign);
+			return(0);
+	}
+}
+
+/* ADPCM blocks don't depend on each other, so big data chunks are split
+   into runs of blocks that are decoded on the job threads.
+ */
+#define WAVE_MIN_THREAD_BLOCKS	256
+
+typedef struct WaveDecodeJob {
+	WaveDecoder *decoder;
+	const Uint8 *encoded;
+	Uint8 *decoded;
+	volatile int bad;	/* The first bad block found, or the block count */
+} WaveDecodeJob;
+
+static void SDLCALL WaveDecodeBlocks(void *data, int first, int last)
+{
+	WaveDecodeJob *job = (WaveDecodeJob *)data;
+	WaveDecoder *decoder = job->decoder;
+	Uint32 blocksize = decoder->blockframes * decoder->framesize;
+	const Uint8 *encoded = job->encoded + first * decoder->blockalign;
+	Uint8 *decoded = job->decoded + first * blocksize;
+	int bad;
+
+	for ( ; first < last; ++first ) {
+		if ( WaveDecodeBlock(decoder, encoded, decoded) < 0 ) {
+			do {
+				bad = SDL_AtomicGet(&job->bad);
+			} while ( first < bad &&
+			          !SDL_AtomicCAS(&job->bad, bad, first) );
+			break;
+		}
+		encoded += decoder->blockalign;
+		decoded += blocksize;
+	}
+}
+
+/* The fewest blocks each job thread is given */
+static int WaveDecodeGrain(Uint32 blocks)
+{
+	const char *envr = SDL_GetHint(SDL_HINT_WAVE_DECODE_THREADS);
+	int threads;
+
+	if ( envr ) {
+		threads = SDL_atoi(envr);
+		if ( threads <= 1 ) {
+			return((int)blocks);
+		}
+		if ( (blocks + threads - 1) / threads > WAVE_MIN_THREAD_BLOCKS ) {
+			return((int)((blocks + threads - 1) / threads));
+		}
+	}
+	return(WAVE_MIN_THREAD_BLOCKS);
+}
+
+/* Replace a whole ADPCM data chunk with the samples decoded from it */
+static int WaveDecode(WaveDecoder *decoder, Uint8 **audio_buf, Uint32 *audio_len)
+{
+	WaveDecodeJob job;
+	Uint8 *freeable;
+	Uint32 blocks, blocksize;
+
+	if ( decoder->encoding == PCM_CODE ) {
+		return(0);
+	}
 
 	/* Allocate the proper sized output buffer */
-	encoded_len = *audio_len;
-	encoded = *audio_buf;
-	encoded_end = encoded + encoded_len;
+	blocks = *audio_len / decoder->blockalign;
+	blocksize = decoder->blockframes * decoder->framesize;
 	freeable = *audio_buf;
-	*audio_len = (encoded_len/IMA_ADPCM_state.wavefmt.blockalign) * 
-				IMA_ADPCM_state.wSamplesPerBlock*
-				IMA_ADPCM_state.wavefmt.channels*sizeof(Sint16);
+	*audio_len = blocks * blocksize;
 	*audio_buf = (Uint8 *)SDL_malloc(*audio_len);
 	if ( *audio_buf == NULL ) {
+		*audio_buf = freeable;
 		SDL_Error(SDL_ENOMEM);
 		return(-1);
 	}
-	decoded = *audio_buf;
-	decoded_end = decoded + *audio_len;
-
-	/* Get ready... Go! */
-	while ( encoded_len >= IMA_ADPCM_state.wavefmt.blockalign ) {
-		/* Grab the initial information for this block */
-		for ( c=0; c<channels; ++c ) {
-			if (encoded + 4 > encoded_end) goto invalid_size;
-			/* Fill the state information for this block */
-			state[c].sample = ((encoded[1]<<8)|encoded[0]);
-			encoded += 2;
-			if ( state[c].sample & 0x8000 ) {
-				state[c].sample -= 0x10000;
-			}
-			state[c].index = *encoded++;
-			/* Reserved byte in buffer header, should be 0 */
-			if ( *encoded++ != 0 ) {
-				/* Uh oh, corrupt data?  Buggy code? */;
-			}
-
-			/* Store the initial sample we start with */
-			if (decoded + 2 > decoded_end) goto invalid_size;
-			decoded[0] = (Uint8)(state[c].sample&0xFF);
-			decoded[1] = (Uint8)(state[c].sample>>8);
-			decoded += 2;
-		}
 
-		/* Decode and store the other samples in this block */
-		samplesleft = (IMA_ADPCM_state.wSamplesPerBlock-1)*channels;
-		while ( samplesleft > 0 ) {
-			for ( c=0; c<channels; ++c ) {
-				if (encoded + 4 > encoded_end) goto invalid_size;
-				if (decoded + 4 * 4 * channels > decoded_end)
-					goto invalid_size;
-				Fill_IMA_ADPCM_block(decoded, encoded,
-						c, channels, &state[c]);
-				encoded += 4;
-				samplesleft -= 8;
-			}
-			decoded += (channels * 8 * 2);
-		}
-		encoded_len -= IMA_ADPCM_state.wavefmt.blockalign;
+	job.decoder = decoder;
+	job.encoded = freeable;
+	job.decoded = *audio_buf;
+	job.bad = (int)blocks;
+	SDL_ParallelFor(0, (int)blocks, WaveDecodeGrain(blocks),
+	                WaveDecodeBlocks, &job);
+	if ( job.bad < (int)blocks ) {
+		/* Errors are per thread, decode it again here to report it */
+		WaveDecodeBlock(decoder,
+			job.encoded + job.bad * decoder->blockalign,
+			job.decoded + job.bad * blocksize);
+		SDL_free(*audio_buf);
+		*audio_buf = freeable;
+		return(-1);
 	}
 	SDL_free(freeable);
 	return(0);
-invalid_size:
-	SDL_SetError("Unexpected chunk length for an IMA ADPCM decoder");
-	SDL_free(freeable);
-	return(-1);
 }
 
 SDL_AudioSpec * SDL_LoadWAV_RW (SDL_RWops *src, int freesrc,
@@ -439,7 +581,7 @@ SDL_AudioSpec * SDL_LoadWAV_RW (SDL_RWops *src, int freesrc,
 	int was_error;
 	Chunk chunk;
 	int lenread;
-	int MS_ADPCM_encoded, IMA_ADPCM_encoded;
+	WaveDecoder decoder;
 	int samplesize;
 
 	/* WAV magic header */
@@ -498,65 +640,10 @@ SDL_AudioSpec * SDL_LoadWAV_RW (SDL_RWops *src, int freesrc,
 		was_error = 1;
 		goto done;
 	}
-	MS_ADPCM_encoded = IMA_ADPCM_encoded = 0;
-	switch (SDL_SwapLE16(format->encoding)) {
-		case PCM_CODE:
-			/* We can understand this */
-			break;
-		case MS_ADPCM_CODE:
-			/* Try to understand this */
-			if ( InitMS_ADPCM(format, lenread) < 0 ) {
-				was_error = 1;
-				goto done;
-			}
-			MS_ADPCM_encoded = 1;
-			break;
-		case IMA_ADPCM_CODE:
-			/* Try to understand this */
-			if ( InitIMA_ADPCM(format, lenread) < 0 ) {
-				was_error = 1;
-				goto done;
-			}
-			IMA_ADPCM_encoded = 1;
-			break;
-		case MP3_CODE:
-			SDL_SetError("MPEG Layer 3 data not supported",
-					SDL_SwapLE16(format->encoding));
-			was_error = 1;
-			goto done;
-		default:
-			SDL_SetError("Unknown WAVE data format: 0x%.4x",
-					SDL_SwapLE16(format->encoding));
-			was_error = 1;
-			goto done;
-	}
-	SDL_memset(spec, 0, (sizeof *spec));
-	spec->freq = SDL_SwapLE32(format->frequency);
-	switch (SDL_SwapLE16(format->bitspersample)) {
-		case 4:
-			if ( MS_ADPCM_encoded || IMA_ADPCM_encoded ) {
-				spec->format = AUDIO_S16;
-			} else {
-				was_error = 1;
-			}
-			break;
-		case 8:
-			spec->format = AUDIO_U8;
-			break;
-		case 16:
-			spec->format = AUDIO_S16;
-			break;
-		default:
-			was_error = 1;
-			break;
-	}
-	if ( was_error ) {
-		SDL_SetError("Unknown %d-bit PCM data format",
-			SDL_SwapLE16(format->bitspersample));
+	if ( InitWaveDecoder(&decoder, format, lenread, spec) < 0 ) {
+		was_error = 1;
 		goto done;
 	}
-	spec->channels = (Uint8)SDL_SwapLE16(format->channels);
-	spec->samples = 4096;		/* Good default buffer size */
 
 	/* Read the audio data chunk */
 	*audio_buf = NULL;
@@ -576,21 +663,15 @@ SDL_AudioSpec * SDL_LoadWAV_RW (SDL_RWops *src, int freesrc,
 	} while ( chunk.magic != DATA );
 	headerDiff += 2 * sizeof(Uint32); /* for the data chunk and len */
 
-	if ( MS_ADPCM_encoded ) {
-		if ( MS_ADPCM_decode(audio_buf, audio_len) < 0 ) {
-			was_error = 1;
-			goto done;
-		}
-	}
-	if ( IMA_ADPCM_encoded ) {
-		if ( IMA_ADPCM_decode(audio_buf, audio_len) < 0 ) {
-			was_error = 1;
-			goto done;
-		}
+	if ( WaveDecode(&decoder, audio_buf, audio_len) < 0 ) {
+		SDL_free(*audio_buf);
+		*audio_buf = NULL;
+		was_error = 1;
+		goto done;
 	}
 
 	/* Don't return a buffer that isn't a multiple of samplesize */
-	samplesize = ((spec->format & 0xFF)/8)*spec->channels;
+	samplesize = decoder.framesize;
 	*audio_len &= ~(samplesize-1);
 
 done:
@@ -621,6 +702,244 @@ void SDL_FreeWAV(Uint8 *audio_buf)
 	}
 }
 
+/* A WAVE data chunk decoded a block at a time as it is read */
+struct SDL_WAVStream {
+	SDL_RWops *src;
+	int freesrc;
+	WaveDecoder decoder;
+	int data_start;		/* Offset of the data chunk in the source */
+	Uint32 frames;		/* Number of sample frames in the data chunk */
+	Uint32 position;	/* Next sample frame to be read */
+	Uint8 *encoded;		/* One encoded block */
+	Uint8 *decoded;		/* The same block, decoded */
+	int have_block;		/* Is the block holding 'position' decoded? */
+};
+
+SDL_WAVStream * SDL_OpenWAVStream_RW(SDL_RWops *src, int freesrc,
+							SDL_AudioSpec *spec)
+{
+	SDL_WAVStream *stream;
+	Uint32 RIFFchunk, WAVEmagic, length;
+	Uint32 magic = 0;
+	Uint32 data_len = 0;
+	WaveFMT *format = NULL;
+	int fmtlen = 0;
+
+	if ( src == NULL ) {
+		return(NULL);
+	}
+	stream = (SDL_WAVStream *)SDL_malloc(sizeof(*stream));
+	if ( stream == NULL ) {
+		SDL_OutOfMemory();
+		goto error;
+	}
+	SDL_memset(stream, 0, (sizeof *stream));
+	stream->src = src;
+	stream->freesrc = freesrc;
+
+	/* Check the magic header */
+	RIFFchunk	= SDL_ReadLE32(src);
+	length		= SDL_ReadLE32(src);
+	if ( length == WAVE ) { /* The RIFFchunk has already been read */
+		WAVEmagic = length;
+		RIFFchunk = RIFF;
+	} else {
+		WAVEmagic = SDL_ReadLE32(src);
+	}
+	if ( (RIFFchunk != RIFF) || (WAVEmagic != WAVE) ) {
+		SDL_SetError("Unrecognized file type (not WAVE)");
+		goto error;
+	}
+
+	/* Walk the chunks up to the audio data, skipping what we don't need */
+	while ( magic != DATA ) {
+		Uint32 header[2];
+
+		if ( SDL_RWread(src, header, sizeof(header), 1) != 1 ) {
+			SDL_SetError("WAVE file has no data chunk");
+			goto error;
+		}
+		magic = SDL_SwapLE32(header[0]);
+		length = SDL_SwapLE32(header[1]);
+		if ( magic == FMT && format == NULL ) {
+			format = (WaveFMT *)SDL_malloc(length);
+			if ( format == NULL ) {
+				SDL_Error(SDL_ENOMEM);
+				goto error;
+			}
+			if ( SDL_RWread(src, format, length, 1) != 1 ) {
+				SDL_Error(SDL_EFREAD);
+				goto error;
+			}
+			fmtlen = length;
+			if ( length & 1 ) {
+				SDL_RWseek(src, 1, RW_SEEK_CUR);
+			}
+		} else if ( magic == DATA ) {
+			data_len = length;
+		} else if ( SDL_RWseek(src, length + (length & 1),
+						RW_SEEK_CUR) < 0 ) {
+			SDL_Error(SDL_EFSEEK);
+			goto error;
+		}
+	}
+	if ( format == NULL ) {
+		SDL_SetError("Complex WAVE files not supported");
+		goto error;
+	}
+	if ( InitWaveDecoder(&stream->decoder, format, fmtlen, spec) < 0 ) {
+		goto error;
+	}
+	SDL_free(format);
+	format = NULL;
+	if ( stream->decoder.framesize == 0 ) {
+		SDL_SetError("WAVE file has no audio channels");
+		goto error;
+	}
+
+	/* Only whole blocks are decoded, as with SDL_LoadWAV_RW() */
+	stream->data_start = SDL_RWtell(src);
+	stream->frames = (data_len / stream->decoder.blockalign) *
+						stream->decoder.blockframes;
+	if ( stream->decoder.encoding != PCM_CODE ) {
+		stream->encoded = (Uint8 *)SDL_malloc(stream->decoder.blockalign);
+		stream->decoded = (Uint8 *)SDL_malloc(
+			stream->decoder.blockframes * stream->decoder.framesize);
+		if ( !stream->encoded || !stream->decoded ) {
+			SDL_Error(SDL_ENOMEM);
+			goto error;
+		}
+	}
+	return(stream);
+
+error:
+	if ( format ) {
+		SDL_free(format);
+	}
+	if ( stream ) {
+		SDL_CloseWAVStream(stream);
+	} else if ( freesrc ) {
+		SDL_RWclose(src);
+	}
+	return(NULL);
+}
+
+Uint32 SDL_GetWAVStreamLength(SDL_WAVStream *stream)
+{
+	return(stream ? stream->frames : 0);
+}
+
+Uint32 SDL_TellWAVStream(SDL_WAVStream *stream)
+{
+	return(stream ? stream->position : 0);
+}
+
+int SDL_SeekWAVStream(SDL_WAVStream *stream, Uint32 frame)
+{
+	WaveDecoder *decoder;
+	Uint32 block;
+
+	if ( stream == NULL ) {
+		SDL_SetError("Passed a NULL WAV stream");
+		return(-1);
+	}
+	if ( frame > stream->frames ) {
+		SDL_SetError("Seek past the end of a WAV stream");
+		return(-1);
+	}
+	decoder = &stream->decoder;
+	block = frame / decoder->blockframes;
+	if ( SDL_RWseek(stream->src, stream->data_start +
+			block * decoder->blockalign, RW_SEEK_SET) < 0 ) {
+		SDL_Error(SDL_EFSEEK);
+		return(-1);
+	}
+	stream->position = frame;
+	stream->have_block = 0;
+	return(0);
+}
+
+int SDL_ReadWAVStream(SDL_WAVStream *stream, void *buf, int frames)
+{
+	WaveDecoder *decoder;
+	Uint8 *dst = (Uint8 *)buf;
+	Uint32 offset, amount;
+	int total = 0;
+
+	if ( stream == NULL ) {
+		SDL_SetError("Passed a NULL WAV stream");
+		return(-1);
+	}
+	decoder = &stream->decoder;
+	if ( frames > 0 && (Uint32)frames > stream->frames - stream->position ) {
+		frames = stream->frames - stream->position;
+	}
+	if ( frames <= 0 ) {
+		return(0);
+	}
+
+	/* PCM data needs no decoding, read it straight into the caller's buffer */
+	if ( decoder->encoding == PCM_CODE ) {
+		total = SDL_RWread(stream->src, dst, decoder->framesize, frames);
+		if ( total < 0 ) {
+			return(-1);
+		}
+		if ( total < frames ) {
+			/* Truncated file, stop at the last whole frame */
+			stream->frames = stream->position + total;
+		}
+		stream->position += total;
+		return(total);
+	}
+
+	while ( total < frames ) {
+		offset = stream->position % decoder->blockframes;
+		if ( ! stream->have_block ) {
+			if ( SDL_RWread(stream->src, stream->encoded,
+					decoder->blockalign, 1) != 1 ) {
+				/* Truncated file, stop where the data ends */
+				stream->frames = stream->position;
+				break;
+			}
+			if ( WaveDecodeBlock(decoder,
+				stream->encoded, stream->decoded) < 0 ) {
+				return(-1);
+			}
+			stream->have_block = 1;
+		}
+		amount = decoder->blockframes - offset;
+		if ( amount > (Uint32)(frames - total) ) {
+			amount = frames - total;
+		}
+		SDL_memcpy(dst, stream->decoded + offset * decoder->framesize,
+					amount * decoder->framesize);
+		dst += amount * decoder->framesize;
+		total += amount;
+		stream->position += amount;
+		if ( offset + amount == decoder->blockframes ) {
+			stream->have_block = 0;
+		}
+	}
+	return(total);
+}
+
+void SDL_CloseWAVStream(SDL_WAVStream *stream)
+{
+	if ( stream == NULL ) {
+		return;
+	}
+	if ( stream->freesrc ) {
+		SDL_RWclose(stream->src);
+	}
+	if ( stream->encoded ) {
+		SDL_free(stream->encoded);
+	}
+	if ( stream->decoded ) {
+		SDL_free(stream->decoded);
+	}
+	SDL_free(stream);
+}
+
 static int ReadChunk(SDL_RWops *src, Chunk *chunk)
 {
 	chunk->magic	= SDL_ReadLE32(src);
@@ -28,6 +28,7 @@
 
 #include "SDL_timer.h"
 #include "SDL_audio.h"
+#include "SDL_hints.h"
 #include "../SDL_audiomem.h"
 #include "../SDL_audio_c.h"
 #include "SDL_alsa_audio.h"
@@ -49,6 +50,7 @@ static void ALSA_WaitAudio(_THIS);
 static void ALSA_PlayAudio(_THIS);
 static Uint8 *ALSA_GetAudioBuf(_THIS);
 static void ALSA_CloseAudio(_THIS);
+static int ALSA_CaptureAudio(_THIS, Uint8 *buffer, int buflen);
 
 #ifdef SDL_AUDIO_DRIVER_ALSA_DYNAMIC
 
@@ -59,6 +61,13 @@ static int alsa_loaded = 0;
 static int (*SDL_NAME(snd_pcm_open))(snd_pcm_t **pcm, const char *name, snd_pcm_stream_t stream, int mode);
 static int (*SDL_NAME(snd_pcm_close))(snd_pcm_t *pcm);
 static snd_pcm_sframes_t (*SDL_NAME(snd_pcm_writei))(snd_pcm_t *pcm, const void *buffer, snd_pcm_uframes_t size);
+static snd_pcm_sframes_t (*SDL_NAME(snd_pcm_readi))(snd_pcm_t *pcm, void *buffer, snd_pcm_uframes_t size);
+static int (*SDL_NAME(snd_pcm_mmap_begin))(snd_pcm_t *pcm, const snd_pcm_channel_area_t **areas, snd_pcm_uframes_t *offset, snd_pcm_uframes_t *frames);
+static snd_pcm_sframes_t (*SDL_NAME(snd_pcm_mmap_commit))(snd_pcm_t *pcm, snd_pcm_uframes_t offset, snd_pcm_uframes_t frames);
+static snd_pcm_sframes_t (*SDL_NAME(snd_pcm_avail_update))(snd_pcm_t *pcm);
+static snd_pcm_state_t (*SDL_NAME(snd_pcm_state))(snd_pcm_t *pcm);
+static int (*SDL_NAME(snd_pcm_start))(snd_pcm_t *pcm);
+static int (*SDL_NAME(snd_pcm_wait))(snd_pcm_t *pcm, int timeout);
 static int (*SDL_NAME(snd_pcm_resume))(snd_pcm_t *pcm);
 static int (*SDL_NAME(snd_pcm_prepare))(snd_pcm_t *pcm);
 static const char *(*SDL_NAME(snd_strerror))(int errnum);
@@ -97,6 +106,13 @@ static struct {
 	{ "snd_pcm_open",	(void**)(char*)&SDL_NAME(snd_pcm_open)		},
 	{ "snd_pcm_close",	(void**)(char*)&SDL_NAME(snd_pcm_close)	},
 	{ "snd_pcm_writei",	(void**)(char*)&SDL_NAME(snd_pcm_writei)	},
+	{ "snd_pcm_readi",	(void**)(char*)&SDL_NAME(snd_pcm_readi)	},
+	{ "snd_pcm_mmap_begin",	(void**)(char*)&SDL_NAME(snd_pcm_mmap_begin)	},
+	{ "snd_pcm_mmap_commit",	(void**)(char*)&SDL_NAME(snd_pcm_mmap_commit)	},
+	{ "snd_pcm_avail_update",	(void**)(char*)&SDL_NAME(snd_pcm_avail_update)	},
+	{ "snd_pcm_state",	(void**)(char*)&SDL_NAME(snd_pcm_state)	},
+	{ "snd_pcm_start",	(void**)(char*)&SDL_NAME(snd_pcm_start)	},
+	{ "snd_pcm_wait",	(void**)(char*)&SDL_NAME(snd_pcm_wait)	},
 	{ "snd_pcm_resume",	(void**)(char*)&SDL_NAME(snd_pcm_resume)	},
 	{ "snd_pcm_prepare",	(void**)(char*)&SDL_NAME(snd_pcm_prepare)	},
 	{ "snd_strerror",	(void**)(char*)&SDL_NAME(snd_strerror)		},
@@ -123,17 +139,21 @@ static struct {
 	{ "snd_pcm_nonblock",	(void**)(char*)&SDL_NAME(snd_pcm_nonblock)	},
 };
 
+/* Each open device holds a reference */
 static void UnloadALSALibrary(void) {
-	if (alsa_loaded) {
+	if (alsa_loaded && --alsa_loaded == 0) {
 		SDL_UnloadObject(alsa_handle);
 		alsa_handle = NULL;
-		alsa_loaded = 0;
 	}
 }
 
 static int LoadALSALibrary(void) {
 	int i, retval = -1;
 
+	if (alsa_loaded) {
+		++alsa_loaded;
+		return 0;
+	}
 	alsa_handle = SDL_LoadObject(alsa_library);
 	if (alsa_handle) {
 		alsa_loaded = 1;
@@ -169,6 +189,9 @@ static const char *get_audio_device(int channels)
 	device = SDL_getenv("AUDIODEV");	/* Is there a standard variable name? */
 	if ( device == NULL ) {
 		switch (channels) {
+		case 8:
+			device = "plug:surround71";
+			break;
 		case 6:
 			device = "plug:surround51";
 			break;
@@ -183,6 +206,17 @@ static const char *get_audio_device(int channels)
 	return device;
 }
 
+static const char *get_capture_device(void)
+{
+	const char *device;
+
+	device = SDL_GetHint(SDL_HINT_AUDIO_CAPTURE_DEVICE);
+	if ( device == NULL ) {
+		device = "default";
+	}
+	return device;
+}
+
 /* Audio driver bootstrap functions */
 
 static int Audio_Available(void)
@@ -238,6 +272,7 @@ static SDL_AudioDevice *Audio_CreateDevice(int devindex)
 	this->PlayAudio = ALSA_PlayAudio;
 	this->GetAudioBuf = ALSA_GetAudioBuf;
 	this->CloseAudio = ALSA_CloseAudio;
+	this->CaptureAudio = ALSA_CaptureAudio;
 
 	this->free = Audio_DeleteDevice;
 
@@ -249,54 +284,62 @@ AudioBootStrap ALSA_bootstrap = {
 	Audio_Available, Audio_CreateDevice
 };
 
-/* This function waits until it is possible to write a full sound buffer */
-static void ALSA_WaitAudio(_THIS)
-{
-	/* We're in blocking mode, so there's nothing to do here */
-}
-
-
 /*
  * http://bugzilla.libsdl.org/show_bug.cgi?id=110
  * "For Linux ALSA, this is FL-FR-RL-RR-C-LFE
  *  and for Windows DirectX [and CoreAudio], this is FL-FR-C-LFE-RL-RR"
+ *
+ * 7.1 is the same with the side left and right channels after those.
+ * The swap is its own inverse, and works in place or while copying.
  */
 #define SWIZ6(T) \
-    T *ptr = (T *) mixbuf; \
+    const T *src = (const T *) srcbuf; \
+    T *dst = (T *) dstbuf; \
     Uint32 i; \
-    for (i = 0; i < this->spec.samples; i++, ptr += 6) { \
-        T tmp; \
-        tmp = ptr[2]; ptr[2] = ptr[4]; ptr[4] = tmp; \
-        tmp = ptr[3]; ptr[3] = ptr[5]; ptr[5] = tmp; \
+    for (i = 0; i < frames; i++, src += channels, dst += channels) { \
+        T c = src[2], lfe = src[3]; \
+        dst[0] = src[0]; dst[1] = src[1]; \
+        dst[2] = src[4]; dst[3] = src[5]; \
+        dst[4] = c; dst[5] = lfe; \
+        if (channels == 8) { \
+            dst[6] = src[6]; dst[7] = src[7]; \
+        } \
     }
 
-static __inline__ void swizzle_alsa_channels_6_64bit(_THIS) { SWIZ6(Uint64); }
-static __inline__ void swizzle_alsa_channels_6_32bit(_THIS) { SWIZ6(Uint32); }
-static __inline__ void swizzle_alsa_channels_6_16bit(_THIS) { SWIZ6(Uint16); }
-static __inline__ void swizzle_alsa_channels_6_8bit(_THIS) { SWIZ6(Uint8); }
+static __inline__ void swizzle_alsa_channels_6_64bit(void *dstbuf, const void *srcbuf, Uint32 frames, int channels) { SWIZ6(Uint64); }
+static __inline__ void swizzle_alsa_channels_6_32bit(void *dstbuf, const void *srcbuf, Uint32 frames, int channels) { SWIZ6(Uint32); }
+static __inline__ void swizzle_alsa_channels_6_16bit(void *dstbuf, const void *srcbuf, Uint32 frames, int channels) { SWIZ6(Uint16); }
+static __inline__ void swizzle_alsa_channels_6_8bit(void *dstbuf, const void *srcbuf, Uint32 frames, int channels) { SWIZ6(Uint8); }
 
 #undef SWIZ6
 
 
+/* Whether the channels have to be reordered for ALSA */
+#define ALSA_NEEDS_SWIZZLE(this) \
+	((this)->spec.channels == 6 || (this)->spec.channels == 8)
+
 /*
- * Called right before feeding this->mixbuf to the hardware. Swizzle channels
- *  from Windows/Mac order to the format alsalib will want.
+ * Called on the way between an SDL buffer and the hardware. Swizzle
+ *  channels from Windows/Mac order to the format alsalib will want, or
+ *  back again when recording.  'dst' may be the same as 'src'.
  */
-static __inline__ void swizzle_alsa_channels(_THIS)
+static __inline__ void swizzle_alsa_channels(_THIS, void *dst, const void *src, Uint32 frames)
 {
-    if (this->spec.channels == 6) {
-        const Uint16 fmtsize = (this->spec.format & 0xFF); /* bits/channel. */
+    const Uint16 fmtsize = (this->spec.format & 0xFF); /* bits/channel. */
+    const int channels = this->spec.channels;
+
+    if (channels == 6 || channels == 8) {
         if (fmtsize == 16)
-            swizzle_alsa_channels_6_16bit(this);
+            swizzle_alsa_channels_6_16bit(dst, src, frames, channels);
         else if (fmtsize == 8)
-            swizzle_alsa_channels_6_8bit(this);
+            swizzle_alsa_channels_6_8bit(dst, src, frames, channels);
         else if (fmtsize == 32)
-            swizzle_alsa_channels_6_32bit(this);
+            swizzle_alsa_channels_6_32bit(dst, src, frames, channels);
         else if (fmtsize == 64)
-            swizzle_alsa_channels_6_64bit(this);
+            swizzle_alsa_channels_6_64bit(dst, src, frames, channels);
+    } else if (dst != src) {
+        SDL_memcpy(dst, src, frames * (fmtsize / 8) * channels);
     }
-
-    /* !!! FIXME: update this for 7.1 if needed, later. */
 }
 
 
@@ -319,6 +362,102 @@ static int ALSA_pcm_recover(snd_pcm_t *handle, int err, int silent)
 	return err;
 }
 
+/* This function waits until it is possible to write a full sound buffer */
+static void ALSA_WaitAudio(_THIS)
+{
+	snd_pcm_sframes_t avail;
+	int status;
+
+	/* Writes block in read/write mode, so there's nothing to do there */
+	if ( ! mmap_mode ) {
+		return;
+	}
+
+	while ( this->enabled ) {
+		avail = SDL_NAME(snd_pcm_avail_update)(pcm_handle);
+		if ( avail >= (snd_pcm_sframes_t) this->spec.samples ) {
+			return;
+		}
+		status = (int) avail;
+		if ( status >= 0 ) {
+			status = SDL_NAME(snd_pcm_wait)(pcm_handle, 1000);
+			if ( status >= 0 ) {
+				continue;
+			}
+		}
+		status = ALSA_pcm_recover(pcm_handle, status, 0);
+		if ( status < 0 ) {
+			fprintf(stderr, "ALSA wait failed (unrecoverable): %s\n", SDL_NAME(snd_strerror)(status));
+			this->enabled = 0;
+		}
+	}
+}
+
+/* Where frame 'offset' of the interleaved ring is mapped */
+static __inline__ Uint8 *ALSA_mmap_address(const snd_pcm_channel_area_t *areas, snd_pcm_uframes_t offset)
+{
+	return (Uint8 *) areas[0].addr + (areas[0].first + offset * areas[0].step) / 8;
+}
+
+/* Hand frames written to the ring to the hardware, starting it the first time */
+static int ALSA_mmap_commit(_THIS, snd_pcm_uframes_t offset, snd_pcm_uframes_t frames)
+{
+	snd_pcm_sframes_t status;
+
+	status = SDL_NAME(snd_pcm_mmap_commit)(pcm_handle, offset, frames);
+	if ( status >= 0 && (snd_pcm_uframes_t) status != frames ) {
+		status = -EPIPE;
+	}
+	if ( status < 0 ) {
+		return (int) status;
+	}
+	if ( SDL_NAME(snd_pcm_state)(pcm_handle) == SND_PCM_STATE_PREPARED ) {
+		return SDL_NAME(snd_pcm_start)(pcm_handle);
+	}
+	return 0;
+}
+
+/* Copy mixbuf into the ring, for when it couldn't be mixed in place.
+   This is also where the channels are put in ALSA's order, so the ring
+   is only written once, with finished frames.
+ */
+static int ALSA_mmap_write(_THIS)
+{
+	const snd_pcm_channel_area_t *areas;
+	snd_pcm_uframes_t offset, frames, frames_left;
+	const Uint8 *sample_buf = (const Uint8 *) mixbuf;
+	const int frame_size = (((int) (this->spec.format & 0xFF)) / 8) * this->spec.channels;
+	snd_pcm_sframes_t avail;
+	int status;
+
+	frames_left = ((snd_pcm_uframes_t) this->spec.samples);
+
+	while ( frames_left > 0 && this->enabled ) {
+		avail = SDL_NAME(snd_pcm_avail_update)(pcm_handle);
+		if ( avail < 0 ) {
+			return (int) avail;
+		}
+		if ( avail == 0 ) {
+			ALSA_WaitAudio(this);
+			continue;
+		}
+		frames = frames_left;
+		status = SDL_NAME(snd_pcm_mmap_begin)(pcm_handle, &areas, &offset, &frames);
+		if ( status < 0 ) {
+			return status;
+		}
+		swizzle_alsa_channels(this, ALSA_mmap_address(areas, offset),
+		                      sample_buf, frames);
+		status = ALSA_mmap_commit(this, offset, frames);
+		if ( status < 0 ) {
+			return status;
+		}
+		sample_buf += frames * frame_size;
+		frames_left -= frames;
+	}
+	return 0;
+}
+
 static void ALSA_PlayAudio(_THIS)
 {
 	int status;
@@ -326,7 +465,25 @@ static void ALSA_PlayAudio(_THIS)
 	const Uint8 *sample_buf = (const Uint8 *) mixbuf;
 	const int frame_size = (((int) (this->spec.format & 0xFF)) / 8) * this->spec.channels;
 
-	swizzle_alsa_channels(this);
+	if ( mmap_mode ) {
+		if ( mmap_area != NULL ) {
+			/* Mixed in place, in ALSA's channel order already */
+			mmap_area = NULL;
+			status = ALSA_mmap_commit(this, mmap_offset, this->spec.samples);
+		} else {
+			status = ALSA_mmap_write(this);
+		}
+		if ( status < 0 ) {
+			status = ALSA_pcm_recover(pcm_handle, status, 0);
+			if ( status < 0 ) {
+				fprintf(stderr, "ALSA write failed (unrecoverable): %s\n", SDL_NAME(snd_strerror)(status));
+				this->enabled = 0;
+			}
+		}
+		return;
+	}
+
+	swizzle_alsa_channels(this, mixbuf, mixbuf, this->spec.samples);
 
 	frames_left = ((snd_pcm_uframes_t) this->spec.samples);
 
@@ -354,9 +511,61 @@ static void ALSA_PlayAudio(_THIS)
 
 static Uint8 *ALSA_GetAudioBuf(_THIS)
 {
+	const snd_pcm_channel_area_t *areas;
+	snd_pcm_uframes_t offset, frames;
+
+	/* Mix straight into the ring if a whole buffer fits before it wraps,
+	   and the channels don't need reordering on the way */
+	if ( mmap_mode && ! ALSA_NEEDS_SWIZZLE(this) ) {
+		frames = this->spec.samples;
+		if ( SDL_NAME(snd_pcm_avail_update)(pcm_handle) >= (snd_pcm_sframes_t) frames &&
+		     SDL_NAME(snd_pcm_mmap_begin)(pcm_handle, &areas, &offset, &frames) >= 0 ) {
+			if ( frames == this->spec.samples ) {
+				mmap_area = ALSA_mmap_address(areas, offset);
+				mmap_offset = offset;
+				return(mmap_area);
+			}
+			SDL_NAME(snd_pcm_mmap_commit)(pcm_handle, offset, 0);
+		}
+	}
 	return(mixbuf);
 }
 
+static int ALSA_CaptureAudio(_THIS, Uint8 *buffer, int buflen)
+{
+	int status;
+	snd_pcm_uframes_t frames_left;
+	Uint8 *sample_buf = (Uint8 *) mixbuf;
+	const int frame_size = (((int) (this->spec.format & 0xFF)) / 8) * this->spec.channels;
+
+	frames_left = ((snd_pcm_uframes_t) this->spec.samples);
+
+	while ( frames_left > 0 ) {
+		if ( ! this->enabled ) {
+			return(-1);
+		}
+		status = SDL_NAME(snd_pcm_readi)(pcm_handle, sample_buf, frames_left);
+		if ( status < 0 ) {
+			if ( status == -EAGAIN ) {
+				SDL_Delay(1);
+				continue;
+			}
+			/* An over-run is recovered like an under-run */
+			status = ALSA_pcm_recover(pcm_handle, status, 0);
+			if ( status < 0 ) {
+				fprintf(stderr, "ALSA read failed (unrecoverable): %s\n", SDL_NAME(snd_strerror)(status));
+				return(-1);
+			}
+			continue;
+		}
+		sample_buf += status * frame_size;
+		frames_left -= status;
+	}
+
+	swizzle_alsa_channels(this, buffer, mixbuf, this->spec.samples);
+	return(0);
+}
+
 static void ALSA_CloseAudio(_THIS)
 {
 	if ( mixbuf != NULL ) {
@@ -367,8 +576,10 @@ static void ALSA_CloseAudio(_THIS)
 		/* Wait for the submitted audio to drain
 		   snd_pcm_drop() can hang, so don't use that.
 		 */
-		Uint32 delay = ((this->spec.samples * 1000) / this->spec.freq) * 2;
-		SDL_Delay(delay);
+		if ( ! this->iscapture ) {
+			Uint32 delay = ((this->spec.samples * 1000) / this->spec.freq) * 2;
+			SDL_Delay(delay);
+		}
 		SDL_NAME(snd_pcm_close)(pcm_handle);
 		pcm_handle = NULL;
 	}
@@ -489,14 +700,20 @@ static int ALSA_OpenAudio(_THIS, SDL_AudioSpec *spec)
 
 	/* Open the audio device */
 	/* Name of device should depend on # channels in spec */
-	status = SDL_NAME(snd_pcm_open)(&pcm_handle, get_audio_device(spec->channels), SND_PCM_STREAM_PLAYBACK, SND_PCM_NONBLOCK);
+	if ( this->iscapture ) {
+		status = SDL_NAME(snd_pcm_open)(&pcm_handle, get_capture_device(), SND_PCM_STREAM_CAPTURE, SND_PCM_NONBLOCK);
+	} else if ( this->devname ) {
+		status = SDL_NAME(snd_pcm_open)(&pcm_handle, this->devname, SND_PCM_STREAM_PLAYBACK, SND_PCM_NONBLOCK);
+	} else {
+		status = SDL_NAME(snd_pcm_open)(&pcm_handle, get_audio_device(spec->channels), SND_PCM_STREAM_PLAYBACK, SND_PCM_NONBLOCK);
+	}
 
 	if ( status < 0 ) {
 		SDL_SetError("Couldn't open audio device: %s", SDL_NAME(snd_strerror)(status));
 		return(-1);
 	}
 
-	/* Switch to blocking mode for playback */
+	/* Switch to blocking mode for playback and capture */
 	/* Note: this must happen before hw/sw params are set. */
 	SDL_NAME(snd_pcm_nonblock)(pcm_handle, 0);
 
@@ -509,12 +726,24 @@ static int ALSA_OpenAudio(_THIS, SDL_AudioSpec *spec)
 		return(-1);
 	}
 
+	/* Mix straight into the hardware buffer for playback, if we can */
+	mmap_mode = 0;
+	mmap_area = NULL;
+	if ( ! this->iscapture ) {
+		if ( SDL_GetHintBoolean(SDL_HINT_AUDIO_ALSA_MMAP, SDL_TRUE) ) {
+			status = SDL_NAME(snd_pcm_hw_params_set_access)(pcm_handle, hwparams, SND_PCM_ACCESS_MMAP_INTERLEAVED);
+			mmap_mode = (status >= 0);
+		}
+	}
+
 	/* SDL only uses interleaved sample output */
-	status = SDL_NAME(snd_pcm_hw_params_set_access)(pcm_handle, hwparams, SND_PCM_ACCESS_RW_INTERLEAVED);
-	if ( status < 0 ) {
-		SDL_SetError("Couldn't set interleaved access: %s", SDL_NAME(snd_strerror)(status));
-		ALSA_CloseAudio(this);
-		return(-1);
+	if ( ! mmap_mode ) {
+		status = SDL_NAME(snd_pcm_hw_params_set_access)(pcm_handle, hwparams, SND_PCM_ACCESS_RW_INTERLEAVED);
+		if ( status < 0 ) {
+			SDL_SetError("Couldn't set interleaved access: %s", SDL_NAME(snd_strerror)(status));
+			ALSA_CloseAudio(this);
+			return(-1);
+		}
 	}
 
 	/* Try for a closest match on audio format */
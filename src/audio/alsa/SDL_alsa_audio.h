@@ -38,11 +38,19 @@ struct SDL_PrivateAudioData {
 	/* Raw mixing buffer */
 	Uint8 *mixbuf;
 	int    mixlen;
+
+	/* Mixing into the mmapped hardware buffer */
+	int    mmap_mode;
+	Uint8 *mmap_area;		/* Set between GetAudioBuf and PlayAudio */
+	snd_pcm_uframes_t mmap_offset;
 };
 
 /* Old variable names */
 #define pcm_handle		(this->hidden->pcm_handle)
 #define mixbuf			(this->hidden->mixbuf)
 #define mixlen			(this->hidden->mixlen)
+#define mmap_mode		(this->hidden->mmap_mode)
+#define mmap_area		(this->hidden->mmap_area)
+#define mmap_offset		(this->hidden->mmap_offset)
 
 #endif /* _ALSA_PCM_audio_h */
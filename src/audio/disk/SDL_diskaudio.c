@@ -23,7 +23,16 @@
 */
 #include "SDL_config.h"
 
-/* Output raw audio data to a file. */
+/* Output raw audio data, or a WAV file, to a file.
+
+   The audio thread fills buffers in a ring, and a writer thread takes them
+   to the disk, so a slow disk never stalls the audio thread.  The audio is
+   paced at its real rate unless free running, when it is rendered as fast
+   as the writer thread can keep up.
+
+   The capture device plays back a WAV file as if it had been recorded,
+   at the same pace.
+ */
 
 #if HAVE_STDIO_H
 #include <stdio.h>
@@ -32,19 +41,32 @@
 #include "SDL_rwops.h"
 #include "SDL_timer.h"
 #include "SDL_audio.h"
+#include "SDL_hints.h"
 #include "../SDL_audiomem.h"
 #include "../SDL_audio_c.h"
 #include "../SDL_audiodev_c.h"
+#include "../SDL_wave.h"
+#include "../../thread/SDL_atomic_c.h"
 #include "SDL_diskaudio.h"
 
 /* The tag name used by DISK audio */
 #define DISKAUD_DRIVER_NAME         "disk"
 
 /* environment variables and defaults. */
-#define DISKENVR_OUTFILE         "SDL_DISKAUDIOFILE"
+#define DISKENVR_OUTFILE         SDL_HINT_DISKAUDIOFILE
 #define DISKDEFAULT_OUTFILE      "sdlaudio.raw"
-#define DISKENVR_WRITEDELAY      "SDL_DISKAUDIODELAY"
-#define DISKDEFAULT_WRITEDELAY   150
+#define DISKENVR_WRITEDELAY      SDL_HINT_DISKAUDIODELAY
+#define DISKDEFAULT_WRITEDELAY   -1	/* Real time */
+#define DISKENVR_INFILE          SDL_HINT_DISKAUDIOINFILE
+#define DISKDEFAULT_INFILE       "sdlaudio-in.wav"
+
+/* Size of the RIFF header, and how much of it is counted in its length */
+#define DISKWAV_HEADER_SIZE      44
+#define DISKWAV_RIFF_SIZE        36
+
+/* Number of buffers between the audio thread and the writer thread */
+#define DISKMIN_RING_CHUNKS      4
+#define DISKMAX_RING_CHUNKS      256
 
 /* Audio driver functions */
 static int DISKAUD_OpenAudio(_THIS, SDL_AudioSpec *spec);
@@ -52,21 +74,27 @@ static void DISKAUD_WaitAudio(_THIS);
 static void DISKAUD_PlayAudio(_THIS);
 static Uint8 *DISKAUD_GetAudioBuf(_THIS);
 static void DISKAUD_CloseAudio(_THIS);
+static int DISKAUD_CaptureAudio(_THIS, Uint8 *buffer, int buflen);
 
-static const char *DISKAUD_GetOutputFilename(void)
+static const char *DISKAUD_GetOutputFilename(_THIS)
 {
-	const char *envr = SDL_getenv(DISKENVR_OUTFILE);
+	const char *envr = SDL_GetHint(DISKENVR_OUTFILE);
+	if ( this->devname != NULL ) {
+		return(this->devname);
+	}
 	return((envr != NULL) ? envr : DISKDEFAULT_OUTFILE);
 }
 
+static const char *DISKAUD_GetInputFilename(void)
+{
+	const char *envr = SDL_GetHint(DISKENVR_INFILE);
+	return((envr != NULL) ? envr : DISKDEFAULT_INFILE);
+}
+
 /* Audio driver bootstrap functions */
 static int DISKAUD_Available(void)
 {
-	const char *envr = SDL_getenv("SDL_AUDIODRIVER");
-	if (envr && (SDL_strcmp(envr, DISKAUD_DRIVER_NAME) == 0)) {
-		return(1);
-	}
-	return(0);
+	return(SDL_AudioDriverRequested(DISKAUD_DRIVER_NAME));
 }
 
 static void DISKAUD_DeleteDevice(SDL_AudioDevice *device)
@@ -78,7 +106,6 @@ static void DISKAUD_DeleteDevice(SDL_AudioDevice *device)
 static SDL_AudioDevice *DISKAUD_CreateDevice(int devindex)
 {
 	SDL_AudioDevice *this;
-	const char *envr;
 
 	/* Initialize all variables that we clean on shutdown */
 	this = (SDL_AudioDevice *)SDL_malloc(sizeof(SDL_AudioDevice));
@@ -96,8 +123,9 @@ static SDL_AudioDevice *DISKAUD_CreateDevice(int devindex)
 	}
 	SDL_memset(this->hidden, 0, (sizeof *this->hidden));
 
-	envr = SDL_getenv(DISKENVR_WRITEDELAY);
-	this->hidden->write_delay = (envr) ? SDL_atoi(envr) : DISKDEFAULT_WRITEDELAY;
+	this->hidden->write_delay = SDL_GetHintInt(DISKENVR_WRITEDELAY,
+	                                           DISKDEFAULT_WRITEDELAY);
+	this->hidden->free_running = (this->hidden->write_delay == 0);
 
 	/* Set the function pointers */
 	this->OpenAudio = DISKAUD_OpenAudio;
@@ -105,6 +133,7 @@ static SDL_AudioDevice *DISKAUD_CreateDevice(int devindex)
 	this->PlayAudio = DISKAUD_PlayAudio;
 	this->GetAudioBuf = DISKAUD_GetAudioBuf;
 	this->CloseAudio = DISKAUD_CloseAudio;
+	this->CaptureAudio = DISKAUD_CaptureAudio;
 
 	this->free = DISKAUD_DeleteDevice;
 
@@ -116,54 +145,278 @@ AudioBootStrap DISKAUD_bootstrap = {
 	DISKAUD_Available, DISKAUD_CreateDevice
 };
 
+/* Wait for the time one buffer takes to play, or the fixed delay */
+static void DISKAUD_Pace(_THIS)
+{
+	struct SDL_PrivateAudioData *h = this->hidden;
+	Uint32 due, now;
+
+	if ( h->write_delay > 0 ) {
+		SDL_Delay(h->write_delay);
+	} else {
+		h->paced_rem += this->spec.samples * 1000;
+		h->paced_ms += h->paced_rem / this->spec.freq;
+		h->paced_rem %= this->spec.freq;
+		due = h->start_ticks + h->paced_ms;
+		now = SDL_GetTicks();
+		if ( (Sint32)(due - now) > 0 ) {
+			SDL_Delay(due - now);
+		}
+	}
+}
+
 /* This function waits until it is possible to write a full sound buffer */
 static void DISKAUD_WaitAudio(_THIS)
 {
-	SDL_Delay(this->hidden->write_delay);
+	struct SDL_PrivateAudioData *h = this->hidden;
+
+	if ( h->free_running ) {
+		/* Only the disk holds us back */
+		SDL_SemWait(h->ring_space);
+		h->have_chunk = 1;
+		return;
+	}
+
+	DISKAUD_Pace(this);
+
+	/* If the disk can't keep up, the next buffer is lost */
+	h->have_chunk = (SDL_SemTryWait(h->ring_space) == 0);
+	if ( ! h->have_chunk ) {
+		++h->dropped;
+#ifdef DEBUG_AUDIO
+		fprintf(stderr, "Disk too slow, dropping audio buffer\n");
+#endif
+	}
 }
 
 static void DISKAUD_PlayAudio(_THIS)
 {
-	int written;
-
-	/* Write the audio data */
-	written = SDL_RWwrite(this->hidden->output,
-                        this->hidden->mixbuf, 1,
-                        this->hidden->mixlen);
+	struct SDL_PrivateAudioData *h = this->hidden;
 
 	/* If we couldn't write, assume fatal error for now */
-	if ( (Uint32)written != this->hidden->mixlen ) {
+	if ( SDL_AtomicGet(&h->write_error) ) {
 		this->enabled = 0;
+		return;
+	}
+	if ( ! h->have_chunk ) {
+		return;
+	}
+
+	/* Hand the buffer to the writer thread */
+	h->write_chunk = (h->write_chunk + 1) % h->ring_chunks;
+	h->have_chunk = 0;
+	SDL_AtomicAdd(&h->queued, 1);
+	SDL_SemPost(h->ring_filled);
+}
+
+static Uint8 *DISKAUD_GetAudioBuf(_THIS)
+{
+	struct SDL_PrivateAudioData *h = this->hidden;
+
+	if ( h->have_chunk ) {
+		return(h->ring + h->write_chunk * h->mixlen);
+	}
+	/* Mixed and thrown away */
+	return(h->mixbuf);
+}
+
+/* Hand out the next buffer of the WAV file, then silence, or stop if free-running */
+static int DISKAUD_CaptureAudio(_THIS, Uint8 *buffer, int buflen)
+{
+	struct SDL_PrivateAudioData *h = this->hidden;
+	Uint32 len = h->capture_len - h->capture_pos;
+
+	if ( ! h->free_running ) {
+		DISKAUD_Pace(this);
+	} else if ( this->paused ) {
+		SDL_Delay((this->spec.samples * 1000) / this->spec.freq);
+	} else if ( len == 0 ) {
+		/* Nothing more to record, instead of spinning on silence */
+		return(-1);
+	}
+
+	/* Unlike a microphone, the file waits while recording is paused */
+	if ( this->paused ) {
+		len = 0;
+	}
+
+	if ( len > (Uint32)buflen ) {
+		len = buflen;
 	}
+	SDL_memcpy(buffer, h->capture_buf + h->capture_pos, len);
+	SDL_memset(buffer + len, this->spec.silence, buflen - len);
+	h->capture_pos += len;
+	return(0);
+}
+
+static int SDLCALL DISKAUD_WriterThread(void *data)
+{
+	SDL_AudioDevice *this = (SDL_AudioDevice *)data;
+	struct SDL_PrivateAudioData *h = this->hidden;
+	Uint8 *chunk;
+
+	for ( ; ; ) {
+		SDL_SemWait(h->ring_filled);
+		if ( h->written == SDL_AtomicGet(&h->queued) ) {
+			/* Woken up without a buffer, we're closing */
+			break;
+		}
+
+		chunk = h->ring + (h->written % h->ring_chunks) * h->mixlen;
+		if ( ! h->write_error ) {
+			if ( SDL_RWwrite(h->output, chunk, 1, h->mixlen) !=
+			     (int)h->mixlen ) {
+				SDL_AtomicSet(&h->write_error, 1);
+			} else {
+				h->data_bytes += h->mixlen;
+			}
+		}
 #ifdef DEBUG_AUDIO
-	fprintf(stderr, "Wrote %d bytes of audio data\n", written);
+		fprintf(stderr, "Wrote %d bytes of audio data\n", h->mixlen);
 #endif
+		++h->written;
+		SDL_SemPost(h->ring_space);
+	}
+	return(0);
 }
 
-static Uint8 *DISKAUD_GetAudioBuf(_THIS)
+static int DISKAUD_IsWAVFile(const char *fname)
 {
-	return(this->hidden->mixbuf);
+	size_t len = SDL_strlen(fname);
+
+	return((len >= 4) && (SDL_strcasecmp(fname + len - 4, ".wav") == 0));
+}
+
+static int DISKAUD_WriteWAVHeader(_THIS, SDL_AudioSpec *spec)
+{
+	SDL_RWops *dst = this->hidden->output;
+	Uint16 bits = (spec->format & 0xFF);
+	Uint16 blockalign = (bits / 8) * spec->channels;
+	int ok = 1;
+
+	ok &= SDL_WriteLE32(dst, RIFF);
+	ok &= SDL_WriteLE32(dst, DISKWAV_RIFF_SIZE);	/* Patched on close */
+	ok &= SDL_WriteLE32(dst, WAVE);
+	ok &= SDL_WriteLE32(dst, FMT);
+	ok &= SDL_WriteLE32(dst, 16);
+	ok &= SDL_WriteLE16(dst, PCM_CODE);
+	ok &= SDL_WriteLE16(dst, spec->channels);
+	ok &= SDL_WriteLE32(dst, spec->freq);
+	ok &= SDL_WriteLE32(dst, spec->freq * blockalign);
+	ok &= SDL_WriteLE16(dst, blockalign);
+	ok &= SDL_WriteLE16(dst, bits);
+	ok &= SDL_WriteLE32(dst, DATA);
+	ok &= SDL_WriteLE32(dst, 0);			/* Patched on close */
+	if ( ! ok ) {
+		SDL_SetError("Couldn't write WAV header");
+		return(-1);
+	}
+	return(0);
+}
+
+static void DISKAUD_PatchWAVHeader(_THIS)
+{
+	SDL_RWops *dst = this->hidden->output;
+	Uint32 data_bytes = this->hidden->data_bytes;
+
+	if ( SDL_RWseek(dst, 4, RW_SEEK_SET) == 4 ) {
+		SDL_WriteLE32(dst, DISKWAV_RIFF_SIZE + data_bytes);
+	}
+	if ( SDL_RWseek(dst, DISKWAV_HEADER_SIZE - 4, RW_SEEK_SET) ==
+	     DISKWAV_HEADER_SIZE - 4 ) {
+		SDL_WriteLE32(dst, data_bytes);
+	}
 }
 
 static void DISKAUD_CloseAudio(_THIS)
 {
-	if ( this->hidden->mixbuf != NULL ) {
-		SDL_FreeAudioMem(this->hidden->mixbuf);
-		this->hidden->mixbuf = NULL;
+	struct SDL_PrivateAudioData *h = this->hidden;
+
+	if ( h->capture_buf != NULL ) {
+		SDL_FreeWAV(h->capture_buf);
+		h->capture_buf = NULL;
+	}
+	if ( h->writer != NULL ) {
+		/* Let the writer thread finish the queued buffers */
+		SDL_SemPost(h->ring_filled);
+		SDL_WaitThread(h->writer, NULL);
+		h->writer = NULL;
 	}
-	if ( this->hidden->output != NULL ) {
-		SDL_RWclose(this->hidden->output);
-		this->hidden->output = NULL;
+#ifdef DEBUG_AUDIO
+	fprintf(stderr, "Disk audio: %d buffers written, %d dropped\n",
+		h->written, h->dropped);
+#endif
+	if ( h->ring_filled != NULL ) {
+		SDL_DestroySemaphore(h->ring_filled);
+		h->ring_filled = NULL;
+	}
+	if ( h->ring_space != NULL ) {
+		SDL_DestroySemaphore(h->ring_space);
+		h->ring_space = NULL;
+	}
+	if ( h->ring != NULL ) {
+		SDL_free(h->ring);
+		h->ring = NULL;
+	}
+	if ( h->mixbuf != NULL ) {
+		SDL_FreeAudioMem(h->mixbuf);
+		h->mixbuf = NULL;
+	}
+	if ( h->output != NULL ) {
+		if ( h->wav_header ) {
+			DISKAUD_PatchWAVHeader(this);
+		}
+		SDL_RWclose(h->output);
+		h->output = NULL;
 	}
 }
 
+/* The recorded format is whatever the WAV file holds */
+static int DISKAUD_OpenCapture(_THIS, SDL_AudioSpec *spec)
+{
+	struct SDL_PrivateAudioData *h = this->hidden;
+	const char *fname = DISKAUD_GetInputFilename();
+	SDL_AudioSpec wavspec;
+	int frame;
+
+	if ( SDL_LoadWAV(fname, &wavspec, &h->capture_buf, &h->capture_len) == NULL ) {
+		return(-1);
+	}
+
+#if HAVE_STDIO_H
+	fprintf(stderr, "WARNING: You are using the SDL disk writer"
+                    " audio driver!\n Recording from file [%s].\n", fname);
+#endif
+
+	spec->freq = wavspec.freq;
+	spec->format = wavspec.format;
+	spec->channels = wavspec.channels;
+	SDL_CalculateAudioSpec(spec);
+
+	/* Don't hand out a partial sample frame at the end */
+	frame = ((spec->format & 0xFF) / 8) * spec->channels;
+	h->capture_len -= h->capture_len % frame;
+	h->capture_pos = 0;
+
+	h->start_ticks = SDL_GetTicks();
+	h->paced_ms = 0;
+	h->paced_rem = 0;
+	return(0);
+}
+
 static int DISKAUD_OpenAudio(_THIS, SDL_AudioSpec *spec)
 {
-	const char *fname = DISKAUD_GetOutputFilename();
+	struct SDL_PrivateAudioData *h = this->hidden;
+	const char *fname;
+
+	if ( this->iscapture ) {
+		return(DISKAUD_OpenCapture(this, spec));
+	}
+	fname = DISKAUD_GetOutputFilename(this);
 
 	/* Open the audio device */
-	this->hidden->output = SDL_RWFromFile(fname, "wb");
-	if ( this->hidden->output == NULL ) {
+	h->output = SDL_RWFromFile(fname, "wb");
+	if ( h->output == NULL ) {
 		return(-1);
 	}
 
@@ -172,15 +425,72 @@ static int DISKAUD_OpenAudio(_THIS, SDL_AudioSpec *spec)
                     " audio driver!\n Writing to file [%s].\n", fname);
 #endif
 
-	/* Allocate mixing buffer */
-	this->hidden->mixlen = spec->size;
-	this->hidden->mixbuf = (Uint8 *) SDL_AllocAudioMem(this->hidden->mixlen);
-	if ( this->hidden->mixbuf == NULL ) {
+	/* WAV files hold unsigned 8-bit or signed 16-bit little endian data */
+	h->wav_header = DISKAUD_IsWAVFile(fname);
+	if ( h->wav_header ) {
+		if ( (spec->format & 0xFF) == 8 ) {
+			spec->format = AUDIO_U8;
+		} else {
+			spec->format = AUDIO_S16LSB;
+		}
+		SDL_CalculateAudioSpec(spec);
+		if ( DISKAUD_WriteWAVHeader(this, spec) < 0 ) {
+			DISKAUD_CloseAudio(this);
+			return(-1);
+		}
+	}
+	h->data_bytes = 0;
+
+	/* Allocate mixing buffer, where dropped buffers are mixed */
+	h->mixlen = spec->size;
+	h->mixbuf = (Uint8 *) SDL_AllocAudioMem(h->mixlen);
+	if ( h->mixbuf == NULL ) {
+		DISKAUD_CloseAudio(this);
+		SDL_OutOfMemory();
+		return(-1);
+	}
+	SDL_memset(h->mixbuf, spec->silence, spec->size);
+
+	/* Queue up to about a second of audio for the writer thread */
+	h->ring_chunks = spec->freq / spec->samples;
+	if ( h->ring_chunks < DISKMIN_RING_CHUNKS ) {
+		h->ring_chunks = DISKMIN_RING_CHUNKS;
+	} else if ( h->ring_chunks > DISKMAX_RING_CHUNKS ) {
+		h->ring_chunks = DISKMAX_RING_CHUNKS;
+	}
+	h->ring = (Uint8 *) SDL_malloc(h->ring_chunks * h->mixlen);
+	if ( h->ring == NULL ) {
+		DISKAUD_CloseAudio(this);
+		SDL_OutOfMemory();
 		return(-1);
 	}
-	SDL_memset(this->hidden->mixbuf, spec->silence, spec->size);
+	h->ring_filled = SDL_CreateSemaphore(0);
+	h->ring_space = SDL_CreateSemaphore(h->ring_chunks);
+	if ( (h->ring_filled == NULL) || (h->ring_space == NULL) ) {
+		DISKAUD_CloseAudio(this);
+		return(-1);
+	}
+	h->write_chunk = 0;
+	h->queued = 0;
+	h->written = 0;
+	h->write_error = 0;
+	h->dropped = 0;
+
+	/* The first buffer is ours */
+	SDL_SemWait(h->ring_space);
+	h->have_chunk = 1;
+
+	h->writer = SDL_CreateThread(DISKAUD_WriterThread, this);
+	if ( h->writer == NULL ) {
+		DISKAUD_CloseAudio(this);
+		SDL_SetError("Couldn't create disk writer thread");
+		return(-1);
+	}
+
+	h->start_ticks = SDL_GetTicks();
+	h->paced_ms = 0;
+	h->paced_rem = 0;
 
 	/* We're ready to rock and roll. :-) */
 	return(0);
 }
-
@@ -25,6 +25,7 @@
 #define _SDL_diskaudio_h
 
 #include "SDL_rwops.h"
+#include "SDL_thread.h"
 #include "../SDL_sysaudio.h"
 
 /* Hidden "this" pointer for the video functions */
@@ -35,7 +36,35 @@ struct SDL_PrivateAudioData {
 	SDL_RWops *output;
 	Uint8 *mixbuf;
 	Uint32 mixlen;
-	Uint32 write_delay;
+	int write_delay;		/* ms, 0 to free run, -1 for real time */
+	int free_running;	/* Render as fast as the disk allows */
+
+	/* RIFF header to patch when the file is closed, if any */
+	int wav_header;
+	Uint32 data_bytes;
+
+	/* Buffers queued for the writer thread */
+	Uint8 *ring;
+	int ring_chunks;
+	int write_chunk;	/* Next buffer filled by the audio thread */
+	int have_chunk;		/* The audio thread owns write_chunk */
+	volatile int queued;	/* Buffers handed to the writer thread */
+	int written;		/* Buffers written by the writer thread */
+	volatile int write_error;
+	SDL_sem *ring_filled;
+	SDL_sem *ring_space;
+	SDL_Thread *writer;
+
+	/* Real time pacing */
+	Uint32 start_ticks;
+	Uint32 paced_ms;
+	Uint32 paced_rem;
+	int dropped;
+
+	/* WAV data handed out by the capture device */
+	Uint8 *capture_buf;
+	Uint32 capture_len;
+	Uint32 capture_pos;
 };
 
 #endif /* _SDL_diskaudio_h */
@@ -46,6 +46,7 @@
 
 #include "SDL_timer.h"
 #include "SDL_audio.h"
+#include "SDL_hints.h"
 #include "../SDL_audiomem.h"
 #include "../SDL_audio_c.h"
 #include "../SDL_audiodev_c.h"
@@ -56,6 +57,7 @@
 
 /* Open the audio device for playback, and don't block if busy */
 #define OPEN_FLAGS	(O_WRONLY|O_NONBLOCK)
+#define CAPTURE_FLAGS	(O_RDONLY|O_NONBLOCK)
 
 /* Audio driver functions */
 static int DSP_OpenAudio(_THIS, SDL_AudioSpec *spec);
@@ -63,6 +65,7 @@ static void DSP_WaitAudio(_THIS);
 static void DSP_PlayAudio(_THIS);
 static Uint8 *DSP_GetAudioBuf(_THIS);
 static void DSP_CloseAudio(_THIS);
+static int DSP_CaptureAudio(_THIS, Uint8 *buffer, int buflen);
 
 /* Audio driver bootstrap functions */
 
@@ -113,6 +116,7 @@ static SDL_AudioDevice *Audio_CreateDevice(int devindex)
 	this->PlayAudio = DSP_PlayAudio;
 	this->GetAudioBuf = DSP_GetAudioBuf;
 	this->CloseAudio = DSP_CloseAudio;
+	this->CaptureAudio = DSP_CaptureAudio;
 
 	this->free = Audio_DeleteDevice;
 
@@ -148,6 +152,35 @@ static Uint8 *DSP_GetAudioBuf(_THIS)
 	return(mixbuf);
 }
 
+/* This function blocks until a full buffer has been recorded */
+static int DSP_CaptureAudio(_THIS, Uint8 *buffer, int buflen)
+{
+	int len;
+
+	while ( buflen > 0 ) {
+		if ( ! this->enabled ) {
+			return(-1);
+		}
+		len = read(audio_fd, buffer, buflen);
+		if ( len < 0 ) {
+			if ( errno == EINTR ) {
+				continue;
+			}
+			perror("Audio read");
+			return(-1);
+		}
+		if ( len == 0 ) {
+			return(-1);
+		}
+		buffer += len;
+		buflen -= len;
+	}
+#ifdef DEBUG_AUDIO
+	fprintf(stderr, "Read %d bytes of audio data\n", mixlen);
+#endif
+	return(0);
+}
+
 static void DSP_CloseAudio(_THIS)
 {
 	if ( mixbuf != NULL ) {
@@ -160,6 +193,27 @@ static void DSP_CloseAudio(_THIS)
 	}
 }
 
+static int DSP_OpenDevice(_THIS, char *path, int maxlen)
+{
+	const char *audiodev;
+
+	if ( this->devname ) {
+		SDL_strlcpy(path, this->devname, maxlen);
+		return(open(this->devname, OPEN_FLAGS, 0));
+	}
+	if ( ! this->iscapture ) {
+		return(SDL_OpenAudioPath(path, maxlen, OPEN_FLAGS, 0));
+	}
+
+	/* Microphones are often on another card than the speakers */
+	audiodev = SDL_GetHint(SDL_HINT_AUDIO_CAPTURE_DEVICE);
+	if ( audiodev == NULL ) {
+		return(SDL_OpenAudioPath(path, maxlen, CAPTURE_FLAGS, 0));
+	}
+	SDL_strlcpy(path, audiodev, maxlen);
+	return(open(audiodev, CAPTURE_FLAGS, 0));
+}
+
 static int DSP_OpenAudio(_THIS, SDL_AudioSpec *spec)
 {
 	char audiodev[1024];
@@ -178,14 +232,14 @@ static int DSP_OpenAudio(_THIS, SDL_AudioSpec *spec)
         spec->channels = 2;
 
 	/* Open the audio device */
-	audio_fd = SDL_OpenAudioPath(audiodev, sizeof(audiodev), OPEN_FLAGS, 0);
+	audio_fd = DSP_OpenDevice(this, audiodev, sizeof(audiodev));
 	if ( audio_fd < 0 ) {
 		SDL_SetError("Couldn't open %s: %s", audiodev, strerror(errno));
 		return(-1);
 	}
 	mixbuf = NULL;
 
-	/* Make the file descriptor use blocking writes with fcntl() */
+	/* Make the file descriptor use blocking I/O with fcntl() */
 	{ long flags;
 		flags = fcntl(audio_fd, F_GETFL);
 		flags &= ~O_NONBLOCK;
@@ -46,11 +46,7 @@ static void DUMMYAUD_CloseAudio(_THIS);
 /* Audio driver bootstrap functions */
 static int DUMMYAUD_Available(void)
 {
-	const char *envr = SDL_getenv("SDL_AUDIODRIVER");
-	if (envr && (SDL_strcmp(envr, DUMMYAUD_DRIVER_NAME) == 0)) {
-		return(1);
-	}
-	return(0);
+	return(SDL_AudioDriverRequested(DUMMYAUD_DRIVER_NAME));
 }
 
 static void DUMMYAUD_DeleteDevice(SDL_AudioDevice *device)
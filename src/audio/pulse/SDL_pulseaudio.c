@@ -34,6 +34,7 @@
 
 #include "SDL_timer.h"
 #include "SDL_audio.h"
+#include "SDL_hints.h"
 #include "../SDL_audiomem.h"
 #include "../SDL_audio_c.h"
 #include "../SDL_audiodev_c.h"
@@ -58,6 +59,7 @@ static Uint8 *PULSE_GetAudioBuf(_THIS);
 static void PULSE_CloseAudio(_THIS);
 static void PULSE_WaitDone(_THIS);
 static void PULSE_SetCaption(_THIS, const char *str);
+static int PULSE_GetLatency(_THIS);
 
 #ifdef SDL_AUDIO_DRIVER_PULSE_DYNAMIC
 
@@ -111,6 +113,13 @@ static pa_stream_state_t (*SDL_NAME(pa_stream_get_state))(pa_stream *s);
 static size_t (*SDL_NAME(pa_stream_writable_size))(pa_stream *s);
 static int (*SDL_NAME(pa_stream_write))(pa_stream *s, const void *data, size_t nbytes,
 	pa_free_cb_t free_cb, int64_t offset, pa_seek_mode_t seek);
+#ifdef PULSE_BEGIN_WRITE
+static int (*SDL_NAME(pa_stream_begin_write))(pa_stream *s, void **data,
+	size_t *nbytes);
+static int (*SDL_NAME(pa_stream_cancel_write))(pa_stream *s);
+#endif
+static int (*SDL_NAME(pa_stream_get_latency))(pa_stream *s, pa_usec_t *r_usec,
+	int *negative);
 static pa_operation * (*SDL_NAME(pa_stream_drain))(pa_stream *s,
 	pa_stream_success_cb_t cb, void *userdata);
 static int (*SDL_NAME(pa_stream_disconnect))(pa_stream *s);
@@ -121,6 +130,7 @@ static pa_operation* (*SDL_NAME(pa_context_set_name))(pa_context *c,
 static struct {
 	const char *name;
 	void **func;
+	int optional;		/* Left NULL if the library doesn't have it */
 } pulse_functions[] = {
 	{ "pa_simple_new",
 		(void **)&SDL_NAME(pa_simple_new)		},
@@ -162,6 +172,14 @@ static struct {
 		(void **)&SDL_NAME(pa_stream_writable_size)	},
 	{ "pa_stream_write",
 		(void **)&SDL_NAME(pa_stream_write)		},
+#ifdef PULSE_BEGIN_WRITE
+	{ "pa_stream_begin_write",
+		(void **)&SDL_NAME(pa_stream_begin_write), 1	},
+	{ "pa_stream_cancel_write",
+		(void **)&SDL_NAME(pa_stream_cancel_write), 1	},
+#endif
+	{ "pa_stream_get_latency",
+		(void **)&SDL_NAME(pa_stream_get_latency)	},
 	{ "pa_stream_drain",
 		(void **)&SDL_NAME(pa_stream_drain)		},
 	{ "pa_stream_disconnect",
@@ -172,12 +190,12 @@ static struct {
 		(void **)&SDL_NAME(pa_context_set_name)		},
 };
 
+/* Each open device holds a reference */
 static void UnloadPulseLibrary()
 {
-	if ( pulse_loaded ) {
+	if ( pulse_loaded && --pulse_loaded == 0 ) {
 		SDL_UnloadObject(pulse_handle);
 		pulse_handle = NULL;
-		pulse_loaded = 0;
 	}
 }
 
@@ -185,13 +203,17 @@ static int LoadPulseLibrary(void)
 {
 	int i, retval = -1;
 
+	if ( pulse_loaded ) {
+		++pulse_loaded;
+		return 0;
+	}
 	pulse_handle = SDL_LoadObject(pulse_library);
 	if ( pulse_handle ) {
 		pulse_loaded = 1;
 		retval = 0;
 		for ( i=0; i<SDL_arraysize(pulse_functions); ++i ) {
 			*pulse_functions[i].func = SDL_LoadFunction(pulse_handle, pulse_functions[i].name);
-			if ( !*pulse_functions[i].func ) {
+			if ( !*pulse_functions[i].func && !pulse_functions[i].optional ) {
 				retval = -1;
 				UnloadPulseLibrary();
 				break;
@@ -215,6 +237,18 @@ static int LoadPulseLibrary(void)
 
 #endif /* SDL_AUDIO_DRIVER_PULSE_DYNAMIC */
 
+/* pa_stream_begin_write() may be missing from the library loaded at
+   run time, even if the headers SDL was built with have it.
+ */
+#ifdef PULSE_BEGIN_WRITE
+#ifdef SDL_AUDIO_DRIVER_PULSE_DYNAMIC
+#define PULSE_HAS_BEGIN_WRITE() \
+	(SDL_NAME(pa_stream_begin_write) && SDL_NAME(pa_stream_cancel_write))
+#else
+#define PULSE_HAS_BEGIN_WRITE()	1
+#endif
+#endif
+
 /* Audio driver bootstrap functions */
 
 static int Audio_Available(void)
@@ -289,6 +323,7 @@ static SDL_AudioDevice *Audio_CreateDevice(int devindex)
 	this->CloseAudio = PULSE_CloseAudio;
 	this->WaitDone = PULSE_WaitDone;
 	this->SetCaption = PULSE_SetCaption;
+	this->GetLatency = PULSE_GetLatency;
 
 	this->free = Audio_DeleteDevice;
 
@@ -300,6 +335,22 @@ AudioBootStrap PULSE_bootstrap = {
 	Audio_Available, Audio_CreateDevice
 };
 
+/* Pulse objects belong to the audio thread, so it keeps a copy of the
+   latency for PULSE_GetLatency() to read.
+ */
+static void PULSE_UpdateLatency(_THIS)
+{
+	pa_usec_t usec;
+	int negative;
+
+	if (SDL_NAME(pa_stream_get_latency)(stream, &usec, &negative) == 0) {
+		if (negative) {
+			usec = 0;
+		}
+		this->hidden->latency = (usec > 0x7FFFFFFF) ? 0x7FFFFFFF : (int)usec;
+	}
+}
+
 /* This function waits until it is possible to write a full sound buffer */
 static void PULSE_WaitAudio(_THIS)
 {
@@ -313,24 +364,53 @@ static void PULSE_WaitAudio(_THIS)
 		}
 		size = SDL_NAME(pa_stream_writable_size)(stream);
 		if (size >= mixlen)
-			return;
+			break;
 	}
+	PULSE_UpdateLatency(this);
 }
 
 static void PULSE_PlayAudio(_THIS)
 {
-	/* Write the audio data */
-	if (SDL_NAME(pa_stream_write)(stream, mixbuf, mixlen, NULL, 0LL, PA_SEEK_RELATIVE) < 0)
+	Uint8 *buf = (writebuf != NULL) ? writebuf : mixbuf;
+
+	/* Write the audio data, without a copy if it's already the server's */
+	writebuf = NULL;
+	if (SDL_NAME(pa_stream_write)(stream, buf, mixlen, NULL, 0LL, PA_SEEK_RELATIVE) < 0)
 		this->enabled = 0;
 }
 
 static Uint8 *PULSE_GetAudioBuf(_THIS)
 {
+#ifdef PULSE_BEGIN_WRITE
+	void *data = NULL;
+	size_t nbytes = mixlen;
+
+	/* Mix straight into memory shared with the server if we can */
+	if (PULSE_HAS_BEGIN_WRITE() &&
+	    SDL_NAME(pa_stream_begin_write)(stream, &data, &nbytes) == 0) {
+		if (nbytes >= (size_t)mixlen) {
+			writebuf = (Uint8 *)data;
+			return(writebuf);
+		}
+		SDL_NAME(pa_stream_cancel_write)(stream);
+	}
+#endif
 	return(mixbuf);
 }
 
+static int PULSE_GetLatency(_THIS)
+{
+	return(this->hidden->latency);
+}
+
 static void PULSE_CloseAudio(_THIS)
 {
+#ifdef PULSE_BEGIN_WRITE
+	if ( writebuf != NULL ) {
+		SDL_NAME(pa_stream_cancel_write)(stream);
+		writebuf = NULL;
+	}
+#endif
 	if ( mixbuf != NULL ) {
 		SDL_FreeAudioMem(mixbuf);
 		mixbuf = NULL;
@@ -479,6 +559,17 @@ static int PULSE_OpenAudio(_THIS, SDL_AudioSpec *spec)
 	paattr.minreq = mixlen; /* -1 can lead to pa_stream_writable_size()
 				   >= mixlen never becoming true */
 	flags = PA_STREAM_ADJUST_LATENCY;
+
+	/* Ask the server for a target latency in ms, down to two buffers */
+	{ const char *env = SDL_GetHint(SDL_HINT_AUDIO_PULSE_LATENCY);
+		if (env) {
+			int frame_size = (spec->format & 0xFF) / 8 * spec->channels;
+			paattr.tlength = (SDL_atoi(env) * spec->freq / 1000) * frame_size;
+			if (paattr.tlength < (Uint32)mixlen * 2) {
+				paattr.tlength = mixlen * 2;
+			}
+		}
+	}
 #else
 	paattr.tlength = mixlen*2;
 	paattr.prebuf = mixlen*2;
@@ -486,6 +577,10 @@ static int PULSE_OpenAudio(_THIS, SDL_AudioSpec *spec)
 	paattr.minreq = mixlen;
 #endif
 
+	/* Keep the timing current, so the latency is cheap to ask for */
+	flags |= PA_STREAM_INTERPOLATE_TIMING | PA_STREAM_AUTO_TIMING_UPDATE;
+	this->hidden->latency = -1;
+
 	/* The SDL ALSA output hints us that we use Windows' channel mapping */
 	/* http://bugzilla.libsdl.org/show_bug.cgi?id=110 */
 	SDL_NAME(pa_channel_map_init_auto)(
@@ -545,7 +640,7 @@ static int PULSE_OpenAudio(_THIS, SDL_AudioSpec *spec)
 		return(-1);
 	}
 
-	if (SDL_NAME(pa_stream_connect_playback)(stream, NULL, &paattr, flags,
+	if (SDL_NAME(pa_stream_connect_playback)(stream, this->devname, &paattr, flags,
 			NULL, NULL) < 0) {
 		PULSE_CloseAudio(this);
 		SDL_SetError("Could not connect PulseAudio stream");
@@ -42,6 +42,12 @@ struct SDL_PrivateAudioData {
 	/* Raw mixing buffer */
 	Uint8 *mixbuf;
 	int    mixlen;
+
+	/* Server memory being mixed into, instead of mixbuf */
+	Uint8 *writebuf;
+
+	/* Playback latency in microseconds, -1 until the server reports it */
+	volatile int latency;
 };
 
 #if (PA_API_VERSION < 12)
@@ -61,6 +67,13 @@ static inline int PA_STREAM_IS_GOOD(pa_stream_state_t x) {
 }
 #endif	/* pulseaudio <= 0.9.10 */
 
+/* pa_stream_begin_write() appeared in pulseaudio 0.9.16 */
+#ifdef PA_CHECK_VERSION
+#if PA_CHECK_VERSION(0,9,16)
+#define PULSE_BEGIN_WRITE	1
+#endif
+#endif
+
 /* Old variable names */
 #define mainloop		(this->hidden->mainloop)
 #define mainloop_api		(this->hidden->mainloop_api)
@@ -68,6 +81,7 @@ static inline int PA_STREAM_IS_GOOD(pa_stream_state_t x) {
 #define stream			(this->hidden->stream)
 #define mixbuf			(this->hidden->mixbuf)
 #define mixlen			(this->hidden->mixlen)
+#define writebuf		(this->hidden->writebuf)
 
 #endif /* _SDL_pulseaudio_h */
 
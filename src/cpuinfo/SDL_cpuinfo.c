@@ -24,10 +24,10 @@
 /* CPU feature detection for SDL */
 
 #include "SDL.h"
-#include "SDL_cpuinfo.h"
+#include "SDL_cpuinfo_c.h"
 
-#if defined(__MACOSX__) && (defined(__ppc__) || defined(__ppc64__))
-#include <sys/sysctl.h> /* For AltiVec check */
+#if defined(__MACOSX__)
+#include <sys/sysctl.h> /* For AltiVec check and cache sizes */
 #elif defined(__OpenBSD__) && defined(__powerpc__)
 #include <sys/param.h>
 #include <sys/sysctl.h> /* For AltiVec check */
@@ -41,6 +41,20 @@
 #include <sys/syspage.h>
 #endif
 
+#if defined(__WIN32__)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>	/* For GetSystemInfo */
+#elif defined(__LINUX__) || defined(__MACOSX__) || defined(__FREEBSD__) || \
+      defined(__NETBSD__) || defined(__OPENBSD__) || defined(__SOLARIS__) || \
+      defined(__IRIX__) || defined(__AIX__) || defined(__HPUX__) || \
+      defined(__OSF__) || defined(__QNXNTO__)
+#include <unistd.h>	/* For sysconf */
+#endif
+
+#if defined(__LINUX__)
+#include <stdio.h>	/* For reading the topology from sysfs */
+#endif
+
 #if defined(__LINUX__) && defined(__arm__)
 #include <unistd.h>
 #include <sys/types.h>
@@ -69,17 +83,6 @@
 #include <swis.h>
 #endif
 
-#define CPU_HAS_RDTSC	0x00000001
-#define CPU_HAS_MMX	0x00000002
-#define CPU_HAS_MMXEXT	0x00000004
-#define CPU_HAS_3DNOW	0x00000010
-#define CPU_HAS_3DNOWEXT 0x00000020
-#define CPU_HAS_SSE	0x00000040
-#define CPU_HAS_SSE2	0x00000080
-#define CPU_HAS_ALTIVEC	0x00000100
-#define CPU_HAS_ARM_SIMD 0x00000200
-#define CPU_HAS_NEON     0x00000400
-
 #if SDL_ALTIVEC_BLITTERS && HAVE_SETJMP && !__MACOSX__ && !__OpenBSD__
 /* This is the brute force way of detecting instruction sets...
    the idea is borrowed from the libmpeg2 library - thanks!
@@ -339,6 +342,104 @@ done:
 	return features;
 }
 
+/* Run CPUID for a leaf and subleaf and get eax, ebx, ecx and edx back.
+   The caller makes sure the leaf is one the CPU has.
+ */
+static void CPU_cpuid(Uint32 leaf, Uint32 subleaf, Uint32 regs[4])
+{
+	Uint32 a = 0, b = 0, c = 0, d = 0;
+#if defined(__GNUC__) && defined(__i386__)
+	__asm__ __volatile__ (
+"        movl    %%ebx,%%esi         # Save ebx, it may be the PIC register\n"
+"        cpuid                                                         \n"
+"        xchgl   %%ebx,%%esi                                           \n"
+	: "=a" (a), "=S" (b), "=c" (c), "=d" (d)
+	: "0" (leaf), "2" (subleaf)
+	);
+#elif defined(__GNUC__) && defined(__x86_64__)
+	__asm__ __volatile__ (
+"        movq    %%rbx,%%rsi         # Save rbx                        \n"
+"        cpuid                                                         \n"
+"        xchgq   %%rbx,%%rsi                                           \n"
+	: "=a" (a), "=S" (b), "=c" (c), "=d" (d)
+	: "0" (leaf), "2" (subleaf)
+	);
+#elif (defined(_MSC_VER) && defined(_M_IX86)) || defined(__WATCOMC__)
+	__asm {
+        mov     eax, leaf
+        mov     ecx, subleaf
+        push    ebx
+        cpuid
+        mov     esi, ebx
+        pop     ebx
+        mov     a, eax
+        mov     b, esi
+        mov     c, ecx
+        mov     d, edx
+	}
+#endif
+	regs[0] = a;
+	regs[1] = b;
+	regs[2] = c;
+	regs[3] = d;
+}
+
+/* The highest leaf from 'base', either 0 or 0x80000000 */
+static Uint32 CPU_getCPUIDMaxLeaf(Uint32 base)
+{
+	Uint32 regs[4];
+
+	if ( !CPU_haveCPUID() ) {
+		return 0;
+	}
+	CPU_cpuid(base, 0, regs);
+	if ( regs[0] < base ) {
+		return 0;
+	}
+	return regs[0];
+}
+
+static Uint32 CPU_getCPUIDLeaf(Uint32 leaf, int reg)
+{
+	Uint32 regs[4];
+
+	if ( CPU_getCPUIDMaxLeaf(leaf & 0x80000000) < leaf ) {
+		return 0;
+	}
+	CPU_cpuid(leaf, 0, regs);
+	return regs[reg];
+}
+
+/* Which register states the OS saves on a context switch (XCR0) */
+static Uint32 CPU_getXCR0(void)
+{
+	Uint32 xcr0 = 0;
+
+	/* The OS has to have turned XSAVE on for XGETBV to work */
+	if ( !(CPU_getCPUIDLeaf(1, 2) & 0x08000000) ) {
+		return 0;
+	}
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+	{
+		Uint32 high;
+		__asm__ __volatile__ (
+"        .byte   0x0f,0x01,0xd0      # xgetbv, for older assemblers    \n"
+		: "=a" (xcr0), "=d" (high)
+		: "c" (0)
+		);
+	}
+#elif defined(_MSC_VER) && defined(_M_IX86)
+	__asm {
+        xor     ecx, ecx
+        _emit   0x0f
+        _emit   0x01
+        _emit   0xd0
+        mov     xcr0, eax
+	}
+#endif
+	return xcr0;
+}
+
 static __inline__ int CPU_haveRDTSC(void)
 {
 	if ( CPU_haveCPUID() ) {
@@ -395,6 +496,52 @@ static __inline__ int CPU_haveSSE2(void)
 	return 0;
 }
 
+static __inline__ int CPU_haveSSE3(void)
+{
+	return (CPU_getCPUIDLeaf(1, 2) & 0x00000001);
+}
+
+static __inline__ int CPU_haveSSSE3(void)
+{
+	return (CPU_getCPUIDLeaf(1, 2) & 0x00000200);
+}
+
+static __inline__ int CPU_haveSSE41(void)
+{
+	return (CPU_getCPUIDLeaf(1, 2) & 0x00080000);
+}
+
+static __inline__ int CPU_haveSSE42(void)
+{
+	return (CPU_getCPUIDLeaf(1, 2) & 0x00100000);
+}
+
+/* AVX needs the OS to save the SSE and AVX registers as well */
+static __inline__ int CPU_haveAVX(void)
+{
+	if ( CPU_getCPUIDLeaf(1, 2) & 0x10000000 ) {
+		return ((CPU_getXCR0() & 0x06) == 0x06);
+	}
+	return 0;
+}
+
+static __inline__ int CPU_haveAVX2(void)
+{
+	if ( CPU_haveAVX() ) {
+		return (CPU_getCPUIDLeaf(7, 1) & 0x00000020);
+	}
+	return 0;
+}
+
+/* AVX-512 also needs the opmask and upper ZMM registers saved */
+static __inline__ int CPU_haveAVX512F(void)
+{
+	if ( CPU_getCPUIDLeaf(7, 1) & 0x00010000 ) {
+		return ((CPU_getXCR0() & 0xE6) == 0xE6);
+	}
+	return 0;
+}
+
 static __inline__ int CPU_haveAltiVec(void)
 {
 	volatile int altivec = 0;
@@ -597,6 +744,27 @@ static Uint32 SDL_GetCPUFeatures(void)
 		if ( CPU_haveSSE2() ) {
 			SDL_CPUFeatures |= CPU_HAS_SSE2;
 		}
+		if ( CPU_haveSSE3() ) {
+			SDL_CPUFeatures |= CPU_HAS_SSE3;
+		}
+		if ( CPU_haveSSSE3() ) {
+			SDL_CPUFeatures |= CPU_HAS_SSSE3;
+		}
+		if ( CPU_haveSSE41() ) {
+			SDL_CPUFeatures |= CPU_HAS_SSE41;
+		}
+		if ( CPU_haveSSE42() ) {
+			SDL_CPUFeatures |= CPU_HAS_SSE42;
+		}
+		if ( CPU_haveAVX() ) {
+			SDL_CPUFeatures |= CPU_HAS_AVX;
+		}
+		if ( CPU_haveAVX2() ) {
+			SDL_CPUFeatures |= CPU_HAS_AVX2;
+		}
+		if ( CPU_haveAVX512F() ) {
+			SDL_CPUFeatures |= CPU_HAS_AVX512F;
+		}
 		if ( CPU_haveAltiVec() ) {
 			SDL_CPUFeatures |= CPU_HAS_ALTIVEC;
 		}
@@ -666,6 +834,62 @@ SDL_bool SDL_HasSSE2(void)
 	return SDL_FALSE;
 }
 
+SDL_bool SDL_HasSSE3(void)
+{
+	if ( SDL_GetCPUFeatures() & CPU_HAS_SSE3 ) {
+		return SDL_TRUE;
+	}
+	return SDL_FALSE;
+}
+
+SDL_bool SDL_HasSSSE3(void)
+{
+	if ( SDL_GetCPUFeatures() & CPU_HAS_SSSE3 ) {
+		return SDL_TRUE;
+	}
+	return SDL_FALSE;
+}
+
+SDL_bool SDL_HasSSE41(void)
+{
+	if ( SDL_GetCPUFeatures() & CPU_HAS_SSE41 ) {
+		return SDL_TRUE;
+	}
+	return SDL_FALSE;
+}
+
+SDL_bool SDL_HasSSE42(void)
+{
+	if ( SDL_GetCPUFeatures() & CPU_HAS_SSE42 ) {
+		return SDL_TRUE;
+	}
+	return SDL_FALSE;
+}
+
+SDL_bool SDL_HasAVX(void)
+{
+	if ( SDL_GetCPUFeatures() & CPU_HAS_AVX ) {
+		return SDL_TRUE;
+	}
+	return SDL_FALSE;
+}
+
+SDL_bool SDL_HasAVX2(void)
+{
+	if ( SDL_GetCPUFeatures() & CPU_HAS_AVX2 ) {
+		return SDL_TRUE;
+	}
+	return SDL_FALSE;
+}
+
+SDL_bool SDL_HasAVX512F(void)
+{
+	if ( SDL_GetCPUFeatures() & CPU_HAS_AVX512F ) {
+		return SDL_TRUE;
+	}
+	return SDL_FALSE;
+}
+
 SDL_bool SDL_HasAltiVec(void)
 {
 	if ( SDL_GetCPUFeatures() & CPU_HAS_ALTIVEC ) {
@@ -690,6 +914,307 @@ SDL_bool SDL_HasNEON(void)
 	return SDL_FALSE;
 }
 
+/* What each SDL_SIMD_LEVEL allows.  The x86 levels include the ones
+   below them, and MMX comes with the MMX extensions and 3DNow!
+ */
+#define SIMD_MMX	(CPU_HAS_MMX|CPU_HAS_MMXEXT|CPU_HAS_3DNOW|CPU_HAS_3DNOWEXT)
+#define SIMD_SSE	(SIMD_MMX|CPU_HAS_SSE)
+#define SIMD_SSE2	(SIMD_SSE|CPU_HAS_SSE2)
+#define SIMD_SSE3	(SIMD_SSE2|CPU_HAS_SSE3)
+#define SIMD_SSSE3	(SIMD_SSE3|CPU_HAS_SSSE3)
+#define SIMD_SSE41	(SIMD_SSSE3|CPU_HAS_SSE41)
+#define SIMD_SSE42	(SIMD_SSE41|CPU_HAS_SSE42)
+#define SIMD_AVX	(SIMD_SSE42|CPU_HAS_AVX)
+#define SIMD_AVX2	(SIMD_AVX|CPU_HAS_AVX2)
+#define SIMD_AVX512F	(SIMD_AVX2|CPU_HAS_AVX512F)
+
+static const struct {
+	const char *name;
+	Uint32 features;
+} SDL_SIMDLevels[] = {
+	{ "none",	0 },
+	{ "mmx",	SIMD_MMX },
+	{ "sse",	SIMD_SSE },
+	{ "sse2",	SIMD_SSE2 },
+	{ "sse3",	SIMD_SSE3 },
+	{ "ssse3",	SIMD_SSSE3 },
+	{ "sse4.1",	SIMD_SSE41 },
+	{ "sse4.2",	SIMD_SSE42 },
+	{ "avx",	SIMD_AVX },
+	{ "avx2",	SIMD_AVX2 },
+	{ "avx512f",	SIMD_AVX512F },
+	{ "altivec",	CPU_HAS_ALTIVEC },
+	{ "armsimd",	CPU_HAS_ARM_SIMD },
+	{ "neon",	CPU_HAS_ARM_SIMD|CPU_HAS_NEON }
+};
+
+static Uint32 SDL_SIMDFeatures = 0xFFFFFFFF;
+
+void SDL_InitSIMD(void)
+{
+	const char *level = SDL_GetHint(SDL_HINT_SIMD_LEVEL);
+	Uint32 allowed = 0xFFFFFFFF;
+	char names[128];
+	int i;
+
+	if ( level && *level ) {
+		for ( i = 0; i < (int)SDL_arraysize(SDL_SIMDLevels); ++i ) {
+			if ( SDL_strcasecmp(level, SDL_SIMDLevels[i].name) == 0 ) {
+				allowed = SDL_SIMDLevels[i].features | CPU_HAS_RDTSC;
+				break;
+			}
+		}
+		if ( i == SDL_arraysize(SDL_SIMDLevels) ) {
+			/* Not fatal, but a typo shouldn't go unnoticed */
+			names[0] = '\0';
+			for ( i = 0; i < (int)SDL_arraysize(SDL_SIMDLevels); ++i ) {
+				if ( i > 0 ) {
+					SDL_strlcat(names, ", ", sizeof(names));
+				}
+				SDL_strlcat(names, SDL_SIMDLevels[i].name, sizeof(names));
+			}
+			SDL_SetError("Unknown SDL_SIMD_LEVEL \"%s\", expected one of: %s",
+			             level, names);
+		}
+	}
+	SDL_SIMDFeatures = SDL_GetCPUFeatures() & allowed;
+}
+
+Uint32 SDL_GetSIMDFeatures(void)
+{
+	if ( SDL_SIMDFeatures == 0xFFFFFFFF ) {
+		SDL_InitSIMD();
+	}
+	return SDL_SIMDFeatures;
+}
+
+SDL_SIMDFunction SDL_SelectSIMDKernel(const SDL_SIMDKernel *kernels)
+{
+	Uint32 features = SDL_GetSIMDFeatures();
+
+	while ( kernels->features & ~features ) {
+		++kernels;
+	}
+	return kernels->function;
+}
+
+static int SDL_CPUCount = 0;
+
+int SDL_GetCPUCount(void)
+{
+	if ( SDL_CPUCount <= 0 ) {
+#if defined(__WIN32__)
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		SDL_CPUCount = (int)info.dwNumberOfProcessors;
+#elif defined(__IRIX__)
+		SDL_CPUCount = (int)sysconf(_SC_NPROC_ONLN);
+#elif defined(_SC_NPROCESSORS_ONLN)
+		/* number of processors online (SVR4.0MP compliant machines) */
+		SDL_CPUCount = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#elif defined(_SC_NPROCESSORS_CONF)
+		/* number of processors configured (SVR4.0MP compliant machines) */
+		SDL_CPUCount = (int)sysconf(_SC_NPROCESSORS_CONF);
+#endif
+		if ( SDL_CPUCount <= 0 ) {
+			SDL_CPUCount = 1;
+		}
+	}
+	return SDL_CPUCount;
+}
+
+/* The deterministic cache parameters, in leaf 4 from Intel and leaf
+   0x8000001D from AMD, list each cache with its level and geometry.
+   Older AMD CPUs only have the sizes in leaves 0x80000005 and 0x80000006.
+ */
+static void CPU_getCPUIDCaches(int cache[4], int *line)
+{
+	Uint32 regs[4], leaf, type, level;
+	int i;
+
+	leaf = 4;
+	if ( CPU_getCPUIDLeaf(4, 0) == 0 ) {
+		leaf = 0x8000001D;
+	}
+	if ( CPU_getCPUIDLeaf(leaf, 0) != 0 ) {
+		for ( i = 0; i < 16; ++i ) {
+			CPU_cpuid(leaf, i, regs);
+			type = regs[0] & 0x1F;
+			level = (regs[0] >> 5) & 0x07;
+			if ( type == 0 ) {
+				break;
+			}
+			if ( type == 2 || level < 1 || level > 3 || cache[level] ) {
+				/* An instruction cache, or one we already know */
+				continue;
+			}
+			cache[level] = (int)((((regs[1] >> 22) & 0x3FF) + 1) *
+			                     (((regs[1] >> 12) & 0x3FF) + 1) *
+			                     ((regs[1] & 0xFFF) + 1) * (regs[2] + 1));
+			if ( level == 1 ) {
+				*line = (int)((regs[1] & 0xFFF) + 1);
+			}
+		}
+	}
+	if ( !cache[1] && CPU_getCPUIDMaxLeaf(0x80000000) >= 0x80000005 ) {
+		regs[2] = CPU_getCPUIDLeaf(0x80000005, 2);
+		cache[1] = (int)(regs[2] >> 24) * 1024;
+		*line = (int)(regs[2] & 0xFF);
+	}
+	if ( !cache[2] && CPU_getCPUIDMaxLeaf(0x80000000) >= 0x80000006 ) {
+		regs[2] = CPU_getCPUIDLeaf(0x80000006, 2);
+		regs[3] = CPU_getCPUIDLeaf(0x80000006, 3);
+		cache[2] = (int)(regs[2] >> 16) * 1024;
+		if ( !cache[3] ) {
+			cache[3] = (int)(regs[3] >> 18) * 512 * 1024;
+		}
+	}
+	if ( !*line && (CPU_getCPUIDLeaf(1, 3) & 0x00080000) ) {
+		/* The CLFLUSH line size is given in units of 8 bytes */
+		*line = (int)((CPU_getCPUIDLeaf(1, 1) >> 8) & 0xFF) * 8;
+	}
+}
+
+#if defined(__LINUX__)
+static int CPU_readSysfs(const char *path, char *buf, int len)
+{
+	FILE *file;
+	int ok = 0;
+
+	file = fopen(path, "r");
+	if ( file ) {
+		ok = (fgets(buf, len, file) != NULL);
+		fclose(file);
+	}
+	return ok;
+}
+
+static void CPU_getSysfsCaches(int cache[4], int *line)
+{
+	const char *dir = "/sys/devices/system/cpu/cpu0/cache/index";
+	char path[128], buf[64];
+	int i, level, size;
+
+	for ( i = 0; i < 16; ++i ) {
+		SDL_snprintf(path, sizeof(path), "%s%d/level", dir, i);
+		if ( !CPU_readSysfs(path, buf, sizeof(buf)) ) {
+			break;
+		}
+		level = SDL_atoi(buf);
+		SDL_snprintf(path, sizeof(path), "%s%d/type", dir, i);
+		if ( level < 1 || level > 3 || cache[level] ||
+		     !CPU_readSysfs(path, buf, sizeof(buf)) || buf[0] == 'I' ) {
+			continue;
+		}
+		SDL_snprintf(path, sizeof(path), "%s%d/size", dir, i);
+		if ( !CPU_readSysfs(path, buf, sizeof(buf)) ) {
+			continue;
+		}
+		size = SDL_atoi(buf);
+		if ( SDL_strchr(buf, 'K') ) {
+			size *= 1024;
+		} else if ( SDL_strchr(buf, 'M') ) {
+			size *= 1024 * 1024;
+		}
+		cache[level] = size;
+		SDL_snprintf(path, sizeof(path), "%s%d/coherency_line_size", dir, i);
+		if ( level == 1 && !*line && CPU_readSysfs(path, buf, sizeof(buf)) ) {
+			*line = SDL_atoi(buf);
+		}
+	}
+}
+
+/* Count the CPUs that are the first hardware thread of their core */
+static int CPU_getSysfsCores(void)
+{
+	char path[128], buf[64];
+	int i, cpus, cores = 0;
+
+	cpus = (int)sysconf(_SC_NPROCESSORS_CONF);
+	for ( i = 0; i < cpus; ++i ) {
+		SDL_snprintf(path, sizeof(path),
+		    "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", i);
+		if ( CPU_readSysfs(path, buf, sizeof(buf)) && SDL_atoi(buf) == i ) {
+			++cores;
+		}
+	}
+	return cores;
+}
+
+#elif defined(__MACOSX__)
+static int CPU_sysctl(const char *name)
+{
+	union { Uint32 u32; Uint64 u64; } value;
+	size_t size = sizeof(value);
+
+	value.u64 = 0;
+	if ( sysctlbyname(name, &value, &size, NULL, 0) != 0 ) {
+		return 0;
+	}
+	return (size == sizeof(Uint32)) ? (int)value.u32 : (int)value.u64;
+}
+#endif /* __LINUX__ */
+
+typedef struct SDL_CPUTopology {
+	int cores;
+	int cache[4];	/* Data cache sizes by level, from 1 to 3 */
+	int line;
+} SDL_CPUTopology;
+
+static SDL_CPUTopology SDL_Topology;
+static int SDL_TopologyKnown = 0;
+
+static SDL_CPUTopology *SDL_GetCPUTopology(void)
+{
+	SDL_CPUTopology topology;
+
+	if ( !SDL_TopologyKnown ) {
+		SDL_memset(&topology, 0, sizeof(topology));
+		CPU_getCPUIDCaches(topology.cache, &topology.line);
+#if defined(__LINUX__)
+		CPU_getSysfsCaches(topology.cache, &topology.line);
+		topology.cores = CPU_getSysfsCores();
+#elif defined(__MACOSX__)
+		topology.cores = CPU_sysctl("hw.physicalcpu");
+		if ( !topology.cache[1] ) {
+			topology.cache[1] = CPU_sysctl("hw.l1dcachesize");
+			topology.cache[2] = CPU_sysctl("hw.l2cachesize");
+			topology.cache[3] = CPU_sysctl("hw.l3cachesize");
+		}
+		if ( !topology.line ) {
+			topology.line = CPU_sysctl("hw.cachelinesize");
+		}
+#endif
+		if ( topology.cores <= 0 || topology.cores > SDL_GetCPUCount() ) {
+			topology.cores = SDL_GetCPUCount();
+		}
+		if ( topology.line <= 0 ) {
+			topology.line = 64;
+		}
+		SDL_Topology = topology;
+		SDL_TopologyKnown = 1;
+	}
+	return &SDL_Topology;
+}
+
+int SDL_GetCPUCoreCount(void)
+{
+	return SDL_GetCPUTopology()->cores;
+}
+
+int SDL_GetCPUCacheSize(int level)
+{
+	if ( level < 1 || level > 3 ) {
+		return 0;
+	}
+	return SDL_GetCPUTopology()->cache[level];
+}
+
+int SDL_GetCPUCacheLineSize(void)
+{
+	return SDL_GetCPUTopology()->line;
+}
+
 #ifdef TEST_MAIN
 
 #include <stdio.h>
@@ -706,6 +1231,18 @@ int main()
 	printf("AltiVec: %d\n", SDL_HasAltiVec());
 	printf("ARM SIMD: %d\n", SDL_HasARMSIMD());
 	printf("NEON: %d\n", SDL_HasNEON());
+	printf("SSE3: %d\n", SDL_HasSSE3());
+	printf("SSSE3: %d\n", SDL_HasSSSE3());
+	printf("SSE4.1: %d\n", SDL_HasSSE41());
+	printf("SSE4.2: %d\n", SDL_HasSSE42());
+	printf("AVX: %d\n", SDL_HasAVX());
+	printf("AVX2: %d\n", SDL_HasAVX2());
+	printf("AVX-512F: %d\n", SDL_HasAVX512F());
+	printf("CPUs: %d\n", SDL_GetCPUCount());
+	printf("Cores: %d\n", SDL_GetCPUCoreCount());
+	printf("L1, L2, L3: %d, %d, %d\n", SDL_GetCPUCacheSize(1),
+	       SDL_GetCPUCacheSize(2), SDL_GetCPUCacheSize(3));
+	printf("Cache line: %d\n", SDL_GetCPUCacheLineSize());
 	return 0;
 }
 
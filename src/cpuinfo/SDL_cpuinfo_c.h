@@ -0,0 +1,75 @@
+/*
+    SDL - Simple DirectMedia Layer
+    Copyright (C) 1997-2012 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+#include "SDL_config.h"
+
+/* Choosing between the SIMD versions of SDL's own routines */
+
+#ifndef _SDL_cpuinfo_c_h
+#define _SDL_cpuinfo_c_h
+
+#include "SDL_cpuinfo.h"
+
+#define CPU_HAS_RDTSC	0x00000001
+#define CPU_HAS_MMX	0x00000002
+#define CPU_HAS_MMXEXT	0x00000004
+#define CPU_HAS_3DNOW	0x00000010
+#define CPU_HAS_3DNOWEXT 0x00000020
+#define CPU_HAS_SSE	0x00000040
+#define CPU_HAS_SSE2	0x00000080
+#define CPU_HAS_ALTIVEC	0x00000100
+#define CPU_HAS_ARM_SIMD 0x00000200
+#define CPU_HAS_NEON     0x00000400
+#define CPU_HAS_SSE3	0x00000800
+#define CPU_HAS_SSSE3	0x00001000
+#define CPU_HAS_SSE41	0x00002000
+#define CPU_HAS_SSE42	0x00004000
+#define CPU_HAS_AVX	0x00008000
+#define CPU_HAS_AVX2	0x00010000
+#define CPU_HAS_AVX512F	0x00020000
+
+/* Work out which CPU features SDL's SIMD routines may use: the ones the
+   CPU has, less any above the level the SDL_SIMD_LEVEL hint asks for.
+   SDL_InitSubSystem() calls this, so the hint can be changed between
+   runs of SDL_Init().
+ */
+extern void SDL_InitSIMD(void);
+
+/* The CPU features SDL's SIMD routines may use, as CPU_HAS_* flags */
+extern Uint32 SDL_GetSIMDFeatures(void);
+
+#define SDL_UseSIMD(features) \
+	((SDL_GetSIMDFeatures() & (features)) == (features))
+
+/* One version of a routine and the CPU features it needs.  Lists of them
+   go from the fastest to a last one that needs no features at all.
+ */
+typedef void (*SDL_SIMDFunction)(void);
+
+typedef struct SDL_SIMDKernel {
+	Uint32 features;
+	SDL_SIMDFunction function;
+} SDL_SIMDKernel;
+
+/* Returns the first routine in the list whose features can be used */
+extern SDL_SIMDFunction SDL_SelectSIMDKernel(const SDL_SIMDKernel *kernels);
+
+#endif /* _SDL_cpuinfo_c_h */
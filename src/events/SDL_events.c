@@ -28,6 +28,7 @@
 #include "SDL_sysevents.h"
 #include "SDL_events_c.h"
 #include "../timer/SDL_timer_c.h"
+#include "../video/SDL_present_c.h"
 #if !SDL_JOYSTICK_DISABLED
 #include "../joystick/SDL_joystick_c.h"
 #endif
@@ -104,7 +105,9 @@ static int SDLCALL SDL_GobbleEvents(void *unused)
 
 		/* Get events from the video subsystem */
 		if ( video ) {
+			SDL_LockPresent(video);
 			video->PumpEvents(this);
+			SDL_UnlockPresent(video);
 		}
 
 		/* Queue pending key-repeat events */
@@ -373,7 +376,9 @@ void SDL_PumpEvents(void)
 
 		/* Get events from the video subsystem */
 		if ( video ) {
+			SDL_LockPresent(video);
 			video->PumpEvents(this);
+			SDL_UnlockPresent(video);
 		}
 
 		/* Queue pending key-repeat events */
@@ -131,6 +131,270 @@ static struct {
 	{ "UCS-4",	ENCODING_UCS4 },
 };
 
+/* How each encoding stores the characters below 0x80, which every
+   encoding here has in common, so that runs of them can be copied
+   without decoding and encoding each one.
+ */
+enum {
+	UNITS_NONE,
+	UNITS_8,
+	UNITS_16LE,
+	UNITS_16BE,
+	UNITS_32LE,
+	UNITS_32BE
+};
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+#define UNITS_16NATIVE	UNITS_16BE
+#define UNITS_32NATIVE	UNITS_32BE
+#else
+#define UNITS_16NATIVE	UNITS_16LE
+#define UNITS_32NATIVE	UNITS_32LE
+#endif
+
+static int ascii_units(int format)
+{
+	switch (format) {
+	    case ENCODING_ASCII:
+	    case ENCODING_LATIN1:
+	    case ENCODING_UTF8:
+		return UNITS_8;
+	    case ENCODING_UTF16BE:
+		return UNITS_16BE;
+	    case ENCODING_UTF16LE:
+		return UNITS_16LE;
+	    case ENCODING_UCS2:
+		return UNITS_16NATIVE;
+	    case ENCODING_UTF32BE:
+		return UNITS_32BE;
+	    case ENCODING_UTF32LE:
+		return UNITS_32LE;
+	    case ENCODING_UCS4:
+		return UNITS_32NATIVE;
+	}
+	return UNITS_NONE;
+}
+
+static size_t unit_size(int units)
+{
+	switch (units) {
+	    case UNITS_16LE:
+	    case UNITS_16BE:
+		return 2;
+	    case UNITS_32LE:
+	    case UNITS_32BE:
+		return 4;
+	}
+	return 1;
+}
+
+static Uint32 read_unit(const Uint8 *p, int units)
+{
+	switch (units) {
+	    case UNITS_16LE:
+		return ((Uint32)p[1] << 8) | p[0];
+	    case UNITS_16BE:
+		return ((Uint32)p[0] << 8) | p[1];
+	    case UNITS_32LE:
+		return ((Uint32)p[3] << 24) | ((Uint32)p[2] << 16) |
+		       ((Uint32)p[1] << 8) | p[0];
+	    case UNITS_32BE:
+		return ((Uint32)p[0] << 24) | ((Uint32)p[1] << 16) |
+		       ((Uint32)p[2] << 8) | p[3];
+	}
+	return p[0];
+}
+
+static void write_ascii(Uint8 *p, int units, Uint8 ch)
+{
+	switch (units) {
+	    case UNITS_16LE:
+		p[0] = ch;
+		p[1] = 0;
+		break;
+	    case UNITS_16BE:
+		p[0] = 0;
+		p[1] = ch;
+		break;
+	    case UNITS_32LE:
+		p[0] = ch;
+		p[1] = p[2] = p[3] = 0;
+		break;
+	    case UNITS_32BE:
+		p[0] = p[1] = p[2] = 0;
+		p[3] = ch;
+		break;
+	    default:
+		p[0] = ch;
+		break;
+	}
+}
+
+#if SDL_ASSEMBLY_ROUTINES && defined(__GNUC__) && defined(__SSE2__) && \
+    SDL_BYTEORDER == SDL_LIL_ENDIAN
+#define SSE2_ASCII_RUNS	1
+#include <emmintrin.h>
+#include "../cpuinfo/SDL_cpuinfo_c.h"
+
+/* Copy 16 characters at a time while they're all below 0x80 */
+static size_t ascii_run_sse2(const Uint8 *src, int src_units,
+				Uint8 *dst, int dst_units, size_t count)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i high16 = _mm_set1_epi16((short)0xFF80);
+	const __m128i high32 = _mm_set1_epi32((int)0xFFFFFF80);
+	__m128i a, b, c, d;
+	size_t i = 0;
+
+	if ( src_units == UNITS_8 ) {
+		for ( ; i + 16 <= count; i += 16 ) {
+			a = _mm_loadu_si128((const __m128i *)(src + i));
+			if ( _mm_movemask_epi8(a) ) {
+				break;
+			}
+			switch (dst_units) {
+			    case UNITS_8:
+				_mm_storeu_si128((__m128i *)(dst + i), a);
+				break;
+			    case UNITS_16LE:
+				_mm_storeu_si128((__m128i *)(dst + i*2),
+				                 _mm_unpacklo_epi8(a, zero));
+				_mm_storeu_si128((__m128i *)(dst + i*2 + 16),
+				                 _mm_unpackhi_epi8(a, zero));
+				break;
+			    case UNITS_32LE:
+				b = _mm_unpacklo_epi8(a, zero);
+				c = _mm_unpackhi_epi8(a, zero);
+				_mm_storeu_si128((__m128i *)(dst + i*4),
+				                 _mm_unpacklo_epi16(b, zero));
+				_mm_storeu_si128((__m128i *)(dst + i*4 + 16),
+				                 _mm_unpackhi_epi16(b, zero));
+				_mm_storeu_si128((__m128i *)(dst + i*4 + 32),
+				                 _mm_unpacklo_epi16(c, zero));
+				_mm_storeu_si128((__m128i *)(dst + i*4 + 48),
+				                 _mm_unpackhi_epi16(c, zero));
+				break;
+			    default:
+				return i;
+			}
+		}
+	} else if ( src_units == UNITS_16LE && dst_units == UNITS_8 ) {
+		for ( ; i + 16 <= count; i += 16 ) {
+			a = _mm_loadu_si128((const __m128i *)(src + i*2));
+			b = _mm_loadu_si128((const __m128i *)(src + i*2 + 16));
+			c = _mm_and_si128(_mm_or_si128(a, b), high16);
+			if ( _mm_movemask_epi8(_mm_cmpeq_epi16(c, zero)) != 0xFFFF ) {
+				break;
+			}
+			_mm_storeu_si128((__m128i *)(dst + i),
+			                 _mm_packus_epi16(a, b));
+		}
+	} else if ( src_units == UNITS_32LE && dst_units == UNITS_8 ) {
+		for ( ; i + 16 <= count; i += 16 ) {
+			a = _mm_loadu_si128((const __m128i *)(src + i*4));
+			b = _mm_loadu_si128((const __m128i *)(src + i*4 + 16));
+			c = _mm_loadu_si128((const __m128i *)(src + i*4 + 32));
+			d = _mm_loadu_si128((const __m128i *)(src + i*4 + 48));
+			if ( _mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(
+			         _mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d)),
+			         high32), zero)) != 0xFFFF ) {
+				break;
+			}
+			_mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(
+			                 _mm_packs_epi32(a, b), _mm_packs_epi32(c, d)));
+		}
+	}
+	return i;
+}
+#endif /* SSE2 */
+
+/* Copy the characters below 0x80 at the start of the source, returning
+   how many were copied.
+ */
+static size_t ascii_run(const Uint8 *src, size_t srclen, int src_units,
+			Uint8 *dst, size_t dstlen, int dst_units)
+{
+	size_t count, i = 0;
+	Uint32 ch;
+
+	count = srclen / unit_size(src_units);
+	if ( count > dstlen / unit_size(dst_units) ) {
+		count = dstlen / unit_size(dst_units);
+	}
+#ifdef SSE2_ASCII_RUNS
+	if ( SDL_UseSIMD(CPU_HAS_SSE2) ) {
+		i = ascii_run_sse2(src, src_units, dst, dst_units, count);
+	}
+#endif
+	if ( src_units == UNITS_8 && dst_units == UNITS_8 ) {
+		for ( ; i < count && src[i] < 0x80; ++i ) {
+			dst[i] = src[i];
+		}
+		return i;
+	}
+	for ( ; i < count; ++i ) {
+		ch = read_unit(src + i * unit_size(src_units), src_units);
+		if ( ch >= 0x80 ) {
+			break;
+		}
+		write_ascii(dst + i * unit_size(dst_units), dst_units, (Uint8)ch);
+	}
+	return i;
+}
+
+/* The most bytes that converting 'inbytes' bytes can take, or 0 if the
+   encodings aren't known yet.  Sequences that can't be decoded become
+   U+FFFD, which is 3 bytes of UTF-8, so one bad byte of UTF-8 input can
+   take 3 bytes of output.
+ */
+static size_t SDL_iconv_bound(SDL_iconv_t cd, size_t inbytes)
+{
+	size_t units, out;
+
+	switch (cd->src_fmt) {
+	    case ENCODING_UTF16:
+	    case ENCODING_UTF16BE:
+	    case ENCODING_UTF16LE:
+	    case ENCODING_UCS2:
+		units = 2;
+		break;
+	    case ENCODING_UTF32:
+	    case ENCODING_UTF32BE:
+	    case ENCODING_UTF32LE:
+	    case ENCODING_UCS4:
+		units = 4;
+		break;
+	    default:
+		units = 1;
+		break;
+	}
+	switch (cd->dst_fmt) {
+	    case ENCODING_ASCII:
+	    case ENCODING_LATIN1:
+		out = 1;
+		break;
+	    case ENCODING_UTF8:
+		if ( cd->src_fmt == ENCODING_ASCII ) {
+			out = 1;
+		} else if ( cd->src_fmt == ENCODING_LATIN1 ) {
+			out = 2;
+		} else {
+			out = (units == 4) ? 4 : 3;
+		}
+		break;
+	    case ENCODING_UTF16:
+	    case ENCODING_UTF16BE:
+	    case ENCODING_UTF16LE:
+	    case ENCODING_UCS2:
+		out = (units == 4) ? 4 : 2;
+		break;
+	    default:
+		out = 4;
+		break;
+	}
+	/* Room for a byte order marker */
+	return (inbytes / units + 1) * out + 4;
+}
+
 static const char *getlocale(char *buffer, size_t bufsize)
 {
 	const char *lang;
@@ -214,6 +478,7 @@ size_t SDL_iconv(SDL_iconv_t cd,
 	size_t srclen, dstlen;
 	Uint32 ch = 0;
 	size_t total;
+	int src_units, dst_units;
 
 	if ( !inbuf || !*inbuf ) {
 		/* Reset the context */
@@ -300,7 +565,51 @@ size_t SDL_iconv(SDL_iconv_t cd,
 	}
 
 	total = 0;
+	src_units = ascii_units(cd->src_fmt);
+	dst_units = ascii_units(cd->dst_fmt);
+
+	/* These convert every character to itself */
+	if ( cd->src_fmt == cd->dst_fmt &&
+	     (cd->src_fmt == ENCODING_LATIN1 || cd->src_fmt == ENCODING_UCS2) ) {
+		size_t len = srclen - (srclen % unit_size(src_units));
+		if ( len > dstlen ) {
+			len = dstlen - (dstlen % unit_size(src_units));
+		}
+		SDL_memcpy(dst, src, len);
+		src += len;
+		srclen -= len;
+		dst += len;
+		dstlen -= len;
+		total = len / unit_size(src_units);
+		*inbuf = src;
+		*inbytesleft = srclen;
+		*outbuf = dst;
+		*outbytesleft = dstlen;
+	}
+
 	while ( srclen > 0 ) {
+		/* Copy characters below 0x80 straight across */
+		if ( src_units != UNITS_NONE && dst_units != UNITS_NONE &&
+		     srclen >= unit_size(src_units) &&
+		     read_unit((const Uint8 *)src, src_units) < 0x80 ) {
+			size_t n = ascii_run((const Uint8 *)src, srclen, src_units,
+			                     (Uint8 *)dst, dstlen, dst_units);
+			if ( n > 0 ) {
+				src += n * unit_size(src_units);
+				srclen -= n * unit_size(src_units);
+				dst += n * unit_size(dst_units);
+				dstlen -= n * unit_size(dst_units);
+				total += n;
+				*inbuf = src;
+				*inbytesleft = srclen;
+				*outbuf = dst;
+				*outbytesleft = dstlen;
+				if ( srclen == 0 ) {
+					break;
+				}
+			}
+		}
+
 		/* Decode a character */
 		switch ( cd->src_fmt ) {
 		    case ENCODING_ASCII:
@@ -836,15 +1145,22 @@ char *SDL_iconv_string(const char *tocode, const char *fromcode, const char *inb
 		return NULL;
 	}
 
+	/* The converted string is followed by a 4 byte terminator, enough
+	   for any encoding.  SDL's own converter knows the most room it can
+	   need, so it converts in one pass, and the string is trimmed after.
+	 */
+#ifdef HAVE_ICONV
 	stringsize = inbytesleft > 4 ? inbytesleft : 4;
-	string = SDL_malloc(stringsize);
+#else
+	stringsize = SDL_iconv_bound(cd, inbytesleft);
+#endif
+	string = SDL_malloc(stringsize + 4);
 	if ( !string ) {
 		SDL_iconv_close(cd);
 		return NULL;
 	}
 	outbuf = string;
 	outbytesleft = stringsize;
-	SDL_memset(outbuf, 0, 4);
 
 	while ( inbytesleft > 0 ) {
 		retCode = SDL_iconv(cd, &inbuf, &inbytesleft, &outbuf, &outbytesleft);
@@ -853,7 +1169,7 @@ char *SDL_iconv_string(const char *tocode, const char *fromcode, const char *inb
 			{
 				char *oldstring = string;
 				stringsize *= 2;
-				string = SDL_realloc(string, stringsize);
+				string = SDL_realloc(string, stringsize + 4);
 				if ( !string ) {
 					SDL_free(oldstring);
 					SDL_iconv_close(cd);
@@ -861,7 +1177,6 @@ char *SDL_iconv_string(const char *tocode, const char *fromcode, const char *inb
 				}
 				outbuf = string + (outbuf - oldstring);
 				outbytesleft = stringsize - (outbuf - string);
-				SDL_memset(outbuf, 0, 4);
 			}
 			break;
 		    case SDL_ICONV_EILSEQ:
@@ -876,6 +1191,13 @@ char *SDL_iconv_string(const char *tocode, const char *fromcode, const char *inb
 			break;
 		}
 	}
+	SDL_memset(outbuf, 0, 4);
+	if ( outbytesleft > 0 ) {
+		char *trimmed = SDL_realloc(string, (outbuf - string) + 4);
+		if ( trimmed ) {
+			string = trimmed;
+		}
+	}
 	SDL_iconv_close(cd);
 
 	return string;
@@ -21,29 +21,39 @@
 
 #include "SDL_config.h"
 
-#ifndef HAVE_QSORT
 #include "SDL_stdinc.h"
+#include "SDL_error.h"
 
 #ifdef assert
 #undef assert
 #endif
 #define assert(X)
+/* Only where the C library doesn't have them, or SDL_malloc() and the
+   rest are the very macros being defined here */
+#ifndef HAVE_MALLOC
 #ifdef malloc
 #undef malloc
 #endif
 #define malloc SDL_malloc
+#endif
+#ifndef HAVE_FREE
 #ifdef free
 #undef free
 #endif
 #define free SDL_free
+#endif
+#ifndef HAVE_MEMCPY
 #ifdef memcpy
 #undef memcpy
 #endif
 #define memcpy SDL_memcpy
+#endif
+#ifndef HAVE_MEMMOVE
 #ifdef memmove
 #undef memmove
 #endif
 #define memmove SDL_memmove
+#endif
 #ifdef qsortG
 #undef qsortG
 #endif
@@ -53,8 +63,9 @@
 This code came from Gareth McCaughan, under the zlib license.
 Specifically this: https://www.mccaughan.org.uk/software/qsort.c-1.15
 
-Everything below this comment until the HAVE_QSORT #endif was from Gareth
-(any minor changes will be noted inline).
+Everything below this comment until SDL_RadixSort32() was from Gareth
+(any minor changes will be noted inline).  SDL uses it even where the C
+library has a qsort(), so it behaves the same everywhere.
 
 Thank you to Gareth for relicensing this code under the zlib license for our
 benefit!
@@ -165,9 +176,18 @@ static char _ID[]="<qsort.c gjm 1.15 2016-03-10>";
  * value might work well for the other two cases. Of course
  * what works well on my machine might work badly on yours.
  */
-#define TRUNC_nonaligned	12
-#define TRUNC_aligned		12
-#define TRUNC_words		12*WORD_BYTES	/* nb different meaning */
+/* BEGIN SDL CHANGE ... the cutoff shrinks as elements get bigger, since
+   insertion sort moves every element it passes over. */
+#define TRUNC_nonaligned	trunc_for_size(size)
+#define TRUNC_aligned		trunc_for_size(size)
+#define TRUNC_words		16*WORD_BYTES	/* nb different meaning */
+
+static size_t trunc_for_size(size_t size) {
+  if (size<=2*WORD_BYTES) return 20;
+  if (size<=8*WORD_BYTES) return 12;
+  return 8;
+}
+/* END SDL CHANGE ... the cutoff shrinks as elements get bigger. */
 
 /* We use a simple pivoting algorithm for shortish sub-arrays
  * and a more complicated one for larger ones. The threshold
@@ -175,16 +195,37 @@ static char _ID[]="<qsort.c gjm 1.15 2016-03-10>";
  */
 #define PIVOT_THRESHOLD 40
 
-typedef struct { char * first; char * last; } stack_entry;
-#define pushLeft {stack[stacktop].first=ffirst;stack[stacktop++].last=last;}
-#define pushRight {stack[stacktop].first=first;stack[stacktop++].last=llast;}
+/* BEGIN SDL CHANGE ... each subarray remembers how many more times it
+   may be partitioned before it's heapsorted instead, so no input can
+   make this take time of order n^2 (introsort). */
+typedef struct { char * first; char * last; int depth; } stack_entry;
+#define pushLeft {stack[stacktop].first=ffirst;stack[stacktop].last=last;\
+  stack[stacktop++].depth=depth;}
+#define pushRight {stack[stacktop].first=first;stack[stacktop].last=llast;\
+  stack[stacktop++].depth=depth;}
 #define doLeft {first=ffirst;llast=last;continue;}
 #define doRight {ffirst=first;last=llast;continue;}
 #define pop {if (--stacktop<0) break;\
   first=ffirst=stack[stacktop].first;\
   last=llast=stack[stacktop].last;\
+  depth=stack[stacktop].depth;\
   continue;}
 
+/* Twice the number of times n can be halved */
+static int depth_limit(size_t nmemb) {
+  int depth=0;
+  while (nmemb>1) { nmemb>>=1; depth+=2; }
+  return depth;
+}
+
+/* Give up on partitioning a subarray that has been split too unevenly */
+#define Introspect(sz)				\
+  if (depth--==0) {				\
+    heapsort_range(first,(last-first)/sz+1,sz,compare);\
+    pop						\
+  }
+/* END SDL CHANGE ... each subarray remembers how many more times. */
+
 /* Some comments on the implementation.
  * 1. When we finish partitioning the array into "low"
  *    and "high", we forget entirely about short subarrays,
@@ -338,10 +379,21 @@ typedef struct { char * first; char * last; } stack_entry;
     }						\
   }
 
-#define SWAP_nonaligned(a,b) { \
-  register char *aa=(a),*bb=(b); \
-  register size_t sz=size; \
-  do { register char t=*aa; *aa++=*bb; *bb++=t; } while (--sz); }
+/* BEGIN SDL CHANGE ... swap odd sizes a block at a time, rather than
+   a byte at a time. */
+#define SWAP_nonaligned(a,b) { swap_bytes((a),(b),size); }
+
+#define SWAP_BLOCK 32
+
+static void swap_bytes(char *a, char *b, size_t size) {
+  char t[SWAP_BLOCK];
+  while (size>=SWAP_BLOCK) {
+    memcpy(t,a,SWAP_BLOCK); memcpy(a,b,SWAP_BLOCK); memcpy(b,t,SWAP_BLOCK);
+    a+=SWAP_BLOCK; b+=SWAP_BLOCK; size-=SWAP_BLOCK;
+  }
+  if (size) { memcpy(t,a,size); memcpy(a,b,size); memcpy(b,t,size); }
+}
+/* END SDL CHANGE ... swap odd sizes a block at a time. */
 
 #define SWAP_aligned(a,b) { \
   register int *aa=(int*)(a),*bb=(int*)(b); \
@@ -353,9 +405,37 @@ typedef struct { char * first; char * last; } stack_entry;
 
 /* ---------------------------------------------------------------------- */
 
+/* BEGIN SDL CHANGE ... the heapsort used when partitioning goes badly.
+   It's only reached on hostile or unlucky input, so it isn't specialised
+   for the different element sizes. */
+static void sift_down(char *base, size_t root, size_t nmemb, size_t size,
+                      int (*compare)(const void *, const void *)) {
+  size_t child;
+  while ((child=2*root+1)<nmemb) {
+    if (child+1<nmemb && compare(base+child*size,base+(child+1)*size)<0)
+      ++child;
+    if (compare(base+root*size,base+child*size)>=0) return;
+    swap_bytes(base+root*size,base+child*size,size);
+    root=child;
+  }
+}
+
+static void heapsort_range(char *base, size_t nmemb, size_t size,
+                           int (*compare)(const void *, const void *)) {
+  size_t i;
+  for (i=nmemb/2;i>0;--i) sift_down(base,i-1,nmemb,size,compare);
+  for (i=nmemb-1;i>0;--i) {
+    swap_bytes(base,base+i*size,size);
+    sift_down(base,0,i,size,compare);
+  }
+}
+/* END SDL CHANGE ... the heapsort used when partitioning goes badly. */
+
+/* ---------------------------------------------------------------------- */
+
 static char * pivot_big(char *first, char *mid, char *last, size_t size,
                         int compare(const void *, const void *)) {
-  int d=(((last-first)/size)>>3)*size;
+  size_t d=(((last-first)/size)>>3)*size;	/* SDL CHANGE: was int */
 #ifdef DEBUG_QSORT
 fprintf(stderr, "pivot_big: first=%p last=%p size=%lu n=%lu\n", first, (unsigned long)last, size, (unsigned long)((last-first+1)/size));
 #endif
@@ -402,6 +482,7 @@ static void qsort_nonaligned(void *base, size_t nmemb, size_t size,
   char *first,*last;
   char *pivot=malloc(size);
   size_t trunc=TRUNC_nonaligned*size;
+  int depth=depth_limit(nmemb);
   assert(pivot!=0);
 
   first=(char*)base; last=first+(nmemb-1)*size;
@@ -409,6 +490,7 @@ static void qsort_nonaligned(void *base, size_t nmemb, size_t size,
   if (last-first>=trunc) {
     char *ffirst=first, *llast=last;
     while (1) {
+      Introspect(size)
       /* Select pivot */
       { char * mid=first+size*((last-first)/size >> 1);
         Pivot(SWAP_nonaligned,size);
@@ -433,6 +515,7 @@ static void qsort_aligned(void *base, size_t nmemb, size_t size,
   char *first,*last;
   char *pivot=malloc(size);
   size_t trunc=TRUNC_aligned*size;
+  int depth=depth_limit(nmemb);
   assert(pivot!=0);
 
   first=(char*)base; last=first+(nmemb-1)*size;
@@ -440,6 +523,7 @@ static void qsort_aligned(void *base, size_t nmemb, size_t size,
   if (last-first>=trunc) {
     char *ffirst=first,*llast=last;
     while (1) {
+      Introspect(size)
       /* Select pivot */
       { char * mid=first+size*((last-first)/size >> 1);
         Pivot(SWAP_aligned,size);
@@ -463,6 +547,7 @@ static void qsort_words(void *base, size_t nmemb,
   int stacktop=0;
   char *first,*last;
   char *pivot=malloc(WORD_BYTES);
+  int depth=depth_limit(nmemb);
   assert(pivot!=0);
 
   first=(char*)base; last=first+(nmemb-1)*WORD_BYTES;
@@ -470,6 +555,7 @@ static void qsort_words(void *base, size_t nmemb,
   if (last-first>=TRUNC_words) {
     char *ffirst=first, *llast=last;
     while (1) {
+      Introspect(WORD_BYTES)
 #ifdef DEBUG_QSORT
 fprintf(stderr,"Doing %d:%d: ",
         (first-(char*)base)/WORD_BYTES,
@@ -512,7 +598,7 @@ extern void qsortG(void *base, size_t nmemb, size_t size,
            int (*compare)(const void *, const void *)) {
 
   if (nmemb<=1) return;
-  if (((int)base|size)&(WORD_BYTES-1))
+  if (((size_t)base|size)&(WORD_BYTES-1))	/* SDL CHANGE: was (int)base */
     qsort_nonaligned(base,nmemb,size,compare);
   else if (size!=WORD_BYTES)
     qsort_aligned(base,nmemb,size,compare);
@@ -520,7 +606,148 @@ extern void qsortG(void *base, size_t nmemb, size_t size,
     qsort_words(base,nmemb,compare);
 }
 
-#endif /* ifndef HAVE_QSORT */
+/* ---------------------------------------------------------------------- */
+
+/* SDL_RadixSort32() is a least significant byte first radix sort, so it
+   keeps elements with equal keys in order.  The four byte histograms are
+   counted in a single pass, and a byte that's the same in every key gets
+   no pass of its own, so keys that only use their low bits (like layer
+   numbers) are sorted in one or two passes.
+ */
+
+/* Below this many elements an insertion sort is quicker */
+#define RADIX_SMALL	48
+
+/* The biggest element the insertion sort will hold on the stack */
+#define RADIX_SMALL_SIZE	64
+
+static __inline__ Uint32 radix_key(const Uint8 *elem, size_t offset, int aligned)
+{
+	Uint32 key;
+
+	if ( aligned ) {
+		return *(const Uint32 *)(elem + offset);
+	}
+	SDL_memcpy(&key, elem + offset, sizeof(key));
+	return key;
+}
+
+static void radix_insertion_sort(Uint8 *base, size_t nmemb, size_t size,
+                                 size_t offset, int aligned)
+{
+	Uint8 elem[RADIX_SMALL_SIZE];
+	Uint8 *p, *q;
+	Uint32 key;
+	size_t i;
+
+	for ( i = 1; i < nmemb; ++i ) {
+		p = base + i * size;
+		key = radix_key(p, offset, aligned);
+		if ( radix_key(p - size, offset, aligned) <= key ) {
+			continue;
+		}
+		SDL_memcpy(elem, p, size);
+		q = p - size;
+		while ( q > base && radix_key(q - size, offset, aligned) > key ) {
+			q -= size;
+		}
+		SDL_memmove(q + size, q, p - q);
+		SDL_memcpy(q, elem, size);
+	}
+}
+
+/* Move every element to its place by one byte of its key */
+static void radix_scatter(const Uint8 *src, Uint8 *dst, size_t nmemb,
+                          size_t size, size_t offset, int aligned,
+                          int shift, size_t *place)
+{
+	const Uint8 *end = src + nmemb * size;
+	Uint32 key;
+
+	if ( aligned && size == sizeof(Uint32) ) {
+		for ( ; src != end; src += sizeof(Uint32) ) {
+			key = *(const Uint32 *)src;
+			((Uint32 *)dst)[place[(key >> shift) & 0xFF]++] = key;
+		}
+#ifdef SDL_HAS_64BIT_TYPE
+	} else if ( aligned && size == sizeof(Uint64) &&
+	            ((((size_t)src | (size_t)dst) & (sizeof(Uint64)-1)) == 0) ) {
+		for ( ; src != end; src += sizeof(Uint64) ) {
+			key = *(const Uint32 *)(src + offset);
+			((Uint64 *)dst)[place[(key >> shift) & 0xFF]++] = *(const Uint64 *)src;
+		}
+#endif
+	} else {
+		for ( ; src != end; src += size ) {
+			key = radix_key(src, offset, aligned);
+			SDL_memcpy(dst + place[(key >> shift) & 0xFF]++ * size, src, size);
+		}
+	}
+}
+
+int SDL_RadixSort32(void *base, size_t nmemb, size_t size, size_t offset)
+{
+	size_t count[4][256];
+	size_t place[256];
+	Uint8 *src, *dst, *scratch, *p, *end;
+	Uint32 key, first;
+	size_t total;
+	int aligned, byte, i;
+
+	if ( nmemb <= 1 ) {
+		return(0);
+	}
+	if ( size < offset + sizeof(Uint32) ) {
+		SDL_SetError("The sort key doesn't fit in the element");
+		return(-1);
+	}
+	aligned = (((((size_t)base + offset) | size) & (sizeof(Uint32)-1)) == 0);
+
+	if ( nmemb < RADIX_SMALL && size <= RADIX_SMALL_SIZE ) {
+		radix_insertion_sort((Uint8 *)base, nmemb, size, offset, aligned);
+		return(0);
+	}
+
+	SDL_memset(count, 0, sizeof(count));
+	end = (Uint8 *)base + nmemb * size;
+	for ( p = (Uint8 *)base; p != end; p += size ) {
+		key = radix_key(p, offset, aligned);
+		++count[0][key & 0xFF];
+		++count[1][(key >> 8) & 0xFF];
+		++count[2][(key >> 16) & 0xFF];
+		++count[3][key >> 24];
+	}
+
+	scratch = NULL;
+	src = (Uint8 *)base;
+	first = radix_key(src, offset, aligned);
+	for ( byte = 0; byte < 4; ++byte ) {
+		if ( count[byte][(first >> (byte * 8)) & 0xFF] == nmemb ) {
+			/* Every key has the same value in this byte */
+			continue;
+		}
+		if ( scratch == NULL ) {
+			scratch = (Uint8 *)SDL_malloc(nmemb * size);
+			if ( scratch == NULL ) {
+				SDL_OutOfMemory();
+				return(-1);
+			}
+		}
+		total = 0;
+		for ( i = 0; i < 256; ++i ) {
+			place[i] = total;
+			total += count[byte][i];
+		}
+		dst = (src == base) ? scratch : (Uint8 *)base;
+		radix_scatter(src, dst, nmemb, size, offset, aligned, byte * 8, place);
+		src = dst;
+	}
+	if ( src != base ) {
+		SDL_memcpy(base, src, nmemb * size);
+	}
+	SDL_free(scratch);
+	return(0);
+}
 
 /* vi: set ts=4 sw=4 expandtab: */
 
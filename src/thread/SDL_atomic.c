@@ -0,0 +1,51 @@
+/*
+    SDL - Simple DirectMedia Layer
+    Copyright (C) 1997-2012 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+#include "SDL_config.h"
+
+/* Lock based atomic operations, for compilers without atomic builtins */
+
+#include "SDL_mutex.h"
+#include "SDL_atomic_c.h"
+
+#ifdef SDL_ATOMIC_LOCKED
+
+static SDL_mutex *atomic_lock = NULL;
+
+void SDL_AtomicLock(void)
+{
+	/* WARNING:
+	   Like the thread list lock, this is created on first use, which is
+	   safe as long as the first atomic operation happens before there
+	   is more than one thread using them.
+	*/
+	if ( !atomic_lock ) {
+		atomic_lock = SDL_CreateMutex();
+	}
+	SDL_mutexP(atomic_lock);
+}
+
+void SDL_AtomicUnlock(void)
+{
+	SDL_mutexV(atomic_lock);
+}
+
+#endif /* SDL_ATOMIC_LOCKED */
@@ -0,0 +1,254 @@
+/*
+    SDL - Simple DirectMedia Layer
+    Copyright (C) 1997-2012 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+#include "SDL_config.h"
+
+#ifndef _SDL_atomic_c_h
+#define _SDL_atomic_c_h
+
+/* Atomic operations used inside SDL to hand data between threads without
+   taking a lock.  All of these except the plain loads are full memory
+   barriers.  Compilers without atomic builtins fall back to a global lock.
+ */
+
+#include "SDL_stdinc.h"
+
+#if SDL_THREADS_DISABLED
+#define SDL_ATOMIC_NONE
+#elif defined(__GNUC__) && defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_4) && \
+      ((__SIZEOF_POINTER__ == 4) || defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_8))
+#define SDL_ATOMIC_GCC
+#elif defined(_MSC_VER) && (_MSC_VER >= 1400)
+#define SDL_ATOMIC_MSVC
+#include <intrin.h>
+#pragma intrinsic(_InterlockedCompareExchange)
+#pragma intrinsic(_InterlockedExchangeAdd)
+#pragma intrinsic(_ReadWriteBarrier)
+#ifdef _WIN64
+#pragma intrinsic(_InterlockedCompareExchangePointer)
+#endif
+#else
+#define SDL_ATOMIC_LOCKED
+#endif
+
+#if defined(SDL_ATOMIC_GCC)
+
+#define SDL_MemoryBarrier()	__sync_synchronize()
+
+static __inline__ SDL_bool SDL_AtomicCAS(volatile int *ptr, int oldval, int newval)
+{
+	return __sync_bool_compare_and_swap(ptr, oldval, newval) ? SDL_TRUE : SDL_FALSE;
+}
+
+static __inline__ SDL_bool SDL_AtomicCASPtr(void * volatile *ptr, void *oldval, void *newval)
+{
+	return __sync_bool_compare_and_swap(ptr, oldval, newval) ? SDL_TRUE : SDL_FALSE;
+}
+
+static __inline__ int SDL_AtomicAdd(volatile int *ptr, int value)
+{
+	return __sync_fetch_and_add(ptr, value);
+}
+
+#ifdef __ATOMIC_ACQUIRE
+static __inline__ int SDL_AtomicGet(volatile int *ptr)
+{
+	return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+}
+
+static __inline__ void *SDL_AtomicGetPtr(void * volatile *ptr)
+{
+	return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+}
+#else
+static __inline__ int SDL_AtomicGet(volatile int *ptr)
+{
+	int value = *ptr;
+	__sync_synchronize();
+	return value;
+}
+
+static __inline__ void *SDL_AtomicGetPtr(void * volatile *ptr)
+{
+	void *value = *ptr;
+	__sync_synchronize();
+	return value;
+}
+#endif /* __ATOMIC_ACQUIRE */
+
+#elif defined(SDL_ATOMIC_MSVC)
+
+#define SDL_MemoryBarrier()	_ReadWriteBarrier()
+
+static __inline__ SDL_bool SDL_AtomicCAS(volatile int *ptr, int oldval, int newval)
+{
+	return (_InterlockedCompareExchange((volatile long *)ptr, newval, oldval) == oldval) ? SDL_TRUE : SDL_FALSE;
+}
+
+static __inline__ SDL_bool SDL_AtomicCASPtr(void * volatile *ptr, void *oldval, void *newval)
+{
+#ifdef _WIN64
+	return (_InterlockedCompareExchangePointer(ptr, newval, oldval) == oldval) ? SDL_TRUE : SDL_FALSE;
+#else
+	return (_InterlockedCompareExchange((volatile long *)ptr, (long)newval, (long)oldval) == (long)oldval) ? SDL_TRUE : SDL_FALSE;
+#endif
+}
+
+static __inline__ int SDL_AtomicAdd(volatile int *ptr, int value)
+{
+	return _InterlockedExchangeAdd((volatile long *)ptr, value);
+}
+
+static __inline__ int SDL_AtomicGet(volatile int *ptr)
+{
+	int value = *ptr;
+	_ReadWriteBarrier();
+	return value;
+}
+
+static __inline__ void *SDL_AtomicGetPtr(void * volatile *ptr)
+{
+	void *value = *ptr;
+	_ReadWriteBarrier();
+	return value;
+}
+
+#elif defined(SDL_ATOMIC_LOCKED)
+
+/* These are in SDL_atomic.c */
+extern void SDL_AtomicLock(void);
+extern void SDL_AtomicUnlock(void);
+
+#define SDL_MemoryBarrier()	do { SDL_AtomicLock(); SDL_AtomicUnlock(); } while (0)
+
+static __inline__ SDL_bool SDL_AtomicCAS(volatile int *ptr, int oldval, int newval)
+{
+	SDL_bool retval = SDL_FALSE;
+
+	SDL_AtomicLock();
+	if ( *ptr == oldval ) {
+		*ptr = newval;
+		retval = SDL_TRUE;
+	}
+	SDL_AtomicUnlock();
+	return retval;
+}
+
+static __inline__ SDL_bool SDL_AtomicCASPtr(void * volatile *ptr, void *oldval, void *newval)
+{
+	SDL_bool retval = SDL_FALSE;
+
+	SDL_AtomicLock();
+	if ( *ptr == oldval ) {
+		*ptr = newval;
+		retval = SDL_TRUE;
+	}
+	SDL_AtomicUnlock();
+	return retval;
+}
+
+static __inline__ int SDL_AtomicAdd(volatile int *ptr, int value)
+{
+	int oldval;
+
+	SDL_AtomicLock();
+	oldval = *ptr;
+	*ptr = oldval + value;
+	SDL_AtomicUnlock();
+	return oldval;
+}
+
+static __inline__ int SDL_AtomicGet(volatile int *ptr)
+{
+	int value;
+
+	SDL_AtomicLock();
+	value = *ptr;
+	SDL_AtomicUnlock();
+	return value;
+}
+
+static __inline__ void *SDL_AtomicGetPtr(void * volatile *ptr)
+{
+	void *value;
+
+	SDL_AtomicLock();
+	value = *ptr;
+	SDL_AtomicUnlock();
+	return value;
+}
+
+#else /* SDL_ATOMIC_NONE */
+
+#define SDL_MemoryBarrier()
+
+static __inline__ SDL_bool SDL_AtomicCAS(volatile int *ptr, int oldval, int newval)
+{
+	if ( *ptr == oldval ) {
+		*ptr = newval;
+		return SDL_TRUE;
+	}
+	return SDL_FALSE;
+}
+
+static __inline__ SDL_bool SDL_AtomicCASPtr(void * volatile *ptr, void *oldval, void *newval)
+{
+	if ( *ptr == oldval ) {
+		*ptr = newval;
+		return SDL_TRUE;
+	}
+	return SDL_FALSE;
+}
+
+static __inline__ int SDL_AtomicAdd(volatile int *ptr, int value)
+{
+	int oldval = *ptr;
+	*ptr = oldval + value;
+	return oldval;
+}
+
+#define SDL_AtomicGet(ptr)	(*(ptr))
+#define SDL_AtomicGetPtr(ptr)	(*(ptr))
+
+#endif
+
+/* Store a new value, returning the old one */
+static __inline__ int SDL_AtomicSet(volatile int *ptr, int value)
+{
+	int oldval;
+
+	do {
+		oldval = *ptr;
+	} while ( !SDL_AtomicCAS(ptr, oldval, value) );
+	return oldval;
+}
+
+static __inline__ void *SDL_AtomicSetPtr(void * volatile *ptr, void *value)
+{
+	void *oldval;
+
+	do {
+		oldval = *ptr;
+	} while ( !SDL_AtomicCASPtr(ptr, oldval, value) );
+	return oldval;
+}
+
+#endif /* _SDL_atomic_c_h */
@@ -0,0 +1,597 @@
+/*
+    SDL - Simple DirectMedia Layer
+    Copyright (C) 1997-2012 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+#include "SDL_config.h"
+
+/* The job pool: worker threads that each own a work-stealing deque.
+
+   A job started on a worker goes on the bottom of that worker's deque,
+   where the worker takes it back first (most recent first, while its
+   data is still in the cache).  Idle workers steal from the top of the
+   other deques.  Jobs started on any other thread go on a shared queue
+   under the pool lock.  The deques are the lock-free ones of Chase and
+   Lev, in a fixed ring; a worker with a full deque uses the shared queue.
+
+   'queued' counts the jobs in all the queues.  Threads with nothing to do
+   sleep on the pool's condition variable until it's non-zero, or until
+   the job they're waiting for finishes.
+ */
+
+#include "SDL_timer.h"
+#include "SDL_thread.h"
+#include "SDL_cpuinfo.h"
+#include "SDL_hints.h"
+#include "SDL_jobs.h"
+#include "SDL_jobs_c.h"
+#include "SDL_atomic_c.h"
+
+#define MAX_JOB_THREADS	64
+#define JOB_DEQUE_SIZE	1024	/* A power of two */
+#define JOB_SPINS	64	/* Times to look for work before sleeping */
+
+/* How many pieces SDL_ParallelFor() makes for each thread */
+#define PIECES_PER_THREAD	4
+
+struct SDL_Job {
+	SDL_JobFunction func;
+	void *data;
+	volatile int refs;	/* The handle, and the pool until it's run */
+	volatile int pending;	/* Not started, and unfinished dependencies */
+	volatile int started;
+	volatile int done;
+	void * volatile dependents;	/* JobLinks, or JOB_CLOSED when done */
+	SDL_Job *next;		/* In the shared queue */
+};
+
+/* A job waiting for another one to finish */
+typedef struct JobLink {
+	SDL_Job *job;
+	struct JobLink *next;
+} JobLink;
+
+static char job_closed;
+#define JOB_CLOSED	((void *)&job_closed)
+
+typedef struct JobDeque {
+	volatile int top;	/* Where other threads steal from */
+	volatile int bottom;	/* Where the owner pushes and pops */
+	void * volatile jobs[JOB_DEQUE_SIZE];
+} JobDeque;
+
+typedef struct JobWorker {
+	SDL_Thread *thread;
+	Uint32 threadid;
+	int index;
+	JobDeque deque;
+} JobWorker;
+
+static struct {
+	volatile int state;	/* 0 stopped, 1 starting, 2 running */
+	volatile int num_workers;
+	JobWorker *workers;
+	SDL_mutex *lock;
+	SDL_cond *wake;
+	SDL_Job *head, *tail;	/* The shared queue, under the lock */
+	volatile int shared;	/* Jobs in the shared queue */
+	volatile int queued;	/* Jobs in all the queues */
+	volatile int sleepers;	/* Threads sleeping on 'wake' */
+	volatile int waiters;	/* ... of which are waiting for a job */
+	volatile int quit;
+} pool;
+
+/* The deques count up forever, so compare positions by their difference */
+#define DEQUE_DIFF(a, b)	((int)((unsigned int)(a) - (unsigned int)(b)))
+#define DEQUE_SLOT(d, i)	(&(d)->jobs[(unsigned int)(i) & (JOB_DEQUE_SIZE-1)])
+
+/* The owner adds a job to the bottom */
+static int SDL_PushJob(JobDeque *deque, SDL_Job *job)
+{
+	int bottom = SDL_AtomicGet(&deque->bottom);
+	int top = SDL_AtomicGet(&deque->top);
+
+	if ( DEQUE_DIFF(bottom, top) >= JOB_DEQUE_SIZE ) {
+		return(-1);
+	}
+	SDL_AtomicSetPtr(DEQUE_SLOT(deque, bottom), job);
+	SDL_AtomicSet(&deque->bottom, (int)((unsigned int)bottom + 1));
+	return(0);
+}
+
+/* The owner takes a job back from the bottom */
+static SDL_Job *SDL_PopJob(JobDeque *deque)
+{
+	int bottom = (int)((unsigned int)SDL_AtomicGet(&deque->bottom) - 1);
+	int top;
+	SDL_Job *job;
+
+	SDL_AtomicSet(&deque->bottom, bottom);
+	top = SDL_AtomicGet(&deque->top);
+	if ( DEQUE_DIFF(bottom, top) < 0 ) {
+		/* It was empty */
+		SDL_AtomicSet(&deque->bottom, top);
+		return(NULL);
+	}
+	job = (SDL_Job *)SDL_AtomicGetPtr(DEQUE_SLOT(deque, bottom));
+	if ( bottom != top ) {
+		return(job);
+	}
+	/* That was the last one, which a thief might be taking too */
+	if ( !SDL_AtomicCAS(&deque->top, top, (int)((unsigned int)top + 1)) ) {
+		job = NULL;
+	}
+	SDL_AtomicSet(&deque->bottom, (int)((unsigned int)top + 1));
+	return(job);
+}
+
+/* Any other thread takes a job from the top */
+static SDL_Job *SDL_StealJob(JobDeque *deque)
+{
+	int top = SDL_AtomicGet(&deque->top);
+	int bottom;
+	SDL_Job *job;
+
+	SDL_MemoryBarrier();
+	bottom = SDL_AtomicGet(&deque->bottom);
+	if ( DEQUE_DIFF(bottom, top) <= 0 ) {
+		return(NULL);
+	}
+	job = (SDL_Job *)SDL_AtomicGetPtr(DEQUE_SLOT(deque, top));
+	if ( !SDL_AtomicCAS(&deque->top, top, (int)((unsigned int)top + 1)) ) {
+		/* Someone else got it */
+		return(NULL);
+	}
+	return(job);
+}
+
+/* The worker this thread is, or NULL */
+static JobWorker *SDL_CurrentWorker(void)
+{
+	int i, num_workers = SDL_AtomicGet(&pool.num_workers);
+	Uint32 threadid;
+
+	if ( num_workers == 0 ) {
+		return(NULL);
+	}
+	threadid = SDL_ThreadID();
+	for ( i = 0; i < num_workers; ++i ) {
+		if ( pool.workers[i].threadid == threadid ) {
+			return(&pool.workers[i]);
+		}
+	}
+	return(NULL);
+}
+
+static void SDL_UnrefJob(SDL_Job *job)
+{
+	if ( SDL_AtomicAdd(&job->refs, -1) == 1 ) {
+		SDL_free(job);
+	}
+}
+
+static void SDL_RunJob(SDL_Job *job);
+
+/* Put a job whose dependencies have finished where a thread will run it */
+static void SDL_QueueJob(SDL_Job *job)
+{
+	JobWorker *self;
+
+	if ( SDL_AtomicGet(&pool.num_workers) == 0 ) {
+		SDL_RunJob(job);
+		return;
+	}
+
+	SDL_AtomicAdd(&pool.queued, 1);
+	self = SDL_CurrentWorker();
+	if ( self == NULL || SDL_PushJob(&self->deque, job) < 0 ) {
+		SDL_mutexP(pool.lock);
+		job->next = NULL;
+		if ( pool.tail ) {
+			pool.tail->next = job;
+		} else {
+			pool.head = job;
+		}
+		pool.tail = job;
+		SDL_AtomicAdd(&pool.shared, 1);
+		SDL_mutexV(pool.lock);
+	}
+	if ( SDL_AtomicGet(&pool.sleepers) > 0 ) {
+		SDL_mutexP(pool.lock);
+		SDL_CondSignal(pool.wake);
+		SDL_mutexV(pool.lock);
+	}
+}
+
+/* Count off one reason for a job not to run yet */
+static void SDL_ReleaseJob(SDL_Job *job)
+{
+	if ( SDL_AtomicAdd(&job->pending, -1) == 1 ) {
+		SDL_QueueJob(job);
+	}
+}
+
+static void SDL_RunJob(SDL_Job *job)
+{
+	JobLink *link, *next;
+
+	job->func(job->data);
+
+	/* Let the jobs waiting for this one go */
+	link = (JobLink *)SDL_AtomicSetPtr(&job->dependents, JOB_CLOSED);
+	while ( link ) {
+		next = link->next;
+		SDL_ReleaseJob(link->job);
+		SDL_free(link);
+		link = next;
+	}
+
+	SDL_AtomicSet(&job->done, 1);
+	if ( SDL_AtomicGet(&pool.waiters) > 0 ) {
+		SDL_mutexP(pool.lock);
+		SDL_CondBroadcast(pool.wake);
+		SDL_mutexV(pool.lock);
+	}
+	SDL_UnrefJob(job);
+}
+
+/* Take a job from anywhere, starting with this worker's own deque */
+static SDL_Job *SDL_FindJob(JobWorker *self)
+{
+	SDL_Job *job = NULL;
+	int i, num_workers;
+
+	if ( self ) {
+		job = SDL_PopJob(&self->deque);
+	}
+	if ( job == NULL && SDL_AtomicGet(&pool.shared) > 0 ) {
+		SDL_mutexP(pool.lock);
+		job = pool.head;
+		if ( job ) {
+			pool.head = job->next;
+			if ( pool.head == NULL ) {
+				pool.tail = NULL;
+			}
+			SDL_AtomicAdd(&pool.shared, -1);
+		}
+		SDL_mutexV(pool.lock);
+	}
+	if ( job == NULL ) {
+		num_workers = SDL_AtomicGet(&pool.num_workers);
+		for ( i = 0; i < num_workers && job == NULL; ++i ) {
+			JobWorker *victim;
+
+			victim = &pool.workers[((self ? self->index + 1 : 0) + i) % num_workers];
+			if ( victim != self ) {
+				job = SDL_StealJob(&victim->deque);
+			}
+		}
+	}
+	if ( job ) {
+		SDL_AtomicAdd(&pool.queued, -1);
+	}
+	return(job);
+}
+
+static int SDLCALL SDL_JobWorkerThread(void *data)
+{
+	JobWorker *self = (JobWorker *)data;
+	SDL_Job *job;
+	int spins = 0;
+
+	for ( ; ; ) {
+		job = SDL_FindJob(self);
+		if ( job ) {
+			SDL_RunJob(job);
+			spins = 0;
+			continue;
+		}
+		if ( ++spins < JOB_SPINS && SDL_AtomicGet(&pool.queued) > 0 ) {
+			continue;
+		}
+		spins = 0;
+
+		SDL_mutexP(pool.lock);
+		SDL_AtomicAdd(&pool.sleepers, 1);
+		while ( SDL_AtomicGet(&pool.queued) == 0 &&
+		        !SDL_AtomicGet(&pool.quit) ) {
+			SDL_CondWait(pool.wake, pool.lock);
+		}
+		SDL_AtomicAdd(&pool.sleepers, -1);
+		SDL_mutexV(pool.lock);
+
+		if ( SDL_AtomicGet(&pool.quit) && SDL_AtomicGet(&pool.queued) == 0 ) {
+			break;
+		}
+	}
+	return(0);
+}
+
+static void SDL_StartJobThreads(void)
+{
+	int i, num_workers;
+
+	if ( SDL_AtomicGet(&pool.state) == 2 ) {
+		return;
+	}
+	if ( !SDL_AtomicCAS(&pool.state, 0, 1) ) {
+		/* Another thread is starting them */
+		while ( SDL_AtomicGet(&pool.state) != 2 ) {
+			SDL_Delay(1);
+		}
+		return;
+	}
+
+	num_workers = SDL_GetHintInt(SDL_HINT_JOB_THREADS, SDL_GetCPUCount() - 1);
+	if ( num_workers > MAX_JOB_THREADS ) {
+		num_workers = MAX_JOB_THREADS;
+	}
+	if ( num_workers > 0 ) {
+		pool.lock = SDL_CreateMutex();
+		pool.wake = SDL_CreateCond();
+		pool.workers = (JobWorker *)SDL_malloc(num_workers * sizeof(JobWorker));
+		if ( !pool.lock || !pool.wake || !pool.workers ) {
+			num_workers = 0;
+		} else {
+			SDL_memset(pool.workers, 0, num_workers * sizeof(JobWorker));
+		}
+	}
+	for ( i = 0; i < num_workers; ++i ) {
+		JobWorker *worker = &pool.workers[i];
+
+		worker->index = i;
+		worker->thread = SDL_CreateThread(SDL_JobWorkerThread, worker);
+		if ( worker->thread == NULL ) {
+			/* Carry on with the workers we have */
+			break;
+		}
+		worker->threadid = SDL_GetThreadID(worker->thread);
+		SDL_AtomicSet(&pool.num_workers, i + 1);
+	}
+	SDL_AtomicSet(&pool.state, 2);
+}
+
+void SDL_QuitJobs(void)
+{
+	int i, num_workers;
+
+	if ( SDL_AtomicGet(&pool.state) != 2 ) {
+		return;
+	}
+	num_workers = SDL_AtomicGet(&pool.num_workers);
+	if ( num_workers > 0 ) {
+		/* The workers run any jobs left in the queues before they go */
+		SDL_mutexP(pool.lock);
+		SDL_AtomicSet(&pool.quit, 1);
+		SDL_CondBroadcast(pool.wake);
+		SDL_mutexV(pool.lock);
+		for ( i = 0; i < num_workers; ++i ) {
+			SDL_WaitThread(pool.workers[i].thread, NULL);
+		}
+	}
+	if ( pool.workers ) {
+		SDL_free(pool.workers);
+	}
+	if ( pool.wake ) {
+		SDL_DestroyCond(pool.wake);
+	}
+	if ( pool.lock ) {
+		SDL_DestroyMutex(pool.lock);
+	}
+	pool.workers = NULL;
+	pool.wake = NULL;
+	pool.lock = NULL;
+	pool.head = pool.tail = NULL;
+	SDL_AtomicSet(&pool.num_workers, 0);
+	SDL_AtomicSet(&pool.quit, 0);
+	SDL_AtomicSet(&pool.state, 0);
+}
+
+SDL_Job *SDL_CreateJob(SDL_JobFunction func, void *data)
+{
+	SDL_Job *job;
+
+	if ( func == NULL ) {
+		SDL_SetError("No job function");
+		return(NULL);
+	}
+	SDL_StartJobThreads();
+
+	job = (SDL_Job *)SDL_malloc(sizeof(*job));
+	if ( job == NULL ) {
+		SDL_OutOfMemory();
+		return(NULL);
+	}
+	job->func = func;
+	job->data = data;
+	job->refs = 2;
+	job->pending = 1;
+	job->started = 0;
+	job->done = 0;
+	job->dependents = NULL;
+	job->next = NULL;
+	return(job);
+}
+
+int SDL_JobDependsOn(SDL_Job *job, SDL_Job *dependency)
+{
+	JobLink *link;
+	void *head;
+
+	if ( job == NULL || dependency == NULL || job == dependency ) {
+		SDL_SetError("Invalid job");
+		return(-1);
+	}
+	if ( SDL_AtomicGet(&job->started) ) {
+		SDL_SetError("The job has already been started");
+		return(-1);
+	}
+	link = (JobLink *)SDL_malloc(sizeof(*link));
+	if ( link == NULL ) {
+		SDL_OutOfMemory();
+		return(-1);
+	}
+	link->job = job;
+
+	SDL_AtomicAdd(&job->pending, 1);
+	do {
+		head = SDL_AtomicGetPtr(&dependency->dependents);
+		if ( head == JOB_CLOSED ) {
+			/* It has already finished */
+			SDL_AtomicAdd(&job->pending, -1);
+			SDL_free(link);
+			return(0);
+		}
+		link->next = (JobLink *)head;
+	} while ( !SDL_AtomicCASPtr(&dependency->dependents, head, link) );
+	return(0);
+}
+
+void SDL_StartJob(SDL_Job *job)
+{
+	if ( job && SDL_AtomicCAS(&job->started, 0, 1) ) {
+		SDL_ReleaseJob(job);
+	}
+}
+
+SDL_bool SDL_JobDone(SDL_Job *job)
+{
+	return((job && SDL_AtomicGet(&job->done)) ? SDL_TRUE : SDL_FALSE);
+}
+
+void SDL_WaitJob(SDL_Job *job)
+{
+	JobWorker *self;
+	SDL_Job *other;
+
+	if ( job == NULL ) {
+		return;
+	}
+	SDL_StartJob(job);
+
+	self = SDL_CurrentWorker();
+	while ( !SDL_AtomicGet(&job->done) ) {
+		/* Make ourselves useful */
+		other = SDL_FindJob(self);
+		if ( other ) {
+			SDL_RunJob(other);
+			continue;
+		}
+
+		if ( pool.lock == NULL ) {
+			/* No job threads, another thread is running it */
+			SDL_Delay(1);
+			continue;
+		}
+		SDL_mutexP(pool.lock);
+		SDL_AtomicAdd(&pool.waiters, 1);
+		SDL_AtomicAdd(&pool.sleepers, 1);
+		while ( !SDL_AtomicGet(&job->done) &&
+		        SDL_AtomicGet(&pool.queued) == 0 ) {
+			SDL_CondWait(pool.wake, pool.lock);
+		}
+		SDL_AtomicAdd(&pool.sleepers, -1);
+		SDL_AtomicAdd(&pool.waiters, -1);
+		SDL_mutexV(pool.lock);
+	}
+	SDL_UnrefJob(job);
+}
+
+void SDL_DetachJob(SDL_Job *job)
+{
+	if ( job ) {
+		SDL_StartJob(job);
+		SDL_UnrefJob(job);
+	}
+}
+
+typedef struct ParallelFor {
+	SDL_ParallelForFunction func;
+	void *data;
+	int first;
+	int last;
+	int step;
+	int pieces;
+	volatile int next;
+} ParallelFor;
+
+static void SDLCALL SDL_RunParallelFor(void *data)
+{
+	ParallelFor *loop = (ParallelFor *)data;
+	int piece, first;
+
+	while ( (piece = SDL_AtomicAdd(&loop->next, 1)) < loop->pieces ) {
+		first = loop->first + piece * loop->step;
+		loop->func(loop->data, first,
+		           SDL_min(first + loop->step, loop->last));
+	}
+}
+
+void SDL_ParallelFor(int first, int last, int grain, SDL_ParallelForFunction func, void *data)
+{
+	SDL_Job *helpers[MAX_JOB_THREADS];
+	ParallelFor loop;
+	int count, threads, pieces, i, num_helpers;
+
+	if ( last <= first || func == NULL ) {
+		return;
+	}
+	if ( grain < 1 ) {
+		grain = 1;
+	}
+	count = last - first;
+	threads = SDL_GetJobThreads();
+	pieces = count / grain + (count % grain != 0);
+	if ( pieces > (threads + 1) * PIECES_PER_THREAD ) {
+		pieces = (threads + 1) * PIECES_PER_THREAD;
+	}
+	if ( threads == 0 || pieces <= 1 ) {
+		func(data, first, last);
+		return;
+	}
+
+	loop.func = func;
+	loop.data = data;
+	loop.first = first;
+	loop.last = last;
+	loop.step = count / pieces + (count % pieces != 0);
+	loop.pieces = count / loop.step + (count % loop.step != 0);
+	loop.next = 0;
+
+	/* Every thread that joins in takes pieces until there are none left */
+	num_helpers = SDL_min(loop.pieces - 1, threads);
+	for ( i = 0; i < num_helpers; ++i ) {
+		helpers[i] = SDL_CreateJob(SDL_RunParallelFor, &loop);
+		if ( helpers[i] == NULL ) {
+			break;
+		}
+		SDL_StartJob(helpers[i]);
+	}
+	num_helpers = i;
+	SDL_RunParallelFor(&loop);
+	for ( i = 0; i < num_helpers; ++i ) {
+		SDL_WaitJob(helpers[i]);
+	}
+}
+
+int SDL_GetJobThreads(void)
+{
+	SDL_StartJobThreads();
+	return(SDL_AtomicGet(&pool.num_workers));
+}
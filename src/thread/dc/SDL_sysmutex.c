@@ -120,3 +120,12 @@ int SDL_mutexV(SDL_mutex *mutex)
 	return 0;
 #endif /* SDL_THREADS_DISABLED */
 }
+
+Uint32 SDL_GetMutexContention(SDL_mutex *mutex)
+{
+	/* Not counted here */
+	return 0;
+}
+
+/* Reader-writer locks built on these mutexes */
+#include "../generic/SDL_sysrwlock.c"
@@ -127,3 +127,16 @@ int SDL_mutexV(SDL_mutex *mutex)
 	return 0;
 #endif /* SDL_THREADS_DISABLED */
 }
+
+Uint32 SDL_GetMutexContention(SDL_mutex *mutex)
+{
+	/* Not counted here */
+	return 0;
+}
+
+/* Reader-writer locks built on these mutexes.  Builds without threads
+   compile every file in this directory, so they get it on its own.
+ */
+#if !SDL_THREADS_DISABLED
+#include "SDL_sysrwlock.c"
+#endif
@@ -0,0 +1,177 @@
+/*
+    SDL - Simple DirectMedia Layer
+    Copyright (C) 1997-2012 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+#include "SDL_config.h"
+
+/* An implementation of reader-writer locks using a mutex and condition
+   variables, included by the SDL_sysmutex.c of platforms without their
+   own.  A writer waiting for the lock holds off new readers, so a
+   steady stream of readers can't keep it out forever.
+ */
+
+#include "SDL_thread.h"
+
+struct SDL_rwlock {
+	SDL_mutex *lock;
+	SDL_cond *can_read;
+	SDL_cond *can_write;
+	int readers;		/* Threads holding it for reading */
+	int writer;		/* Whether a thread holds it for writing */
+	int waiting_writers;
+};
+
+SDL_rwlock *SDL_CreateRWLock(void)
+{
+	SDL_rwlock *rwlock;
+
+	rwlock = (SDL_rwlock *)SDL_malloc(sizeof(*rwlock));
+	if ( rwlock ) {
+		rwlock->lock = SDL_CreateMutex();
+		rwlock->can_read = SDL_CreateCond();
+		rwlock->can_write = SDL_CreateCond();
+		rwlock->readers = rwlock->writer = rwlock->waiting_writers = 0;
+		if ( ! rwlock->lock || ! rwlock->can_read || ! rwlock->can_write ) {
+			SDL_DestroyRWLock(rwlock);
+			rwlock = NULL;
+		}
+	} else {
+		SDL_OutOfMemory();
+	}
+	return(rwlock);
+}
+
+void SDL_DestroyRWLock(SDL_rwlock *rwlock)
+{
+	if ( rwlock ) {
+		if ( rwlock->can_write ) {
+			SDL_DestroyCond(rwlock->can_write);
+		}
+		if ( rwlock->can_read ) {
+			SDL_DestroyCond(rwlock->can_read);
+		}
+		if ( rwlock->lock ) {
+			SDL_DestroyMutex(rwlock->lock);
+		}
+		SDL_free(rwlock);
+	}
+}
+
+/* Take the lock for reading, waiting for it if 'wait' is set */
+static int SDL_LockRWLockReader(SDL_rwlock *rwlock, SDL_bool wait)
+{
+	int retval = 0;
+
+	if ( rwlock == NULL ) {
+		SDL_SetError("Passed a NULL rwlock");
+		return -1;
+	}
+
+	SDL_mutexP(rwlock->lock);
+	if ( wait ) {
+		while ( rwlock->writer || rwlock->waiting_writers ) {
+			SDL_CondWait(rwlock->can_read, rwlock->lock);
+		}
+	}
+	if ( rwlock->writer || rwlock->waiting_writers ) {
+		retval = SDL_MUTEX_TIMEDOUT;
+	} else {
+		++rwlock->readers;
+	}
+	SDL_mutexV(rwlock->lock);
+	return retval;
+}
+
+/* Take the lock for writing, waiting for it if 'wait' is set */
+static int SDL_LockRWLockWriter(SDL_rwlock *rwlock, SDL_bool wait)
+{
+	int retval = 0;
+
+	if ( rwlock == NULL ) {
+		SDL_SetError("Passed a NULL rwlock");
+		return -1;
+	}
+
+	SDL_mutexP(rwlock->lock);
+	if ( wait ) {
+		++rwlock->waiting_writers;
+		while ( rwlock->writer || rwlock->readers ) {
+			SDL_CondWait(rwlock->can_write, rwlock->lock);
+		}
+		--rwlock->waiting_writers;
+	}
+	if ( rwlock->writer || rwlock->readers ) {
+		retval = SDL_MUTEX_TIMEDOUT;
+	} else {
+		rwlock->writer = 1;
+	}
+	SDL_mutexV(rwlock->lock);
+	return retval;
+}
+
+int SDL_LockRWLockForReading(SDL_rwlock *rwlock)
+{
+	return SDL_LockRWLockReader(rwlock, SDL_TRUE);
+}
+
+int SDL_LockRWLockForWriting(SDL_rwlock *rwlock)
+{
+	return SDL_LockRWLockWriter(rwlock, SDL_TRUE);
+}
+
+int SDL_TryLockRWLockForReading(SDL_rwlock *rwlock)
+{
+	return SDL_LockRWLockReader(rwlock, SDL_FALSE);
+}
+
+int SDL_TryLockRWLockForWriting(SDL_rwlock *rwlock)
+{
+	return SDL_LockRWLockWriter(rwlock, SDL_FALSE);
+}
+
+int SDL_UnlockRWLock(SDL_rwlock *rwlock)
+{
+	int retval = 0;
+
+	if ( rwlock == NULL ) {
+		SDL_SetError("Passed a NULL rwlock");
+		return -1;
+	}
+
+	SDL_mutexP(rwlock->lock);
+	if ( rwlock->writer ) {
+		rwlock->writer = 0;
+	} else if ( rwlock->readers > 0 ) {
+		--rwlock->readers;
+	} else {
+		SDL_SetError("rwlock not locked");
+		retval = -1;
+	}
+	/* Let in the next writer if there is one, or else all the readers */
+	if ( rwlock->waiting_writers ) {
+		if ( rwlock->readers == 0 ) {
+			SDL_CondSignal(rwlock->can_write);
+		}
+	} else {
+		SDL_CondBroadcast(rwlock->can_read);
+	}
+	SDL_mutexV(rwlock->lock);
+	return retval;
+}
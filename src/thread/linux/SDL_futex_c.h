@@ -0,0 +1,115 @@
+/*
+    SDL - Simple DirectMedia Layer
+    Copyright (C) 1997-2012 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+#include "SDL_config.h"
+
+/* Linux futexes, which the pthread mutexes, semaphores and condition
+   variables use instead of the pthread ones where they're available.
+   A futex is an int in user space that threads can sleep on until
+   another thread wakes them, so the usual case of taking a lock nobody
+   else holds is just an atomic operation, with no system call.
+
+   Build with -DSDL_THREAD_NO_FUTEX to use the pthread versions instead.
+ */
+
+#ifndef _SDL_futex_c_h
+#define _SDL_futex_c_h
+
+#include "../SDL_atomic_c.h"
+
+#if defined(__linux__) && !defined(SDL_THREAD_NO_FUTEX) && defined(SDL_ATOMIC_GCC)
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#if defined(SYS_futex) && defined(FUTEX_WAIT_BITSET_PRIVATE)
+#define SDL_THREAD_FUTEX	1
+#endif
+#endif
+
+#if SDL_THREAD_FUTEX
+
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <limits.h>
+
+#include "SDL_cpuinfo.h"
+
+/* How many times to look at a lock before going to sleep on it */
+#define FUTEX_MAX_SPINS		100
+
+/* Make a deadline 'ms' milliseconds from now, on the monotonic clock so
+   it isn't moved by changes to the time of day.
+ */
+static __inline__ void SDL_FutexDeadline(struct timespec *deadline, Uint32 ms)
+{
+#if HAVE_CLOCK_GETTIME
+	clock_gettime(CLOCK_MONOTONIC, deadline);
+#else
+	syscall(SYS_clock_gettime, CLOCK_MONOTONIC, deadline);
+#endif
+	deadline->tv_sec += ms / 1000;
+	deadline->tv_nsec += (ms % 1000) * 1000000;
+	if ( deadline->tv_nsec >= 1000000000 ) {
+		deadline->tv_nsec -= 1000000000;
+		deadline->tv_sec += 1;
+	}
+}
+
+/* Sleep while '*addr' is 'value', until woken or the deadline (NULL for
+   none) has passed.  Returns 0, or ETIMEDOUT, or another errno value if
+   it returned early, which callers treat like being woken.
+ */
+static __inline__ int SDL_FutexWait(volatile int *addr, int value, const struct timespec *deadline)
+{
+	if ( syscall(SYS_futex, addr, FUTEX_WAIT_BITSET_PRIVATE, value,
+	             deadline, NULL, FUTEX_BITSET_MATCH_ANY) < 0 ) {
+		return errno;
+	}
+	return 0;
+}
+
+/* Wake up to 'count' threads sleeping on 'addr' */
+static __inline__ void SDL_FutexWake(volatile int *addr, int count)
+{
+	syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0);
+}
+
+/* Tell the CPU we're spinning, so it can give the core to the thread
+   we're waiting for if they share one.
+ */
+static __inline__ void SDL_FutexPause(void)
+{
+#if defined(__i386__) || defined(__x86_64__)
+	__asm__ __volatile__ ( "pause" );
+#elif defined(__aarch64__)
+	__asm__ __volatile__ ( "yield" );
+#endif
+}
+
+/* Spinning only helps if the thread holding the lock can run meanwhile */
+static __inline__ SDL_bool SDL_FutexShouldSpin(void)
+{
+	return (SDL_GetCPUCount() > 1) ? SDL_TRUE : SDL_FALSE;
+}
+
+#endif /* SDL_THREAD_FUTEX */
+
+#endif /* _SDL_futex_c_h */
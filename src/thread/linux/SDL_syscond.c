@@ -0,0 +1,131 @@
+/*
+    SDL - Simple DirectMedia Layer
+    Copyright (C) 1997-2012 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+#include "SDL_config.h"
+
+/* Condition variables built on a futex.  Waiters sleep while the
+   sequence number is the one they saw before unlocking the mutex, and
+   signaling bumps it, so a signal can't slip in between unlocking and
+   going to sleep.  A thread can occasionally wake without being
+   signaled, as with pthread condition variables.
+ */
+
+#include "SDL_thread.h"
+#include "SDL_futex_c.h"
+
+struct SDL_cond
+{
+	volatile int sequence;
+	volatile int waiters;
+};
+
+/* Create a condition variable */
+SDL_cond * SDL_CreateCond(void)
+{
+	SDL_cond *cond;
+
+	cond = (SDL_cond *) SDL_calloc(1, sizeof(SDL_cond));
+	if ( ! cond ) {
+		SDL_OutOfMemory();
+	}
+	return(cond);
+}
+
+/* Destroy a condition variable */
+void SDL_DestroyCond(SDL_cond *cond)
+{
+	if ( cond ) {
+		SDL_free(cond);
+	}
+}
+
+/* Wake up to 'count' of the threads waiting on the condition variable */
+static int SDL_CondWake(SDL_cond *cond, int count)
+{
+	if ( ! cond ) {
+		SDL_SetError("Passed a NULL condition variable");
+		return -1;
+	}
+
+	SDL_AtomicAdd(&cond->sequence, 1);
+	if ( SDL_AtomicGet(&cond->waiters) > 0 ) {
+		SDL_FutexWake(&cond->sequence, count);
+	}
+	return 0;
+}
+
+/* Restart one of the threads that are waiting on the condition variable */
+int SDL_CondSignal(SDL_cond *cond)
+{
+	return SDL_CondWake(cond, 1);
+}
+
+/* Restart all threads that are waiting on the condition variable */
+int SDL_CondBroadcast(SDL_cond *cond)
+{
+	return SDL_CondWake(cond, INT_MAX);
+}
+
+static int SDL_CondWaitDeadline(SDL_cond *cond, SDL_mutex *mutex, const struct timespec *deadline)
+{
+	int sequence;
+	int retval;
+
+	if ( ! cond ) {
+		SDL_SetError("Passed a NULL condition variable");
+		return -1;
+	}
+
+	sequence = SDL_AtomicGet(&cond->sequence);
+	SDL_AtomicAdd(&cond->waiters, 1);
+	if ( SDL_mutexV(mutex) < 0 ) {
+		SDL_AtomicAdd(&cond->waiters, -1);
+		return -1;
+	}
+
+	retval = 0;
+	if ( SDL_FutexWait(&cond->sequence, sequence, deadline) == ETIMEDOUT ) {
+		retval = SDL_MUTEX_TIMEDOUT;
+	}
+	SDL_AtomicAdd(&cond->waiters, -1);
+
+	SDL_mutexP(mutex);
+	return retval;
+}
+
+int SDL_CondWaitTimeout(SDL_cond *cond, SDL_mutex *mutex, Uint32 ms)
+{
+	struct timespec deadline;
+
+	if ( ms == SDL_MUTEX_MAXWAIT ) {
+		return SDL_CondWaitDeadline(cond, mutex, NULL);
+	}
+	SDL_FutexDeadline(&deadline, ms);
+	return SDL_CondWaitDeadline(cond, mutex, &deadline);
+}
+
+/* Wait on the condition variable, unlocking the provided mutex.
+   The mutex must be locked before entering this function!
+ */
+int SDL_CondWait(SDL_cond *cond, SDL_mutex *mutex)
+{
+	return SDL_CondWaitDeadline(cond, mutex, NULL);
+}
@@ -0,0 +1,147 @@
+/*
+    SDL - Simple DirectMedia Layer
+    Copyright (C) 1997-2012 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+#include "SDL_config.h"
+
+/* Mutexes built on a futex.  Taking a mutex nobody holds is one atomic
+   operation.  Otherwise the thread spins for a while, since most locks
+   are held only briefly, and then sleeps until the mutex is unlocked.
+ */
+
+#include <pthread.h>
+
+#include "SDL_thread.h"
+#include "SDL_futex_c.h"
+
+struct SDL_mutex {
+	volatile int state;	/* 0 unlocked, 1 locked, 2 locked with sleepers */
+	pthread_t owner;
+	int recursive;
+	int spins;		/* how long spinning took lately */
+	volatile int contended;
+};
+
+SDL_mutex *SDL_CreateMutex(void)
+{
+	SDL_mutex *mutex;
+
+	mutex = (SDL_mutex *)SDL_calloc(1, sizeof(*mutex));
+	if ( ! mutex ) {
+		SDL_OutOfMemory();
+	}
+	return(mutex);
+}
+
+void SDL_DestroyMutex(SDL_mutex *mutex)
+{
+	if ( mutex ) {
+		SDL_free(mutex);
+	}
+}
+
+/* Wait for a mutex another thread holds */
+static void SDL_LockContended(SDL_mutex *mutex)
+{
+	int i, limit;
+
+	SDL_AtomicAdd(&mutex->contended, 1);
+
+	/* Spin for a little longer than it has taken lately, so locks that
+	   are never held for long don't cost a trip to the kernel.
+	 */
+	if ( SDL_FutexShouldSpin() ) {
+		limit = mutex->spins * 2 + 10;
+		if ( limit > FUTEX_MAX_SPINS ) {
+			limit = FUTEX_MAX_SPINS;
+		}
+		for ( i = 0; i < limit; ++i ) {
+			SDL_FutexPause();
+			if ( mutex->state == 0 &&
+			     SDL_AtomicCAS(&mutex->state, 0, 1) ) {
+				mutex->spins += (i - mutex->spins) / 8;
+				return;
+			}
+		}
+		mutex->spins += (limit - mutex->spins) / 8;
+	}
+
+	/* Mark it as having sleepers, so it's woken when it's unlocked */
+	while ( __sync_lock_test_and_set(&mutex->state, 2) != 0 ) {
+		SDL_FutexWait(&mutex->state, 2, NULL);
+	}
+}
+
+/* Lock the mutex */
+int SDL_mutexP(SDL_mutex *mutex)
+{
+	pthread_t this_thread;
+
+	if ( mutex == NULL ) {
+		SDL_SetError("Passed a NULL mutex");
+		return -1;
+	}
+
+	this_thread = pthread_self();
+	if ( pthread_equal(mutex->owner, this_thread) ) {
+		++mutex->recursive;
+		return 0;
+	}
+	if ( ! SDL_AtomicCAS(&mutex->state, 0, 1) ) {
+		SDL_LockContended(mutex);
+	}
+	mutex->owner = this_thread;
+	mutex->recursive = 0;
+	return 0;
+}
+
+int SDL_mutexV(SDL_mutex *mutex)
+{
+	if ( mutex == NULL ) {
+		SDL_SetError("Passed a NULL mutex");
+		return -1;
+	}
+
+	/* We can only unlock the mutex if we own it */
+	if ( ! pthread_equal(mutex->owner, pthread_self()) ) {
+		SDL_SetError("mutex not owned by this thread");
+		return -1;
+	}
+	if ( mutex->recursive ) {
+		--mutex->recursive;
+		return 0;
+	}
+
+	mutex->owner = 0;
+	if ( SDL_AtomicAdd(&mutex->state, -1) != 1 ) {
+		/* Another thread may be asleep waiting for it */
+		__sync_lock_release(&mutex->state);
+		SDL_FutexWake(&mutex->state, 1);
+	}
+	return 0;
+}
+
+Uint32 SDL_GetMutexContention(SDL_mutex *mutex)
+{
+	if ( mutex == NULL ) {
+		return 0;
+	}
+	return (Uint32)SDL_AtomicGet(&mutex->contended);
+}
@@ -0,0 +1,166 @@
+/*
+    SDL - Simple DirectMedia Layer
+    Copyright (C) 1997-2012 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+#include "SDL_config.h"
+
+/* Semaphores built on a futex.  Posting is an atomic add, plus a system
+   call only when a thread is asleep waiting, and waiting spins a little
+   before sleeping.  Timeouts are measured on the monotonic clock.
+ */
+
+#include "SDL_thread.h"
+#include "SDL_timer.h"
+#include "SDL_futex_c.h"
+
+struct SDL_semaphore {
+	volatile int count;
+	volatile int sleepers;
+	volatile int contended;
+};
+
+/* Create a semaphore, initialized with value */
+SDL_sem *SDL_CreateSemaphore(Uint32 initial_value)
+{
+	SDL_sem *sem;
+
+	if ( initial_value > INT_MAX ) {
+		SDL_SetError("Semaphore value too large");
+		return NULL;
+	}
+	sem = (SDL_sem *) SDL_calloc(1, sizeof(*sem));
+	if ( sem ) {
+		sem->count = (int)initial_value;
+	} else {
+		SDL_OutOfMemory();
+	}
+	return sem;
+}
+
+void SDL_DestroySemaphore(SDL_sem *sem)
+{
+	if ( sem ) {
+		SDL_free(sem);
+	}
+}
+
+int SDL_SemTryWait(SDL_sem *sem)
+{
+	int value;
+
+	if ( ! sem ) {
+		SDL_SetError("Passed a NULL semaphore");
+		return -1;
+	}
+	do {
+		value = sem->count;
+		if ( value <= 0 ) {
+			return SDL_MUTEX_TIMEDOUT;
+		}
+	} while ( ! SDL_AtomicCAS(&sem->count, value, value - 1) );
+	return 0;
+}
+
+/* Wait until the count can be taken or the deadline (NULL for none) */
+static int SDL_SemWaitDeadline(SDL_sem *sem, const struct timespec *deadline)
+{
+	int i, retval;
+
+	retval = SDL_SemTryWait(sem);
+	if ( retval != SDL_MUTEX_TIMEDOUT ) {
+		return retval;
+	}
+	SDL_AtomicAdd(&sem->contended, 1);
+
+	if ( SDL_FutexShouldSpin() ) {
+		for ( i = 0; i < FUTEX_MAX_SPINS; ++i ) {
+			SDL_FutexPause();
+			if ( sem->count > 0 && SDL_SemTryWait(sem) == 0 ) {
+				return 0;
+			}
+		}
+	}
+
+	/* Sleep while the count is 0.  SDL_SemPost() checks for sleepers
+	   after it adds to the count, so either it sees us here or we see
+	   the count it added.
+	 */
+	SDL_AtomicAdd(&sem->sleepers, 1);
+	while ( (retval = SDL_SemTryWait(sem)) == SDL_MUTEX_TIMEDOUT ) {
+		if ( SDL_FutexWait(&sem->count, 0, deadline) == ETIMEDOUT ) {
+			retval = SDL_SemTryWait(sem);
+			break;
+		}
+	}
+	SDL_AtomicAdd(&sem->sleepers, -1);
+	return retval;
+}
+
+int SDL_SemWait(SDL_sem *sem)
+{
+	return SDL_SemWaitDeadline(sem, NULL);
+}
+
+int SDL_SemWaitTimeout(SDL_sem *sem, Uint32 timeout)
+{
+	struct timespec deadline;
+
+	/* Try the easy cases first */
+	if ( timeout == 0 ) {
+		return SDL_SemTryWait(sem);
+	}
+	if ( timeout == SDL_MUTEX_MAXWAIT ) {
+		return SDL_SemWait(sem);
+	}
+
+	SDL_FutexDeadline(&deadline, timeout);
+	return SDL_SemWaitDeadline(sem, &deadline);
+}
+
+Uint32 SDL_SemValue(SDL_sem *sem)
+{
+	int value = 0;
+	if ( sem ) {
+		value = SDL_AtomicGet(&sem->count);
+	}
+	return (Uint32)value;
+}
+
+int SDL_SemPost(SDL_sem *sem)
+{
+	if ( ! sem ) {
+		SDL_SetError("Passed a NULL semaphore");
+		return -1;
+	}
+
+	SDL_AtomicAdd(&sem->count, 1);
+	if ( SDL_AtomicGet(&sem->sleepers) > 0 ) {
+		SDL_FutexWake(&sem->count, 1);
+	}
+	return 0;
+}
+
+Uint32 SDL_GetSemContention(SDL_sem *sem)
+{
+	if ( ! sem ) {
+		return 0;
+	}
+	return (Uint32)SDL_AtomicGet(&sem->contended);
+}
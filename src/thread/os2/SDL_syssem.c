@@ -190,3 +190,9 @@ DECLSPEC int SDLCALL SDL_SemPost(SDL_sem *sem)
         DosReleaseMutexSem(sem->id);
         return 0;
 }
+
+Uint32 SDL_GetSemContention(SDL_sem *sem)
+{
+	/* Not counted here */
+	return 0;
+}
@@ -27,6 +27,12 @@
 #include <pthread.h>
 
 #include "SDL_thread.h"
+#include "../linux/SDL_futex_c.h"
+
+#if SDL_THREAD_FUTEX
+#include "../linux/SDL_syscond.c"
+#else
+
 #include "SDL_sysmutex_c.h"
 
 struct SDL_cond
@@ -110,7 +116,7 @@ int SDL_CondWaitTimeout(SDL_cond *cond, SDL_mutex *mutex, Uint32 ms)
 
 	abstime.tv_sec = delta.tv_sec + (ms/1000);
 	abstime.tv_nsec = (delta.tv_usec + (ms%1000) * 1000) * 1000;
-        if ( abstime.tv_nsec > 1000000000 ) {
+        if ( abstime.tv_nsec >= 1000000000 ) {
           abstime.tv_sec += 1;
           abstime.tv_nsec -= 1000000000;
         }
@@ -153,3 +159,5 @@ int SDL_CondWait(SDL_cond *cond, SDL_mutex *mutex)
 	}
 	return retval;
 }
+
+#endif /* SDL_THREAD_FUTEX */
@@ -27,6 +27,11 @@
 #include <pthread.h>
 
 #include "SDL_thread.h"
+#include "../linux/SDL_futex_c.h"
+
+#if SDL_THREAD_FUTEX
+#include "../linux/SDL_sysmutex.c"
+#else
 
 #if !SDL_THREAD_PTHREAD_RECURSIVE_MUTEX && \
     !SDL_THREAD_PTHREAD_RECURSIVE_MUTEX_NP
@@ -154,3 +159,14 @@ int SDL_mutexV(SDL_mutex *mutex)
 
 	return retval;
 }
+
+Uint32 SDL_GetMutexContention(SDL_mutex *mutex)
+{
+	/* pthreads doesn't say */
+	return 0;
+}
+
+#endif /* SDL_THREAD_FUTEX */
+
+/* Reader-writer locks using pthread_rwlock */
+#include "SDL_sysrwlock.c"
@@ -28,12 +28,15 @@
 
 #include "SDL_thread.h"
 #include "SDL_timer.h"
+#include "../linux/SDL_futex_c.h"
 
 /* Wrapper around POSIX 1003.1b semaphores */
 
 #ifdef __MACOSX__
 /* Mac OS X doesn't support sem_getvalue() as of version 10.4 */
 #include "../generic/SDL_syssem.c"
+#elif SDL_THREAD_FUTEX
+#include "../linux/SDL_syssem.c"
 #else
 
 struct SDL_semaphore {
@@ -155,10 +158,10 @@ int SDL_SemWaitTimeout(SDL_sem *sem, Uint32 timeout)
 #else
 	end = SDL_GetTicks() + timeout;
 	while ((retval = SDL_SemTryWait(sem)) == SDL_MUTEX_TIMEDOUT) {
-		if ((SDL_GetTicks() - end) >= 0) {
+		if ((Sint32)(SDL_GetTicks() - end) >= 0) {
 			break;
 		}
-		SDL_Delay(0);
+		SDL_Delay(1);
 	}
 #endif /* HAVE_SEM_TIMEDWAIT */
 
@@ -193,4 +196,10 @@ int SDL_SemPost(SDL_sem *sem)
 	return retval;
 }
 
+Uint32 SDL_GetSemContention(SDL_sem *sem)
+{
+	/* POSIX semaphores don't say */
+	return 0;
+}
+
 #endif /* __MACOSX__ */
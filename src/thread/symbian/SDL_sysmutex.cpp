@@ -128,3 +128,12 @@ int SDL_mutexV(SDL_mutex *mutex)
 	rmutex.Signal();
 	return(0);
 }
+
+Uint32 SDL_GetMutexContention(SDL_mutex *mutex)
+{
+	/* Not counted here */
+	return 0;
+}
+
+/* Reader-writer locks built on these mutexes */
+#include "../generic/SDL_sysrwlock.c"
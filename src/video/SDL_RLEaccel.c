@@ -98,8 +98,8 @@
 
 #ifdef MMX_ASMBLIT
 #include "mmx.h"
-#include "SDL_cpuinfo.h"
 #endif
+#include "../cpuinfo/SDL_cpuinfo_c.h"
 
 #ifndef MAX
 #define MAX(a, b) ((a) > (b) ? (a) : (b))
@@ -644,7 +644,7 @@ do {							\
 			if(alpha == 128)				\
 			    blitter(2, Uint8, ALPHA_BLIT16_565_50);	\
 			else {						\
-			    if(SDL_HasMMX())				\
+			    if(SDL_UseSIMD(CPU_HAS_MMX))				\
 				blitter(2, Uint8, ALPHA_BLIT16_565MMX);	\
 			    else					\
 				blitter(2, Uint8, ALPHA_BLIT16_565);	\
@@ -660,7 +660,7 @@ do {							\
 			if(alpha == 128)				\
 			    blitter(2, Uint8, ALPHA_BLIT16_555_50);	\
 			else {						\
-			    if(SDL_HasMMX())				\
+			    if(SDL_UseSIMD(CPU_HAS_MMX))				\
 				blitter(2, Uint8, ALPHA_BLIT16_555MMX);	\
 			    else					\
 				blitter(2, Uint8, ALPHA_BLIT16_555);	\
@@ -685,14 +685,14 @@ do {							\
 		       || fmt->Bmask == 0xff00)) {			\
 		    if(alpha == 128)					\
 		    {							\
-			if(SDL_HasMMX())				\
+			if(SDL_UseSIMD(CPU_HAS_MMX))				\
 				blitter(4, Uint16, ALPHA_BLIT32_888_50MMX);\
 			else						\
 				blitter(4, Uint16, ALPHA_BLIT32_888_50);\
 		    }							\
 		    else						\
 		    {							\
-			if(SDL_HasMMX())				\
+			if(SDL_UseSIMD(CPU_HAS_MMX))				\
 				blitter(4, Uint16, ALPHA_BLIT32_888MMX);\
 			else						\
 				blitter(4, Uint16, ALPHA_BLIT32_888);	\
@@ -26,6 +26,7 @@
 #include "SDL_blit.h"
 #include "SDL_RLEaccel_c.h"
 #include "SDL_pixels_c.h"
+#include "../cpuinfo/SDL_cpuinfo_c.h"
 
 #if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__)) && SDL_ASSEMBLY_ROUTINES
 #define MMX_ASMBLIT
@@ -35,7 +36,6 @@
 #endif
 
 #if defined(MMX_ASMBLIT)
-#include "SDL_cpuinfo.h"
 #include "mmx.h"
 #endif
 
@@ -152,7 +152,8 @@ static __inline__ void SDL_memcpySSE(Uint8 *to, const Uint8 *from, int len)
 #endif
 #endif
 
-static void SDL_BlitCopy(SDL_BlitInfo *info)
+#ifdef SSE_ASMBLIT
+static void SDL_BlitCopySSE(SDL_BlitInfo *info)
 {
 	Uint8 *src, *dst;
 	int w, h;
@@ -164,35 +165,53 @@ static void SDL_BlitCopy(SDL_BlitInfo *info)
 	dst = info->d_pixels;
 	srcskip = w+info->s_skip;
 	dstskip = w+info->d_skip;
-
-#ifdef SSE_ASMBLIT
-	if(SDL_HasSSE())
-	{
-		while ( h-- ) {
-			SDL_memcpySSE(dst, src, w);
-			src += srcskip;
-			dst += dstskip;
-		}
-		__asm__ __volatile__ (
-		"	emms\n"
-		::);
+	while ( h-- ) {
+		SDL_memcpySSE(dst, src, w);
+		src += srcskip;
+		dst += dstskip;
 	}
-	else
+	__asm__ __volatile__ (
+	"	emms\n"
+	::);
+}
 #endif
+
 #ifdef MMX_ASMBLIT
-	if(SDL_HasMMX())
-	{
-		while ( h-- ) {
-			SDL_memcpyMMX(dst, src, w);
-			src += srcskip;
-			dst += dstskip;
-		}
-		__asm__ __volatile__ (
-		"	emms\n"
-		::);
+static void SDL_BlitCopyMMX(SDL_BlitInfo *info)
+{
+	Uint8 *src, *dst;
+	int w, h;
+	int srcskip, dstskip;
+
+	w = info->d_width*info->dst->BytesPerPixel;
+	h = info->d_height;
+	src = info->s_pixels;
+	dst = info->d_pixels;
+	srcskip = w+info->s_skip;
+	dstskip = w+info->d_skip;
+	while ( h-- ) {
+		SDL_memcpyMMX(dst, src, w);
+		src += srcskip;
+		dst += dstskip;
 	}
-	else
+	__asm__ __volatile__ (
+	"	emms\n"
+	::);
+}
 #endif
+
+static void SDL_BlitCopy(SDL_BlitInfo *info)
+{
+	Uint8 *src, *dst;
+	int w, h;
+	int srcskip, dstskip;
+
+	w = info->d_width*info->dst->BytesPerPixel;
+	h = info->d_height;
+	src = info->s_pixels;
+	dst = info->d_pixels;
+	srcskip = w+info->s_skip;
+	dstskip = w+info->d_skip;
 	while ( h-- ) {
 		SDL_memcpy(dst, src, w);
 		src += srcskip;
@@ -200,6 +219,16 @@ static void SDL_BlitCopy(SDL_BlitInfo *info)
 	}
 }
 
+static const SDL_SIMDKernel SDL_BlitCopyKernels[] = {
+#ifdef SSE_ASMBLIT
+	{ CPU_HAS_SSE, (SDL_SIMDFunction)SDL_BlitCopySSE },
+#endif
+#ifdef MMX_ASMBLIT
+	{ CPU_HAS_MMX, (SDL_SIMDFunction)SDL_BlitCopyMMX },
+#endif
+	{ 0, (SDL_SIMDFunction)SDL_BlitCopy }
+};
+
 static void SDL_BlitCopyOverlap(SDL_BlitInfo *info)
 {
 	Uint8 *src, *dst;
@@ -302,7 +331,8 @@ int SDL_CalculateBlit(SDL_Surface *surface)
 
 	/* Check for special "identity" case -- copy blit */
 	if ( surface->map->identity && blit_index == 0 ) {
-	        surface->map->sw_data->blit = SDL_BlitCopy;
+	        surface->map->sw_data->blit =
+			(SDL_loblit)SDL_SelectSIMDKernel(SDL_BlitCopyKernels);
 
 		/* Handle overlapping blits on the same surface */
 		if ( surface == surface->map->dst ) {
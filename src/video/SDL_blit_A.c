@@ -52,7 +52,7 @@
 #endif /* SDL_ASSEMBLY_ROUTINES */
 
 /* Function to check the CPU flags */
-#include "SDL_cpuinfo.h"
+#include "../cpuinfo/SDL_cpuinfo_c.h"
 #if GCC_ASMBLIT
 #include "mmx.h"
 #elif MSVC_ASMBLIT
@@ -2792,7 +2792,7 @@ SDL_loblit SDL_CalculateAlphaBlit(SDL_Surface *surface, int blit_index)
 	    else
 #if SDL_ALTIVEC_BLITTERS
 	if (sf->BytesPerPixel == 4 && df->BytesPerPixel == 4 &&
-	    !(surface->map->dst->flags & SDL_HWSURFACE) && SDL_HasAltiVec())
+	    !(surface->map->dst->flags & SDL_HWSURFACE) && SDL_UseSIMD(CPU_HAS_ALTIVEC))
             return Blit32to32SurfaceAlphaKeyAltivec;
         else
 #endif
@@ -2808,7 +2808,7 @@ SDL_loblit SDL_CalculateAlphaBlit(SDL_Surface *surface, int blit_index)
 		    if(df->Gmask == 0x7e0)
 		    {
 #if MMX_ASMBLIT
-		if(SDL_HasMMX())
+		if(SDL_UseSIMD(CPU_HAS_MMX))
 			return Blit565to565SurfaceAlphaMMX;
 		else
 #endif
@@ -2817,7 +2817,7 @@ SDL_loblit SDL_CalculateAlphaBlit(SDL_Surface *surface, int blit_index)
 		    else if(df->Gmask == 0x3e0)
 		    {
 #if MMX_ASMBLIT
-		if(SDL_HasMMX())
+		if(SDL_UseSIMD(CPU_HAS_MMX))
 			return Blit555to555SurfaceAlphaMMX;
 		else
 #endif
@@ -2836,14 +2836,14 @@ SDL_loblit SDL_CalculateAlphaBlit(SDL_Surface *surface, int blit_index)
 			if(sf->Rshift % 8 == 0
 			   && sf->Gshift % 8 == 0
 			   && sf->Bshift % 8 == 0
-			   && SDL_HasMMX())
+			   && SDL_UseSIMD(CPU_HAS_MMX))
 			    return BlitRGBtoRGBSurfaceAlphaMMX;
 #endif
 			if((sf->Rmask | sf->Gmask | sf->Bmask) == 0xffffff)
 			{
 #if SDL_ALTIVEC_BLITTERS
 				if(!(surface->map->dst->flags & SDL_HWSURFACE)
-					&& SDL_HasAltiVec())
+					&& SDL_UseSIMD(CPU_HAS_ALTIVEC))
 					return BlitRGBtoRGBSurfaceAlphaAltivec;
 #endif
 				return BlitRGBtoRGBSurfaceAlpha;
@@ -2851,7 +2851,7 @@ SDL_loblit SDL_CalculateAlphaBlit(SDL_Surface *surface, int blit_index)
 		}
 #if SDL_ALTIVEC_BLITTERS
 		if((sf->BytesPerPixel == 4) &&
-		   !(surface->map->dst->flags & SDL_HWSURFACE) && SDL_HasAltiVec())
+		   !(surface->map->dst->flags & SDL_HWSURFACE) && SDL_UseSIMD(CPU_HAS_ALTIVEC))
 			return Blit32to32SurfaceAlphaAltivec;
 		else
 #endif
@@ -2872,7 +2872,7 @@ SDL_loblit SDL_CalculateAlphaBlit(SDL_Surface *surface, int blit_index)
 #if SDL_ALTIVEC_BLITTERS
 	if(sf->BytesPerPixel == 4 && !(surface->map->dst->flags & SDL_HWSURFACE) &&
            df->Gmask == 0x7e0 &&
-	   df->Bmask == 0x1f && SDL_HasAltiVec())
+	   df->Bmask == 0x1f && SDL_UseSIMD(CPU_HAS_ALTIVEC))
             return Blit32to565PixelAlphaAltivec;
         else
 #endif
@@ -2883,11 +2883,11 @@ SDL_loblit SDL_CalculateAlphaBlit(SDL_Surface *surface, int blit_index)
 		   || (sf->Bmask == 0xff && df->Bmask == 0x1f)))
 		{
 #if SDL_ARM_NEON_BLITTERS
-		    if(SDL_HasNEON())
+		    if(SDL_UseSIMD(CPU_HAS_NEON))
 		        return BlitARGBto565PixelAlphaARMNEON;
 #endif
 #if SDL_ARM_SIMD_BLITTERS
-		    if(SDL_HasARMSIMD())
+		    if(SDL_UseSIMD(CPU_HAS_ARM_SIMD))
 		        return BlitARGBto565PixelAlphaARMSIMD;
 #endif
 		}
@@ -2916,9 +2916,9 @@ SDL_loblit SDL_CalculateAlphaBlit(SDL_Surface *surface, int blit_index)
 		   && sf->Ashift % 8 == 0
 		   && sf->Aloss == 0)
 		{
-			if(SDL_Has3DNow())
+			if(SDL_UseSIMD(CPU_HAS_3DNOW))
 				return BlitRGBtoRGBPixelAlphaMMX3DNOW;
-			if(SDL_HasMMX())
+			if(SDL_UseSIMD(CPU_HAS_MMX))
 				return BlitRGBtoRGBPixelAlphaMMX;
 		}
 #endif
@@ -2926,15 +2926,15 @@ SDL_loblit SDL_CalculateAlphaBlit(SDL_Surface *surface, int blit_index)
 		{
 #if SDL_ALTIVEC_BLITTERS
 			if(!(surface->map->dst->flags & SDL_HWSURFACE)
-				&& SDL_HasAltiVec())
+				&& SDL_UseSIMD(CPU_HAS_ALTIVEC))
 				return BlitRGBtoRGBPixelAlphaAltivec;
 #endif
 #if SDL_ARM_NEON_BLITTERS
-			if (SDL_HasNEON())
+			if (SDL_UseSIMD(CPU_HAS_NEON))
 				return BlitRGBtoRGBPixelAlphaARMNEON;
 #endif
 #if SDL_ARM_SIMD_BLITTERS
-			if (SDL_HasARMSIMD())
+			if (SDL_UseSIMD(CPU_HAS_ARM_SIMD))
 				return BlitRGBtoRGBPixelAlphaARMSIMD;
 #endif
 			return BlitRGBtoRGBPixelAlpha;
@@ -2942,7 +2942,7 @@ SDL_loblit SDL_CalculateAlphaBlit(SDL_Surface *surface, int blit_index)
 	    }
 #if SDL_ALTIVEC_BLITTERS
 	    if (sf->Amask && sf->BytesPerPixel == 4 &&
-	        !(surface->map->dst->flags & SDL_HWSURFACE) && SDL_HasAltiVec())
+	        !(surface->map->dst->flags & SDL_HWSURFACE) && SDL_UseSIMD(CPU_HAS_ALTIVEC))
 		return Blit32to32PixelAlphaAltivec;
 	    else
 #endif
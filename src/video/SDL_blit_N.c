@@ -23,7 +23,7 @@
 
 #include "SDL_video.h"
 #include "SDL_endian.h"
-#include "SDL_cpuinfo.h"
+#include "../cpuinfo/SDL_cpuinfo_c.h"
 #include "SDL_blit.h"
 
 /* General optimized routines that write char by char */
@@ -53,24 +53,20 @@ enum blit_features {
 #endif
 #define assert(X)
 #ifdef __MACOSX__
-#include <sys/sysctl.h>
 static size_t GetL3CacheSize( void )
 {
-    const char key[] = "hw.l3cachesize";
-    u_int64_t result = 0;
-    size_t typeSize = sizeof( result );
-
-
-    int err = sysctlbyname( key, &result, &typeSize, NULL, 0 );
-    if( 0 != err ) return 0;
-
-    return result;
+    return SDL_GetCPUCacheSize(3);
 }
 #else
 static size_t GetL3CacheSize( void )
 {
-    /* XXX: Just guess G4 */
-    return 2097152;
+    size_t size = SDL_GetCPUCacheSize(3);
+
+    if ( size == 0 ) {
+        /* XXX: Couldn't find out, just guess G4 */
+        size = 2097152;
+    }
+    return size;
 }
 #endif /* __MACOSX__ */
 
@@ -876,34 +872,33 @@ static void ConvertAltivec32to32_prefetch(SDL_BlitInfo *info)
 
 static enum blit_features GetBlitFeatures( void )
 {
-    static enum blit_features features = -1;
-    if (features == (enum blit_features) -1) {
-        /* Provide an override for testing .. */
-        char *override = SDL_getenv("SDL_ALTIVEC_BLIT_FEATURES");
-        if (override) {
-            unsigned int features_as_uint = 0;
-            SDL_sscanf(override, "%u", &features_as_uint);
-            features = (enum blit_features) features_as_uint;
-        } else {
-            features = ( 0
-                /* Feature 1 is has-MMX */
-                | ((SDL_HasMMX()) ? BLIT_FEATURE_HAS_MMX : 0)
-                /* Feature 2 is has-AltiVec */
-                | ((SDL_HasAltiVec()) ? BLIT_FEATURE_HAS_ALTIVEC : 0)
-                /* Feature 4 is dont-use-prefetch */
-                /* !!!! FIXME: Check for G5 or later, not the cache size! Always prefetch on a G4. */
-                | ((GetL3CacheSize() == 0) ? BLIT_FEATURE_ALTIVEC_DONT_USE_PREFETCH : 0)
-            );
-        }
+    static enum blit_features prefetch = -1;
+    /* Provide an override for testing .. */
+    char *override = SDL_getenv("SDL_ALTIVEC_BLIT_FEATURES");
+    if (override) {
+        unsigned int features_as_uint = 0;
+        SDL_sscanf(override, "%u", &features_as_uint);
+        return (enum blit_features) features_as_uint;
     }
-    return features;
+    if (prefetch == (enum blit_features) -1) {
+        /* Feature 4 is dont-use-prefetch */
+        /* !!!! FIXME: Check for G5 or later, not the cache size! Always prefetch on a G4. */
+        prefetch = ((GetL3CacheSize() == 0) ? BLIT_FEATURE_ALTIVEC_DONT_USE_PREFETCH : 0);
+    }
+    /* The SIMD features can change with SDL_SIMD_LEVEL between SDL_Init()s */
+    return ( prefetch
+        /* Feature 1 is has-MMX */
+        | ((SDL_UseSIMD(CPU_HAS_MMX)) ? BLIT_FEATURE_HAS_MMX : 0)
+        /* Feature 2 is has-AltiVec */
+        | ((SDL_UseSIMD(CPU_HAS_ALTIVEC)) ? BLIT_FEATURE_HAS_ALTIVEC : 0)
+    );
 }
 #if __MWERKS__
 #pragma altivec_model off
 #endif
 #else
 /* Feature 1 is has-MMX */
-#define GetBlitFeatures() ((SDL_HasMMX() ? BLIT_FEATURE_HAS_MMX : 0) | (SDL_HasARMSIMD() ? BLIT_FEATURE_HAS_ARM_SIMD : 0))
+#define GetBlitFeatures() ((SDL_UseSIMD(CPU_HAS_MMX) ? BLIT_FEATURE_HAS_MMX : 0) | (SDL_UseSIMD(CPU_HAS_ARM_SIMD) ? BLIT_FEATURE_HAS_ARM_SIMD : 0))
 #endif
 
 #if SDL_ARM_SIMD_BLITTERS
@@ -3240,7 +3235,7 @@ SDL_loblit SDL_CalculateBlitN(SDL_Surface *surface, int blit_index)
 		return BlitNto1Key;
 	    else {
 #if SDL_ALTIVEC_BLITTERS
-        if((srcfmt->BytesPerPixel == 4) && (dstfmt->BytesPerPixel == 4) && SDL_HasAltiVec()) {
+        if((srcfmt->BytesPerPixel == 4) && (dstfmt->BytesPerPixel == 4) && SDL_UseSIMD(CPU_HAS_ALTIVEC)) {
             return Blit32to32KeyAltivec;
         } else
 #endif
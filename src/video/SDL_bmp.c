@@ -30,7 +30,8 @@
    and save, and since PNG is so complex that it would bloat the library,
    BMP is a good alternative. 
 
-   This code currently supports Win32 DIBs in uncompressed 8 and 24 bpp.
+   This code currently supports Win32 DIBs in 1, 4, 8, 16, 24 and 32 bpp,
+   uncompressed or RLE4/RLE8 compressed, with any header up to BITMAPV5.
 */
 
 #include "SDL_video.h"
@@ -43,8 +44,89 @@
 #define BI_RLE4		2
 #define BI_BITFIELDS	3
 #endif
+#ifndef BI_ALPHABITFIELDS
+#define BI_ALPHABITFIELDS	6
+#endif
 
 
+/* Decode BI_RLE8 or BI_RLE4 data into an 8 bpp surface.
+   Pixels that the data skips over are left as color 0.
+ */
+static int DecodeRLE(SDL_Surface *surface, const Uint8 *data, Uint32 length,
+						int rle4, SDL_bool topDown)
+{
+	Uint32 pos = 0;
+	int x = 0, y = 0;
+	int count, bytes, i;
+	Uint8 value, *row;
+
+#define RLE_ROW(y) ((Uint8 *)surface->pixels + \
+		(topDown ? (y) : (surface->h-1-(y))) * surface->pitch)
+
+	row = RLE_ROW(0);
+	while ( y < surface->h ) {
+		if ( pos + 2 > length ) {
+			goto corrupt;
+		}
+		count = data[pos++];
+		value = data[pos++];
+		if ( count ) {
+			/* Encoded mode: 'count' pixels of one (or two) colors */
+			for ( i = 0; i < count && x < surface->w; ++i, ++x ) {
+				if ( rle4 ) {
+					row[x] = (i & 1) ? (value & 0x0F) : (value >> 4);
+				} else {
+					row[x] = value;
+				}
+			}
+			continue;
+		}
+		switch (value) {
+			case 0:		/* End of line */
+				x = 0;
+				if ( ++y < surface->h ) {
+					row = RLE_ROW(y);
+				}
+				break;
+			case 1:		/* End of bitmap */
+				return(0);
+			case 2:		/* Move right and up */
+				if ( pos + 2 > length ) {
+					goto corrupt;
+				}
+				x += data[pos++];
+				y += data[pos++];
+				if ( y < surface->h ) {
+					row = RLE_ROW(y);
+				}
+				break;
+			default:	/* Absolute mode, padded to 16 bits */
+				count = value;
+				bytes = rle4 ? (count + 1) / 2 : count;
+				if ( pos + bytes > length ) {
+					goto corrupt;
+				}
+				for ( i = 0; i < count && x < surface->w; ++i, ++x ) {
+					if ( rle4 ) {
+						value = data[pos + i/2];
+						row[x] = (i & 1) ? (value & 0x0F) : (value >> 4);
+					} else {
+						row[x] = data[pos + i];
+					}
+				}
+				x += count - i;
+				pos += (bytes + 1) & ~1;
+				break;
+		}
+	}
+	return(0);
+#undef RLE_ROW
+
+corrupt:
+	SDL_SetError("Corrupt RLE data in BMP file");
+	return(-1);
+}
+
 SDL_Surface * SDL_LoadBMP_RW (SDL_RWops *src, int freesrc)
 {
 	SDL_bool was_error;
@@ -55,9 +137,13 @@ SDL_Surface * SDL_LoadBMP_RW (SDL_RWops *src, int freesrc)
 	Uint32 Rmask;
 	Uint32 Gmask;
 	Uint32 Bmask;
+	Uint32 Amask;
 	SDL_Palette *palette;
+	Uint8 colors[256*4];
 	Uint8 *bits;
-	Uint8 *top, *end;
+	Uint8 *data;
+	Uint32 datalen;
+	int nread;
 	SDL_bool topDown;
 	int ExpandBMP;
 
@@ -81,8 +167,15 @@ SDL_Surface * SDL_LoadBMP_RW (SDL_RWops *src, int freesrc)
 	Uint32 biClrUsed;
 	Uint32 biClrImportant;
 
+	/* The masks in BITMAPV2INFOHEADER and later headers */
+	Uint32 bV4RedMask = 0;
+	Uint32 bV4GreenMask = 0;
+	Uint32 bV4BlueMask = 0;
+	Uint32 bV4AlphaMask = 0;
+
 	/* Make sure we are passed a valid data source */
 	surface = NULL;
+	data = NULL;
 	was_error = SDL_FALSE;
 	if ( src == NULL ) {
 		was_error = SDL_TRUE;
@@ -131,6 +224,24 @@ SDL_Surface * SDL_LoadBMP_RW (SDL_RWops *src, int freesrc)
 		biYPelsPerMeter	= SDL_ReadLE32(src);
 		biClrUsed	= SDL_ReadLE32(src);
 		biClrImportant	= SDL_ReadLE32(src);
+
+		/* OS/2 2.x headers are 64 bytes and have no masks */
+		if ( biSize >= 52 && biSize != 64 ) {
+			bV4RedMask	= SDL_ReadLE32(src);
+			bV4GreenMask	= SDL_ReadLE32(src);
+			bV4BlueMask	= SDL_ReadLE32(src);
+			if ( biSize >= 56 ) {
+				bV4AlphaMask = SDL_ReadLE32(src);
+			}
+		}
+
+		/* Skip the color space and profile parts of V4 and V5 headers */
+		if ( biSize > 40 && SDL_RWseek(src,
+				fp_offset+14+biSize, RW_SEEK_SET) < 0 ) {
+			SDL_Error(SDL_EFSEEK);
+			was_error = SDL_TRUE;
+			goto done;
+		}
 	}
 
 	/* stop some compiler warnings. */
@@ -138,7 +249,6 @@ SDL_Surface * SDL_LoadBMP_RW (SDL_RWops *src, int freesrc)
 	(void) bfReserved1;
 	(void) bfReserved2;
 	(void) biPlanes;
-	(void) biSizeImage;
 	(void) biXPelsPerMeter;
 	(void) biYPelsPerMeter;
 	(void) biClrImportant;
@@ -182,12 +292,12 @@ SDL_Surface * SDL_LoadBMP_RW (SDL_RWops *src, int freesrc)
 			break;
 	}
 
-	/* We don't support any BMP compression right now */
-	Rmask = Gmask = Bmask = 0;
+	/* Work out the color masks */
+	Rmask = Gmask = Bmask = Amask = 0;
 	switch (biCompression) {
 		case BI_RGB:
 			/* If there are no masks, use the defaults */
-			if ( bfOffBits == (14+biSize) ) {
+			if ( bfOffBits == (14+biSize) || biSize > 40 ) {
 				/* Default values for the BMP format */
 				switch (biBitCount) {
 					case 15:
@@ -216,18 +326,43 @@ SDL_Surface * SDL_LoadBMP_RW (SDL_RWops *src, int freesrc)
 			/* Fall through -- read the RGB masks */
 
 		case BI_BITFIELDS:
+		case BI_ALPHABITFIELDS:
 			switch (biBitCount) {
 				case 15:
 				case 16:
 				case 32:
+					if ( biSize >= 52 && biSize != 64 ) {
+						Rmask = bV4RedMask;
+						Gmask = bV4GreenMask;
+						Bmask = bV4BlueMask;
+						Amask = bV4AlphaMask;
+						break;
+					}
 					Rmask = SDL_ReadLE32(src);
 					Gmask = SDL_ReadLE32(src);
 					Bmask = SDL_ReadLE32(src);
+					if ( biCompression == BI_ALPHABITFIELDS ) {
+						Amask = SDL_ReadLE32(src);
+					}
 					break;
 				default:
 					break;
 			}
 			break;
+		case BI_RLE8:
+			if ( biBitCount != 8 || ExpandBMP ) {
+				SDL_SetError("RLE8 BMP files must be 8 bpp");
+				was_error = SDL_TRUE;
+				goto done;
+			}
+			break;
+		case BI_RLE4:
+			if ( ExpandBMP != 4 ) {
+				SDL_SetError("RLE4 BMP files must be 4 bpp");
+				was_error = SDL_TRUE;
+				goto done;
+			}
+			break;
 		default:
 			SDL_SetError("Compressed BMP files not supported");
 			was_error = SDL_TRUE;
@@ -236,36 +371,34 @@ SDL_Surface * SDL_LoadBMP_RW (SDL_RWops *src, int freesrc)
 
 	/* Create a compatible surface, note that the colors are RGB ordered */
 	surface = SDL_CreateRGBSurface(SDL_SWSURFACE,
-			biWidth, biHeight, biBitCount, Rmask, Gmask, Bmask, 0);
+			biWidth, biHeight, biBitCount, Rmask, Gmask, Bmask, Amask);
 	if ( surface == NULL ) {
 		was_error = SDL_TRUE;
 		goto done;
 	}
 
-	/* Load the palette, if any */
+	/* Load the palette, if any, in one read */
 	palette = (surface->format)->palette;
 	if ( palette ) {
+		int size = (biSize == 12) ? 3 : 4;
+
 		if ( biClrUsed == 0 ) {
-			biClrUsed = 1 << biBitCount;
+			biClrUsed = 1 << (ExpandBMP ? ExpandBMP : biBitCount);
 		} else if ( biClrUsed > (1 << biBitCount) ) {
 			SDL_SetError("BMP file has an invalid number of colors");
 			was_error = SDL_TRUE;
 			goto done;
 		}
-		if ( biSize == 12 ) {
-			for ( i = 0; i < (int)biClrUsed; ++i ) {
-				SDL_RWread(src, &palette->colors[i].b, 1, 1);
-				SDL_RWread(src, &palette->colors[i].g, 1, 1);
-				SDL_RWread(src, &palette->colors[i].r, 1, 1);
-				palette->colors[i].unused = 0;
-			}	
-		} else {
-			for ( i = 0; i < (int)biClrUsed; ++i ) {
-				SDL_RWread(src, &palette->colors[i].b, 1, 1);
-				SDL_RWread(src, &palette->colors[i].g, 1, 1);
-				SDL_RWread(src, &palette->colors[i].r, 1, 1);
-				SDL_RWread(src, &palette->colors[i].unused, 1, 1);
-			}	
+		if ( SDL_RWread(src, colors, size, biClrUsed) != (int)biClrUsed ) {
+			SDL_Error(SDL_EFREAD);
+			was_error = SDL_TRUE;
+			goto done;
+		}
+		for ( i = 0; i < (int)biClrUsed; ++i ) {
+			palette->colors[i].b = colors[i*size+0];
+			palette->colors[i].g = colors[i*size+1];
+			palette->colors[i].r = colors[i*size+2];
+			palette->colors[i].unused = (size == 4) ? colors[i*size+3] : 0;
 		}
 		palette->ncolors = biClrUsed;
 	}
@@ -276,106 +409,149 @@ SDL_Surface * SDL_LoadBMP_RW (SDL_RWops *src, int freesrc)
 		was_error = SDL_TRUE;
 		goto done;
 	}
-	top = (Uint8 *)surface->pixels;
-	end = (Uint8 *)surface->pixels+(surface->h*surface->pitch);
-	switch (ExpandBMP) {
-		case 1:
+	if ( biCompression == BI_RLE8 || biCompression == BI_RLE4 ) {
+		/* Read all of the RLE data and decode it straight into place */
+		int end = SDL_RWseek(src, 0, RW_SEEK_END);
+		if ( end < 0 || SDL_RWseek(src,
+				fp_offset+bfOffBits, RW_SEEK_SET) < 0 ) {
+			SDL_Error(SDL_EFSEEK);
+			was_error = SDL_TRUE;
+			goto done;
+		}
+		datalen = 0;
+		if ( end > fp_offset+(long)bfOffBits ) {
+			datalen = end - (fp_offset+bfOffBits);
+		}
+		if ( biSizeImage && biSizeImage < datalen ) {
+			datalen = biSizeImage;
+		}
+		data = (Uint8 *)SDL_malloc(datalen ? datalen : 1);
+		if ( data == NULL ) {
+			SDL_OutOfMemory();
+			was_error = SDL_TRUE;
+			goto done;
+		}
+		nread = SDL_RWread(src, data, 1, datalen);
+		if ( nread < 0 ) {
+			SDL_Error(SDL_EFREAD);
+			was_error = SDL_TRUE;
+			goto done;
+		}
+		datalen = (Uint32)nread;
+		if ( DecodeRLE(surface, data, datalen,
+				(biCompression == BI_RLE4), topDown) < 0 ) {
+			was_error = SDL_TRUE;
+			goto done;
+		}
+	} else if ( ExpandBMP ) {
+		/* Read all of the packed rows, then expand each one */
+		if ( ExpandBMP == 1 ) {
 			bmpPitch = (biWidth + 7) >> 3;
-			pad  = (((bmpPitch)%4) ? (4-((bmpPitch)%4)) : 0);
-			break;
-		case 4:
+		} else {
 			bmpPitch = (biWidth + 1) >> 1;
-			pad  = (((bmpPitch)%4) ? (4-((bmpPitch)%4)) : 0);
-			break;
-		default:
-			pad  = ((surface->pitch%4) ?
-					(4-(surface->pitch%4)) : 0);
-			break;
-	}
-	if ( topDown ) {
-		bits = top;
-	} else {
-		bits = end - surface->pitch;
-	}
-	while ( bits >= top && bits < end ) {
-		switch (ExpandBMP) {
-			case 1:
-			case 4: {
-			Uint8 pixel = 0;
-			int   shift = (8-ExpandBMP);
-			for ( i=0; i<surface->w; ++i ) {
-				if ( i%(8/ExpandBMP) == 0 ) {
-					if ( !SDL_RWread(src, &pixel, 1, 1) ) {
-						SDL_SetError(
-					"Error reading from BMP");
-						was_error = SDL_TRUE;
-						goto done;
-					}
+		}
+		pad  = (((bmpPitch)%4) ? (4-((bmpPitch)%4)) : 0);
+		datalen = (bmpPitch+pad) * surface->h;
+		data = (Uint8 *)SDL_malloc(datalen);
+		if ( data == NULL ) {
+			SDL_OutOfMemory();
+			was_error = SDL_TRUE;
+			goto done;
+		}
+		/* The padding after the last row may be missing */
+		if ( SDL_RWread(src, data, 1, datalen) < (int)(datalen - pad) ) {
+			SDL_SetError("Error reading from BMP");
+			was_error = SDL_TRUE;
+			goto done;
+		}
+		for ( i = 0; i < surface->h; ++i ) {
+			const Uint8 *packed = data + i * (bmpPitch+pad);
+			int x;
+
+			bits = (Uint8 *)surface->pixels +
+				(topDown ? i : surface->h-1-i) * surface->pitch;
+			if ( ExpandBMP == 1 ) {
+				for ( x = 0; x < surface->w; ++x ) {
+					bits[x] = (packed[x>>3] >> (7-(x&7))) & 1;
 				}
-				*(bits+i) = (pixel>>shift);
-				pixel <<= ExpandBMP;
-				if ( bits[i] >= biClrUsed ) {
-					SDL_SetError(
-						"A BMP image contains a pixel with a color out of the palette");
-					was_error = SDL_TRUE;
-					goto done;
+			} else {
+				for ( x = 0; x < surface->w; ++x ) {
+					bits[x] = (x & 1) ? (packed[x>>1] & 0x0F) :
+							    (packed[x>>1] >> 4);
 				}
-			} }
-			break;
+			}
+		}
+	} else {
+		/* The rows are 4 byte aligned, just like the surface */
+		if ( SDL_RWread(src, surface->pixels, surface->pitch, surface->h)
+							 != surface->h ) {
+			SDL_Error(SDL_EFREAD);
+			was_error = SDL_TRUE;
+			goto done;
+		}
+		if ( !topDown ) {
+			Uint8 *top = (Uint8 *)surface->pixels;
+			Uint8 *bottom = top + (surface->h-1) * surface->pitch;
 
-			default:
-			if ( SDL_RWread(src, bits, 1, surface->pitch)
-							 != surface->pitch ) {
-				SDL_Error(SDL_EFREAD);
+			data = (Uint8 *)SDL_malloc(surface->pitch);
+			if ( data == NULL ) {
+				SDL_OutOfMemory();
 				was_error = SDL_TRUE;
 				goto done;
 			}
-			if ( 8 == biBitCount && palette && biClrUsed < (1 << biBitCount ) ) {
-				for ( i=0; i<surface->w; ++i ) {
-					if ( bits[i] >= biClrUsed ) {
-						SDL_SetError(
-							"A BMP image contains a pixel with a color out of the palette");
-						was_error = SDL_TRUE;
-						goto done;
-					}
-				}
+			while ( top < bottom ) {
+				SDL_memcpy(data, top, surface->pitch);
+				SDL_memcpy(top, bottom, surface->pitch);
+				SDL_memcpy(bottom, data, surface->pitch);
+				top += surface->pitch;
+				bottom -= surface->pitch;
 			}
+		}
 #if SDL_BYTEORDER == SDL_BIG_ENDIAN
-			/* Byte-swap the pixels if needed. Note that the 24bpp
-			   case has already been taken care of above. */
+		/* Byte-swap the pixels if needed. Note that the 24bpp
+		   case has already been taken care of above. */
+		bits = (Uint8 *)surface->pixels;
+		for ( i = 0; i < surface->h; ++i, bits += surface->pitch ) {
+			int x;
 			switch(biBitCount) {
 				case 15:
 				case 16: {
 				        Uint16 *pix = (Uint16 *)bits;
-					for(i = 0; i < surface->w; i++)
-					        pix[i] = SDL_Swap16(pix[i]);
+					for(x = 0; x < surface->w; x++)
+					        pix[x] = SDL_Swap16(pix[x]);
 					break;
 				}
 
 				case 32: {
 				        Uint32 *pix = (Uint32 *)bits;
-					for(i = 0; i < surface->w; i++)
-					        pix[i] = SDL_Swap32(pix[i]);
+					for(x = 0; x < surface->w; x++)
+					        pix[x] = SDL_Swap32(pix[x]);
 					break;
 				}
 			}
-#endif
-			break;
 		}
-		/* Skip padding bytes, ugh */
-		if ( pad ) {
-			Uint8 padbyte;
-			for ( i=0; i<pad; ++i ) {
-				SDL_RWread(src, &padbyte, 1, 1);
+#endif
+	}
+
+	/* Make sure every pixel has a color in the palette */
+	if ( palette && biClrUsed < (1 << biBitCount) ) {
+		bits = (Uint8 *)surface->pixels;
+		for ( i = 0; i < surface->h; ++i, bits += surface->pitch ) {
+			int x;
+			for ( x = 0; x < surface->w; ++x ) {
+				if ( bits[x] >= biClrUsed ) {
+					SDL_SetError(
+						"A BMP image contains a pixel with a color out of the palette");
+					was_error = SDL_TRUE;
+					goto done;
+				}
 			}
 		}
-		if ( topDown ) {
-			bits += surface->pitch;
-		} else {
-			bits -= surface->pitch;
-		}
 	}
 done:
+	if ( data ) {
+		SDL_free(data);
+	}
 	if ( was_error ) {
 		if ( src ) {
 			SDL_RWseek(src, fp_offset, RW_SEEK_SET);
@@ -30,6 +30,7 @@
 #include "SDL_sysvideo.h"
 #include "SDL_cursor_c.h"
 #include "SDL_pixels_c.h"
+#include "SDL_present_c.h"
 #include "default_cursor.h"
 #include "../events/SDL_sysevents.h"
 #include "../events/SDL_events_c.h"
@@ -153,8 +154,10 @@ SDL_Cursor * SDL_CreateCursor (Uint8 *data, Uint8 *mask,
 
 	/* If the window manager gives us a good cursor, we're done! */
 	if ( video->CreateWMCursor ) {
+		SDL_LockPresent(video);
 		cursor->wm_cursor = video->CreateWMCursor(video, data, mask,
 							w, h, hot_x, hot_y);
+		SDL_UnlockPresent(video);
 	} else {
 		cursor->wm_cursor = NULL;
 	}
@@ -175,7 +178,11 @@ void SDL_SetCursor (SDL_Cursor *cursor)
 		return;
 	}
 
-	/* Prevent the event thread from moving the mouse */
+	/* Keep the presentation thread out of the driver, and prevent the
+	   event thread from moving the mouse.  The presentation thread takes
+	   the locks in the same order.
+	 */
+	SDL_LockPresent(video);
 	SDL_LockCursor();
 
 	/* Set the new cursor */
@@ -229,6 +236,7 @@ void SDL_SetCursor (SDL_Cursor *cursor)
 		}
 	}
 	SDL_UnlockCursor();
+	SDL_UnlockPresent(video);
 }
 
 SDL_Cursor * SDL_GetCursor (void)
@@ -254,7 +262,9 @@ void SDL_FreeCursor (SDL_Cursor *cursor)
 			}
 			if ( video && cursor->wm_cursor ) {
 				if ( video->FreeWMCursor ) {
+					SDL_LockPresent(video);
 					video->FreeWMCursor(this, cursor->wm_cursor);
+					SDL_UnlockPresent(video);
 				}
 			}
 			SDL_free(cursor);
@@ -281,7 +291,9 @@ int SDL_ShowCursor (int toggle)
 
 			SDL_SetCursor(NULL);
 			if ( video && video->CheckMouseMode ) {
+				SDL_LockPresent(video);
 				video->CheckMouseMode(this);
+				SDL_UnlockPresent(video);
 			}
 		}
 	} else {
@@ -312,7 +324,9 @@ void SDL_WarpMouse (Uint16 x, Uint16 y)
 
 	/* This generates a mouse motion event */
 	if ( video->WarpWMCursor ) {
+		SDL_LockPresent(video);
 		video->WarpWMCursor(this, x, y);
+		SDL_UnlockPresent(video);
 	} else {
 		SDL_PrivateMouseMotion(0, 0, x, y);
 	}
@@ -325,14 +339,18 @@ void SDL_MoveCursor(int x, int y)
 	/* Erase and update the current mouse position */
 	if ( SHOULD_DRAWCURSOR(SDL_cursorstate) ) {
 		/* Erase and redraw mouse cursor in new position */
+		SDL_LockPresent(video);
 		SDL_LockCursor();
 		SDL_EraseCursor(SDL_VideoSurface);
 		SDL_cursor->area.x = (x - SDL_cursor->hot_x);
 		SDL_cursor->area.y = (y - SDL_cursor->hot_y);
 		SDL_DrawCursor(SDL_VideoSurface);
 		SDL_UnlockCursor();
+		SDL_UnlockPresent(video);
 	} else if ( video->MoveWMCursor ) {
+		SDL_LockPresent(video);
 		video->MoveWMCursor(video, x, y);
+		SDL_UnlockPresent(video);
 	}
 }
 
@@ -0,0 +1,310 @@
+/*
+    SDL - Simple DirectMedia Layer
+    Copyright (C) 1997-2012 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+#include "SDL_config.h"
+
+/* Frame timing statistics for SDL_Flip() and SDL_UpdateRects() */
+
+#if defined(SDL_TIMER_UNIX)
+#include <sys/time.h>
+#if HAVE_CLOCK_GETTIME
+#include <time.h>
+#endif
+#elif defined(SDL_TIMER_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+
+#include "SDL_video.h"
+#include "SDL_timer.h"
+#include "SDL_thread.h"
+#include "SDL_sysvideo.h"
+#include "SDL_framestats_c.h"
+
+struct SDL_FrameData {
+	SDL_mutex *lock;
+	SDL_FrameStats stats;
+	SDL_FrameTiming history[SDL_FRAMESTATS_HISTORY];
+	int head;		/* Where the next frame goes */
+
+	/* The frame being timed by SDL_FrameBegin(), also under the lock */
+	SDL_FrameTiming pending;
+	int nesting;
+};
+
+Uint32 SDL_FrameTime(void)
+{
+#if defined(SDL_TIMER_UNIX) && HAVE_CLOCK_GETTIME
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (Uint32)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+#elif defined(SDL_TIMER_UNIX)
+	struct timeval now;
+
+	gettimeofday(&now, NULL);
+	return (Uint32)now.tv_sec * 1000000 + now.tv_usec;
+#elif defined(SDL_TIMER_WIN32)
+	static LARGE_INTEGER hires_ticks_per_second;
+	LARGE_INTEGER now;
+
+	if ( !hires_ticks_per_second.QuadPart &&
+	     !QueryPerformanceFrequency(&hires_ticks_per_second) ) {
+		return SDL_GetTicks() * 1000;
+	}
+	QueryPerformanceCounter(&now);
+	return (Uint32)(now.QuadPart * 1000000 /
+	                hires_ticks_per_second.QuadPart);
+#else
+	return SDL_GetTicks() * 1000;
+#endif
+}
+
+/* Histogram bucket for a duration in microseconds */
+static int SDL_FrameBucket(Uint32 time)
+{
+	int bucket = 0;
+
+	time >>= 5;
+	while ( time > 1 && bucket < SDL_FRAMESTATS_BUCKETS-1 ) {
+		time >>= 1;
+		++bucket;
+	}
+	return bucket;
+}
+
+int SDL_FrameStatsInit(SDL_VideoDevice *video)
+{
+	SDL_FrameData *data;
+
+	data = (SDL_FrameData *)SDL_malloc(sizeof(*data));
+	if ( ! data ) {
+		SDL_OutOfMemory();
+		return(-1);
+	}
+	SDL_memset(data, 0, sizeof(*data));
+	data->lock = SDL_CreateMutex();
+	if ( ! data->lock ) {
+		SDL_free(data);
+		return(-1);
+	}
+
+	video->framestats = data;
+	return(0);
+}
+
+void SDL_FrameStatsQuit(SDL_VideoDevice *video)
+{
+	SDL_FrameData *data = video->framestats;
+
+	if ( data ) {
+		SDL_DestroyMutex(data->lock);
+		SDL_free(data);
+		video->framestats = NULL;
+	}
+}
+
+/* Add a frame to the history, with the lock held */
+static void SDL_AddFrame(SDL_FrameData *data, SDL_FrameTiming *timing)
+{
+	SDL_FrameStats *stats = &data->stats;
+	SDL_FrameTiming *oldest;
+	SDL_FrameTiming *prev;
+
+	if ( stats->count == SDL_FRAMESTATS_HISTORY ) {
+		/* Forget the oldest frame in the histograms */
+		oldest = &data->history[data->head];
+		--stats->blit_time[SDL_FrameBucket(oldest->blit-oldest->begin)];
+		--stats->upload_time[SDL_FrameBucket(oldest->upload-oldest->blit)];
+		prev = oldest;
+		oldest = &data->history[(data->head+1) % SDL_FRAMESTATS_HISTORY];
+		--stats->interval[SDL_FrameBucket(oldest->begin - prev->begin)];
+		--stats->count;
+	}
+	if ( stats->count > 0 ) {
+		prev = &data->history[(data->head + SDL_FRAMESTATS_HISTORY - 1) %
+		                      SDL_FRAMESTATS_HISTORY];
+		++stats->interval[SDL_FrameBucket(timing->begin - prev->begin)];
+	}
+	++stats->blit_time[SDL_FrameBucket(timing->blit - timing->begin)];
+	++stats->upload_time[SDL_FrameBucket(timing->upload - timing->blit)];
+	++stats->count;
+	++stats->frames;
+
+	data->history[data->head] = *timing;
+	data->head = (data->head + 1) % SDL_FRAMESTATS_HISTORY;
+	stats->last = *timing;
+}
+
+void SDL_FrameBegin(SDL_VideoDevice *video)
+{
+	SDL_FrameData *data = video->framestats;
+
+	if ( ! data ) {
+		return;
+	}
+	SDL_mutexP(data->lock);
+	if ( data->nesting == 0 ) {
+		SDL_memset(&data->pending, 0, sizeof(data->pending));
+		data->pending.begin = SDL_FrameTime();
+	}
+	++data->nesting;
+	SDL_mutexV(data->lock);
+}
+
+void SDL_FrameBlitted(SDL_VideoDevice *video)
+{
+	SDL_FrameData *data = video->framestats;
+
+	if ( ! data ) {
+		return;
+	}
+	SDL_mutexP(data->lock);
+	if ( data->nesting ) {
+		data->pending.blit = SDL_FrameTime();
+	}
+	SDL_mutexV(data->lock);
+}
+
+void SDL_FrameEnd(SDL_VideoDevice *video)
+{
+	SDL_FrameData *data = video->framestats;
+
+	if ( ! data ) {
+		return;
+	}
+	SDL_mutexP(data->lock);
+	if ( data->nesting == 1 ) {
+		data->pending.upload = SDL_FrameTime();
+		if ( ! data->pending.blit ) {
+			/* Nothing needed converting */
+			data->pending.blit = data->pending.begin;
+		}
+		SDL_AddFrame(data, &data->pending);
+	}
+	if ( data->nesting > 0 ) {
+		--data->nesting;
+	}
+	SDL_mutexV(data->lock);
+}
+
+void SDL_FrameRecord(SDL_VideoDevice *video, SDL_FrameTiming *timing)
+{
+	SDL_FrameData *data = video->framestats;
+
+	if ( data ) {
+		SDL_mutexP(data->lock);
+		SDL_AddFrame(data, timing);
+		SDL_mutexV(data->lock);
+	}
+}
+
+void SDL_FrameVBlank(SDL_VideoDevice *video, Uint32 when)
+{
+	SDL_FrameData *data = video->framestats;
+	int last;
+
+	if ( ! data ) {
+		return;
+	}
+
+	SDL_mutexP(data->lock);
+	if ( data->nesting ) {
+		/* A display thread can show the frame before SDL_Flip() returns */
+		data->pending.vblank = when;
+	} else if ( data->stats.count > 0 && ! data->stats.last.vblank ) {
+		last = (data->head + SDL_FRAMESTATS_HISTORY - 1) %
+		       SDL_FRAMESTATS_HISTORY;
+		data->history[last].vblank = when;
+		data->stats.last.vblank = when;
+	}
+	SDL_mutexV(data->lock);
+}
+
+void SDL_FrameDropped(SDL_VideoDevice *video)
+{
+	SDL_FrameData *data = video->framestats;
+
+	if ( data ) {
+		SDL_mutexP(data->lock);
+		++data->stats.dropped;
+		SDL_mutexV(data->lock);
+	}
+}
+
+int SDL_GetFrameStats(SDL_FrameStats *stats)
+{
+	SDL_VideoDevice *video = current_video;
+	SDL_FrameData *data;
+
+	if ( !video || !video->framestats ) {
+		SDL_SetError("Video subsystem has not been initialized");
+		return(-1);
+	}
+	data = video->framestats;
+
+	SDL_mutexP(data->lock);
+	*stats = data->stats;
+	SDL_mutexV(data->lock);
+	return(0);
+}
+
+int SDL_GetFrameTimings(SDL_FrameTiming *timings, int maxtimings)
+{
+	SDL_VideoDevice *video = current_video;
+	SDL_FrameData *data;
+	int i, count, first;
+
+	if ( !video || !video->framestats ) {
+		SDL_SetError("Video subsystem has not been initialized");
+		return(-1);
+	}
+	data = video->framestats;
+
+	SDL_mutexP(data->lock);
+	count = data->stats.count;
+	if ( count > maxtimings ) {
+		count = (maxtimings > 0) ? maxtimings : 0;
+	}
+	first = data->head + SDL_FRAMESTATS_HISTORY - count;
+	for ( i=0; i<count; ++i ) {
+		timings[i] = data->history[(first+i) % SDL_FRAMESTATS_HISTORY];
+	}
+	SDL_mutexV(data->lock);
+	return(count);
+}
+
+void SDL_ResetFrameStats(void)
+{
+	SDL_VideoDevice *video = current_video;
+
+	SDL_FrameData *data;
+
+	if ( !video || !video->framestats ) {
+		return;
+	}
+	data = video->framestats;
+
+	SDL_mutexP(data->lock);
+	SDL_memset(&data->stats, 0, sizeof(data->stats));
+	data->head = 0;
+	SDL_mutexV(data->lock);
+}
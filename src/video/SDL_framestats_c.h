@@ -0,0 +1,49 @@
+/*
+    SDL - Simple DirectMedia Layer
+    Copyright (C) 1997-2012 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+#include "SDL_config.h"
+
+/* Useful functions and variables from SDL_framestats.c */
+#include "SDL_sysvideo.h"
+
+extern int SDL_FrameStatsInit(SDL_VideoDevice *video);
+extern void SDL_FrameStatsQuit(SDL_VideoDevice *video);
+
+/* The clock used for the frame timestamps, in microseconds */
+extern Uint32 SDL_FrameTime(void);
+
+/* Time a frame presented on the calling thread.  These calls may nest,
+   the frame is recorded when the outermost SDL_FrameEnd() is reached.
+ */
+extern void SDL_FrameBegin(SDL_VideoDevice *video);
+extern void SDL_FrameBlitted(SDL_VideoDevice *video);
+extern void SDL_FrameEnd(SDL_VideoDevice *video);
+
+/* Record a frame timed by another thread */
+extern void SDL_FrameRecord(SDL_VideoDevice *video, SDL_FrameTiming *timing);
+
+/* The driver put the current, or else the last recorded, frame on the
+   screen at 'when'.
+ */
+extern void SDL_FrameVBlank(SDL_VideoDevice *video, Uint32 when);
+
+/* A frame was replaced before it could be shown */
+extern void SDL_FrameDropped(SDL_VideoDevice *video);
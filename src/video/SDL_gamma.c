@@ -36,6 +36,7 @@
 #endif
 
 #include "SDL_sysvideo.h"
+#include "SDL_present_c.h"
 
 
 static void CalculateGammaRamp(float gamma, Uint16 *ramp)
@@ -186,7 +187,9 @@ int SDL_SetGammaRamp(const Uint16 *red, const Uint16 *green, const Uint16 *blue)
 	/* Try to set the gamma ramp in the driver */
 	succeeded = -1;
 	if ( video->SetGammaRamp ) {
+		SDL_LockPresent(video);
 		succeeded = video->SetGammaRamp(this, video->gamma);
+		SDL_UnlockPresent(video);
 	} else {
 		SDL_SetError("Gamma ramp manipulation not supported");
 	}
@@ -0,0 +1,328 @@
+/*
+    SDL - Simple DirectMedia Layer
+    Copyright (C) 1997-2012 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+#include "SDL_config.h"
+
+/* Presentation thread for software video surfaces.
+
+   The application draws into the shadow surface, and SDL_Flip() only trades
+   the buffer behind it for another one.  A separate thread converts the
+   finished frame into the video surface and calls the driver's UpdateRects.
+
+   With three buffers the frames are traded through a mailbox word: a flip
+   never waits, and a frame the thread didn't get to in time is dropped.
+   With two buffers a flip waits until the previous frame has been shown.
+ */
+
+#include "SDL_thread.h"
+#include "SDL_hints.h"
+#include "SDL_sysvideo.h"
+#include "SDL_blit.h"
+#include "SDL_pixels_c.h"
+#include "SDL_cursor_c.h"
+#include "SDL_present_c.h"
+#include "SDL_framestats_c.h"
+#include "../events/SDL_events_c.h"
+#include "../thread/SDL_atomic_c.h"
+
+#define PRESENT_INDEX	0x03
+#define PRESENT_FRESH	0x04
+
+struct SDL_PresentQueue {
+	int nbuffers;
+	SDL_Surface *buffers[3];
+	Uint32 flipped[3];	/* When each frame was handed over */
+	void *pixels;		/* The shadow surface's own pixels */
+	int back;		/* Drawn on by the application */
+	int front;		/* Shown by the presentation thread */
+	volatile int mailbox;	/* Index of the next frame | PRESENT_FRESH */
+	volatile int stop;
+	SDL_mutex *lock;
+	SDL_sem *wake;
+	SDL_sem *idle;		/* Only used with two buffers */
+	SDL_Thread *thread;
+};
+
+int SDL_WantPresentThread(Uint32 flags)
+{
+	const char *variable;
+
+	if ( flags & (SDL_HWSURFACE|SDL_DOUBLEBUF|SDL_OPENGL|SDL_OPENGLBLIT) ) {
+		return(0);
+	}
+	variable = SDL_GetHint(SDL_HINT_VIDEO_PRESENT_THREAD);
+	return(variable && SDL_atoi(variable) > 0);
+}
+
+/* Copy the colors the frame should be shown with into the buffer palette */
+static void SDL_PresentPalette(SDL_VideoDevice *video, SDL_Surface *buffer)
+{
+	SDL_Palette *pal = SDL_ShadowSurface->format->palette;
+	SDL_Color *colors;
+	int size;
+
+	if ( ! pal ) {
+		return;
+	}
+	colors = pal->colors;
+	if ( !(SDL_VideoSurface->flags & SDL_HWPALETTE) ) {
+		/* simulated 8bpp, use correct physical palette */
+		if ( video->gammacols ) {
+			colors = video->gammacols;
+		} else if ( video->physpal ) {
+			colors = video->physpal->colors;
+		}
+	}
+	size = pal->ncolors * sizeof(SDL_Color);
+	if ( SDL_memcmp(buffer->format->palette->colors, colors, size) != 0 ) {
+		SDL_memcpy(buffer->format->palette->colors, colors, size);
+		SDL_InvalidateMap(buffer->map);
+	}
+}
+
+static void SDL_PresentBuffer(SDL_VideoDevice *video, int index)
+{
+	SDL_VideoDevice *this = video;
+	SDL_Surface *buffer = video->present->buffers[index];
+	SDL_FrameTiming timing;
+	SDL_Rect rect;
+
+	SDL_memset(&timing, 0, sizeof(timing));
+	timing.begin = video->present->flipped[index];
+
+	rect.x = 0;
+	rect.y = 0;
+	rect.w = buffer->w;
+	rect.h = buffer->h;
+
+	SDL_mutexP(video->present->lock);
+	SDL_LockCursor();
+	if ( SHOULD_DRAWCURSOR(SDL_cursorstate) ) {
+		SDL_DrawCursor(buffer);
+		SDL_LowerBlit(buffer, &rect, SDL_VideoSurface, &rect);
+		SDL_EraseCursor(buffer);
+	} else {
+		SDL_LowerBlit(buffer, &rect, SDL_VideoSurface, &rect);
+	}
+	SDL_UnlockCursor();
+	timing.blit = SDL_FrameTime();
+
+	rect.x = video->offset_x;
+	rect.y = video->offset_y;
+	rect.w = buffer->w;
+	rect.h = buffer->h;
+	video->UpdateRects(this, 1, &rect);
+	timing.upload = SDL_FrameTime();
+	SDL_mutexV(video->present->lock);
+
+	SDL_FrameRecord(video, &timing);
+}
+
+static int SDLCALL SDL_PresentThread(void *data)
+{
+	SDL_VideoDevice *video = (SDL_VideoDevice *)data;
+	SDL_PresentQueue *queue = video->present;
+	int mailbox;
+
+	for ( ; ; ) {
+		SDL_SemWait(queue->wake);
+		if ( SDL_AtomicGet(&queue->stop) ) {
+			break;
+		}
+
+		mailbox = SDL_AtomicGet(&queue->mailbox);
+		if ( !(mailbox & PRESENT_FRESH) ) {
+			continue;
+		}
+		if ( queue->nbuffers == 2 ) {
+			/* The application waits for us, take the frame as is */
+			queue->front = (mailbox & PRESENT_INDEX);
+		} else {
+			mailbox = SDL_AtomicSet(&queue->mailbox, queue->front);
+			queue->front = (mailbox & PRESENT_INDEX);
+		}
+
+		SDL_PresentBuffer(video, queue->front);
+
+		if ( queue->nbuffers == 2 ) {
+			SDL_AtomicSet(&queue->mailbox, queue->front);
+			SDL_SemPost(queue->idle);
+		}
+	}
+	return(0);
+}
+
+static void SDL_FreePresentQueue(SDL_PresentQueue *queue)
+{
+	int i;
+
+	for ( i=0; i<(int)SDL_arraysize(queue->buffers); ++i ) {
+		if ( queue->buffers[i] ) {
+			SDL_FreeSurface(queue->buffers[i]);
+		}
+	}
+	if ( queue->lock ) {
+		SDL_DestroyMutex(queue->lock);
+	}
+	if ( queue->wake ) {
+		SDL_DestroySemaphore(queue->wake);
+	}
+	if ( queue->idle ) {
+		SDL_DestroySemaphore(queue->idle);
+	}
+	SDL_free(queue);
+}
+
+int SDL_StartPresentThread(SDL_VideoDevice *video)
+{
+	SDL_Surface *screen = SDL_ShadowSurface;
+	SDL_PixelFormat *format;
+	SDL_PresentQueue *queue;
+	const char *variable;
+	int i;
+
+	if ( ! screen ) {
+		SDL_SetError("No shadow surface to present");
+		return(-1);
+	}
+	format = screen->format;
+
+	queue = (SDL_PresentQueue *)SDL_malloc(sizeof(*queue));
+	if ( ! queue ) {
+		SDL_OutOfMemory();
+		return(-1);
+	}
+	SDL_memset(queue, 0, sizeof(*queue));
+
+	queue->nbuffers = 3;
+	variable = SDL_GetHint(SDL_HINT_VIDEO_PRESENT_BUFFERS);
+	if ( variable && SDL_atoi(variable) == 2 ) {
+		queue->nbuffers = 2;
+	}
+
+	/* The first buffer is the shadow surface's own memory */
+	queue->pixels = screen->pixels;
+	for ( i=0; i<queue->nbuffers; ++i ) {
+		if ( i == 0 ) {
+			queue->buffers[i] = SDL_CreateRGBSurfaceFrom(
+				screen->pixels, screen->w, screen->h,
+				format->BitsPerPixel, screen->pitch,
+				format->Rmask, format->Gmask, format->Bmask, 0);
+		} else {
+			queue->buffers[i] = SDL_CreateRGBSurface(SDL_SWSURFACE,
+				screen->w, screen->h, format->BitsPerPixel,
+				format->Rmask, format->Gmask, format->Bmask, 0);
+		}
+		if ( ! queue->buffers[i] ) {
+			SDL_FreePresentQueue(queue);
+			return(-1);
+		}
+		if ( queue->buffers[i]->pitch != screen->pitch ) {
+			SDL_SetError("Present buffer doesn't match the screen");
+			SDL_FreePresentQueue(queue);
+			return(-1);
+		}
+	}
+	queue->back = 0;
+	queue->mailbox = 1;
+	queue->front = 2;
+
+	queue->lock = SDL_CreateMutex();
+	queue->wake = SDL_CreateSemaphore(0);
+	queue->idle = SDL_CreateSemaphore(1);
+	if ( !queue->lock || !queue->wake || !queue->idle ) {
+		SDL_FreePresentQueue(queue);
+		return(-1);
+	}
+
+	SDL_Lock_EventThread();
+	video->present = queue;
+	SDL_Unlock_EventThread();
+
+	queue->thread = SDL_CreateThread(SDL_PresentThread, video);
+	if ( ! queue->thread ) {
+		SDL_Lock_EventThread();
+		video->present = NULL;
+		SDL_Unlock_EventThread();
+		SDL_FreePresentQueue(queue);
+		return(-1);
+	}
+	return(0);
+}
+
+void SDL_StopPresentThread(SDL_VideoDevice *video)
+{
+	SDL_PresentQueue *queue = video->present;
+
+	if ( ! queue ) {
+		return;
+	}
+
+	SDL_AtomicSet(&queue->stop, 1);
+	SDL_SemPost(queue->wake);
+	SDL_WaitThread(queue->thread, NULL);
+
+	/* Give the shadow surface its own memory back */
+	if ( SDL_ShadowSurface ) {
+		SDL_ShadowSurface->pixels = queue->pixels;
+	}
+
+	SDL_Lock_EventThread();
+	video->present = NULL;
+	SDL_Unlock_EventThread();
+	SDL_FreePresentQueue(queue);
+}
+
+int SDL_PresentFlip(SDL_VideoDevice *video)
+{
+	SDL_PresentQueue *queue = video->present;
+	int mailbox;
+
+	SDL_PresentPalette(video, queue->buffers[queue->back]);
+
+	if ( queue->nbuffers == 2 ) {
+		SDL_SemWait(queue->idle);
+	}
+	queue->flipped[queue->back] = SDL_FrameTime();
+	mailbox = SDL_AtomicSet(&queue->mailbox, queue->back|PRESENT_FRESH);
+	if ( mailbox & PRESENT_FRESH ) {
+		SDL_FrameDropped(video);
+	}
+	queue->back = (mailbox & PRESENT_INDEX);
+	SDL_ShadowSurface->pixels = queue->buffers[queue->back]->pixels;
+	SDL_SemPost(queue->wake);
+
+	return(0);
+}
+
+void SDL_LockPresent(SDL_VideoDevice *video)
+{
+	if ( video && video->present ) {
+		SDL_mutexP(video->present->lock);
+	}
+}
+
+void SDL_UnlockPresent(SDL_VideoDevice *video)
+{
+	if ( video && video->present ) {
+		SDL_mutexV(video->present->lock);
+	}
+}
@@ -0,0 +1,47 @@
+/*
+    SDL - Simple DirectMedia Layer
+    Copyright (C) 1997-2012 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+#include "SDL_config.h"
+
+/* Useful functions and variables from SDL_present.c */
+#include "SDL_sysvideo.h"
+
+/* Returns non-zero if a mode set with these flags should be presented from
+   a separate thread (SDL_VIDEO_PRESENT_THREAD)
+ */
+extern int SDL_WantPresentThread(Uint32 flags);
+
+/* Start presenting the shadow surface from a separate thread.
+   On failure SDL_Flip() just keeps updating the screen synchronously.
+ */
+extern int SDL_StartPresentThread(SDL_VideoDevice *video);
+extern void SDL_StopPresentThread(SDL_VideoDevice *video);
+
+/* Hand the shadow surface to the presentation thread and continue drawing
+   on another back buffer.  The new back buffer holds an older frame.
+ */
+extern int SDL_PresentFlip(SDL_VideoDevice *video);
+
+/* Serialize access to the video surface and the driver with the
+   presentation thread.  These do nothing if it isn't running.
+ */
+extern void SDL_LockPresent(SDL_VideoDevice *video);
+extern void SDL_UnlockPresent(SDL_VideoDevice *video);
@@ -40,6 +40,12 @@
 /* The SDL video driver */
 typedef struct SDL_VideoDevice SDL_VideoDevice;
 
+/* The presentation thread state, see SDL_present.c */
+typedef struct SDL_PresentQueue SDL_PresentQueue;
+
+/* Frame timing statistics, see SDL_framestats.c */
+typedef struct SDL_FrameData SDL_FrameData;
+
 /* Define the SDL video driver structure */
 #define _THIS	SDL_VideoDevice *_this
 #ifndef _STATUS
@@ -274,6 +280,12 @@ struct SDL_VideoDevice {
 	/* Driver information flags */
 	int handles_any_size;	/* Driver handles any size video mode */
 
+	/* Presentation thread, if SDL_Flip() is asynchronous */
+	SDL_PresentQueue *present;
+
+	/* Timing of the frames shown, for SDL_GetFrameStats() */
+	SDL_FrameData *framestats;
+
 	/* * * */
 	/* Data used by the GL drivers */
 	struct {
@@ -28,6 +28,8 @@
 #include "SDL_blit.h"
 #include "SDL_pixels_c.h"
 #include "SDL_cursor_c.h"
+#include "SDL_present_c.h"
+#include "SDL_framestats_c.h"
 #include "../events/SDL_sysevents.h"
 #include "../events/SDL_events_c.h"
 
@@ -225,6 +227,8 @@ int SDL_VideoInit (const char *driver_name, Uint32 flags)
 	video->wm_icon  = NULL;
 	video->offset_x = 0;
 	video->offset_y = 0;
+	video->present = NULL;
+	video->framestats = NULL;
 	SDL_memset(&video->info, 0, (sizeof video->info));
 	
 	video->displayformatalphapixel = NULL;
@@ -256,6 +260,10 @@ int SDL_VideoInit (const char *driver_name, Uint32 flags)
 		SDL_VideoQuit();
 		return(-1);
 	}
+	if ( SDL_FrameStatsInit(video) < 0 ) {
+		SDL_VideoQuit();
+		return(-1);
+	}
 
 	/* Create a zero sized video surface of the appropriate format */
 	video_flags = SDL_SWSURFACE;
@@ -663,6 +671,7 @@ SDL_Surface * SDL_SetVideoMode (int width, int height, int bpp, Uint32 flags)
 	SDL_cursorstate &= ~CURSOR_USINGSW;
 
 	/* Clean up any previous video mode */
+	SDL_StopPresentThread(video);
 	if ( SDL_PublicSurface != NULL ) {
 		SDL_PublicSurface = NULL;
 	}
@@ -919,12 +928,27 @@ SDL_Surface * SDL_SetVideoMode (int width, int height, int bpp, Uint32 flags)
 			return(NULL);
 		}
 		SDL_PublicSurface = SDL_ShadowSurface;
+	} else if ( !(SDL_VideoSurface->flags & SDL_OPENGL) &&
+	            SDL_WantPresentThread(flags) ) {
+		/* The presentation thread needs a surface to swap buffers on */
+		SDL_CreateShadowSurface(SDL_VideoSurface->format->BitsPerPixel);
+		if ( SDL_ShadowSurface == NULL ) {
+			SDL_SetError("Couldn't create shadow surface");
+			return(NULL);
+		}
+		SDL_PublicSurface = SDL_ShadowSurface;
 	} else {
 		SDL_PublicSurface = SDL_VideoSurface;
 	}
+	if ( (SDL_PublicSurface == SDL_ShadowSurface) &&
+	     SDL_WantPresentThread(flags) ) {
+		/* Not fatal, SDL_Flip() just stays synchronous */
+		SDL_StartPresentThread(video);
+	}
 	video->info.vfmt = SDL_VideoSurface->format;
 	video->info.current_w = SDL_VideoSurface->w;
 	video->info.current_h = SDL_VideoSurface->h;
+	SDL_ResetFrameStats();
 
 	/* We're done! */
 	return(SDL_PublicSurface);
@@ -1048,11 +1072,18 @@ void SDL_UpdateRects (SDL_Surface *screen, int numrects, SDL_Rect *rects)
 	int i;
 	SDL_VideoDevice *video = current_video;
 	SDL_VideoDevice *this = current_video;
+	/* Updates of other surfaces do nothing, so they aren't frames */
+	int is_frame = (screen == SDL_ShadowSurface ||
+	                screen == SDL_VideoSurface);
 
 	if ( (screen->flags & (SDL_OPENGL | SDL_OPENGLBLIT)) == SDL_OPENGL ) {
 		SDL_SetError("OpenGL active, use SDL_GL_SwapBuffers()");
 		return;
 	}
+	SDL_LockPresent(video);
+	if ( is_frame ) {
+		SDL_FrameBegin(video);
+	}
 	if ( screen == SDL_ShadowSurface ) {
 		/* Blit the shadow surface using saved mapping */
 		SDL_Palette *pal = screen->format->palette;
@@ -1086,6 +1117,7 @@ void SDL_UpdateRects (SDL_Surface *screen, int numrects, SDL_Rect *rects)
 		if ( saved_colors ) {
 			pal->colors = saved_colors;
 		}
+		SDL_FrameBlitted(video);
 
 		/* Fall through to video surface update */
 		screen = SDL_VideoSurface;
@@ -1106,6 +1138,10 @@ void SDL_UpdateRects (SDL_Surface *screen, int numrects, SDL_Rect *rects)
 			video->UpdateRects(this, numrects, rects);
 		}
 	}
+	if ( is_frame ) {
+		SDL_FrameEnd(video);
+	}
+	SDL_UnlockPresent(video);
 }
 
 /*
@@ -1114,6 +1150,16 @@ void SDL_UpdateRects (SDL_Surface *screen, int numrects, SDL_Rect *rects)
 int SDL_Flip(SDL_Surface *screen)
 {
 	SDL_VideoDevice *video = current_video;
+	int retval = 0;
+	int is_frame = (screen == SDL_ShadowSurface ||
+	                screen == SDL_VideoSurface);
+	/* Let the presentation thread copy the shadow surface, if running */
+	if ( (screen == SDL_ShadowSurface) && video->present ) {
+		return(SDL_PresentFlip(video));
+	}
+	if ( is_frame ) {
+		SDL_FrameBegin(video);
+	}
 	/* Copy the shadow surface to the video surface */
 	if ( screen == SDL_ShadowSurface ) {
 		SDL_Rect rect;
@@ -1149,17 +1195,21 @@ int SDL_Flip(SDL_Surface *screen)
 		if ( saved_colors ) {
 			pal->colors = saved_colors;
 		}
+		SDL_FrameBlitted(video);
 
 		/* Fall through to video surface update */
 		screen = SDL_VideoSurface;
 	}
 	if ( (screen->flags & SDL_DOUBLEBUF) == SDL_DOUBLEBUF ) {
 		SDL_VideoDevice *this  = current_video;
-		return(video->FlipHWSurface(this, SDL_VideoSurface));
+		retval = video->FlipHWSurface(this, SDL_VideoSurface);
 	} else {
 		SDL_UpdateRect(screen, 0, 0, 0, 0);
 	}
-	return(0);
+	if ( is_frame ) {
+		SDL_FrameEnd(video);
+	}
+	return(retval);
 }
 
 static void SetPalette_logical(SDL_Surface *screen, SDL_Color *colors,
@@ -1307,7 +1357,9 @@ int SDL_SetPalette(SDL_Surface *screen, int which,
 		 * interpretation of the pixel values (for blits etc) is
 		 * changed.
 		 */
+		SDL_LockPresent(current_video);
 		SetPalette_logical(screen, colors, firstcolor, ncolors);
+		SDL_UnlockPresent(current_video);
 	}
 	if ( which & SDL_PHYSPAL ) {
 		SDL_VideoDevice *video = current_video;
@@ -1332,10 +1384,12 @@ int SDL_SetPalette(SDL_Surface *screen, int which,
 			}
 			SDL_memcpy(pp->colors, pal->colors, size);
 		}
+		SDL_LockPresent(video);
 		if ( ! SetPalette_physical(screen,
 		                           colors, firstcolor, ncolors) ) {
 			gotall = 0;
 		}
+		SDL_UnlockPresent(video);
 	}
 	return gotall;
 }
@@ -1360,6 +1414,7 @@ void SDL_VideoQuit (void)
 
 		/* Halt event processing before doing anything else */
 		SDL_StopEventLoop();
+		SDL_StopPresentThread(video);
 
 		/* Clean up allocated window manager items */
 		if ( SDL_PublicSurface ) {
@@ -1408,6 +1463,7 @@ void SDL_VideoQuit (void)
 		}
 
 		/* Finish cleaning up video subsystem */
+		SDL_FrameStatsQuit(video);
 		video->free(this);
 		current_video = NULL;
 	}
@@ -1723,7 +1779,9 @@ void SDL_WM_SetCaption (const char *title, const char *icon)
 			video->wm_icon = SDL_strdup(icon);
 		}
 		if ( (title || icon) && (video->SetCaption != NULL) ) {
+			SDL_LockPresent(video);
 			video->SetCaption(this, video->wm_title,video->wm_icon);
+			SDL_UnlockPresent(video);
 		}
 	}
 
@@ -1825,10 +1883,14 @@ void SDL_WM_SetIcon (SDL_Surface *icon, Uint8 *mask)
 			if( flags ) {
 				CreateMaskFromColorKeyOrAlpha(icon, mask, flags);
 			}
+			SDL_LockPresent(video);
 			video->SetIcon(video, icon, mask);
+			SDL_UnlockPresent(video);
 			SDL_free(mask);
 		} else {
+			SDL_LockPresent(video);
 			video->SetIcon(this, icon, mask);
+			SDL_UnlockPresent(video);
 		}
 	}
 }
@@ -1852,6 +1914,7 @@ static SDL_GrabMode SDL_WM_GrabInputRaw(SDL_GrabMode mode)
 #ifdef DEBUG_GRAB
   printf("SDL_WM_GrabInputRaw(%d) ... ", mode);
 #endif
+	SDL_LockPresent(video);
 	if ( mode == SDL_GRAB_OFF ) {
 		if ( video->input_grab != SDL_GRAB_OFF ) {
 			mode = video->GrabInput(this, mode);
@@ -1867,6 +1930,7 @@ static SDL_GrabMode SDL_WM_GrabInputRaw(SDL_GrabMode mode)
 			video->CheckMouseMode(this);
 		}
 	}
+	SDL_UnlockPresent(video);
 #ifdef DEBUG_GRAB
   printf("Final mode %d\n", video->input_grab);
 #endif
@@ -1933,7 +1997,9 @@ int SDL_WM_IconifyWindow(void)
 
 	retval = 0;
 	if ( video->IconifyWindow ) {
+		SDL_LockPresent(video);
 		retval = video->IconifyWindow(this);
+		SDL_UnlockPresent(video);
 	}
 	return(retval);
 }
@@ -1950,6 +2016,7 @@ int SDL_WM_ToggleFullScreen(SDL_Surface *surface)
 	toggled = 0;
 	if ( SDL_PublicSurface && (surface == SDL_PublicSurface) &&
 	     video->ToggleFullScreen ) {
+		SDL_LockPresent(video);
 		if ( surface->flags & SDL_FULLSCREEN ) {
 			toggled = video->ToggleFullScreen(this, 0);
 			if ( toggled ) {
@@ -1967,6 +2034,7 @@ int SDL_WM_ToggleFullScreen(SDL_Surface *surface)
 		if ( toggled ) {
 			SDL_WM_GrabInput(video->input_grab);
 		}
+		SDL_UnlockPresent(video);
 	}
 	return(toggled);
 }
@@ -1979,9 +2047,12 @@ int SDL_GetWMInfo (SDL_SysWMinfo *info)
 	SDL_VideoDevice *video = current_video;
 	SDL_VideoDevice *this  = current_video;
 
+	int retval = 0;
+
 	if ( video && video->GetWMInfo ) {
-		return(video->GetWMInfo(this, info));
-	} else {
-		return(0);
+		SDL_LockPresent(video);
+		retval = video->GetWMInfo(this, info);
+		SDL_UnlockPresent(video);
 	}
+	return(retval);
 }
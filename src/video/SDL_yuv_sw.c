@@ -84,7 +84,7 @@
  */
 
 #include "SDL_video.h"
-#include "SDL_cpuinfo.h"
+#include "../cpuinfo/SDL_cpuinfo_c.h"
 #include "SDL_stretch_c.h"
 #include "SDL_yuvfuncs.h"
 #include "SDL_yuv_sw_c.h"
@@ -1063,7 +1063,7 @@ SDL_Overlay *SDL_CreateYUV_SW(_THIS, int width, int height, Uint32 format, SDL_S
 		if ( display->format->BytesPerPixel == 2 ) {
 #if (__GNUC__ > 2) && defined(__i386__) && __OPTIMIZE__ && SDL_ASSEMBLY_ROUTINES
 			/* inline assembly functions */
-			if ( SDL_HasMMX() && (Rmask == 0xF800) &&
+			if ( SDL_UseSIMD(CPU_HAS_MMX) && (Rmask == 0xF800) &&
 			                     (Gmask == 0x07E0) &&
 				             (Bmask == 0x001F) &&
 			                     (width & 15) == 0) {
@@ -1085,7 +1085,7 @@ SDL_Overlay *SDL_CreateYUV_SW(_THIS, int width, int height, Uint32 format, SDL_S
 		if ( display->format->BytesPerPixel == 4 ) {
 #if (__GNUC__ > 2) && defined(__i386__) && __OPTIMIZE__ && SDL_ASSEMBLY_ROUTINES
 			/* inline assembly functions */
-			if ( SDL_HasMMX() && (Rmask == 0x00FF0000) &&
+			if ( SDL_UseSIMD(CPU_HAS_MMX) && (Rmask == 0x00FF0000) &&
 			                     (Gmask == 0x0000FF00) &&
 				             (Bmask == 0x000000FF) && 
 			                     (width & 15) == 0) {
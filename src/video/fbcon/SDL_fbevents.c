@@ -47,6 +47,7 @@
 #include "../../events/SDL_events_c.h"
 #include "SDL_fbvideo.h"
 #include "SDL_fbevents_c.h"
+#include "SDL_fbshadow.h"
 #include "SDL_fbkeys.h"
 
 #include "SDL_fbelo.h"
@@ -951,9 +952,16 @@ static void switch_vt_done(_THIS)
 		screen_contents = NULL;
 	}
 
-	/* Get updates to the shadow surface while switched away */
+	/* The screen no longer shows what the shadow rows were hashed from */
+	FB_InvalidateShadowUpdate(this);
+
+	/* Get updates to the shadow surface while switched away, or else
+	   repaint the screen from the shadow framebuffer
+	 */
 	if ( SDL_ShadowSurface ) {
 		SDL_UpdateRect(SDL_ShadowSurface, 0, 0, 0, 0);
+	} else if ( shadow_fb ) {
+		SDL_UpdateRect(screen, 0, 0, 0, 0);
 	}
 
 	SDL_PrivateAppActive(1, (SDL_APPACTIVE|SDL_APPINPUTFOCUS|SDL_APPMOUSEFOCUS));
@@ -0,0 +1,1059 @@
+/*
+    SDL - Simple DirectMedia Layer
+    Copyright (C) 1997-2012 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+#include "SDL_config.h"
+
+/* Shadow framebuffer update engine for the SDL framebuffer console driver.
+
+   Every copy walks the destination (the real framebuffer) in rows and
+   steps through the shadow buffer by the given pixel deltas, so the same
+   loop handles all four orientations.  For the 90 degree rotations the
+   reads are strided by a whole shadow line, so the copy is split into
+   cache sized blocks, and where SSE2 is available the blocks are done as
+   small register transposes.
+
+   Video memory is usually uncached or write-combined, so the updates are
+   widened to whole aligned 16 byte chunks and written with streaming
+   stores, and large updates are spread over a few worker threads.  Rows
+   that haven't changed since the last update can be skipped, but hashing
+   them costs more than copying them to an ordinary framebuffer, so that's
+   off unless SDL_FBCON_SKIP_UNCHANGED asks for it.
+*/
+
+#include "SDL_video.h"
+#include "SDL_hints.h"
+#include "SDL_fbshadow.h"
+#include "../../cpuinfo/SDL_cpuinfo_c.h"
+
+#if SDL_ASSEMBLY_ROUTINES && defined(__GNUC__) && defined(__SSE2__)
+#define SSE2_SHADOW_BLIT 1
+#include <emmintrin.h>
+#endif
+
+#define BLOCKSIZE_W 32
+#define BLOCKSIZE_H 32
+
+#define min(a,b) ((a)<(b)?(a):(b))
+
+/* Copy a run of pixels into video memory */
+typedef void FB_rowCopy(Uint8 *dst, const Uint8 *src, int len);
+
+static void FB_copyRow(Uint8 *dst, const Uint8 *src, int len)
+{
+	SDL_memcpy(dst, src, len);
+}
+
+#if SSE2_SHADOW_BLIT
+/* Copy a run of pixels into video memory, writing whole aligned chunks */
+static void FB_copyRowSSE2(Uint8 *dst, const Uint8 *src, int len)
+{
+	while ( len && ((unsigned long)dst & 15) ) {
+		*dst++ = *src++;
+		--len;
+	}
+	while ( len >= 64 ) {
+		__m128i r0, r1, r2, r3;
+		r0 = _mm_loadu_si128((const __m128i *)(src));
+		r1 = _mm_loadu_si128((const __m128i *)(src + 16));
+		r2 = _mm_loadu_si128((const __m128i *)(src + 32));
+		r3 = _mm_loadu_si128((const __m128i *)(src + 48));
+		_mm_stream_si128((__m128i *)(dst), r0);
+		_mm_stream_si128((__m128i *)(dst + 16), r1);
+		_mm_stream_si128((__m128i *)(dst + 32), r2);
+		_mm_stream_si128((__m128i *)(dst + 48), r3);
+		src += 64;
+		dst += 64;
+		len -= 64;
+	}
+	while ( len >= 16 ) {
+		_mm_stream_si128((__m128i *)dst,
+				_mm_loadu_si128((const __m128i *)src));
+		src += 16;
+		dst += 16;
+		len -= 16;
+	}
+	while ( len-- ) {
+		*dst++ = *src++;
+	}
+}
+#endif
+
+/* Copy a tile of pixels, transposing it on the way */
+typedef void FB_tileBlit(Uint8 *src_pos, int src_right_delta,
+		int src_down_delta, Uint8 *dst_pos, int dst_linebytes);
+
+#define DEFINE_SHADOW_BLIT(name, type, copyRow)				\
+static void name(Uint8 *byte_src_pos, int src_right_delta, int src_down_delta, \
+		Uint8 *byte_dst_pos, int dst_linebytes, int width, int height) \
+{									\
+	int w;								\
+	type *src_pos = (type *)byte_src_pos;				\
+	type *dst_pos = (type *)byte_dst_pos;				\
+									\
+	while (height) {						\
+		type *src = src_pos;					\
+		type *dst = dst_pos;					\
+		if (src_right_delta == 1) {				\
+			copyRow((Uint8 *)dst, (Uint8 *)src,		\
+					width * sizeof(type));		\
+		} else {						\
+			for (w = width; w != 0; w--) {			\
+				*dst = *src;				\
+				src += src_right_delta;			\
+				dst++;					\
+			}						\
+		}							\
+		dst_pos = (type *)((Uint8 *)dst_pos + dst_linebytes);	\
+		src_pos += src_down_delta;				\
+		height--;						\
+	}								\
+}
+
+DEFINE_SHADOW_BLIT(FB_blit8, Uint8, FB_copyRow)
+DEFINE_SHADOW_BLIT(FB_blit16, Uint16, FB_copyRow)
+DEFINE_SHADOW_BLIT(FB_blit32, Uint32, FB_copyRow)
+#if SSE2_SHADOW_BLIT
+DEFINE_SHADOW_BLIT(FB_blit8SSE2, Uint8, FB_copyRowSSE2)
+DEFINE_SHADOW_BLIT(FB_blit16SSE2, Uint16, FB_copyRowSSE2)
+DEFINE_SHADOW_BLIT(FB_blit32SSE2, Uint32, FB_copyRowSSE2)
+#endif
+
+static __inline__ void FB_blit24rows(FB_rowCopy *copyRow,
+		Uint8 *src_pos, int src_right_delta, int src_down_delta,
+		Uint8 *dst_pos, int dst_linebytes, int width, int height)
+{
+	int w;
+
+	src_right_delta *= 3;
+	src_down_delta *= 3;
+	while (height) {
+		Uint8 *src = src_pos;
+		Uint8 *dst = dst_pos;
+		if (src_right_delta == 3) {
+			copyRow(dst, src, width * 3);
+		} else {
+			for (w = width; w != 0; w--) {
+				dst[0] = src[0];
+				dst[1] = src[1];
+				dst[2] = src[2];
+				src += src_right_delta;
+				dst += 3;
+			}
+		}
+		dst_pos += dst_linebytes;
+		src_pos += src_down_delta;
+		height--;
+	}
+}
+
+static void FB_blit24(Uint8 *src_pos, int src_right_delta, int src_down_delta,
+		Uint8 *dst_pos, int dst_linebytes, int width, int height)
+{
+	FB_blit24rows(FB_copyRow, src_pos, src_right_delta, src_down_delta,
+			dst_pos, dst_linebytes, width, height);
+}
+
+#if SSE2_SHADOW_BLIT
+static void FB_blit24SSE2(Uint8 *src_pos, int src_right_delta, int src_down_delta,
+		Uint8 *dst_pos, int dst_linebytes, int width, int height)
+{
+	FB_blit24rows(FB_copyRowSSE2, src_pos, src_right_delta, src_down_delta,
+			dst_pos, dst_linebytes, width, height);
+}
+#endif
+
+/* Split the copy into blocks that fit into the cache */
+static void FB_blitBlocked(FB_bitBlit *blit, int bytes_per_pixel,
+		Uint8 *src_pos, int src_right_delta, int src_down_delta,
+		Uint8 *dst_pos, int dst_linebytes, int width, int height)
+{
+	int w;
+	int src_right_bytes = src_right_delta * bytes_per_pixel;
+	int src_down_bytes = src_down_delta * bytes_per_pixel;
+
+	while (height > 0) {
+		Uint8 *src = src_pos;
+		Uint8 *dst = dst_pos;
+		for (w = width; w > 0; w -= BLOCKSIZE_W) {
+			blit(src,
+					src_right_delta,
+					src_down_delta,
+					dst,
+					dst_linebytes,
+					min(w, BLOCKSIZE_W),
+					min(height, BLOCKSIZE_H));
+			src += src_right_bytes * BLOCKSIZE_W;
+			dst += bytes_per_pixel * BLOCKSIZE_W;
+		}
+		dst_pos += dst_linebytes * BLOCKSIZE_H;
+		src_pos += src_down_bytes * BLOCKSIZE_H;
+		height -= BLOCKSIZE_H;
+	}
+}
+
+#if SSE2_SHADOW_BLIT
+/* Write a tile row, bypassing the cache if the row is aligned */
+static __inline__ void FB_storeTileRow(Uint8 *dst, __m128i row, int aligned)
+{
+	if ( aligned ) {
+		_mm_stream_si128((__m128i *)dst, row);
+	} else {
+		_mm_storeu_si128((__m128i *)dst, row);
+	}
+}
+
+/* Copy the interior of a block as square tiles, which only works when a
+   destination column is a run of adjacent shadow pixels (CW and CCW).
+   The ragged right and bottom edges are done by the plain copy.
+ */
+static void FB_blitTiled(FB_bitBlit *blit, FB_tileBlit *tile, int tilesize,
+		int bytes_per_pixel,
+		Uint8 *src_pos, int src_right_delta, int src_down_delta,
+		Uint8 *dst_pos, int dst_linebytes, int width, int height)
+{
+	int x, y;
+	int tw = width - (width % tilesize);
+	int th = height - (height % tilesize);
+	int src_right_bytes = src_right_delta * bytes_per_pixel;
+	int src_down_bytes = src_down_delta * bytes_per_pixel;
+
+	if ( (src_down_delta != 1) && (src_down_delta != -1) ) {
+		blit(src_pos, src_right_delta, src_down_delta,
+				dst_pos, dst_linebytes, width, height);
+		return;
+	}
+
+	for (y = 0; y < th; y += tilesize) {
+		for (x = 0; x < tw; x += tilesize) {
+			tile(src_pos + y * src_down_bytes + x * src_right_bytes,
+					src_right_delta,
+					src_down_delta,
+					dst_pos + y * dst_linebytes + x * bytes_per_pixel,
+					dst_linebytes);
+		}
+	}
+	if (tw < width) {
+		blit(src_pos + tw * src_right_bytes,
+				src_right_delta,
+				src_down_delta,
+				dst_pos + tw * bytes_per_pixel,
+				dst_linebytes,
+				width - tw,
+				height);
+	}
+	if (th < height && tw > 0) {
+		blit(src_pos + th * src_down_bytes,
+				src_right_delta,
+				src_down_delta,
+				dst_pos + th * dst_linebytes,
+				dst_linebytes,
+				tw,
+				height - th);
+	}
+}
+
+/* 8x8 transpose of 16-bit pixels.  Each load picks up one destination
+   column; if the shadow runs backwards along it the rows come out
+   reversed, so they are stored bottom up.
+ */
+static void FB_tile16(Uint8 *byte_src_pos, int src_right_delta,
+		int src_down_delta, Uint8 *dst_pos, int dst_linebytes)
+{
+	Uint16 *src = (Uint16 *)byte_src_pos;
+	int aligned = !(((unsigned long)dst_pos | dst_linebytes) & 15);
+	__m128i r0, r1, r2, r3, r4, r5, r6, r7;
+	__m128i t0, t1, t2, t3, t4, t5, t6, t7;
+
+	if (src_down_delta < 0) {
+		src -= 7;
+	}
+	r0 = _mm_loadu_si128((const __m128i *)(src));
+	r1 = _mm_loadu_si128((const __m128i *)(src + src_right_delta));
+	r2 = _mm_loadu_si128((const __m128i *)(src + src_right_delta * 2));
+	r3 = _mm_loadu_si128((const __m128i *)(src + src_right_delta * 3));
+	r4 = _mm_loadu_si128((const __m128i *)(src + src_right_delta * 4));
+	r5 = _mm_loadu_si128((const __m128i *)(src + src_right_delta * 5));
+	r6 = _mm_loadu_si128((const __m128i *)(src + src_right_delta * 6));
+	r7 = _mm_loadu_si128((const __m128i *)(src + src_right_delta * 7));
+
+	t0 = _mm_unpacklo_epi16(r0, r1);
+	t1 = _mm_unpackhi_epi16(r0, r1);
+	t2 = _mm_unpacklo_epi16(r2, r3);
+	t3 = _mm_unpackhi_epi16(r2, r3);
+	t4 = _mm_unpacklo_epi16(r4, r5);
+	t5 = _mm_unpackhi_epi16(r4, r5);
+	t6 = _mm_unpacklo_epi16(r6, r7);
+	t7 = _mm_unpackhi_epi16(r6, r7);
+
+	r0 = _mm_unpacklo_epi32(t0, t2);
+	r1 = _mm_unpackhi_epi32(t0, t2);
+	r2 = _mm_unpacklo_epi32(t1, t3);
+	r3 = _mm_unpackhi_epi32(t1, t3);
+	r4 = _mm_unpacklo_epi32(t4, t6);
+	r5 = _mm_unpackhi_epi32(t4, t6);
+	r6 = _mm_unpacklo_epi32(t5, t7);
+	r7 = _mm_unpackhi_epi32(t5, t7);
+
+	t0 = _mm_unpacklo_epi64(r0, r4);
+	t1 = _mm_unpackhi_epi64(r0, r4);
+	t2 = _mm_unpacklo_epi64(r1, r5);
+	t3 = _mm_unpackhi_epi64(r1, r5);
+	t4 = _mm_unpacklo_epi64(r2, r6);
+	t5 = _mm_unpackhi_epi64(r2, r6);
+	t6 = _mm_unpacklo_epi64(r3, r7);
+	t7 = _mm_unpackhi_epi64(r3, r7);
+
+	if (src_down_delta < 0) {
+		dst_pos += dst_linebytes * 7;
+		dst_linebytes = -dst_linebytes;
+	}
+	FB_storeTileRow(dst_pos, t0, aligned); dst_pos += dst_linebytes;
+	FB_storeTileRow(dst_pos, t1, aligned); dst_pos += dst_linebytes;
+	FB_storeTileRow(dst_pos, t2, aligned); dst_pos += dst_linebytes;
+	FB_storeTileRow(dst_pos, t3, aligned); dst_pos += dst_linebytes;
+	FB_storeTileRow(dst_pos, t4, aligned); dst_pos += dst_linebytes;
+	FB_storeTileRow(dst_pos, t5, aligned); dst_pos += dst_linebytes;
+	FB_storeTileRow(dst_pos, t6, aligned); dst_pos += dst_linebytes;
+	FB_storeTileRow(dst_pos, t7, aligned);
+}
+
+/* 4x4 transpose of 32-bit pixels, see FB_tile16() */
+static void FB_tile32(Uint8 *byte_src_pos, int src_right_delta,
+		int src_down_delta, Uint8 *dst_pos, int dst_linebytes)
+{
+	Uint32 *src = (Uint32 *)byte_src_pos;
+	int aligned = !(((unsigned long)dst_pos | dst_linebytes) & 15);
+	__m128i r0, r1, r2, r3;
+	__m128i t0, t1, t2, t3;
+
+	if (src_down_delta < 0) {
+		src -= 3;
+	}
+	r0 = _mm_loadu_si128((const __m128i *)(src));
+	r1 = _mm_loadu_si128((const __m128i *)(src + src_right_delta));
+	r2 = _mm_loadu_si128((const __m128i *)(src + src_right_delta * 2));
+	r3 = _mm_loadu_si128((const __m128i *)(src + src_right_delta * 3));
+
+	t0 = _mm_unpacklo_epi32(r0, r1);
+	t1 = _mm_unpacklo_epi32(r2, r3);
+	t2 = _mm_unpackhi_epi32(r0, r1);
+	t3 = _mm_unpackhi_epi32(r2, r3);
+
+	r0 = _mm_unpacklo_epi64(t0, t1);
+	r1 = _mm_unpackhi_epi64(t0, t1);
+	r2 = _mm_unpacklo_epi64(t2, t3);
+	r3 = _mm_unpackhi_epi64(t2, t3);
+
+	if (src_down_delta < 0) {
+		dst_pos += dst_linebytes * 3;
+		dst_linebytes = -dst_linebytes;
+	}
+	FB_storeTileRow(dst_pos, r0, aligned); dst_pos += dst_linebytes;
+	FB_storeTileRow(dst_pos, r1, aligned); dst_pos += dst_linebytes;
+	FB_storeTileRow(dst_pos, r2, aligned); dst_pos += dst_linebytes;
+	FB_storeTileRow(dst_pos, r3, aligned);
+}
+
+static void FB_blit16tiled(Uint8 *src_pos, int src_right_delta, int src_down_delta,
+		Uint8 *dst_pos, int dst_linebytes, int width, int height)
+{
+	FB_blitTiled(FB_blit16, FB_tile16, 8, 2, src_pos, src_right_delta,
+			src_down_delta, dst_pos, dst_linebytes, width, height);
+}
+
+static void FB_blit32tiled(Uint8 *src_pos, int src_right_delta, int src_down_delta,
+		Uint8 *dst_pos, int dst_linebytes, int width, int height)
+{
+	FB_blitTiled(FB_blit32, FB_tile32, 4, 4, src_pos, src_right_delta,
+			src_down_delta, dst_pos, dst_linebytes, width, height);
+}
+#endif /* SSE2_SHADOW_BLIT */
+
+static void FB_blit8blocked(Uint8 *src_pos, int src_right_delta, int src_down_delta,
+		Uint8 *dst_pos, int dst_linebytes, int width, int height)
+{
+	FB_blitBlocked(FB_blit8, 1, src_pos, src_right_delta,
+			src_down_delta, dst_pos, dst_linebytes, width, height);
+}
+
+static void FB_blit16blocked(Uint8 *src_pos, int src_right_delta, int src_down_delta,
+		Uint8 *dst_pos, int dst_linebytes, int width, int height)
+{
+	FB_blitBlocked(FB_blit16, 2, src_pos, src_right_delta,
+			src_down_delta, dst_pos, dst_linebytes, width, height);
+}
+
+static void FB_blit24blocked(Uint8 *src_pos, int src_right_delta, int src_down_delta,
+		Uint8 *dst_pos, int dst_linebytes, int width, int height)
+{
+	FB_blitBlocked(FB_blit24, 3, src_pos, src_right_delta,
+			src_down_delta, dst_pos, dst_linebytes, width, height);
+}
+
+static void FB_blit32blocked(Uint8 *src_pos, int src_right_delta, int src_down_delta,
+		Uint8 *dst_pos, int dst_linebytes, int width, int height)
+{
+	FB_blitBlocked(FB_blit32, 4, src_pos, src_right_delta,
+			src_down_delta, dst_pos, dst_linebytes, width, height);
+}
+
+#if SSE2_SHADOW_BLIT
+static void FB_blit16blockedSSE2(Uint8 *src_pos, int src_right_delta, int src_down_delta,
+		Uint8 *dst_pos, int dst_linebytes, int width, int height)
+{
+	FB_blitBlocked(FB_blit16tiled, 2, src_pos, src_right_delta,
+			src_down_delta, dst_pos, dst_linebytes, width, height);
+}
+
+static void FB_blit32blockedSSE2(Uint8 *src_pos, int src_right_delta, int src_down_delta,
+		Uint8 *dst_pos, int dst_linebytes, int width, int height)
+{
+	FB_blitBlocked(FB_blit32tiled, 4, src_pos, src_right_delta,
+			src_down_delta, dst_pos, dst_linebytes, width, height);
+}
+#endif
+
+/* The unrotated and upside down blits, with streaming row copies */
+static const SDL_SIMDKernel FB_blit8Kernels[] = {
+#if SSE2_SHADOW_BLIT
+	{ CPU_HAS_SSE2, (SDL_SIMDFunction)FB_blit8SSE2 },
+#endif
+	{ 0, (SDL_SIMDFunction)FB_blit8 }
+};
+
+static const SDL_SIMDKernel FB_blit16Kernels[] = {
+#if SSE2_SHADOW_BLIT
+	{ CPU_HAS_SSE2, (SDL_SIMDFunction)FB_blit16SSE2 },
+#endif
+	{ 0, (SDL_SIMDFunction)FB_blit16 }
+};
+
+static const SDL_SIMDKernel FB_blit24Kernels[] = {
+#if SSE2_SHADOW_BLIT
+	{ CPU_HAS_SSE2, (SDL_SIMDFunction)FB_blit24SSE2 },
+#endif
+	{ 0, (SDL_SIMDFunction)FB_blit24 }
+};
+
+static const SDL_SIMDKernel FB_blit32Kernels[] = {
+#if SSE2_SHADOW_BLIT
+	{ CPU_HAS_SSE2, (SDL_SIMDFunction)FB_blit32SSE2 },
+#endif
+	{ 0, (SDL_SIMDFunction)FB_blit32 }
+};
+
+/* The rotated blits, with the SSE2 tile transposes where they can be used */
+static const SDL_SIMDKernel FB_blit16blockedKernels[] = {
+#if SSE2_SHADOW_BLIT
+	{ CPU_HAS_SSE2, (SDL_SIMDFunction)FB_blit16blockedSSE2 },
+#endif
+	{ 0, (SDL_SIMDFunction)FB_blit16blocked }
+};
+
+static const SDL_SIMDKernel FB_blit32blockedKernels[] = {
+#if SSE2_SHADOW_BLIT
+	{ CPU_HAS_SSE2, (SDL_SIMDFunction)FB_blit32blockedSSE2 },
+#endif
+	{ 0, (SDL_SIMDFunction)FB_blit32blocked }
+};
+
+FB_bitBlit *FB_GetShadowBlit(int bpp, int rotation)
+{
+	int blocked;
+
+	/* Only the 90 degree rotations read across shadow lines */
+	blocked = (rotation == FBCON_ROTATE_CW || rotation == FBCON_ROTATE_CCW);
+	switch (bpp) {
+		case 8:
+			if ( blocked ) {
+				return FB_blit8blocked;
+			}
+			return (FB_bitBlit *)SDL_SelectSIMDKernel(FB_blit8Kernels);
+		case 16:
+			if ( blocked ) {
+				return (FB_bitBlit *)
+					SDL_SelectSIMDKernel(FB_blit16blockedKernels);
+			}
+			return (FB_bitBlit *)SDL_SelectSIMDKernel(FB_blit16Kernels);
+		case 24:
+			if ( blocked ) {
+				return FB_blit24blocked;
+			}
+			return (FB_bitBlit *)SDL_SelectSIMDKernel(FB_blit24Kernels);
+		case 32:
+			if ( blocked ) {
+				return (FB_bitBlit *)
+					SDL_SelectSIMDKernel(FB_blit32blockedKernels);
+			}
+			return (FB_bitBlit *)SDL_SelectSIMDKernel(FB_blit32Kernels);
+		default:
+			break;
+	}
+	return NULL;
+}
+
+/* The update engine */
+
+/* Updates smaller than this aren't worth waking the workers for */
+#define PARALLEL_MIN_PIXELS	(64*1024)
+
+/* Width of a video memory write, in bytes */
+#define CHUNK_BYTES	16
+
+enum {
+	SHADOW_JOB_HASH,
+	SHADOW_JOB_COPY,
+	SHADOW_JOB_QUIT
+};
+
+typedef struct FB_ShadowJob {
+	int type;
+	int x1, y1, x2, y2;
+} FB_ShadowJob;
+
+#if !SDL_THREADS_DISABLED
+typedef struct FB_ShadowWorker {
+	SDL_VideoDevice *device;
+	SDL_Thread *thread;
+	SDL_sem *wake;
+	FB_ShadowJob job;
+} FB_ShadowWorker;
+#endif
+
+struct FB_ShadowUpdater {
+	int width;
+	int height;
+	int bytes_per_pixel;
+	int chunk;		/* Pixels in an aligned video memory write */
+	int skip_unchanged;
+	Uint32 *row_hash;	/* Hash of each shadow row on the screen */
+	Uint8 *row_valid;	/* Whether the row hash matches the screen */
+	Uint8 *row_dirty;	/* Whether the row changed in this update */
+#if !SDL_THREADS_DISABLED
+	int num_workers;
+	FB_ShadowWorker *workers;
+	SDL_sem *done;
+#endif
+};
+
+/* A 32-bit hash of a shadow row, four independent MurmurHash3 lanes */
+#define HASH_ROTL(x, r)	(((x) << (r)) | ((x) >> (32 - (r))))
+#define HASH_MIX(h, k) {						\
+	k *= 0xcc9e2d51;						\
+	k = HASH_ROTL(k, 15);						\
+	k *= 0x1b873593;						\
+	h ^= k;								\
+	h = HASH_ROTL(h, 13);						\
+	h = h * 5 + 0xe6546b64;						\
+}
+
+static Uint32 FB_HashRow(const Uint8 *row, int len)
+{
+	Uint32 h0 = 0x9747b28c, h1 = 0x85ebca6b, h2 = 0xc2b2ae35, h3 = 0x27d4eb2f;
+	Uint32 k0, k1, k2, k3;
+
+	if ( !((unsigned long)row & 3) ) {
+		const Uint32 *words = (const Uint32 *)row;
+		while ( len >= 16 ) {
+			k0 = words[0];
+			k1 = words[1];
+			k2 = words[2];
+			k3 = words[3];
+			HASH_MIX(h0, k0);
+			HASH_MIX(h1, k1);
+			HASH_MIX(h2, k2);
+			HASH_MIX(h3, k3);
+			words += 4;
+			len -= 16;
+		}
+		row = (const Uint8 *)words;
+	}
+	while ( len-- ) {
+		k0 = *row++;
+		HASH_MIX(h0, k0);
+	}
+	h0 ^= HASH_ROTL(h1, 7) ^ HASH_ROTL(h2, 14) ^ HASH_ROTL(h3, 21);
+	h0 ^= h0 >> 16;
+	h0 *= 0x85ebca6b;
+	h0 ^= h0 >> 13;
+	return h0;
+}
+
+/* Widen a shadow rectangle so that its screen rows start and end on
+   chunk boundaries.  The extra pixels come from the shadow, which holds
+   the current screen contents anyway.
+ */
+static void FB_AlignShadowRect(_THIS, int *x1, int *y1, int *x2, int *y2)
+{
+	FB_ShadowUpdater *updater = shadow_updater;
+	int width = updater->width;
+	int height = updater->height;
+	int chunk = updater->chunk;
+	int lo, hi, size;
+
+	switch (rotate) {
+		case FBCON_ROTATE_NONE:
+			lo = *x1;
+			hi = *x2;
+			size = width;
+			break;
+		case FBCON_ROTATE_UD:
+			lo = width - *x2;
+			hi = width - *x1;
+			size = width;
+			break;
+		case FBCON_ROTATE_CW:
+			lo = height - *y2;
+			hi = height - *y1;
+			size = height;
+			break;
+		case FBCON_ROTATE_CCW:
+			lo = *y1;
+			hi = *y2;
+			size = height;
+			break;
+		default:
+			return;
+	}
+	lo -= lo % chunk;
+	hi += (chunk - hi % chunk) % chunk;
+	if ( hi > size ) {
+		hi = size;
+	}
+	switch (rotate) {
+		case FBCON_ROTATE_NONE:
+			*x1 = lo;
+			*x2 = hi;
+			break;
+		case FBCON_ROTATE_UD:
+			*x1 = width - hi;
+			*x2 = width - lo;
+			break;
+		case FBCON_ROTATE_CW:
+			*y1 = height - hi;
+			*y2 = height - lo;
+			break;
+		case FBCON_ROTATE_CCW:
+			*y1 = lo;
+			*y2 = hi;
+			break;
+	}
+}
+
+static void FB_HashShadowRows(_THIS, int y1, int y2)
+{
+	FB_ShadowUpdater *updater = shadow_updater;
+	int linebytes = updater->width * updater->bytes_per_pixel;
+	const Uint8 *row = (const Uint8 *)shadow_mem + y1 * linebytes;
+	int y;
+
+	for ( y = y1; y < y2; ++y ) {
+		Uint32 hash = FB_HashRow(row, linebytes);
+		updater->row_dirty[y] = !updater->row_valid[y] ||
+		                        (updater->row_hash[y] != hash);
+		updater->row_hash[y] = hash;
+		updater->row_valid[y] = 1;
+		row += linebytes;
+	}
+}
+
+static void FB_CopyShadowRect(_THIS, int x1, int y1, int x2, int y2)
+{
+	FB_ShadowUpdater *updater = shadow_updater;
+	int width = updater->width;
+	int height = updater->height;
+	int bytes_per_pixel = updater->bytes_per_pixel;
+	int scr_x1, scr_y1, scr_x2, scr_y2;
+	int sha_x1, sha_y1;
+	int shadow_right_delta;  /* Address change when moving right in dest */
+	int shadow_down_delta;   /* Address change when moving down in dest */
+	char *src_start;
+	char *dst_start;
+
+	switch (rotate) {
+		case FBCON_ROTATE_NONE:
+			sha_x1 = scr_x1 = x1;
+			sha_y1 = scr_y1 = y1;
+			scr_x2 = x2;
+			scr_y2 = y2;
+			shadow_right_delta = 1;
+			shadow_down_delta = width;
+			break;
+		case FBCON_ROTATE_CCW:
+			scr_x1 = y1;
+			scr_y1 = width - x2;
+			scr_x2 = y2;
+			scr_y2 = width - x1;
+			sha_x1 = x2 - 1;
+			sha_y1 = y1;
+			shadow_right_delta = width;
+			shadow_down_delta = -1;
+			break;
+		case FBCON_ROTATE_UD:
+			scr_x1 = width - x2;
+			scr_y1 = height - y2;
+			scr_x2 = width - x1;
+			scr_y2 = height - y1;
+			sha_x1 = x2 - 1;
+			sha_y1 = y2 - 1;
+			shadow_right_delta = -1;
+			shadow_down_delta = -width;
+			break;
+		case FBCON_ROTATE_CW:
+			scr_x1 = height - y2;
+			scr_y1 = x1;
+			scr_x2 = height - y1;
+			scr_y2 = x2;
+			sha_x1 = x1;
+			sha_y1 = y2 - 1;
+			shadow_right_delta = -width;
+			shadow_down_delta = 1;
+			break;
+		default:
+			return;
+	}
+
+	src_start = shadow_mem +
+		(sha_y1 * width + sha_x1) * bytes_per_pixel;
+	dst_start = mapped_mem + mapped_offset + scr_y1 * physlinebytes + 
+		scr_x1 * bytes_per_pixel;
+
+	blitFunc((Uint8 *) src_start,
+			shadow_right_delta, 
+			shadow_down_delta, 
+			(Uint8 *) dst_start,
+			physlinebytes,
+			scr_x2 - scr_x1,
+			scr_y2 - scr_y1);
+#if SSE2_SHADOW_BLIT
+	/* Make the streaming stores visible before the update returns */
+	_mm_sfence();
+#endif
+}
+
+static void FB_RunShadowJob(_THIS, FB_ShadowJob *job)
+{
+	switch (job->type) {
+		case SHADOW_JOB_HASH:
+			FB_HashShadowRows(this, job->y1, job->y2);
+			break;
+		case SHADOW_JOB_COPY:
+			FB_CopyShadowRect(this, job->x1, job->y1, job->x2, job->y2);
+			break;
+		default:
+			break;
+	}
+}
+
+#if !SDL_THREADS_DISABLED
+static int FB_ShadowWorkerThread(void *data)
+{
+	FB_ShadowWorker *worker = (FB_ShadowWorker *)data;
+	SDL_VideoDevice *this = worker->device;
+
+	for ( ; ; ) {
+		SDL_SemWait(worker->wake);
+		if ( worker->job.type == SHADOW_JOB_QUIT ) {
+			break;
+		}
+		FB_RunShadowJob(this, &worker->job);
+		SDL_SemPost(shadow_updater->done);
+	}
+	return(0);
+}
+#endif
+
+/* Run a job over a rectangle, in bands along one axis.  Copies are split
+   along the screen rows so that no two threads write the same line.
+ */
+static void FB_RunShadowJobs(_THIS, int type, int x1, int y1, int x2, int y2,
+                             int split_x)
+{
+	FB_ShadowJob job;
+	int lo, hi, step;
+#if !SDL_THREADS_DISABLED
+	FB_ShadowUpdater *updater = shadow_updater;
+	int bands, i;
+#endif
+
+	job.type = type;
+	job.x1 = x1;
+	job.y1 = y1;
+	job.x2 = x2;
+	job.y2 = y2;
+	lo = split_x ? x1 : y1;
+	hi = split_x ? x2 : y2;
+	step = hi - lo;
+
+#if !SDL_THREADS_DISABLED
+	bands = 1;
+	if ( updater->num_workers && ((x2-x1)*(y2-y1) >= PARALLEL_MIN_PIXELS) ) {
+		bands = updater->num_workers + 1;
+		/* Keep the bands a whole number of copy blocks */
+		step = (hi - lo + bands - 1) / bands;
+		step = (step + BLOCKSIZE_W - 1) & ~(BLOCKSIZE_W - 1);
+	}
+	for ( i = 1; (i < bands) && (lo + i*step < hi); ++i ) {
+		FB_ShadowWorker *worker = &updater->workers[i-1];
+		int band_lo = lo + i*step;
+		int band_hi = min(band_lo + step, hi);
+
+		worker->job = job;
+		if ( split_x ) {
+			worker->job.x1 = band_lo;
+			worker->job.x2 = band_hi;
+		} else {
+			worker->job.y1 = band_lo;
+			worker->job.y2 = band_hi;
+		}
+		SDL_SemPost(worker->wake);
+	}
+	bands = i;
+#endif
+
+	/* This thread does the first band */
+	if ( split_x ) {
+		job.x2 = min(lo + step, hi);
+	} else {
+		job.y2 = min(lo + step, hi);
+	}
+	FB_RunShadowJob(this, &job);
+
+#if !SDL_THREADS_DISABLED
+	for ( i = 1; i < bands; ++i ) {
+		SDL_SemWait(updater->done);
+	}
+#endif
+}
+
+static void FB_CopyShadowRectAligned(_THIS, int x1, int y1, int x2, int y2)
+{
+	FB_AlignShadowRect(this, &x1, &y1, &x2, &y2);
+	FB_RunShadowJobs(this, SHADOW_JOB_COPY, x1, y1, x2, y2,
+	                 (rotate == FBCON_ROTATE_CW || rotate == FBCON_ROTATE_CCW));
+}
+
+void FB_ShadowUpdate(_THIS, int numrects, SDL_Rect *rects)
+{
+	FB_ShadowUpdater *updater = shadow_updater;
+	int width;
+	int height;
+	int i;
+
+	if ( updater == NULL ) {
+		return;
+	}
+	width = updater->width;
+	height = updater->height;
+
+	for (i = 0; i < numrects; i++) {
+		int x1, y1, x2, y2;
+
+		x1 = rects[i].x; 
+		y1 = rects[i].y;
+		x2 = x1 + rects[i].w; 
+		y2 = y1 + rects[i].h;
+
+		if (x1 < 0) {
+			x1 = 0;
+		} else if (x1 > width) {
+			x1 = width;
+		}
+		if (x2 < 0) {
+			x2 = 0;
+		} else if (x2 > width) {
+			x2 = width;
+		}
+		if (y1 < 0) {
+			y1 = 0;
+		} else if (y1 > height) {
+			y1 = height;
+		}
+		if (y2 < 0) {
+			y2 = 0;
+		} else if (y2 > height) {
+			y2 = height;
+		}
+		if (x2 <= x1 || y2 <= y1) {
+			continue;
+		}
+
+		if ( updater->skip_unchanged && (x1 == 0) && (x2 == width) ) {
+			int y, end;
+
+			/* Only copy the runs of rows that changed */
+			FB_RunShadowJobs(this, SHADOW_JOB_HASH, x1, y1, x2, y2, 0);
+			for ( y = y1; y < y2; y = end ) {
+				end = y + 1;
+				if ( updater->row_dirty[y] ) {
+					while ( (end < y2) && updater->row_dirty[end] ) {
+						++end;
+					}
+					FB_CopyShadowRectAligned(this, x1, y, x2, end);
+				}
+			}
+		} else {
+			/* The row hashes no longer describe the screen */
+			SDL_memset(&updater->row_valid[y1], 0, y2 - y1);
+			FB_CopyShadowRectAligned(this, x1, y1, x2, y2);
+		}
+	}
+}
+
+static int FB_ShadowUpdateThreads(void)
+{
+	const char *variable = SDL_GetHint(SDL_HINT_FBCON_UPDATE_THREADS);
+	int threads = 1;
+
+	if ( variable ) {
+		threads = SDL_atoi(variable);
+	} else {
+		threads = SDL_GetCPUCount();
+		/* More threads than this just fight over the bus */
+		if ( threads > 4 ) {
+			threads = 4;
+		}
+	}
+	if ( threads < 1 ) {
+		threads = 1;
+	}
+	return threads;
+}
+
+int FB_InitShadowUpdate(_THIS, int width, int height, int bpp)
+{
+	FB_ShadowUpdater *updater;
+	const char *variable;
+	int bytes_per_pixel = (bpp + 7) / 8;
+#if !SDL_THREADS_DISABLED
+	int i;
+#endif
+
+	FB_QuitShadowUpdate(this);
+
+	updater = (FB_ShadowUpdater *)SDL_malloc(sizeof(*updater));
+	if ( updater == NULL ) {
+		SDL_OutOfMemory();
+		return(-1);
+	}
+	SDL_memset(updater, 0, sizeof(*updater));
+	shadow_updater = updater;
+
+	updater->width = width;
+	updater->height = height;
+	updater->bytes_per_pixel = bytes_per_pixel;
+	updater->chunk = CHUNK_BYTES;
+	while ( (updater->chunk > 1) && !(bytes_per_pixel & 1) ) {
+		updater->chunk /= 2;
+		bytes_per_pixel /= 2;
+	}
+
+	variable = SDL_GetHint(SDL_HINT_FBCON_SKIP_UNCHANGED);
+	updater->skip_unchanged = variable ? SDL_atoi(variable) : 0;
+	updater->row_hash = (Uint32 *)SDL_malloc(height * sizeof(Uint32));
+	updater->row_valid = (Uint8 *)SDL_malloc(height);
+	updater->row_dirty = (Uint8 *)SDL_malloc(height);
+	if ( !updater->row_hash || !updater->row_valid || !updater->row_dirty ) {
+		FB_QuitShadowUpdate(this);
+		SDL_OutOfMemory();
+		return(-1);
+	}
+	SDL_memset(updater->row_valid, 0, height);
+
+#if !SDL_THREADS_DISABLED
+	updater->num_workers = FB_ShadowUpdateThreads() - 1;
+	if ( updater->num_workers > 0 ) {
+		updater->done = SDL_CreateSemaphore(0);
+		updater->workers = (FB_ShadowWorker *)
+			SDL_malloc(updater->num_workers * sizeof(FB_ShadowWorker));
+		if ( !updater->done || !updater->workers ) {
+			updater->num_workers = 0;
+		}
+	}
+	for ( i = 0; i < updater->num_workers; ++i ) {
+		FB_ShadowWorker *worker = &updater->workers[i];
+
+		worker->device = this;
+		worker->wake = SDL_CreateSemaphore(0);
+		worker->thread = NULL;
+		if ( worker->wake ) {
+			worker->thread = SDL_CreateThread(FB_ShadowWorkerThread, worker);
+		}
+		if ( worker->thread == NULL ) {
+			/* Carry on with the workers we have */
+			if ( worker->wake ) {
+				SDL_DestroySemaphore(worker->wake);
+			}
+			updater->num_workers = i;
+			break;
+		}
+	}
+#endif
+	return(0);
+}
+
+void FB_InvalidateShadowUpdate(_THIS)
+{
+	FB_ShadowUpdater *updater = shadow_updater;
+
+	if ( updater ) {
+		SDL_memset(updater->row_valid, 0, updater->height);
+	}
+}
+
+void FB_QuitShadowUpdate(_THIS)
+{
+	FB_ShadowUpdater *updater = shadow_updater;
+#if !SDL_THREADS_DISABLED
+	int i;
+#endif
+
+	if ( updater == NULL ) {
+		return;
+	}
+#if !SDL_THREADS_DISABLED
+	for ( i = 0; i < updater->num_workers; ++i ) {
+		FB_ShadowWorker *worker = &updater->workers[i];
+
+		worker->job.type = SHADOW_JOB_QUIT;
+		SDL_SemPost(worker->wake);
+		SDL_WaitThread(worker->thread, NULL);
+		SDL_DestroySemaphore(worker->wake);
+	}
+	if ( updater->workers ) {
+		SDL_free(updater->workers);
+	}
+	if ( updater->done ) {
+		SDL_DestroySemaphore(updater->done);
+	}
+#endif
+	if ( updater->row_hash ) {
+		SDL_free(updater->row_hash);
+	}
+	if ( updater->row_valid ) {
+		SDL_free(updater->row_valid);
+	}
+	if ( updater->row_dirty ) {
+		SDL_free(updater->row_dirty);
+	}
+	SDL_free(updater);
+	shadow_updater = NULL;
+}
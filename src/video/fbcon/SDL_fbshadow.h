@@ -0,0 +1,41 @@
+/*
+    SDL - Simple DirectMedia Layer
+    Copyright (C) 1997-2012 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+#include "SDL_config.h"
+
+/* Shadow framebuffer copy functions for the SDL framebuffer console driver */
+
+#include "SDL_fbvideo.h"
+
+/* Return the shadow -> framebuffer copy function for the given depth
+   and rotation, or NULL if the depth isn't supported.
+ */
+extern FB_bitBlit *FB_GetShadowBlit(int bpp, int rotation);
+
+/* Set up the shadow update engine for a shadow of the given size */
+extern int FB_InitShadowUpdate(_THIS, int width, int height, int bpp);
+extern void FB_QuitShadowUpdate(_THIS);
+
+/* Forget what's on the screen, so the next update copies every row */
+extern void FB_InvalidateShadowUpdate(_THIS);
+
+/* Copy the given shadow rectangles to the framebuffer */
+extern void FB_ShadowUpdate(_THIS, int numrects, SDL_Rect *rects);
@@ -25,10 +25,12 @@
 */
 
 #include <stdio.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 
 #ifndef HAVE_GETPAGESIZE
 #include <asm/page.h>		/* For definition of PAGE_SIZE */
@@ -38,15 +40,19 @@
 
 #include "SDL_video.h"
 #include "SDL_mouse.h"
+#include "SDL_hints.h"
 #include "../SDL_sysvideo.h"
 #include "../SDL_pixels_c.h"
+#include "../SDL_framestats_c.h"
 #include "../../events/SDL_events_c.h"
+#include "../../thread/SDL_atomic_c.h"
 #include "SDL_fbvideo.h"
 #include "SDL_fbmouse_c.h"
 #include "SDL_fbevents_c.h"
 #include "SDL_fb3dfx.h"
 #include "SDL_fbmatrox.h"
 #include "SDL_fbriva.h"
+#include "SDL_fbshadow.h"
 
 /*#define FBCON_DEBUG*/
 
@@ -126,14 +132,6 @@ static const struct {
 	{ 1600, 1200,/*?*/0, 272, 48, 32,  5, 152, 5, 0, 0 },	/* 60 Hz */
 #endif
 };
-enum {
-	FBCON_ROTATE_NONE = 0,
-	FBCON_ROTATE_CCW = 90,
-	FBCON_ROTATE_UD = 180,
-	FBCON_ROTATE_CW = 270
-};
-
-#define min(a,b) ((a)<(b)?(a):(b))
 
 /* Initialization/Query functions */
 static int FB_VideoInit(_THIS, SDL_PixelFormat *vformat);
@@ -167,10 +165,6 @@ static void FB_SavePalette(_THIS, struct fb_fix_screeninfo *finfo,
                                   struct fb_var_screeninfo *vinfo);
 static void FB_RestorePalette(_THIS);
 
-/* Shadow buffer functions */
-static FB_bitBlit FB_blit16;
-static FB_bitBlit FB_blit16blocked;
-
 static int SDL_getpagesize(void)
 {
 #ifdef HAVE_GETPAGESIZE
@@ -198,6 +192,171 @@ static void *do_mmap(void *start, size_t length, int prot, int flags, int fd, of
 	return ret;
 }
 
+/* A regular file can stand in for the framebuffer device, which is handy
+   for testing without a display.  The file gets a fixed mode taken from
+   SDL_FBCON_FILE_MODE, and the screen info requests are answered here.
+ */
+static void FB_SetFilePixelFormat(struct fb_var_screeninfo *vinfo, int bpp)
+{
+	vinfo->bits_per_pixel = bpp;
+	SDL_memset(&vinfo->red, 0, sizeof(vinfo->red));
+	SDL_memset(&vinfo->green, 0, sizeof(vinfo->green));
+	SDL_memset(&vinfo->blue, 0, sizeof(vinfo->blue));
+	SDL_memset(&vinfo->transp, 0, sizeof(vinfo->transp));
+	switch (bpp) {
+		case 8:
+			vinfo->red.length = 8;
+			vinfo->green.length = 8;
+			vinfo->blue.length = 8;
+			break;
+		case 16:
+			vinfo->red.offset = 11;
+			vinfo->red.length = 5;
+			vinfo->green.offset = 5;
+			vinfo->green.length = 6;
+			vinfo->blue.length = 5;
+			break;
+		default:
+			vinfo->red.offset = 16;
+			vinfo->red.length = 8;
+			vinfo->green.offset = 8;
+			vinfo->green.length = 8;
+			vinfo->blue.length = 8;
+			break;
+	}
+}
+
+static int FB_OpenFileDevice(_THIS, const char *path)
+{
+	struct stat sb;
+	const char *mode;
+	unsigned int w = 640, h = 480, bpp = 32;
+
+	if ( (fstat(console_fd, &sb) < 0) || !S_ISREG(sb.st_mode) ) {
+		return(0);
+	}
+
+	mode = SDL_GetHint(SDL_HINT_FBCON_FILE_MODE);
+	if ( mode ) {
+		if ( (SDL_sscanf(mode, "%ux%ux%u", &w, &h, &bpp) != 3) ||
+		     !w || !h || ((bpp != 8) && (bpp != 16) &&
+		                  (bpp != 24) && (bpp != 32)) ) {
+			SDL_SetError("\"%s\" is not a valid value for "
+				 "SDL_FBCON_FILE_MODE", mode);
+			return(-1);
+		}
+	}
+
+	SDL_memset(&file_vinfo, 0, sizeof(file_vinfo));
+	file_vinfo.xres = file_vinfo.xres_virtual = w;
+	file_vinfo.yres = file_vinfo.yres_virtual = h;
+	FB_SetFilePixelFormat(&file_vinfo, bpp);
+	SDL_memset(file_cmap, 0, sizeof(file_cmap));
+
+	/* Leave room for triple buffering */
+	file_memlen = w * (bpp / 8) * h * 3;
+	if ( (sb.st_size < file_memlen) &&
+	     (ftruncate(console_fd, file_memlen) < 0) ) {
+		SDL_SetError("Unable to resize %s", path);
+		return(-1);
+	}
+	file_fb = 1;
+	return(1);
+}
+
+static int FB_ioctl(_THIS, unsigned long request, void *arg)
+{
+	int linebytes;
+
+	if ( ! file_fb ) {
+		return ioctl(console_fd, request, arg);
+	}
+
+	linebytes = file_vinfo.xres_virtual * (file_vinfo.bits_per_pixel / 8);
+	switch (request) {
+	    case FBIOGET_FSCREENINFO: {
+		struct fb_fix_screeninfo *finfo = (struct fb_fix_screeninfo *)arg;
+
+		SDL_memset(finfo, 0, sizeof(*finfo));
+		SDL_strlcpy(finfo->id, "SDL file", sizeof(finfo->id));
+		finfo->smem_len = file_memlen;
+		finfo->type = FB_TYPE_PACKED_PIXELS;
+		if ( file_vinfo.bits_per_pixel == 8 ) {
+			finfo->visual = FB_VISUAL_PSEUDOCOLOR;
+		} else {
+			finfo->visual = FB_VISUAL_TRUECOLOR;
+		}
+		finfo->ypanstep = 1;
+		finfo->line_length = linebytes;
+		finfo->accel = FB_ACCEL_NONE;
+		return(0);
+	    }
+	    case FBIOGET_VSCREENINFO:
+		*(struct fb_var_screeninfo *)arg = file_vinfo;
+		return(0);
+	    case FBIOPUT_VSCREENINFO: {
+		struct fb_var_screeninfo *vinfo = (struct fb_var_screeninfo *)arg;
+		__u32 yres_virtual = vinfo->yres_virtual;
+
+		/* The mode of a file is fixed, only the paging can change */
+		if ( yres_virtual < file_vinfo.yres ) {
+			yres_virtual = file_vinfo.yres;
+		}
+		if ( (vinfo->xres != file_vinfo.xres) ||
+		     (vinfo->yres != file_vinfo.yres) ||
+		     (vinfo->bits_per_pixel != file_vinfo.bits_per_pixel) ||
+		     (yres_virtual * linebytes > file_memlen) ) {
+			errno = EINVAL;
+			return(-1);
+		}
+		*vinfo = file_vinfo;
+		vinfo->yres_virtual = yres_virtual;
+		vinfo->yoffset = 0;
+		if ( (vinfo->activate & FB_ACTIVATE_MASK) != FB_ACTIVATE_TEST ) {
+			file_vinfo = *vinfo;
+		}
+		return(0);
+	    }
+	    case FBIOPAN_DISPLAY: {
+		struct fb_var_screeninfo *vinfo = (struct fb_var_screeninfo *)arg;
+
+		if ( vinfo->yoffset + file_vinfo.yres > file_vinfo.yres_virtual ) {
+			errno = EINVAL;
+			return(-1);
+		}
+		file_vinfo.yoffset = vinfo->yoffset;
+		return(0);
+	    }
+	    case FBIOGETCMAP:
+	    case FBIOPUTCMAP: {
+		struct fb_cmap *cmap = (struct fb_cmap *)arg;
+		__u32 i;
+
+		if ( cmap->start + cmap->len > 256 ) {
+			errno = EINVAL;
+			return(-1);
+		}
+		for ( i=0; i<cmap->len; ++i ) {
+			__u16 *entry = &file_cmap[cmap->start+i];
+			if ( request == FBIOGETCMAP ) {
+				cmap->red[i] = entry[0*256];
+				cmap->green[i] = entry[1*256];
+				cmap->blue[i] = entry[2*256];
+			} else {
+				entry[0*256] = cmap->red[i];
+				entry[1*256] = cmap->green[i];
+				entry[2*256] = cmap->blue[i];
+			}
+		}
+		return(0);
+	    }
+	    default:
+		break;
+	}
+	errno = ENOTTY;
+	return(-1);
+}
+
 /* FB driver bootstrap functions */
 
 static int FB_Available(void)
@@ -208,7 +367,7 @@ static int FB_Available(void)
 	int idx = 0;
 	const char *SDL_fbdevs[4] = { NULL, "/dev/fb0", "/dev/fb/0", NULL };
 
-	SDL_fbdevs[0] = SDL_getenv("SDL_FBDEV");
+	SDL_fbdevs[0] = SDL_GetHint(SDL_HINT_FBDEV);
 	if( !SDL_fbdevs[0] )
 		idx++;
 	for( ; SDL_fbdevs[idx]; idx++ )
@@ -400,7 +559,7 @@ static int FB_CheckMode(_THIS, struct fb_var_screeninfo *vinfo,
 	vinfo->yres = *h;
 	vinfo->yres_virtual = *h;
 	vinfo->activate = FB_ACTIVATE_TEST;
-	if ( ioctl(console_fd, FBIOPUT_VSCREENINFO, vinfo) == 0 ) {
+	if ( FB_ioctl(this, FBIOPUT_VSCREENINFO, vinfo) == 0 ) {
 #ifdef FBCON_DEBUG
 		fprintf(stderr, "Checked mode %dx%d at %d bpp, got mode %dx%d at %d bpp\n", *w, *h, (index+1)*8, vinfo->xres, vinfo->yres, vinfo->bits_per_pixel);
 #endif
@@ -513,7 +672,7 @@ static int FB_VideoInit(_THIS, SDL_PixelFormat *vformat)
 	FILE *modesdb;
 
 	/* Initialize the library */
-	SDL_fbdev = SDL_getenv("SDL_FBDEV");
+	SDL_fbdev = SDL_GetHint(SDL_HINT_FBDEV);
 	if ( SDL_fbdev == NULL ) {
 		SDL_fbdev = "/dev/fb0";
 	}
@@ -522,6 +681,10 @@ static int FB_VideoInit(_THIS, SDL_PixelFormat *vformat)
 		SDL_SetError("Unable to open %s", SDL_fbdev);
 		return(-1);
 	}
+	if ( FB_OpenFileDevice(this, SDL_fbdev) < 0 ) {
+		FB_VideoQuit(this);
+		return(-1);
+	}
 
 #if !SDL_THREADS_DISABLED
 	/* Create the hardware surface lock mutex */
@@ -534,7 +697,7 @@ static int FB_VideoInit(_THIS, SDL_PixelFormat *vformat)
 #endif
 
 	/* Get the type of video hardware */
-	if ( ioctl(console_fd, FBIOGET_FSCREENINFO, &finfo) < 0 ) {
+	if ( FB_ioctl(this, FBIOGET_FSCREENINFO, &finfo) < 0 ) {
 		SDL_SetError("Couldn't get console hardware info");
 		FB_VideoQuit(this);
 		return(-1);
@@ -575,12 +738,7 @@ static int FB_VideoInit(_THIS, SDL_PixelFormat *vformat)
 	}
 
 	/* Check if the user wants to disable hardware acceleration */
-	{ const char *fb_accel;
-		fb_accel = SDL_getenv("SDL_FBACCEL");
-		if ( fb_accel ) {
-			finfo.accel = SDL_atoi(fb_accel);
-		}
-	}
+	finfo.accel = SDL_GetHintInt(SDL_HINT_FBACCEL, finfo.accel);
 
 	/* Memory map the device, compensating for buggy PPC mmap() */
 	mapped_offset = (((long)finfo.smem_start) -
@@ -599,7 +757,7 @@ static int FB_VideoInit(_THIS, SDL_PixelFormat *vformat)
 	memset(mapped_mem, 0, mapped_memlen);
 
 	/* Determine the current screen depth */
-	if ( ioctl(console_fd, FBIOGET_VSCREENINFO, &vinfo) < 0 ) {
+	if ( FB_ioctl(this, FBIOGET_VSCREENINFO, &vinfo) < 0 ) {
 		SDL_SetError("Couldn't get console pixel format");
 		FB_VideoQuit(this);
 		return(-1);
@@ -630,7 +788,7 @@ static int FB_VideoInit(_THIS, SDL_PixelFormat *vformat)
 	   can take advantage of any supported hardware acceleration.
 	 */
 	vinfo.accel_flags = 0;	/* Temporarily reserve registers */
-	ioctl(console_fd, FBIOPUT_VSCREENINFO, &vinfo);
+	FB_ioctl(this, FBIOPUT_VSCREENINFO, &vinfo);
 	if ( finfo.accel && finfo.mmio_len ) {
 		mapped_iolen = finfo.mmio_len;
 		mapped_io = do_mmap(NULL, mapped_iolen, PROT_READ|PROT_WRITE,
@@ -642,7 +800,7 @@ static int FB_VideoInit(_THIS, SDL_PixelFormat *vformat)
 	}
 
 	rotate = FBCON_ROTATE_NONE;
-	rotation = SDL_getenv("SDL_VIDEO_FBCON_ROTATION");
+	rotation = SDL_GetHint(SDL_HINT_FBCON_ROTATION);
 	if (rotation != NULL) {
 		if (SDL_strlen(rotation) == 0) {
 			shadow_fb = 0;
@@ -696,7 +854,7 @@ static int FB_VideoInit(_THIS, SDL_PixelFormat *vformat)
 		SDL_nummodes[i] = 0;
 		SDL_modelist[i] = NULL;
 	}
-	if ( SDL_getenv("SDL_FB_BROKEN_MODES") != NULL ) {
+	if ( file_fb || (SDL_getenv("SDL_FB_BROKEN_MODES") != NULL) ) {
 		FB_AddMode(this, current_index, current_w, current_h, 0);
 	} else if(modesdb) {
 		while ( read_fbmodes_mode(modesdb, &vinfo) ) {
@@ -801,12 +959,13 @@ static int FB_VideoInit(_THIS, SDL_PixelFormat *vformat)
 		} 
 	}
 
-	/* Enable mouse and keyboard support */
-	if ( FB_OpenKeyboard(this) < 0 ) {
+	/* Enable mouse and keyboard support, files have no console */
+	if ( file_fb ) {
+		/* No input devices */
+	} else if ( FB_OpenKeyboard(this) < 0 ) {
 		FB_VideoQuit(this);
 		return(-1);
-	}
-	if ( FB_OpenMouse(this) < 0 ) {
+	} else if ( FB_OpenMouse(this) < 0 ) {
 		const char *sdl_nomouse;
 
 		sdl_nomouse = SDL_getenv("SDL_NOMOUSE");
@@ -956,7 +1115,7 @@ static SDL_Surface *FB_SetVGA16Mode(_THIS, SDL_Surface *current,
 	struct fb_var_screeninfo vinfo;
 
 	/* Set the terminal into graphics mode */
-	if ( FB_EnterGraphicsMode(this) < 0 ) {
+	if ( !file_fb && (FB_EnterGraphicsMode(this) < 0) ) {
 		return(NULL);
 	}
 
@@ -964,7 +1123,7 @@ static SDL_Surface *FB_SetVGA16Mode(_THIS, SDL_Surface *current,
 	FB_RestorePalette(this);
 
 	/* Set the video mode and get the final screen format */
-	if ( ioctl(console_fd, FBIOGET_VSCREENINFO, &vinfo) < 0 ) {
+	if ( FB_ioctl(this, FBIOGET_VSCREENINFO, &vinfo) < 0 ) {
 		SDL_SetError("Couldn't get console screen info");
 		return(NULL);
 	}
@@ -981,7 +1140,7 @@ static SDL_Surface *FB_SetVGA16Mode(_THIS, SDL_Surface *current,
 	/* Get the fixed information about the console hardware.
 	   This is necessary since finfo.line_length changes.
 	 */
-	if ( ioctl(console_fd, FBIOGET_FSCREENINFO, &finfo) < 0 ) {
+	if ( FB_ioctl(this, FBIOGET_FSCREENINFO, &finfo) < 0 ) {
 		SDL_SetError("Couldn't get console hardware info");
 		return(NULL);
 	}
@@ -1021,7 +1180,7 @@ static SDL_Surface *FB_SetVideoMode(_THIS, SDL_Surface *current,
 	int surfaces_len;
 
 	/* Set the terminal into graphics mode */
-	if ( FB_EnterGraphicsMode(this) < 0 ) {
+	if ( !file_fb && (FB_EnterGraphicsMode(this) < 0) ) {
 		return(NULL);
 	}
 
@@ -1029,7 +1188,7 @@ static SDL_Surface *FB_SetVideoMode(_THIS, SDL_Surface *current,
 	FB_RestorePalette(this);
 
 	/* Set the video mode and get the final screen format */
-	if ( ioctl(console_fd, FBIOGET_VSCREENINFO, &vinfo) < 0 ) {
+	if ( FB_ioctl(this, FBIOGET_VSCREENINFO, &vinfo) < 0 ) {
 		SDL_SetError("Couldn't get console screen info");
 		return(NULL);
 	}
@@ -1079,9 +1238,9 @@ static SDL_Surface *FB_SetVideoMode(_THIS, SDL_Surface *current,
 		print_vinfo(&vinfo);
 #endif
 		if ( !shadow_fb &&
-				ioctl(console_fd, FBIOPUT_VSCREENINFO, &vinfo) < 0 ) {
+				FB_ioctl(this, FBIOPUT_VSCREENINFO, &vinfo) < 0 ) {
 			vinfo.yres_virtual = height;
-			if ( ioctl(console_fd, FBIOPUT_VSCREENINFO, &vinfo) < 0 ) {
+			if ( FB_ioctl(this, FBIOPUT_VSCREENINFO, &vinfo) < 0 ) {
 				SDL_SetError("Couldn't set console screen info");
 				return(NULL);
 			}
@@ -1129,7 +1288,7 @@ static SDL_Surface *FB_SetVideoMode(_THIS, SDL_Surface *current,
 	/* Get the fixed information about the console hardware.
 	   This is necessary since finfo.line_length changes.
 	 */
-	if ( ioctl(console_fd, FBIOGET_FSCREENINFO, &finfo) < 0 ) {
+	if ( FB_ioctl(this, FBIOGET_FSCREENINFO, &finfo) < 0 ) {
 		SDL_SetError("Couldn't get console hardware info");
 		return(NULL);
 	}
@@ -1138,11 +1297,8 @@ static SDL_Surface *FB_SetVideoMode(_THIS, SDL_Surface *current,
 	FB_SavePalette(this, &finfo, &vinfo);
 
 	if (shadow_fb) {
-		if (vinfo.bits_per_pixel == 16) {
-			blitFunc = (rotate == FBCON_ROTATE_NONE ||
-					rotate == FBCON_ROTATE_UD) ?
-				FB_blit16 : FB_blit16blocked;
-		} else {
+		blitFunc = FB_GetShadowBlit(vinfo.bits_per_pixel, rotate);
+		if (blitFunc == NULL) {
 #ifdef FBCON_DEBUG
 			fprintf(stderr, "Init vinfo:\n");
 			print_vinfo(&vinfo);
@@ -1172,6 +1328,13 @@ static SDL_Surface *FB_SetVideoMode(_THIS, SDL_Surface *current,
 		current->pixels = mapped_mem+mapped_offset;
 	}
 
+	if (shadow_fb) {
+		if (FB_InitShadowUpdate(this, current->w, current->h,
+					vinfo.bits_per_pixel) < 0) {
+			return(NULL);
+		}
+	}
+
 	/* Set up the information for hardware surfaces */
 	surfaces_mem = (char *)current->pixels +
 		vinfo.yres_virtual*current->pitch;
@@ -1197,15 +1360,10 @@ static SDL_Surface *FB_SetVideoMode(_THIS, SDL_Surface *current,
 	if ( (flags & SDL_TRIPLEBUF) == SDL_TRIPLEBUF ) {
 		current->flags |= SDL_TRIPLEBUF;
 		current_page = 0;
-		new_page = 2;
+		triplebuf_mailbox = 2;
 		triplebuf_thread_stop = 0;
 
-		SDL_LockMutex(triplebuf_mutex);
 		triplebuf_thread = SDL_CreateThread(FB_TripleBufferingThread, this);
-
-		/* Wait until the triplebuf thread is ready */
-		SDL_CondWait(triplebuf_cond, triplebuf_mutex);
-		SDL_UnlockMutex(triplebuf_mutex);
 	}
 #endif
 
@@ -1469,53 +1627,69 @@ static void FB_WaitIdle(_THIS)
 }
 
 #if !SDL_THREADS_DISABLED
+/* The display thread and FB_FlipHWSurface() trade pages through a single
+   atomic mailbox, so the application never waits for the vertical retrace.
+   A flip puts the finished page in the mailbox and takes out whatever was
+   there: the page that went off the screen, or a frame the display never
+   got to, which is dropped.  The display thread swaps the page on the
+   screen for a fresh frame.
+ */
 static int FB_TripleBufferingThread(void *d)
 {
 	SDL_VideoDevice *this = d;
 
-	SDL_LockMutex(triplebuf_mutex);
-	SDL_CondSignal(triplebuf_cond);
-
 	for (;;) {
-		unsigned int page;
+		struct fb_var_screeninfo vinfo;
+		int mailbox;
 
-		SDL_CondWait(triplebuf_cond, triplebuf_mutex);
-		if (triplebuf_thread_stop)
+		SDL_SemWait(triplebuf_wake);
+		if (SDL_AtomicGet(&triplebuf_thread_stop))
 			break;
 
-		/* Flip the most recent back buffer with the front buffer */
-		page = current_page;
-		current_page = new_page;
-		new_page = page;
+		/* Several flips may have been posted for one frame */
+		mailbox = SDL_AtomicGet(&triplebuf_mailbox);
+		if (!(mailbox & TRIPLEBUF_FRESH))
+			continue;
+
+		/* Take the most recent frame, give back the front buffer */
+		while (!SDL_AtomicCAS(&triplebuf_mailbox, mailbox, current_page))
+			mailbox = SDL_AtomicGet(&triplebuf_mailbox);
+		current_page = (mailbox & TRIPLEBUF_PAGE);
+		if (triplebuf_fifo)
+			SDL_SemPost(triplebuf_consumed);
 
-		/* flip display */
-		cache_vinfo.yoffset = current_page * cache_vinfo.yres;
+		/* flip display, panning a copy the application can't touch */
+		vinfo = cache_vinfo;
+		vinfo.yoffset = current_page * vinfo.yres;
 
 		wait_vbl(this);
 
-		if ( ioctl(console_fd, FBIOPAN_DISPLAY, &cache_vinfo) < 0 ) {
+		if ( FB_ioctl(this, FBIOPAN_DISPLAY, &vinfo) < 0 ) {
 			SDL_SetError("ioctl(FBIOPAN_DISPLAY) failed");
-			return(-1);
+			continue;
 		}
+		SDL_FrameVBlank(this, SDL_FrameTime());
 	}
 
-	SDL_UnlockMutex(triplebuf_mutex);
 	return 0;
 }
 
 static void FB_TripleBufferInit(_THIS)
 {
-	triplebuf_mutex = SDL_CreateMutex();
-	triplebuf_cond = SDL_CreateCond();
+	const char *mode;
+
+	triplebuf_wake = SDL_CreateSemaphore(0);
+	triplebuf_consumed = SDL_CreateSemaphore(0);
 	triplebuf_thread = NULL;
+
+	mode = SDL_GetHint(SDL_HINT_FBCON_TRIPLEBUF_MODE);
+	triplebuf_fifo = (mode && SDL_strcasecmp(mode, "FIFO") == 0);
 }
 
 static void FB_TripleBufferStop(_THIS)
 {
-	SDL_LockMutex(triplebuf_mutex);
-	triplebuf_thread_stop = 1;
-	SDL_CondSignal(triplebuf_cond);
-	SDL_UnlockMutex(triplebuf_mutex);
+	SDL_AtomicSet(&triplebuf_thread_stop, 1);
+	SDL_SemPost(triplebuf_wake);
 
 	SDL_WaitThread(triplebuf_thread, NULL);
 	triplebuf_thread = NULL;
@@ -1525,8 +1699,8 @@ static void FB_TripleBufferQuit(_THIS)
 {
 	if (triplebuf_thread)
 		FB_TripleBufferStop(this);
-	SDL_DestroyMutex(triplebuf_mutex);
-	SDL_DestroyCond(triplebuf_cond);
+	SDL_DestroySemaphore(triplebuf_wake);
+	SDL_DestroySemaphore(triplebuf_consumed);
 }
 #endif
 
@@ -1536,25 +1710,31 @@ static int FB_FlipHWSurface(_THIS, SDL_Surface *surface)
 		return -2; /* no hardware access */
 	}
 
-	/* Wait for vertical retrace and then flip display */
-	cache_vinfo.yoffset = flip_page * cache_vinfo.yres;
 	if ( FB_IsSurfaceBusy(this->screen) ) {
 		FB_WaitBusySurfaces(this);
 	}
 
 	if ( (surface->flags & SDL_TRIPLEBUF) == SDL_TRIPLEBUF ) {
 #if !SDL_THREADS_DISABLED
-		unsigned int page;
+		int mailbox;
 
-		/* Flip the two back buffers */
-		SDL_LockMutex(triplebuf_mutex);
-		page = new_page;
-		new_page = flip_page;
-		flip_page = page;
+		/* In FIFO mode, wait for the display to take the last frame */
+		if ( triplebuf_fifo ) {
+			while ( SDL_AtomicGet(&triplebuf_mailbox) & TRIPLEBUF_FRESH ) {
+				SDL_SemWaitTimeout(triplebuf_consumed, 100);
+			}
+		}
+
+		/* Post the new frame and continue on the page we get back */
+		mailbox = SDL_AtomicSet(&triplebuf_mailbox,
+		                        flip_page | TRIPLEBUF_FRESH);
+		if ( mailbox & TRIPLEBUF_FRESH ) {
+			SDL_FrameDropped(this);
+		}
+		flip_page = (mailbox & TRIPLEBUF_PAGE);
 
 		surface->pixels = flip_address[flip_page];
-		SDL_CondSignal(triplebuf_cond);
-		SDL_UnlockMutex(triplebuf_mutex);
+		SDL_SemPost(triplebuf_wake);
 #endif
 	} else {
 		/* Wait for vertical retrace and then flip display */
@@ -1562,10 +1742,11 @@ static int FB_FlipHWSurface(_THIS, SDL_Surface *surface)
 
 		wait_vbl(this);
 
-		if ( ioctl(console_fd, FBIOPAN_DISPLAY, &cache_vinfo) < 0 ) {
+		if ( FB_ioctl(this, FBIOPAN_DISPLAY, &cache_vinfo) < 0 ) {
 			SDL_SetError("ioctl(FBIOPAN_DISPLAY) failed");
 			return(-1);
 		}
+		SDL_FrameVBlank(this, SDL_FrameTime());
 
 		flip_page = !flip_page;
 		surface->pixels = flip_address[flip_page];
@@ -1574,169 +1755,17 @@ static int FB_FlipHWSurface(_THIS, SDL_Surface *surface)
 	return(0);
 }
 
-static void FB_blit16(Uint8 *byte_src_pos, int src_right_delta, int src_down_delta,
-		Uint8 *byte_dst_pos, int dst_linebytes, int width, int height)
-{
-	int w;
-	Uint16 *src_pos = (Uint16 *)byte_src_pos;
-	Uint16 *dst_pos = (Uint16 *)byte_dst_pos;
-
-	while (height) {
-		Uint16 *src = src_pos;
-		Uint16 *dst = dst_pos;
-		for (w = width; w != 0; w--) {
-			*dst = *src;
-			src += src_right_delta;
-			dst++;
-		}
-		dst_pos = (Uint16 *)((Uint8 *)dst_pos + dst_linebytes);
-		src_pos += src_down_delta;
-		height--;
-	}
-}
-
-#define BLOCKSIZE_W 32
-#define BLOCKSIZE_H 32
-
-static void FB_blit16blocked(Uint8 *byte_src_pos, int src_right_delta, int src_down_delta, 
-		Uint8 *byte_dst_pos, int dst_linebytes, int width, int height)
-{
-	int w;
-	Uint16 *src_pos = (Uint16 *)byte_src_pos;
-	Uint16 *dst_pos = (Uint16 *)byte_dst_pos;
-
-	while (height > 0) {
-		Uint16 *src = src_pos;
-		Uint16 *dst = dst_pos;
-		for (w = width; w > 0; w -= BLOCKSIZE_W) {
-			FB_blit16((Uint8 *)src,
-					src_right_delta,
-					src_down_delta,
-					(Uint8 *)dst,
-					dst_linebytes,
-					min(w, BLOCKSIZE_W),
-					min(height, BLOCKSIZE_H));
-			src += src_right_delta * BLOCKSIZE_W;
-			dst += BLOCKSIZE_W;
-		}
-		dst_pos = (Uint16 *)((Uint8 *)dst_pos + dst_linebytes * BLOCKSIZE_H);
-		src_pos += src_down_delta * BLOCKSIZE_H;
-		height -= BLOCKSIZE_H;
-	}
-}
-
 static void FB_DirectUpdate(_THIS, int numrects, SDL_Rect *rects)
 {
-	int width = cache_vinfo.xres;
-	int height = cache_vinfo.yres;
-	int bytes_per_pixel = (cache_vinfo.bits_per_pixel + 7) / 8;
-	int i;
-
 	if (!shadow_fb) {
 		/* The application is already updating the visible video memory */
 		return;
 	}
-
-	if (cache_vinfo.bits_per_pixel != 16) {
-		SDL_SetError("Shadow copy only implemented for 16 bpp");
-		return;
+	if ( switched_away ) {
+		return; /* no hardware access */
 	}
 
-	for (i = 0; i < numrects; i++) {
-		int x1, y1, x2, y2;
-		int scr_x1, scr_y1, scr_x2, scr_y2;
-		int sha_x1, sha_y1;
-		int shadow_right_delta;  /* Address change when moving right in dest */
-		int shadow_down_delta;   /* Address change when moving down in dest */
-		char *src_start;
-		char *dst_start;
-
-		x1 = rects[i].x; 
-		y1 = rects[i].y;
-		x2 = x1 + rects[i].w; 
-		y2 = y1 + rects[i].h;
-
-		if (x1 < 0) {
-			x1 = 0;
-		} else if (x1 > width) {
-			x1 = width;
-		}
-		if (x2 < 0) {
-			x2 = 0;
-		} else if (x2 > width) {
-			x2 = width;
-		}
-		if (y1 < 0) {
-			y1 = 0;
-		} else if (y1 > height) {
-			y1 = height;
-		}
-		if (y2 < 0) {
-			y2 = 0;
-		} else if (y2 > height) {
-			y2 = height;
-		}
-		if (x2 <= x1 || y2 <= y1) {
-			continue;
-		}
-
-		switch (rotate) {
-			case FBCON_ROTATE_NONE:
-				sha_x1 = scr_x1 = x1;
-				sha_y1 = scr_y1 = y1;
-				scr_x2 = x2;
-				scr_y2 = y2;
-				shadow_right_delta = 1;
-				shadow_down_delta = width;
-				break;
-			case FBCON_ROTATE_CCW:
-				scr_x1 = y1;
-				scr_y1 = width - x2;
-				scr_x2 = y2;
-				scr_y2 = width - x1;
-				sha_x1 = x2 - 1;
-				sha_y1 = y1;
-				shadow_right_delta = width;
-				shadow_down_delta = -1;
-				break;
-			case FBCON_ROTATE_UD:
-				scr_x1 = width - x2;
-				scr_y1 = height - y2;
-				scr_x2 = width - x1;
-				scr_y2 = height - y1;
-				sha_x1 = x2 - 1;
-				sha_y1 = y2 - 1;
-				shadow_right_delta = -1;
-				shadow_down_delta = -width;
-				break;
-			case FBCON_ROTATE_CW:
-				scr_x1 = height - y2;
-				scr_y1 = x1;
-				scr_x2 = height - y1;
-				scr_y2 = x2;
-				sha_x1 = x1;
-				sha_y1 = y2 - 1;
-				shadow_right_delta = -width;
-				shadow_down_delta = 1;
-				break;
-			default:
-				SDL_SetError("Unknown rotation");
-				return;
-		}
-
-		src_start = shadow_mem +
-			(sha_y1 * width + sha_x1) * bytes_per_pixel;
-		dst_start = mapped_mem + mapped_offset + scr_y1 * physlinebytes + 
-			scr_x1 * bytes_per_pixel;
-
-		blitFunc((Uint8 *) src_start,
-				shadow_right_delta, 
-				shadow_down_delta, 
-				(Uint8 *) dst_start,
-				physlinebytes,
-				scr_x2 - scr_x1,
-				scr_y2 - scr_y1);
-	}
+	FB_ShadowUpdate(this, numrects, rects);
 }
 
 #ifdef VGA16_FBCON_SUPPORT
@@ -1922,7 +1951,7 @@ void FB_SavePaletteTo(_THIS, int palette_len, __u16 *area)
 	cmap.green = &area[1*palette_len];
 	cmap.blue = &area[2*palette_len];
 	cmap.transp = NULL;
-	ioctl(console_fd, FBIOGETCMAP, &cmap);
+	FB_ioctl(this, FBIOGETCMAP, &cmap);
 }
 
 void FB_RestorePaletteFrom(_THIS, int palette_len, __u16 *area)
@@ -1935,7 +1964,7 @@ void FB_RestorePaletteFrom(_THIS, int palette_len, __u16 *area)
 	cmap.green = &area[1*palette_len];
 	cmap.blue = &area[2*palette_len];
 	cmap.transp = NULL;
-	ioctl(console_fd, FBIOPUTCMAP, &cmap);
+	FB_ioctl(this, FBIOPUTCMAP, &cmap);
 }
 
 static void FB_SavePalette(_THIS, struct fb_fix_screeninfo *finfo,
@@ -2012,7 +2041,7 @@ static int FB_SetColors(_THIS, int firstcolor, int ncolors, SDL_Color *colors)
 	cmap.blue = b;
 	cmap.transp = NULL;
 
-	if( (ioctl(console_fd, FBIOPUTCMAP, &cmap) < 0) ||
+	if( (FB_ioctl(this, FBIOPUTCMAP, &cmap) < 0) ||
 	    !(this->screen->flags & SDL_HWPALETTE) ) {
 	        colors = this->screen->format->palette->colors;
 		ncolors = this->screen->format->palette->ncolors;
@@ -2021,7 +2050,7 @@ static int FB_SetColors(_THIS, int firstcolor, int ncolors, SDL_Color *colors)
 		SDL_memset(r, 0, sizeof(r));
 		SDL_memset(g, 0, sizeof(g));
 		SDL_memset(b, 0, sizeof(b));
-		if ( ioctl(console_fd, FBIOGETCMAP, &cmap) == 0 ) {
+		if ( FB_ioctl(this, FBIOGETCMAP, &cmap) == 0 ) {
 			for ( i=ncolors-1; i>=0; --i ) {
 				colors[i].r = (r[i]>>8);
 				colors[i].g = (g[i]>>8);
@@ -2044,6 +2073,7 @@ static void FB_VideoQuit(_THIS)
 #if !SDL_THREADS_DISABLED
 	FB_TripleBufferQuit(this);
 #endif
+	FB_QuitShadowUpdate(this);
 
 	if ( this->screen ) {
 		/* If the framebuffer is not to be cleared, make sure that we won't
@@ -2104,12 +2134,12 @@ static void FB_VideoQuit(_THIS)
 		if ( FB_InGraphicsMode(this) ) {
 			if (dontClearPixels) {
 				/* Restore only panning, keep current mode */
-				ioctl(console_fd, FBIOGET_VSCREENINFO, &saved_vinfo);
+				FB_ioctl(this, FBIOGET_VSCREENINFO, &saved_vinfo);
 				saved_vinfo.yoffset = saved_vinfo.xoffset = 0;
 			} else {
 				FB_RestorePalette(this);
 			}
-			ioctl(console_fd, FBIOPUT_VSCREENINFO, &saved_vinfo);
+			FB_ioctl(this, FBIOPUT_VSCREENINFO, &saved_vinfo);
 		}
 
 		/* We're all done with the framebuffer */
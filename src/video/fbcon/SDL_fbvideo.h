@@ -48,6 +48,17 @@ typedef void FB_bitBlit(
 		int width,
 		int height);
 
+/* Shadow framebuffer orientations */
+enum {
+	FBCON_ROTATE_NONE = 0,
+	FBCON_ROTATE_CCW = 90,
+	FBCON_ROTATE_UD = 180,
+	FBCON_ROTATE_CW = 270
+};
+
+/* Shadow update state, see SDL_fbshadow.c */
+typedef struct FB_ShadowUpdater FB_ShadowUpdater;
+
 /* This is the structure we use to keep track of video memory */
 typedef struct vidmem_bucket {
 	struct vidmem_bucket *prev;
@@ -86,16 +97,23 @@ struct SDL_PrivateVideoData {
 	int flip_page;
 	char *flip_address[3];
 #if !SDL_THREADS_DISABLED
-	int current_page;
-	int new_page;
-	SDL_mutex *triplebuf_mutex;
-	SDL_cond *triplebuf_cond;
+	int current_page;			/* Owned by the display thread */
+	volatile int triplebuf_mailbox;		/* Page handed between threads */
+	volatile int triplebuf_thread_stop;
+	int triplebuf_fifo;			/* Wait instead of dropping frames */
+	SDL_sem *triplebuf_wake;
+	SDL_sem *triplebuf_consumed;
 	SDL_Thread *triplebuf_thread;
-	int triplebuf_thread_stop;
 #endif
+	int file_fb;				/* The "framebuffer" is a regular file */
+	struct fb_var_screeninfo file_vinfo;
+	__u32 file_memlen;
+	__u16 file_cmap[3*256];
+
 	int rotate;
 	int shadow_fb;				/* Tells whether a shadow is being used. */
 	FB_bitBlit *blitFunc;
+	FB_ShadowUpdater *shadow_updater;
 	int physlinebytes;			/* Length of a line in bytes in physical fb */
 
 #define NUM_MODELISTS	4		/* 8, 16, 24, and 32 bits-per-pixel */
@@ -141,15 +159,27 @@ struct SDL_PrivateVideoData {
 #define flip_address		(this->hidden->flip_address)
 #if !SDL_THREADS_DISABLED
 #define current_page		(this->hidden->current_page)
-#define new_page			(this->hidden->new_page)
-#define triplebuf_mutex		(this->hidden->triplebuf_mutex)
-#define triplebuf_cond		(this->hidden->triplebuf_cond)
-#define triplebuf_thread	(this->hidden->triplebuf_thread)
+#define triplebuf_mailbox	(this->hidden->triplebuf_mailbox)
 #define triplebuf_thread_stop	(this->hidden->triplebuf_thread_stop)
+#define triplebuf_fifo		(this->hidden->triplebuf_fifo)
+#define triplebuf_wake		(this->hidden->triplebuf_wake)
+#define triplebuf_consumed	(this->hidden->triplebuf_consumed)
+#define triplebuf_thread	(this->hidden->triplebuf_thread)
+
+/* The triple buffer mailbox holds a page number and whether the page
+   is a finished frame that hasn't been shown yet.
+ */
+#define TRIPLEBUF_PAGE		0x03
+#define TRIPLEBUF_FRESH		0x04
 #endif
+#define file_fb			(this->hidden->file_fb)
+#define file_vinfo		(this->hidden->file_vinfo)
+#define file_memlen		(this->hidden->file_memlen)
+#define file_cmap		(this->hidden->file_cmap)
 #define rotate			(this->hidden->rotate)
 #define shadow_fb		(this->hidden->shadow_fb)
 #define blitFunc		(this->hidden->blitFunc)
+#define shadow_updater		(this->hidden->shadow_updater)
 #define physlinebytes		(this->hidden->physlinebytes)
 #define SDL_nummodes		(this->hidden->SDL_nummodes)
 #define SDL_modelist		(this->hidden->SDL_modelist)
@@ -0,0 +1,170 @@
+
+/* Benchmark and test for the converted audio cache
+
+   Converts a WAVE file (sample.wav by default) to 44.1 kHz stereo S16,
+   timing a plain SDL_ConvertAudio() against a hit in the cache.  Then
+   has several threads ask a new cache for the same sound at once and
+   checks that it's converted into the cache once, with every other
+   request counted as a hit and given the same buffer.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "SDL.h"
+
+#define CALLS	100
+#define RUNS	5
+#define THREADS	8
+
+static SDL_AudioSpec wave_spec;
+static Uint8 *wave_buf;
+static Uint32 wave_len;
+
+static SDL_AudioCache *race_cache;
+static SDL_sem *race_start;
+static const Uint8 *race_bufs[THREADS];
+
+/* Best time for CALLS conversions, in ms */
+static Uint32 time_convert(const SDL_AudioSpec *out)
+{
+	SDL_AudioCVT cvt;
+	Uint32 then, best = ~0;
+	int run, i;
+
+	SDL_BuildAudioCVT(&cvt, wave_spec.format, wave_spec.channels,
+		wave_spec.freq, out->format, out->channels, out->freq);
+	cvt.buf = (Uint8 *)SDL_malloc(wave_len * cvt.len_mult);
+	if ( cvt.buf == NULL ) {
+		return(0);
+	}
+	for ( run = 0; run < RUNS; ++run ) {
+		then = SDL_GetTicks();
+		for ( i = 0; i < CALLS; ++i ) {
+			SDL_memcpy(cvt.buf, wave_buf, wave_len);
+			cvt.len = wave_len;
+			SDL_ConvertAudio(&cvt);
+		}
+		best = SDL_min(best, SDL_GetTicks() - then);
+	}
+	SDL_free(cvt.buf);
+	return(best);
+}
+
+/* Best time for CALLS hits in the cache, in ms */
+static Uint32 time_hits(SDL_AudioCache *cache)
+{
+	const Uint8 *buf;
+	Uint32 then, best = ~0;
+	int run, i;
+
+	/* The first call converts it */
+	buf = SDL_CacheAudio(cache, &wave_spec, wave_buf, wave_len, NULL);
+	SDL_ReleaseCachedAudio(cache, buf);
+	for ( run = 0; run < RUNS; ++run ) {
+		then = SDL_GetTicks();
+		for ( i = 0; i < CALLS; ++i ) {
+			buf = SDL_CacheAudio(cache, &wave_spec, wave_buf, wave_len, NULL);
+			SDL_ReleaseCachedAudio(cache, buf);
+		}
+		best = SDL_min(best, SDL_GetTicks() - then);
+	}
+	return(best);
+}
+
+static int SDLCALL race_thread(void *data)
+{
+	int index = (int)(size_t)data;
+
+	SDL_SemWait(race_start);
+	race_bufs[index] = SDL_CacheAudio(race_cache, &wave_spec,
+					wave_buf, wave_len, NULL);
+	return(0);
+}
+
+static int check_race(const SDL_AudioSpec *out)
+{
+	SDL_Thread *threads[THREADS];
+	SDL_AudioCacheStats stats;
+	int i, status = 0;
+
+	race_cache = SDL_CreateAudioCache(out, 64*1024*1024);
+	race_start = SDL_CreateSemaphore(0);
+	if ( race_cache == NULL || race_start == NULL ) {
+		fprintf(stderr, "Couldn't create the cache: %s\n", SDL_GetError());
+		return(-1);
+	}
+	for ( i = 0; i < THREADS; ++i ) {
+		threads[i] = SDL_CreateThread(race_thread, (void *)(size_t)i);
+	}
+	for ( i = 0; i < THREADS; ++i ) {
+		SDL_SemPost(race_start);
+	}
+	for ( i = 0; i < THREADS; ++i ) {
+		SDL_WaitThread(threads[i], NULL);
+	}
+
+	SDL_GetAudioCacheStats(race_cache, &stats);
+	printf("%d threads at once: %u hits, %u misses, %u entries\n", THREADS,
+		(unsigned int)stats.hits, (unsigned int)stats.misses,
+		(unsigned int)stats.entries);
+	if ( stats.misses != 1 || stats.hits != THREADS-1 || stats.entries != 1 ) {
+		fprintf(stderr, "Expected 1 miss, %d hits and 1 entry\n", THREADS-1);
+		status = -1;
+	}
+	for ( i = 0; i < THREADS; ++i ) {
+		if ( race_bufs[i] != race_bufs[0] ) {
+			fprintf(stderr, "Thread %d got a different buffer\n", i);
+			status = -1;
+		}
+		SDL_ReleaseCachedAudio(race_cache, race_bufs[i]);
+	}
+	SDL_DestroySemaphore(race_start);
+	SDL_FreeAudioCache(race_cache);
+	return(status);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *file = (argc > 1) ? argv[1] : "sample.wav";
+	SDL_AudioSpec out;
+	SDL_AudioCache *cache;
+	Uint32 convert_ms, hit_ms;
+	int status = 0;
+
+	if ( SDL_Init(0) < 0 ) {
+		fprintf(stderr, "Couldn't initialize SDL: %s\n", SDL_GetError());
+		return(1);
+	}
+	if ( SDL_LoadWAV(file, &wave_spec, &wave_buf, &wave_len) == NULL ) {
+		fprintf(stderr, "Couldn't load %s: %s\n", file, SDL_GetError());
+		SDL_Quit();
+		return(1);
+	}
+	SDL_memset(&out, 0, sizeof(out));
+	out.format = AUDIO_S16SYS;
+	out.channels = 2;
+	out.freq = 44100;
+
+	cache = SDL_CreateAudioCache(&out, 64*1024*1024);
+	if ( cache == NULL ) {
+		fprintf(stderr, "Couldn't create the cache: %s\n", SDL_GetError());
+		SDL_FreeWAV(wave_buf);
+		SDL_Quit();
+		return(1);
+	}
+	convert_ms = time_convert(&out);
+	hit_ms = time_hits(cache);
+	SDL_FreeAudioCache(cache);
+	printf("%s, %u bytes, to 44.1 kHz stereo S16:\n", file,
+		(unsigned int)wave_len);
+	printf("  SDL_ConvertAudio  %6.3f ms\n", (double)convert_ms / CALLS);
+	printf("  cache hit         %6.3f ms\n", (double)hit_ms / CALLS);
+
+	if ( check_race(&out) < 0 ) {
+		status = 1;
+	}
+	SDL_FreeWAV(wave_buf);
+	SDL_Quit();
+	return(status);
+}
@@ -0,0 +1,167 @@
+
+/* Test program to check the RLE decoding in the BMP loader.
+
+   Loads rle8.bmp and rle4.bmp, two 6x4 images that use encoded runs,
+   absolute runs, a delta and end of line markers, and compares their
+   pixels with the expected ones.  Then loads them again from a stream
+   that fails once the pixel data is reached, which must be an error.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "SDL.h"
+
+#define WIDTH	6
+#define HEIGHT	4
+
+/* Rows in file order, which is bottom-up */
+static const Uint8 rle8_pixels[HEIGHT][WIDTH] = {
+	{ 1, 1, 1, 2, 3, 4 },
+	{ 0, 0, 0, 0, 0, 0 },
+	{ 0, 0, 5, 5, 5, 5 },
+	{ 7, 7, 7, 7, 7, 7 }
+};
+static const Uint8 rle4_pixels[HEIGHT][WIDTH] = {
+	{ 1, 2, 1, 3, 4, 5 },
+	{ 0, 0, 0, 0, 0, 0 },
+	{ 0, 0, 6, 7, 6, 7 },
+	{ 8, 9, 8, 9, 8, 9 }
+};
+
+/* A stream whose reads fail from a given offset on */
+typedef struct {
+	SDL_RWops *src;
+	int fail_at;
+} FailingStream;
+
+static int SDLCALL failing_seek(SDL_RWops *context, int offset, int whence)
+{
+	FailingStream *stream = (FailingStream *)context->hidden.unknown.data1;
+	return SDL_RWseek(stream->src, offset, whence);
+}
+
+static int SDLCALL failing_read(SDL_RWops *context, void *ptr, int size, int maxnum)
+{
+	FailingStream *stream = (FailingStream *)context->hidden.unknown.data1;
+	if ( SDL_RWtell(stream->src) >= stream->fail_at ) {
+		SDL_SetError("Simulated read error");
+		return(-1);
+	}
+	return SDL_RWread(stream->src, ptr, size, maxnum);
+}
+
+static int SDLCALL failing_write(SDL_RWops *context, const void *ptr, int size, int num)
+{
+	SDL_SetError("Stream is read-only");
+	return(-1);
+}
+
+static int SDLCALL failing_close(SDL_RWops *context)
+{
+	FailingStream *stream = (FailingStream *)context->hidden.unknown.data1;
+	SDL_RWclose(stream->src);
+	SDL_FreeRW(context);
+	return(0);
+}
+
+static SDL_RWops *FailingRWFromFile(const char *file)
+{
+	static FailingStream stream;
+	Uint8 header[14];
+	SDL_RWops *rw;
+
+	stream.src = SDL_RWFromFile(file, "rb");
+	if ( stream.src == NULL ) {
+		return(NULL);
+	}
+	/* Fail at bfOffBits, where the pixel data starts */
+	if ( SDL_RWread(stream.src, header, sizeof(header), 1) != 1 ) {
+		SDL_RWclose(stream.src);
+		return(NULL);
+	}
+	stream.fail_at = header[10] | (header[11] << 8) |
+	                 (header[12] << 16) | (header[13] << 24);
+	SDL_RWseek(stream.src, 0, RW_SEEK_SET);
+
+	rw = SDL_AllocRW();
+	if ( rw == NULL ) {
+		SDL_RWclose(stream.src);
+		return(NULL);
+	}
+	rw->seek = failing_seek;
+	rw->read = failing_read;
+	rw->write = failing_write;
+	rw->close = failing_close;
+	rw->hidden.unknown.data1 = &stream;
+	return(rw);
+}
+
+static int check_bmp(const char *file, const Uint8 pixels[HEIGHT][WIDTH])
+{
+	SDL_Surface *surface;
+	SDL_RWops *rw;
+	Uint8 *row;
+	int x, y;
+	int failed = 0;
+
+	surface = SDL_LoadBMP(file);
+	if ( surface == NULL ) {
+		fprintf(stderr, "Couldn't load %s: %s\n", file, SDL_GetError());
+		return(-1);
+	}
+	if ( surface->w != WIDTH || surface->h != HEIGHT ||
+	     surface->format->BitsPerPixel != 8 ) {
+		fprintf(stderr, "%s: loaded as %dx%dx%d, expected %dx%dx8\n",
+			file, surface->w, surface->h,
+			surface->format->BitsPerPixel, WIDTH, HEIGHT);
+		SDL_FreeSurface(surface);
+		return(-1);
+	}
+	for ( y = 0; y < HEIGHT; ++y ) {
+		row = (Uint8 *)surface->pixels + (HEIGHT-1-y) * surface->pitch;
+		for ( x = 0; x < WIDTH; ++x ) {
+			if ( row[x] != pixels[y][x] ) {
+				fprintf(stderr, "%s: pixel %d,%d is %d, expected %d\n",
+					file, x, HEIGHT-1-y, row[x], pixels[y][x]);
+				failed = 1;
+			}
+		}
+	}
+	SDL_FreeSurface(surface);
+	if ( failed ) {
+		return(-1);
+	}
+
+	rw = FailingRWFromFile(file);
+	if ( rw == NULL ) {
+		fprintf(stderr, "Couldn't open %s: %s\n", file, SDL_GetError());
+		return(-1);
+	}
+	surface = SDL_LoadBMP_RW(rw, 1);
+	if ( surface != NULL ) {
+		fprintf(stderr, "%s: loaded despite a read error\n", file);
+		SDL_FreeSurface(surface);
+		return(-1);
+	}
+	printf("%s: OK\n", file);
+	return(0);
+}
+
+int main(int argc, char *argv[])
+{
+	int status = 0;
+
+	if ( SDL_Init(0) < 0 ) {
+		fprintf(stderr, "Couldn't initialize SDL: %s\n", SDL_GetError());
+		return(1);
+	}
+	if ( check_bmp("rle8.bmp", rle8_pixels) < 0 ) {
+		status = 1;
+	}
+	if ( check_bmp("rle4.bmp", rle4_pixels) < 0 ) {
+		status = 1;
+	}
+	SDL_Quit();
+	return(status);
+}
@@ -0,0 +1,161 @@
+
+/* Test program to check the hint priorities and callbacks
+
+   Sets hints at each priority, with and without an environment variable
+   of the same name, and checks which value wins.  Then checks that
+   callbacks see every change and only changes, and that a value read
+   from the environment stays valid after SDL reads the environment
+   again when a subsystem is initialized.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+
+#define PRIORITY_HINT	"TESTHINTS_PRIORITY"
+#define ENV_HINT	"TESTHINTS_ENV"
+#define REFRESH_HINT	"TESTHINTS_REFRESH"
+
+static int failures = 0;
+
+static void check(int ok, const char *what)
+{
+	if ( ! ok ) {
+		fprintf(stderr, "FAILED: %s\n", what);
+		++failures;
+	}
+}
+
+static int same(const char *a, const char *b)
+{
+	if ( a == NULL || b == NULL ) {
+		return(a == b);
+	}
+	return(strcmp(a, b) == 0);
+}
+
+static void test_priority(void)
+{
+	check(SDL_GetHint(PRIORITY_HINT) == NULL, "unset hint is NULL");
+	check(SDL_SetHint(PRIORITY_HINT, "normal"), "set at normal priority");
+	check(!SDL_SetHintWithPriority(PRIORITY_HINT, "default", SDL_HINT_DEFAULT),
+	      "default priority can't replace normal");
+	check(same(SDL_GetHint(PRIORITY_HINT), "normal"), "normal value kept");
+	check(SDL_SetHintWithPriority(PRIORITY_HINT, "override", SDL_HINT_OVERRIDE),
+	      "set at override priority");
+	check(!SDL_SetHint(PRIORITY_HINT, "normal"),
+	      "normal priority can't replace override");
+	check(same(SDL_GetHint(PRIORITY_HINT), "override"), "override value kept");
+	check(SDL_SetHintWithPriority(PRIORITY_HINT, NULL, SDL_HINT_OVERRIDE),
+	      "unset at override priority");
+	check(SDL_GetHint(PRIORITY_HINT) == NULL, "unset hint is NULL again");
+	check(SDL_SetHintWithPriority(PRIORITY_HINT, "default", SDL_HINT_DEFAULT),
+	      "set at default priority once unset");
+
+	check(SDL_GetHintInt(PRIORITY_HINT, 7) == 0, "non-numeric hint is 0");
+	SDL_SetHint(PRIORITY_HINT, "42");
+	check(SDL_GetHintInt(PRIORITY_HINT, 7) == 42, "numeric hint");
+	SDL_SetHint(PRIORITY_HINT, "off");
+	check(SDL_GetHintBoolean(PRIORITY_HINT, SDL_TRUE) == SDL_FALSE,
+	      "\"off\" is false");
+	SDL_SetHint(PRIORITY_HINT, NULL);
+	check(SDL_GetHintBoolean(PRIORITY_HINT, SDL_TRUE) == SDL_TRUE,
+	      "unset boolean hint is the default");
+}
+
+static void test_environment(void)
+{
+	SDL_putenv(ENV_HINT "=env");
+	check(same(SDL_GetHint(ENV_HINT), "env"), "hint read from environment");
+	check(SDL_SetHint(ENV_HINT, "normal"), "set over environment");
+	check(same(SDL_GetHint(ENV_HINT), "env"),
+	      "environment wins over normal priority");
+	check(SDL_SetHintWithPriority(ENV_HINT, "override", SDL_HINT_OVERRIDE),
+	      "set over environment at override priority");
+	check(same(SDL_GetHint(ENV_HINT), "override"),
+	      "override priority wins over environment");
+	SDL_SetHintWithPriority(ENV_HINT, NULL, SDL_HINT_OVERRIDE);
+	check(same(SDL_GetHint(ENV_HINT), "env"), "environment back once unset");
+}
+
+static int calls;
+static char last_old[64], last_new[64];
+
+static void SDLCALL watch_hint(void *userdata, const char *name,
+                               const char *oldValue, const char *newValue)
+{
+	++*(int *)userdata;
+	SDL_strlcpy(last_old, oldValue ? oldValue : "(null)", sizeof(last_old));
+	SDL_strlcpy(last_new, newValue ? newValue : "(null)", sizeof(last_new));
+
+	/* Callbacks run without SDL's lock, so they can look hints up */
+	check(same(SDL_GetHint(name), newValue), "callback sees the new value");
+}
+
+static void test_callbacks(void)
+{
+	calls = 0;
+	SDL_SetHint(PRIORITY_HINT, "one");
+	SDL_AddHintCallback(PRIORITY_HINT, watch_hint, &calls);
+	check(calls == 1 && same(last_old, "one") && same(last_new, "one"),
+	      "callback called when added");
+
+	SDL_SetHint(PRIORITY_HINT, "two");
+	check(calls == 2 && same(last_old, "one") && same(last_new, "two"),
+	      "callback called on change");
+	SDL_SetHint(PRIORITY_HINT, "two");
+	check(calls == 2, "callback not called when the value is the same");
+	SDL_SetHintWithPriority(PRIORITY_HINT, "three", SDL_HINT_DEFAULT);
+	check(calls == 2, "callback not called when the hint isn't set");
+	SDL_SetHint(PRIORITY_HINT, NULL);
+	check(calls == 3 && same(last_old, "two") && same(last_new, "(null)"),
+	      "callback called when unset");
+
+	SDL_DelHintCallback(PRIORITY_HINT, watch_hint, &calls);
+	SDL_SetHint(PRIORITY_HINT, "four");
+	check(calls == 3, "callback not called once removed");
+}
+
+static void test_refresh(void)
+{
+	const char *value;
+
+	SDL_putenv(REFRESH_HINT "=first");
+	value = SDL_GetHint(REFRESH_HINT);
+	check(same(value, "first"), "hint read from environment");
+
+	calls = 0;
+	SDL_AddHintCallback(REFRESH_HINT, watch_hint, &calls);
+	SDL_putenv(REFRESH_HINT "=second");
+	check(same(SDL_GetHint(REFRESH_HINT), "first"),
+	      "environment not read again until a subsystem starts");
+	SDL_InitSubSystem(SDL_INIT_TIMER);
+	check(same(SDL_GetHint(REFRESH_HINT), "second"),
+	      "environment read again when a subsystem starts");
+	check(calls == 2 && same(last_old, "first") && same(last_new, "second"),
+	      "callback called when the environment changes");
+	check(same(value, "first"), "old value still valid after the refresh");
+	SDL_DelHintCallback(REFRESH_HINT, watch_hint, &calls);
+}
+
+int main(int argc, char *argv[])
+{
+	if ( SDL_Init(0) < 0 ) {
+		fprintf(stderr, "Couldn't initialize SDL: %s\n", SDL_GetError());
+		return(1);
+	}
+	test_priority();
+	test_environment();
+	test_callbacks();
+	test_refresh();
+	SDL_Quit();
+
+	if ( failures ) {
+		printf("%d checks failed\n", failures);
+		return(1);
+	}
+	printf("All hint checks passed\n");
+	return(0);
+}
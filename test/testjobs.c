@@ -0,0 +1,151 @@
+
+/* Benchmark and test for the job threads in SDL_jobs.h
+
+   Runs a loop over a big array on one thread and with SDL_ParallelFor(),
+   checking that both give the same answer, then starts a tree of jobs
+   that start and wait for jobs of their own, and a chain of jobs that
+   have to run in order.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "SDL.h"
+
+#define ELEMENTS	(4*1024*1024)
+#define GRAIN		4096
+#define RUNS		5
+#define TREE_DEPTH	12
+#define CHAIN_LENGTH	1000
+
+static float *input, *output;
+
+/* Something that takes a little while for each element */
+static void SDLCALL work(void *data, int first, int last)
+{
+	int i, j;
+	float x;
+
+	for ( i = first; i < last; ++i ) {
+		x = input[i];
+		for ( j = 0; j < 16; ++j ) {
+			x = x * 0.999f + 0.5f / (1.0f + x * x);
+		}
+		output[i] = x;
+	}
+}
+
+static Uint32 time_loop(int parallel)
+{
+	Uint32 then, best = ~0;
+	int run;
+
+	for ( run = 0; run < RUNS; ++run ) {
+		then = SDL_GetTicks();
+		if ( parallel ) {
+			SDL_ParallelFor(0, ELEMENTS, GRAIN, work, NULL);
+		} else {
+			work(NULL, 0, ELEMENTS);
+		}
+		then = SDL_GetTicks() - then;
+		if ( then < best ) {
+			best = then;
+		}
+	}
+	return best;
+}
+
+static SDL_mutex *leaves_lock;
+static int leaves;
+
+/* Each job below the bottom of the tree starts two more and waits */
+static void SDLCALL tree(void *data)
+{
+	int depth = (int)(size_t)data;
+	SDL_Job *left, *right;
+
+	if ( depth == 0 ) {
+		SDL_mutexP(leaves_lock);
+		++leaves;
+		SDL_mutexV(leaves_lock);
+		return;
+	}
+	left = SDL_CreateJob(tree, (void *)(size_t)(depth - 1));
+	right = SDL_CreateJob(tree, (void *)(size_t)(depth - 1));
+	SDL_StartJob(left);
+	SDL_StartJob(right);
+	SDL_WaitJob(left);
+	SDL_WaitJob(right);
+}
+
+static int chain_next;
+static int chain_ok = 1;
+
+static void SDLCALL chain_link(void *data)
+{
+	if ( (int)(size_t)data != chain_next++ ) {
+		chain_ok = 0;
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	SDL_Job *chain[CHAIN_LENGTH];
+	float *serial;
+	Uint32 serial_ms, parallel_ms, then;
+	int i, ok;
+
+	if ( SDL_Init(0) < 0 ) {
+		fprintf(stderr, "Couldn't initialize SDL: %s\n", SDL_GetError());
+		return(1);
+	}
+	printf("%d CPU(s), %d job thread(s)\n",
+	       SDL_GetCPUCount(), SDL_GetJobThreads());
+
+	input = (float *)malloc(ELEMENTS * sizeof(float));
+	serial = (float *)malloc(ELEMENTS * sizeof(float));
+	output = serial;
+	for ( i = 0; i < ELEMENTS; ++i ) {
+		input[i] = (float)(i % 1000) / 100.0f;
+	}
+	serial_ms = time_loop(0);
+	output = (float *)malloc(ELEMENTS * sizeof(float));
+	parallel_ms = time_loop(1);
+	ok = (SDL_memcmp(serial, output, ELEMENTS * sizeof(float)) == 0);
+	printf("%d elements:\n", ELEMENTS);
+	printf("  one thread       %6u ms\n", (unsigned int)serial_ms);
+	printf("  SDL_ParallelFor  %6u ms%s\n", (unsigned int)parallel_ms,
+	       ok ? "" : "  WRONG ANSWER");
+	free(input);
+	free(serial);
+	free(output);
+
+	leaves_lock = SDL_CreateMutex();
+	then = SDL_GetTicks();
+	SDL_WaitJob(SDL_CreateJob(tree, (void *)(size_t)TREE_DEPTH));
+	printf("Tree of %d jobs: %u ms%s\n", (2 << TREE_DEPTH) - 1,
+	       (unsigned int)(SDL_GetTicks() - then),
+	       (leaves == (1 << TREE_DEPTH)) ? "" : "  LEAVES MISSING");
+	SDL_DestroyMutex(leaves_lock);
+
+	/* Start the chain from the end, so the dependencies decide the order */
+	then = SDL_GetTicks();
+	for ( i = 0; i < CHAIN_LENGTH; ++i ) {
+		chain[i] = SDL_CreateJob(chain_link, (void *)(size_t)i);
+		if ( i > 0 ) {
+			SDL_JobDependsOn(chain[i], chain[i-1]);
+		}
+	}
+	for ( i = CHAIN_LENGTH-1; i >= 0; --i ) {
+		SDL_StartJob(chain[i]);
+	}
+	for ( i = 0; i < CHAIN_LENGTH; ++i ) {
+		SDL_WaitJob(chain[i]);
+	}
+	printf("Chain of %d jobs: %u ms%s\n", CHAIN_LENGTH,
+	       (unsigned int)(SDL_GetTicks() - then),
+	       (chain_ok && chain_next == CHAIN_LENGTH) ? "" : "  OUT OF ORDER");
+
+	SDL_Quit();
+	return(0);
+}
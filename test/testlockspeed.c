@@ -0,0 +1,227 @@
+
+/* Benchmark for the SDL mutex, semaphore and condition variable code
+
+   Has several threads take turns incrementing a counter under a mutex,
+   two threads bounce a token back and forth with a pair of semaphores
+   and then with a condition variable, and checks that waits time out
+   when they should.  Then several threads read a table under a
+   reader-writer lock while one rewrites it, and the try-locks are
+   checked against a lock held by another thread.  Prints how often the mutex and semaphores were
+   found taken, on platforms where SDL counts that.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "SDL.h"
+#include "SDL_thread.h"
+
+#define NUM_THREADS	4
+#define INCREMENTS	1000000
+#define BOUNCES		100000
+#define TABLE_SIZE	64
+#define READS		200000
+#define WRITES		2000
+
+static SDL_mutex *lock;
+static int counter;
+
+static int SDLCALL increment(void *data)
+{
+	int i;
+
+	for ( i = 0; i < INCREMENTS; ++i ) {
+		SDL_mutexP(lock);
+		++counter;
+		SDL_mutexV(lock);
+	}
+	return 0;
+}
+
+static SDL_sem *ping, *pong;
+
+static int SDLCALL bounce_sem(void *data)
+{
+	int i;
+
+	for ( i = 0; i < BOUNCES; ++i ) {
+		SDL_SemWait(ping);
+		SDL_SemPost(pong);
+	}
+	return 0;
+}
+
+static SDL_cond *turn_changed;
+static int turn;
+
+static int SDLCALL bounce_cond(void *data)
+{
+	int i;
+
+	SDL_mutexP(lock);
+	for ( i = 0; i < BOUNCES; ++i ) {
+		while ( turn != 1 ) {
+			SDL_CondWait(turn_changed, lock);
+		}
+		turn = 0;
+		SDL_CondSignal(turn_changed);
+	}
+	SDL_mutexV(lock);
+	return 0;
+}
+
+static SDL_rwlock *rwlock;
+static int table[TABLE_SIZE];
+static volatile int torn_reads;
+
+static int SDLCALL read_table(void *data)
+{
+	int i, j;
+
+	for ( i = 0; i < READS; ++i ) {
+		SDL_LockRWLockForReading(rwlock);
+		for ( j = 1; j < TABLE_SIZE; ++j ) {
+			if ( table[j] != table[0] ) {
+				++torn_reads;
+				break;
+			}
+		}
+		SDL_UnlockRWLock(rwlock);
+	}
+	return 0;
+}
+
+static int SDLCALL hold_rwlock(void *data)
+{
+	SDL_LockRWLockForReading(rwlock);
+	SDL_SemPost(ping);
+	SDL_SemWait(pong);
+	SDL_UnlockRWLock(rwlock);
+	return 0;
+}
+
+static void check_timeout(const char *what, int retval, Uint32 then, Uint32 ms)
+{
+	Uint32 took = SDL_GetTicks() - then;
+
+	printf("%s: %u ms", what, (unsigned int)took);
+	if ( retval != SDL_MUTEX_TIMEDOUT ) {
+		printf("  RETURNED %d", retval);
+	}
+	if ( took < ms - 10 || took > ms + 50 ) {
+		printf("  EXPECTED %u", (unsigned int)ms);
+	}
+	printf("\n");
+}
+
+int main(int argc, char *argv[])
+{
+	SDL_Thread *threads[NUM_THREADS];
+	Uint32 then;
+	int i;
+
+	if ( SDL_Init(0) < 0 ) {
+		fprintf(stderr, "Couldn't initialize SDL: %s\n", SDL_GetError());
+		return(1);
+	}
+	printf("%d CPU(s)\n", SDL_GetCPUCount());
+
+	lock = SDL_CreateMutex();
+	then = SDL_GetTicks();
+	for ( i = 0; i < NUM_THREADS; ++i ) {
+		threads[i] = SDL_CreateThread(increment, NULL);
+	}
+	for ( i = 0; i < NUM_THREADS; ++i ) {
+		SDL_WaitThread(threads[i], NULL);
+	}
+	printf("%d threads x %d locks: %u ms, contended %u times%s\n",
+	       NUM_THREADS, INCREMENTS, (unsigned int)(SDL_GetTicks() - then),
+	       (unsigned int)SDL_GetMutexContention(lock),
+	       (counter == NUM_THREADS * INCREMENTS) ? "" : "  COUNT WRONG");
+
+	ping = SDL_CreateSemaphore(0);
+	pong = SDL_CreateSemaphore(0);
+	then = SDL_GetTicks();
+	threads[0] = SDL_CreateThread(bounce_sem, NULL);
+	for ( i = 0; i < BOUNCES; ++i ) {
+		SDL_SemPost(ping);
+		SDL_SemWait(pong);
+	}
+	SDL_WaitThread(threads[0], NULL);
+	printf("%d semaphore round trips: %u ms, waited %u times\n",
+	       BOUNCES, (unsigned int)(SDL_GetTicks() - then),
+	       (unsigned int)(SDL_GetSemContention(ping) +
+	                      SDL_GetSemContention(pong)));
+
+	turn_changed = SDL_CreateCond();
+	then = SDL_GetTicks();
+	threads[0] = SDL_CreateThread(bounce_cond, NULL);
+	SDL_mutexP(lock);
+	for ( i = 0; i < BOUNCES; ++i ) {
+		turn = 1;
+		SDL_CondSignal(turn_changed);
+		while ( turn != 0 ) {
+			SDL_CondWait(turn_changed, lock);
+		}
+	}
+	SDL_mutexV(lock);
+	SDL_WaitThread(threads[0], NULL);
+	printf("%d condition variable round trips: %u ms\n",
+	       BOUNCES, (unsigned int)(SDL_GetTicks() - then));
+
+	then = SDL_GetTicks();
+	i = SDL_SemWaitTimeout(ping, 250);
+	check_timeout("SDL_SemWaitTimeout(250)", i, then, 250);
+	SDL_mutexP(lock);
+	then = SDL_GetTicks();
+	i = SDL_CondWaitTimeout(turn_changed, lock, 250);
+	check_timeout("SDL_CondWaitTimeout(250)", i, then, 250);
+	SDL_mutexV(lock);
+
+	rwlock = SDL_CreateRWLock();
+	then = SDL_GetTicks();
+	for ( i = 0; i < NUM_THREADS; ++i ) {
+		threads[i] = SDL_CreateThread(read_table, NULL);
+	}
+	for ( i = 0; i < WRITES; ++i ) {
+		int j;
+
+		SDL_LockRWLockForWriting(rwlock);
+		for ( j = 0; j < TABLE_SIZE; ++j ) {
+			table[j] = i;
+		}
+		SDL_UnlockRWLock(rwlock);
+	}
+	for ( i = 0; i < NUM_THREADS; ++i ) {
+		SDL_WaitThread(threads[i], NULL);
+	}
+	printf("%d threads x %d reads, %d writes: %u ms%s\n",
+	       NUM_THREADS, READS, WRITES,
+	       (unsigned int)(SDL_GetTicks() - then),
+	       torn_reads ? "  TORN READS" : "");
+
+	threads[0] = SDL_CreateThread(hold_rwlock, NULL);
+	SDL_SemWait(ping);
+	i = SDL_TryLockRWLockForReading(rwlock);
+	printf("SDL_TryLockRWLockForReading() while read locked: %d%s\n",
+	       i, (i == 0) ? "" : "  EXPECTED 0");
+	if ( i == 0 ) {
+		SDL_UnlockRWLock(rwlock);
+	}
+	i = SDL_TryLockRWLockForWriting(rwlock);
+	printf("SDL_TryLockRWLockForWriting() while read locked: %d%s\n",
+	       i, (i == SDL_MUTEX_TIMEDOUT) ? "" : "  EXPECTED SDL_MUTEX_TIMEDOUT");
+	if ( i == 0 ) {
+		SDL_UnlockRWLock(rwlock);
+	}
+	SDL_SemPost(pong);
+	SDL_WaitThread(threads[0], NULL);
+	SDL_DestroyRWLock(rwlock);
+
+	SDL_DestroyCond(turn_changed);
+	SDL_DestroySemaphore(ping);
+	SDL_DestroySemaphore(pong);
+	SDL_DestroyMutex(lock);
+	SDL_Quit();
+	return(0);
+}
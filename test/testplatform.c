@@ -135,7 +135,19 @@ int TestCPUInfo(SDL_bool verbose)
 		printf("3DNow Ext %s\n", SDL_Has3DNowExt() ? "detected" : "not detected");
 		printf("SSE %s\n", SDL_HasSSE() ? "detected" : "not detected");
 		printf("SSE2 %s\n", SDL_HasSSE2() ? "detected" : "not detected");
+		printf("SSE3 %s\n", SDL_HasSSE3() ? "detected" : "not detected");
+		printf("SSSE3 %s\n", SDL_HasSSSE3() ? "detected" : "not detected");
+		printf("SSE4.1 %s\n", SDL_HasSSE41() ? "detected" : "not detected");
+		printf("SSE4.2 %s\n", SDL_HasSSE42() ? "detected" : "not detected");
+		printf("AVX %s\n", SDL_HasAVX() ? "detected" : "not detected");
+		printf("AVX2 %s\n", SDL_HasAVX2() ? "detected" : "not detected");
+		printf("AVX-512F %s\n", SDL_HasAVX512F() ? "detected" : "not detected");
 		printf("AltiVec %s\n", SDL_HasAltiVec() ? "detected" : "not detected");
+		printf("%d CPUs, %d cores\n", SDL_GetCPUCount(), SDL_GetCPUCoreCount());
+		printf("L1 data cache %d bytes, L2 %d bytes, L3 %d bytes\n",
+		       SDL_GetCPUCacheSize(1), SDL_GetCPUCacheSize(2),
+		       SDL_GetCPUCacheSize(3));
+		printf("Cache line %d bytes\n", SDL_GetCPUCacheLineSize());
 	}
 	return(0);
 }
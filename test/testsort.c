@@ -0,0 +1,250 @@
+
+/* Benchmark for SDL_qsort() and SDL_RadixSort32()
+
+   Sorts arrays of a few element sizes in a few starting orders with
+   SDL_qsort() and the C library's qsort(), checking that both sort them,
+   then sorts a big list of sprites by depth with SDL_RadixSort32() as
+   well.  The last test counts the comparisons each qsort needs for an
+   array built to make quicksort take time of order n^2.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+
+#define ELEMENTS	500000
+#define SPRITES		1000000
+#define RUNS		3
+
+typedef void (*SortFunc)(void *base, size_t nmemb, size_t size,
+                         int (*compare)(const void *, const void *));
+
+typedef struct {
+	Sint16 x, y;
+	Uint32 depth;
+	SDL_Surface *image;
+} Sprite;
+
+static long comparisons;
+
+static int compare_keys(const void *a, const void *b)
+{
+	Uint32 x, y;
+
+	++comparisons;
+	SDL_memcpy(&x, a, sizeof(x));
+	SDL_memcpy(&y, b, sizeof(y));
+	return (x < y) ? -1 : (x > y);
+}
+
+static int compare_sprites(const void *a, const void *b)
+{
+	Uint32 x = ((const Sprite *)a)->depth;
+	Uint32 y = ((const Sprite *)b)->depth;
+
+	return (x < y) ? -1 : (x > y);
+}
+
+static const char *orders[] = {
+	"random", "sorted", "reversed", "8 values", "organ pipe", "nearly sorted"
+};
+
+static void fill(Uint8 *array, size_t nmemb, size_t size, int order)
+{
+	size_t i;
+	Uint32 key;
+
+	srand(1);
+	for ( i = 0; i < nmemb; ++i ) {
+		switch (order) {
+		    case 0: key = rand(); break;
+		    case 1: key = i; break;
+		    case 2: key = nmemb - i; break;
+		    case 3: key = rand() % 8; break;
+		    case 4: key = (i < nmemb/2) ? i : nmemb - i; break;
+		    default: key = (rand() % 100) ? i : (size_t)rand(); break;
+		}
+		SDL_memset(array + i * size, (int)i, size);
+		SDL_memcpy(array + i * size, &key, sizeof(key));
+	}
+}
+
+static int sorted(const Uint8 *array, size_t nmemb, size_t size)
+{
+	size_t i;
+
+	for ( i = 1; i < nmemb; ++i ) {
+		if ( compare_keys(array + (i-1) * size, array + i * size) > 0 ) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/* The fastest of a few runs, in milliseconds */
+static Uint32 time_sort(SortFunc sort, const Uint8 *original, Uint8 *array,
+                        size_t nmemb, size_t size, int *ok)
+{
+	Uint32 then, best = ~0;
+	int run;
+
+	for ( run = 0; run < RUNS; ++run ) {
+		SDL_memcpy(array, original, nmemb * size);
+		then = SDL_GetTicks();
+		sort(array, nmemb, size, compare_keys);
+		then = SDL_GetTicks() - then;
+		if ( then < best ) {
+			best = then;
+		}
+	}
+	*ok = sorted(array, nmemb, size);
+	return best;
+}
+
+static void benchmark_qsort(void)
+{
+	static const size_t sizes[] = { 4, 8, 12, 16, 64 };
+	Uint8 *original, *array;
+	size_t i, size, nmemb;
+	Uint32 sdl_ms, libc_ms;
+	int order, sdl_ok, libc_ok;
+
+	printf("%-5s %-14s %12s %12s\n", "size", "order", "SDL_qsort", "qsort");
+	for ( i = 0; i < SDL_arraysize(sizes); ++i ) {
+		size = sizes[i];
+		nmemb = (size > 16) ? ELEMENTS / 4 : ELEMENTS;
+		original = (Uint8 *)malloc(nmemb * size);
+		array = (Uint8 *)malloc(nmemb * size);
+		for ( order = 0; order < (int)SDL_arraysize(orders); ++order ) {
+			fill(original, nmemb, size, order);
+			sdl_ms = time_sort(SDL_qsort, original, array, nmemb, size, &sdl_ok);
+			libc_ms = time_sort(qsort, original, array, nmemb, size, &libc_ok);
+			printf("%-5u %-14s %9u ms %9u ms%s\n",
+			       (unsigned int)size, orders[order],
+			       (unsigned int)sdl_ms, (unsigned int)libc_ms,
+			       (sdl_ok && libc_ok) ? "" : "  NOT SORTED");
+		}
+		free(original);
+		free(array);
+	}
+}
+
+/* Where a sprite started, kept in its position to check the sort is stable */
+static Uint32 start_of(const Sprite *sprite)
+{
+	return ((Uint32)(Uint16)sprite->y << 16) | (Uint16)sprite->x;
+}
+
+static void benchmark_radix(int layers)
+{
+	Sprite *original, *sprites;
+	Uint32 then, radix_ms = ~0, sdl_ms = ~0, libc_ms = ~0;
+	int i, run, ok = 1;
+
+	original = (Sprite *)malloc(SPRITES * sizeof(Sprite));
+	sprites = (Sprite *)malloc(SPRITES * sizeof(Sprite));
+	srand(1);
+	for ( i = 0; i < SPRITES; ++i ) {
+		original[i].x = (Sint16)(i & 0xFFFF);
+		original[i].y = (Sint16)(i >> 16);
+		original[i].depth = layers ? (Uint32)(rand() % layers) : (Uint32)rand();
+		original[i].image = NULL;
+	}
+	for ( run = 0; run < RUNS; ++run ) {
+		SDL_memcpy(sprites, original, SPRITES * sizeof(Sprite));
+		then = SDL_GetTicks();
+		SDL_RadixSort32(sprites, SPRITES, sizeof(Sprite),
+		                offsetof(Sprite, depth));
+		radix_ms = SDL_min(radix_ms, SDL_GetTicks() - then);
+		for ( i = 1; i < SPRITES; ++i ) {
+			/* Sprites at the same depth stay in order */
+			if ( sprites[i-1].depth > sprites[i].depth ||
+			     (sprites[i-1].depth == sprites[i].depth &&
+			      start_of(&sprites[i-1]) > start_of(&sprites[i])) ) {
+				ok = 0;
+			}
+		}
+
+		SDL_memcpy(sprites, original, SPRITES * sizeof(Sprite));
+		then = SDL_GetTicks();
+		SDL_qsort(sprites, SPRITES, sizeof(Sprite), compare_sprites);
+		sdl_ms = SDL_min(sdl_ms, SDL_GetTicks() - then);
+
+		SDL_memcpy(sprites, original, SPRITES * sizeof(Sprite));
+		then = SDL_GetTicks();
+		qsort(sprites, SPRITES, sizeof(Sprite), compare_sprites);
+		libc_ms = SDL_min(libc_ms, SDL_GetTicks() - then);
+	}
+	printf("%d sprites by depth, %s:\n", SPRITES,
+	       layers ? "16 layers" : "random depths");
+	printf("  SDL_RadixSort32  %6u ms%s\n", (unsigned int)radix_ms,
+	       ok ? "" : "  NOT SORTED");
+	printf("  SDL_qsort        %6u ms\n", (unsigned int)sdl_ms);
+	printf("  qsort            %6u ms\n", (unsigned int)libc_ms);
+	free(original);
+	free(sprites);
+}
+
+/* M. D. McIlroy's adversary, which decides what the keys are as the sort
+   compares them, so that every pivot a quicksort picks is a bad one. */
+static int *adversary_keys;
+static int adversary_gas, adversary_solid, adversary_candidate;
+
+static int compare_adversary(const void *a, const void *b)
+{
+	int x = *(const int *)a, y = *(const int *)b;
+
+	++comparisons;
+	if ( adversary_keys[x] == adversary_gas &&
+	     adversary_keys[y] == adversary_gas ) {
+		if ( x == adversary_candidate ) {
+			adversary_keys[x] = adversary_solid++;
+		} else {
+			adversary_keys[y] = adversary_solid++;
+		}
+	}
+	if ( adversary_keys[x] == adversary_gas ) {
+		adversary_candidate = x;
+	} else if ( adversary_keys[y] == adversary_gas ) {
+		adversary_candidate = y;
+	}
+	return adversary_keys[x] - adversary_keys[y];
+}
+
+static long adversary(SortFunc sort, int nmemb)
+{
+	int *array = (int *)malloc(nmemb * sizeof(int));
+	int i;
+
+	adversary_keys = (int *)malloc(nmemb * sizeof(int));
+	adversary_gas = nmemb - 1;
+	adversary_solid = 0;
+	adversary_candidate = 0;
+	for ( i = 0; i < nmemb; ++i ) {
+		array[i] = i;
+		adversary_keys[i] = adversary_gas;
+	}
+	comparisons = 0;
+	sort(array, nmemb, sizeof(int), compare_adversary);
+	free(adversary_keys);
+	free(array);
+	return comparisons;
+}
+
+int main(int argc, char *argv[])
+{
+	if ( SDL_Init(0) < 0 ) {
+		fprintf(stderr, "Couldn't initialize SDL: %s\n", SDL_GetError());
+		return(1);
+	}
+	benchmark_qsort();
+	benchmark_radix(0);
+	benchmark_radix(16);
+	printf("Comparisons to sort 100000 elements against an adversary:\n");
+	printf("  SDL_qsort  %ld\n", adversary(SDL_qsort, 100000));
+	printf("  qsort      %ld\n", adversary(qsort, 100000));
+	SDL_Quit();
+	return(0);
+}
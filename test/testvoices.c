@@ -0,0 +1,261 @@
+
+/* Program to play many voices of a wave file at once with the SDL mixer
+
+   First checks the mixer's output exactly for mono, stereo and 5.1,
+   including rounding and clipping.  Then starts a voice every so often at a random pitch and pan, with one voice
+   looping and sweeping from side to side, for a few seconds.  Then it
+   times the mixer mixing 64 voices against SDL_MixAudio() mixing the same
+   sound 64 times.
+*/
+#include "SDL_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if HAVE_SIGNAL_H
+#include <signal.h>
+#endif
+
+#include "SDL.h"
+#include "SDL_audio.h"
+
+#define BENCH_VOICES	64
+#define BENCH_SECONDS	20
+
+static int done = 0;
+void poked(int sig)
+{
+	done = 1;
+}
+
+static float random_float(float lo, float hi)
+{
+	return lo + (hi - lo) * (float)(rand() % 1001) / 1000.0f;
+}
+
+#define CHECK_FRAMES	37
+
+/* What the mixer should store for one sample, rounded half away from zero */
+static Sint16 expected_sample(float x)
+{
+	if ( x > 32767.0f ) {
+		x = 32767.0f;
+	} else if ( x < -32768.0f ) {
+		x = -32768.0f;
+	}
+	return (Sint16)(x < 0.0f ? x - 0.5f : x + 0.5f);
+}
+
+/* Mix a mono ramp of odd values at half gain, so every sample lands on
+   a half, then again loud enough to clip, and compare every channel.
+ */
+static int check_channels(int channels)
+{
+	SDL_AudioMixer *mixer;
+	SDL_MixerSound *sound;
+	SDL_AudioSpec spec;
+	Sint16 ramp[CHECK_FRAMES];
+	Sint16 out[CHECK_FRAMES * 6];
+	float gain, x;
+	int i, c, pass, errors = 0;
+
+	for ( i = 0; i < CHECK_FRAMES; ++i ) {
+		ramp[i] = (Sint16)((i - CHECK_FRAMES / 2) * 1001 | 1);
+	}
+	spec.freq = 44100;
+	spec.format = AUDIO_S16SYS;
+	spec.channels = 1;
+	sound = SDL_CreateMixerSound(&spec, (Uint8 *)ramp, sizeof(ramp));
+	spec.channels = channels;
+
+	for ( pass = 0; pass < 2; ++pass ) {
+		gain = pass ? 1000.0f : 1.0f;
+		mixer = SDL_CreateAudioMixer(&spec, 1);
+		SDL_SetMixerGain(mixer, gain);
+		SDL_PlayMixerSound(mixer, sound, 0, 0.5f, 0.0f, 1.0f);
+		SDL_AudioMixerCallback(mixer, (Uint8 *)out,
+		                       CHECK_FRAMES * channels * sizeof(Sint16));
+		for ( i = 0; i < CHECK_FRAMES; ++i ) {
+			for ( c = 0; c < channels; ++c ) {
+				x = (c < 2) ? ramp[i] * 0.5f * gain : 0.0f;
+				if ( out[i * channels + c] != expected_sample(x) ) {
+					++errors;
+				}
+			}
+		}
+		SDL_FreeAudioMixer(mixer);
+	}
+	SDL_FreeMixerSound(sound);
+
+	printf("%d channel output: %s\n", channels, errors ? "WRONG" : "ok");
+	return errors;
+}
+
+static void play(SDL_MixerSound *sound, int seconds)
+{
+	SDL_AudioMixer *mixer;
+	SDL_AudioSpec desired;
+	Uint32 start;
+	float pan = 0.0f, sweep = 0.05f;
+	char name[32];
+	int loop, voice, started = 0;
+
+	desired.freq = 44100;
+	desired.format = AUDIO_S16SYS;
+	desired.channels = 2;
+	desired.samples = 1024;
+	mixer = SDL_CreateAudioMixer(&desired, 16);
+	if ( mixer == NULL ) {
+		fprintf(stderr, "Couldn't create mixer: %s\n", SDL_GetError());
+		return;
+	}
+	desired.callback = SDL_AudioMixerCallback;
+	desired.userdata = mixer;
+	if ( SDL_OpenAudio(&desired, NULL) < 0 ) {
+		fprintf(stderr, "Couldn't open audio: %s\n", SDL_GetError());
+		SDL_FreeAudioMixer(mixer);
+		return;
+	}
+	printf("Using audio driver: %s\n", SDL_AudioDriverName(name, 32));
+
+	loop = SDL_PlayMixerSound(mixer, sound, -1, 0.5f, 0.0f, 1.0f);
+	SDL_PauseAudio(0);
+
+	start = SDL_GetTicks();
+	while ( !done && (SDL_GetTicks() - start) < (Uint32)seconds * 1000 ) {
+		SDL_Delay(50);
+
+		pan += sweep;
+		if ( pan > 1.0f || pan < -1.0f ) {
+			sweep = -sweep;
+		}
+		SDL_SetMixerVoice(mixer, loop, 0.5f, pan, 1.0f);
+
+		if ( (rand() % 4) == 0 ) {
+			voice = SDL_PlayMixerSound(mixer, sound, 0,
+			                           random_float(0.2f, 0.8f),
+			                           random_float(-1.0f, 1.0f),
+			                           random_float(0.5f, 2.0f));
+			if ( voice < 0 ) {
+				printf("Couldn't start a voice: %s\n", SDL_GetError());
+			} else {
+				++started;
+			}
+		}
+	}
+	printf("Started %d voices\n", started);
+
+	SDL_CloseAudio();
+	SDL_FreeAudioMixer(mixer);
+}
+
+static void benchmark(SDL_AudioSpec *spec, Uint8 *data, Uint32 len)
+{
+	SDL_AudioMixer *mixer;
+	SDL_MixerSound *sound;
+	SDL_AudioSpec mixspec;
+	SDL_AudioCVT cvt;
+	Uint8 *stream;
+	Uint32 then, mixer_ms, mixaudio_ms;
+	int i, pos, chunk, total;
+
+	mixspec.freq = 44100;
+	mixspec.format = AUDIO_S16SYS;
+	mixspec.channels = 2;
+	chunk = 1024 * 4;
+	total = mixspec.freq * 4 * BENCH_SECONDS;
+	stream = (Uint8 *)malloc(chunk);
+
+	/* The same sound, converted to the output format for SDL_MixAudio() */
+	if ( SDL_BuildAudioCVT(&cvt, spec->format, spec->channels, spec->freq,
+	             mixspec.format, mixspec.channels, mixspec.freq) < 0 ) {
+		fprintf(stderr, "Couldn't convert: %s\n", SDL_GetError());
+		free(stream);
+		return;
+	}
+	cvt.len = len;
+	cvt.buf = (Uint8 *)malloc(len * cvt.len_mult);
+	memcpy(cvt.buf, data, len);
+	SDL_ConvertAudio(&cvt);
+	if ( cvt.len_cvt <= chunk ) {
+		fprintf(stderr, "The sound is too short to time\n");
+		free(cvt.buf);
+		free(stream);
+		return;
+	}
+
+	/* Both mix the sound at the output rate */
+	sound = SDL_CreateMixerSound(&mixspec, cvt.buf, cvt.len_cvt);
+	mixer = SDL_CreateAudioMixer(&mixspec, BENCH_VOICES);
+	for ( i = 0; i < BENCH_VOICES; ++i ) {
+		SDL_PlayMixerSound(mixer, sound, -1, 1.0f / BENCH_VOICES,
+		                   (i % 3) - 1.0f, 1.0f);
+	}
+	then = SDL_GetTicks();
+	for ( pos = 0; pos < total; pos += chunk ) {
+		SDL_AudioMixerCallback(mixer, stream, chunk);
+	}
+	mixer_ms = SDL_GetTicks() - then;
+	SDL_FreeAudioMixer(mixer);
+	SDL_FreeMixerSound(sound);
+
+	then = SDL_GetTicks();
+	for ( pos = 0; pos < total; pos += chunk ) {
+		memset(stream, 0, chunk);
+		for ( i = 0; i < BENCH_VOICES; ++i ) {
+			int offset = (pos + i * 4) % (cvt.len_cvt - chunk);
+			SDL_MixAudio(stream, cvt.buf + (offset & ~3), chunk, 2);
+		}
+	}
+	mixaudio_ms = SDL_GetTicks() - then;
+
+	printf("Mixing %d seconds of %d voices:\n", BENCH_SECONDS, BENCH_VOICES);
+	printf("  SDL_AudioMixerCallback  %6u ms\n", (unsigned int)mixer_ms);
+	printf("  SDL_MixAudio            %6u ms\n", (unsigned int)mixaudio_ms);
+
+	free(cvt.buf);
+	free(stream);
+}
+
+int main(int argc, char *argv[])
+{
+	SDL_AudioSpec spec;
+	SDL_MixerSound *sound;
+	Uint8 *data;
+	Uint32 len;
+	const char *file;
+
+	if ( SDL_Init(SDL_INIT_AUDIO) < 0 ) {
+		fprintf(stderr, "Couldn't initialize SDL: %s\n",SDL_GetError());
+		return(1);
+	}
+	file = (argc < 2) ? "sample.wav" : argv[1];
+	if ( SDL_LoadWAV(file, &spec, &data, &len) == NULL ) {
+		fprintf(stderr, "Couldn't load %s: %s\n", file, SDL_GetError());
+		SDL_Quit();
+		return(1);
+	}
+	sound = SDL_CreateMixerSound(&spec, data, len);
+	if ( sound == NULL ) {
+		fprintf(stderr, "Couldn't create sound: %s\n", SDL_GetError());
+		SDL_FreeWAV(data);
+		SDL_Quit();
+		return(1);
+	}
+
+#if HAVE_SIGNAL_H
+	signal(SIGINT, poked);
+	signal(SIGTERM, poked);
+#endif
+	check_channels(1);
+	check_channels(2);
+	check_channels(6);
+	play(sound, 5);
+	benchmark(&spec, data, len);
+
+	SDL_FreeMixerSound(sound);
+	SDL_FreeWAV(data);
+	SDL_Quit();
+	return(0);
+}
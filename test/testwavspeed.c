@@ -0,0 +1,522 @@
+
+/* Benchmark for the ADPCM decoders in the WAVE loader.
+
+   Encodes a few minutes of synthetic audio as IMA and MS ADPCM in memory
+   and times SDL_LoadWAV_RW() on it, once on a single thread and once on
+   as many threads as SDL picks, against a plain serial decoder.
+   A WAVE file given on the command line is timed the same way.
+
+   First loads adpcm8bit.wav, an MS ADPCM file whose header claims 8 bits
+   per sample, whole and as a stream, and checks that it decodes to 16-bit
+   samples in buffers big enough for them.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "SDL.h"
+
+#define RATE		44100
+#define CHANNELS	2
+#define RUNS		5
+
+static const int ima_index_table[16] = {
+	-1, -1, -1, -1, 2, 4, 6, 8,
+	-1, -1, -1, -1, 2, 4, 6, 8
+};
+static const int ima_step_table[89] = {
+	7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31,
+	34, 37, 41, 45, 50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130,
+	143, 157, 173, 190, 209, 230, 253, 279, 307, 337, 371, 408,
+	449, 494, 544, 598, 658, 724, 796, 876, 963, 1060, 1166, 1282,
+	1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+	3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630,
+	9493, 10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350,
+	22385, 24623, 27086, 29794, 32767
+};
+static const int ms_adaptive[16] = {
+	230, 230, 230, 230, 307, 409, 512, 614,
+	768, 614, 512, 409, 307, 230, 230, 230
+};
+static const int ms_coeff[7][2] = {
+	{ 256, 0 }, { 512, -256 }, { 0, 0 }, { 192, 64 },
+	{ 240, 0 }, { 460, -208 }, { 392, -232 }
+};
+
+static int clamp16(int sample)
+{
+	if ( sample > 32767 ) {
+		return 32767;
+	}
+	if ( sample < -32768 ) {
+		return -32768;
+	}
+	return sample;
+}
+
+static void put16(Uint8 *p, int v)
+{
+	p[0] = (Uint8)(v & 0xFF);
+	p[1] = (Uint8)((v >> 8) & 0xFF);
+}
+
+static void put32(Uint8 *p, Uint32 v)
+{
+	put16(p, v & 0xFFFF);
+	put16(p + 2, v >> 16);
+}
+
+static int get16(const Uint8 *p)
+{
+	return (Sint16)((p[1] << 8) | p[0]);
+}
+
+/* A few tones with some noise, loud enough to hit the clamps now and then */
+static int synth(int frame, int channel)
+{
+	double t = (double)frame / RATE;
+	double v = 14000.0 * sin(t * 440.0 * (channel + 1) * 6.2831853) +
+		   9000.0 * sin(t * 97.0 * 6.2831853) +
+		   (double)((rand() % 4001) - 2000);
+	if ( (frame / RATE) % 4 == 3 ) {
+		v *= 2.0;
+	}
+	return clamp16((int)v);
+}
+
+/* Wrap encoded blocks in a RIFF header, 'extra' follows the WaveFMT part */
+static Uint8 *make_wave(int encoding, int blockalign, const Uint8 *extra,
+			int extralen, const Uint8 *data, Uint32 datalen,
+			Uint32 *wavelen)
+{
+	int fmtlen = 16 + 2 + extralen;
+	Uint8 *wave, *p;
+
+	*wavelen = 12 + 8 + fmtlen + 8 + datalen;
+	wave = (Uint8 *)malloc(*wavelen);
+	if ( wave == NULL ) {
+		return NULL;
+	}
+	p = wave;
+	memcpy(p, "RIFF", 4); put32(p + 4, *wavelen - 8); memcpy(p + 8, "WAVE", 4);
+	p += 12;
+	memcpy(p, "fmt ", 4); put32(p + 4, fmtlen);
+	put16(p + 8, encoding);
+	put16(p + 10, CHANNELS);
+	put32(p + 12, RATE);
+	put32(p + 16, RATE * 2 * CHANNELS);
+	put16(p + 20, blockalign);
+	put16(p + 22, 4);
+	put16(p + 24, extralen);
+	memcpy(p + 26, extra, extralen);
+	p += 8 + fmtlen;
+	memcpy(p, "data", 4); put32(p + 4, datalen);
+	memcpy(p + 8, data, datalen);
+	return wave;
+}
+
+static int ima_quantize(int *sample, int *index, int target)
+{
+	int step = ima_step_table[*index];
+	int diff = target - *sample;
+	int nybble = 0, delta;
+
+	if ( diff < 0 ) {
+		nybble = 8;
+		diff = -diff;
+	}
+	if ( diff >= step ) { nybble |= 4; diff -= step; }
+	if ( diff >= (step >> 1) ) { nybble |= 2; diff -= (step >> 1); }
+	if ( diff >= (step >> 2) ) { nybble |= 1; }
+
+	delta = step >> 3;
+	if ( nybble & 4 ) delta += step;
+	if ( nybble & 2 ) delta += (step >> 1);
+	if ( nybble & 1 ) delta += (step >> 2);
+	if ( nybble & 8 ) delta = -delta;
+	*sample = clamp16(*sample + delta);
+	*index += ima_index_table[nybble];
+	if ( *index < 0 ) *index = 0;
+	if ( *index > 88 ) *index = 88;
+	return nybble;
+}
+
+static Uint8 *encode_ima(Uint32 blocks, Uint32 *wavelen)
+{
+	const int spb = 2041;
+	const int blockalign = 4 * CHANNELS + (spb - 1) / 2 * CHANNELS;
+	int sample[CHANNELS], index[CHANNELS];
+	Uint8 extra[2], *data, *p, *wave;
+	Uint32 b;
+	int c, g, i, frame;
+
+	data = (Uint8 *)malloc(blocks * blockalign);
+	if ( data == NULL ) {
+		return NULL;
+	}
+	p = data;
+	frame = 0;
+	for ( c = 0; c < CHANNELS; ++c ) {
+		index[c] = 0;
+	}
+	for ( b = 0; b < blocks; ++b ) {
+		for ( c = 0; c < CHANNELS; ++c ) {
+			sample[c] = synth(frame, c);
+			put16(p, sample[c]);
+			p[2] = (Uint8)index[c];
+			p[3] = 0;
+			p += 4;
+		}
+		++frame;
+		for ( g = 0; g < (spb - 1) / 8; ++g ) {
+			for ( c = 0; c < CHANNELS; ++c ) {
+				for ( i = 0; i < 8; i += 2 ) {
+					int lo = ima_quantize(&sample[c], &index[c], synth(frame + i, c));
+					int hi = ima_quantize(&sample[c], &index[c], synth(frame + i + 1, c));
+					*p++ = (Uint8)(lo | (hi << 4));
+				}
+			}
+			frame += 8;
+		}
+	}
+	put16(extra, spb);
+	wave = make_wave(0x11, blockalign, extra, 2, data, blocks * blockalign, wavelen);
+	free(data);
+	return wave;
+}
+
+static int ms_quantize(int *s1, int *s2, int *delta, const int *coeff, int target)
+{
+	int predict = ((*s1 * coeff[0]) + (*s2 * coeff[1])) / 256;
+	int q, sample;
+
+	q = (target - predict) / *delta;
+	if ( q < -8 ) q = -8;
+	if ( q > 7 ) q = 7;
+	sample = clamp16(predict + q * *delta);
+	*delta = (*delta * ms_adaptive[q & 0x0F]) / 256;
+	if ( *delta < 16 ) {
+		*delta = 16;
+	}
+	*delta &= 0xFFFF;
+	*s2 = *s1;
+	*s1 = sample;
+	return q & 0x0F;
+}
+
+static Uint8 *encode_ms(Uint32 blocks, Uint32 *wavelen)
+{
+	const int spb = 2036;
+	const int blockalign = 7 * CHANNELS + (spb - 2) * CHANNELS / 2;
+	int pred[CHANNELS], s1[CHANNELS], s2[CHANNELS], delta[CHANNELS];
+	Uint8 extra[4 + 7 * 4], *data, *p, *wave;
+	Uint32 b;
+	int c, i, frame;
+
+	data = (Uint8 *)malloc(blocks * blockalign);
+	if ( data == NULL ) {
+		return NULL;
+	}
+	p = data;
+	frame = 0;
+	for ( b = 0; b < blocks; ++b ) {
+		for ( c = 0; c < CHANNELS; ++c ) {
+			pred[c] = (b + c) % 7;
+			delta[c] = 16;
+			s2[c] = synth(frame, c);
+			s1[c] = synth(frame + 1, c);
+			p[c] = (Uint8)pred[c];
+			put16(p + CHANNELS + c * 2, delta[c]);
+			put16(p + CHANNELS * 3 + c * 2, s1[c]);
+			put16(p + CHANNELS * 5 + c * 2, s2[c]);
+		}
+		p += 7 * CHANNELS;
+		frame += 2;
+		for ( i = 2; i < spb; ++i, ++frame ) {
+			int hi = ms_quantize(&s1[0], &s2[0], &delta[0], ms_coeff[pred[0]], synth(frame, 0));
+			int lo = ms_quantize(&s1[1], &s2[1], &delta[1], ms_coeff[pred[1]], synth(frame, 1));
+			*p++ = (Uint8)((hi << 4) | lo);
+		}
+	}
+	put16(extra, spb);
+	put16(extra + 2, 7);
+	for ( i = 0; i < 7; ++i ) {
+		put16(extra + 4 + i * 4, ms_coeff[i][0]);
+		put16(extra + 6 + i * 4, ms_coeff[i][1]);
+	}
+	wave = make_wave(0x02, blockalign, extra, sizeof(extra), data, blocks * blockalign, wavelen);
+	free(data);
+	return wave;
+}
+
+/* The serial decoders, one sample at a time, for comparison */
+static void decode_ima(const Uint8 *in, Uint32 blocks, int blockalign, int spb, Sint16 *out)
+{
+	int sample[CHANNELS], index[CHANNELS];
+	Uint32 b;
+	int c, g, i;
+
+	for ( b = 0; b < blocks; ++b ) {
+		const Uint8 *p = in + b * blockalign;
+		Sint16 *o = out + b * spb * CHANNELS;
+		for ( c = 0; c < CHANNELS; ++c ) {
+			sample[c] = get16(p);
+			index[c] = (Sint8)p[2];
+			*o++ = (Sint16)sample[c];
+			p += 4;
+		}
+		for ( g = 0; g < (spb - 1) / 8; ++g ) {
+			for ( c = 0; c < CHANNELS; ++c ) {
+				for ( i = 0; i < 8; ++i ) {
+					int nybble = (i & 1) ? (p[i / 2] >> 4) : (p[i / 2] & 0x0F);
+					int step, delta;
+					if ( index[c] > 88 ) index[c] = 88;
+					if ( index[c] < 0 ) index[c] = 0;
+					step = ima_step_table[index[c]];
+					delta = step >> 3;
+					if ( nybble & 4 ) delta += step;
+					if ( nybble & 2 ) delta += (step >> 1);
+					if ( nybble & 1 ) delta += (step >> 2);
+					if ( nybble & 8 ) delta = -delta;
+					sample[c] = clamp16(sample[c] + delta);
+					index[c] += ima_index_table[nybble];
+					o[i * CHANNELS + c] = (Sint16)sample[c];
+				}
+				p += 4;
+			}
+			o += 8 * CHANNELS;
+		}
+	}
+}
+
+static void decode_ms(const Uint8 *in, Uint32 blocks, int blockalign, int spb, Sint16 *out)
+{
+	int s1[CHANNELS], s2[CHANNELS], delta[CHANNELS];
+	const int *coeff[CHANNELS];
+	Uint32 b;
+	int c, i;
+
+	for ( b = 0; b < blocks; ++b ) {
+		const Uint8 *p = in + b * blockalign;
+		Sint16 *o = out + b * spb * CHANNELS;
+		for ( c = 0; c < CHANNELS; ++c ) {
+			coeff[c] = ms_coeff[p[c]];
+			delta[c] = (Uint16)get16(p + CHANNELS + c * 2);
+			s1[c] = get16(p + CHANNELS * 3 + c * 2);
+			s2[c] = get16(p + CHANNELS * 5 + c * 2);
+			o[c] = (Sint16)s2[c];
+			o[CHANNELS + c] = (Sint16)s1[c];
+		}
+		p += 7 * CHANNELS;
+		o += 2 * CHANNELS;
+		for ( i = 0; i < (spb - 2) * CHANNELS; ++i ) {
+			int nybble = (i & 1) ? (p[i / 2] & 0x0F) : (p[i / 2] >> 4);
+			int signed_nybble = (nybble & 8) ? nybble - 16 : nybble;
+			c = i % CHANNELS;
+			o[i] = (Sint16)clamp16(((s1[c] * coeff[c][0]) + (s2[c] * coeff[c][1])) / 256 +
+						delta[c] * signed_nybble);
+			delta[c] = (delta[c] * ms_adaptive[nybble]) / 256;
+			if ( delta[c] < 16 ) {
+				delta[c] = 16;
+			}
+			delta[c] &= 0xFFFF;
+			s2[c] = s1[c];
+			s1[c] = o[i];
+		}
+	}
+}
+
+/* Time the best of a few loads of 'wave' with the given thread setting */
+static Uint32 time_load(const Uint8 *wave, Uint32 wavelen, const char *threads,
+			Uint8 **audio_buf, Uint32 *audio_len)
+{
+	static char envr[64];
+	SDL_AudioSpec spec;
+	Uint32 best = 0xFFFFFFFF, then, now;
+	int i;
+
+	SDL_snprintf(envr, sizeof(envr), "SDL_WAVE_DECODE_THREADS=%s", threads);
+	SDL_putenv(envr);
+	for ( i = 0; i < RUNS; ++i ) {
+		if ( *audio_buf ) {
+			SDL_FreeWAV(*audio_buf);
+			*audio_buf = NULL;
+		}
+		then = SDL_GetTicks();
+		if ( SDL_LoadWAV_RW(SDL_RWFromConstMem(wave, wavelen), 1,
+					&spec, audio_buf, audio_len) == NULL ) {
+			fprintf(stderr, "Couldn't load WAVE: %s\n", SDL_GetError());
+			exit(1);
+		}
+		now = SDL_GetTicks();
+		if ( (now - then) < best ) {
+			best = now - then;
+		}
+	}
+	return best;
+}
+
+static void report(const char *what, Uint32 ms, Uint32 bytes)
+{
+	printf("  %-24s %6u ms", what, (unsigned int)ms);
+	if ( ms > 0 ) {
+		printf("  %8.1f MB/s", (bytes / 1048576.0) / (ms / 1000.0));
+	}
+	printf("\n");
+}
+
+static int benchmark(const char *name, const Uint8 *wave, Uint32 wavelen,
+		     void (*serial)(const Uint8 *, Uint32, int, int, Sint16 *),
+		     Uint32 blocks, int blockalign, int spb)
+{
+	Uint8 *one = NULL, *many = NULL;
+	Uint32 onelen, manylen, ms;
+	Sint16 *ref = NULL;
+	char cpus[16], label[64];
+	int errors = 0;
+
+	printf("%s, %u bytes:\n", name, (unsigned int)wavelen);
+	if ( serial ) {
+		Uint32 best = 0xFFFFFFFF, then;
+		int i;
+
+		ref = (Sint16 *)malloc(blocks * spb * CHANNELS * sizeof(Sint16));
+		for ( i = 0; i < RUNS; ++i ) {
+			then = SDL_GetTicks();
+			serial(wave + wavelen - blocks * blockalign, blocks, blockalign, spb, ref);
+			if ( (SDL_GetTicks() - then) < best ) {
+				best = SDL_GetTicks() - then;
+			}
+		}
+		report("serial decoder", best, blocks * spb * CHANNELS * 2);
+	}
+
+	ms = time_load(wave, wavelen, "1", &one, &onelen);
+	report("SDL_LoadWAV_RW, 1 thread", ms, onelen);
+
+	SDL_snprintf(cpus, sizeof(cpus), "%d", SDL_GetCPUCount());
+	ms = time_load(wave, wavelen, cpus, &many, &manylen);
+	SDL_snprintf(label, sizeof(label), "SDL_LoadWAV_RW, %s CPU(s)", cpus);
+	report(label, ms, manylen);
+
+	if ( onelen != manylen || memcmp(one, many, onelen) != 0 ) {
+		printf("  ERROR: threaded decoding gave different samples\n");
+		++errors;
+	}
+	if ( ref ) {
+		if ( onelen != blocks * spb * CHANNELS * 2 ) {
+			printf("  ERROR: decoded %u bytes, expected %u\n",
+				(unsigned int)onelen, (unsigned int)(blocks * spb * CHANNELS * 2));
+			++errors;
+		} else {
+			Uint32 i;
+			for ( i = 0; i < onelen / 2; ++i ) {
+				if ( get16(one + i * 2) != ref[i] ) {
+					printf("  ERROR: sample %u differs from the serial decoder\n",
+						(unsigned int)i);
+					++errors;
+					break;
+				}
+			}
+		}
+		free(ref);
+	}
+	SDL_FreeWAV(one);
+	SDL_FreeWAV(many);
+	return errors;
+}
+
+#define ADPCM8BIT_FRAMES	2000
+
+static int check_adpcm8bit(void)
+{
+	SDL_AudioSpec spec;
+	SDL_WAVStream *stream;
+	Uint8 *data;
+	Uint32 len;
+	Sint16 *frames;
+	int read, errors = 0;
+
+	if ( SDL_LoadWAV("adpcm8bit.wav", &spec, &data, &len) == NULL ) {
+		fprintf(stderr, "Couldn't load adpcm8bit.wav: %s\n", SDL_GetError());
+		return 1;
+	}
+	if ( spec.format != AUDIO_S16 || len != ADPCM8BIT_FRAMES * 2 ) {
+		++errors;
+	}
+	SDL_FreeWAV(data);
+
+	stream = SDL_OpenWAVStream("adpcm8bit.wav", &spec);
+	if ( stream == NULL ) {
+		fprintf(stderr, "Couldn't open adpcm8bit.wav: %s\n", SDL_GetError());
+		return 1;
+	}
+	frames = (Sint16 *)malloc((ADPCM8BIT_FRAMES + 1) * sizeof(Sint16));
+	read = SDL_ReadWAVStream(stream, frames, ADPCM8BIT_FRAMES + 1);
+	if ( spec.format != AUDIO_S16 || read != ADPCM8BIT_FRAMES ) {
+		++errors;
+	}
+	free(frames);
+	SDL_CloseWAVStream(stream);
+
+	printf("adpcm8bit.wav: %s\n", errors ? "WRONG" : "ok");
+	return errors;
+}
+
+int main(int argc, char *argv[])
+{
+	int seconds = 180;
+	Uint32 blocks, wavelen;
+	Uint8 *wave;
+	int errors = 0;
+
+	if ( SDL_Init(0) < 0 ) {
+		fprintf(stderr, "Couldn't initialize SDL: %s\n", SDL_GetError());
+		return(1);
+	}
+	printf("%d CPUs\n", SDL_GetCPUCount());
+	errors += check_adpcm8bit();
+
+	if ( argv[1] ) {
+		SDL_RWops *src = SDL_RWFromFile(argv[1], "rb");
+		if ( src == NULL ) {
+			fprintf(stderr, "Couldn't open %s: %s\n", argv[1], SDL_GetError());
+			SDL_Quit();
+			return(1);
+		}
+		wavelen = SDL_RWseek(src, 0, RW_SEEK_END);
+		SDL_RWseek(src, 0, RW_SEEK_SET);
+		wave = (Uint8 *)malloc(wavelen);
+		if ( wave == NULL || SDL_RWread(src, wave, wavelen, 1) != 1 ) {
+			fprintf(stderr, "Couldn't read %s\n", argv[1]);
+			SDL_Quit();
+			return(1);
+		}
+		SDL_RWclose(src);
+		errors += benchmark(argv[1], wave, wavelen, NULL, 0, 0, 0);
+		free(wave);
+		SDL_Quit();
+		return(errors ? 1 : 0);
+	}
+
+	printf("Encoding %d seconds of %d Hz stereo audio...\n", seconds, RATE);
+	blocks = (Uint32)seconds * RATE / 2041;
+	wave = encode_ima(blocks, &wavelen);
+	if ( wave ) {
+		errors += benchmark("IMA ADPCM", wave, wavelen, decode_ima, blocks,
+				    4 * CHANNELS + 1020 * CHANNELS, 2041);
+		free(wave);
+	}
+	blocks = (Uint32)seconds * RATE / 2036;
+	wave = encode_ms(blocks, &wavelen);
+	if ( wave ) {
+		errors += benchmark("MS ADPCM", wave, wavelen, decode_ms, blocks,
+				    7 * CHANNELS + 1017 * CHANNELS, 2036);
+		free(wave);
+	}
+
+	SDL_Quit();
+	return(errors ? 1 : 0);
+}